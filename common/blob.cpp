@@ -137,6 +137,9 @@ CBlob::Reset()
     left = top = 0x7fff;
     lastBottom.row = lastBottom.invalid_row;
     nextBottom.row = nextBottom.invalid_row;
+#ifndef PIXY
+    label= -1;
+#endif
 
     // Delete segments if any
     SLinkedSegment *tmp;
@@ -246,6 +249,9 @@ CBlobAssembler::CBlobAssembler()
     currentRow=-1;
     maxRowDelta=1;
     m_blobCount=0;
+#ifndef PIXY
+    labels=NULL;
+#endif
 }
 
 CBlobAssembler::~CBlobAssembler() 
@@ -296,6 +302,15 @@ int CBlobAssembler::Add(const SSegment &segment) {
                     CBlob *futileResister = currentBlob->next;
                     // Cut it out of the list
                     currentBlob->next = futileResister->next;
+#ifndef PIXY
+                    // Keep track of labels across the merge
+                    if (futileResister->label >= 0) {
+                        if (currentBlob->label < 0)
+                            currentBlob->label= futileResister->label;
+                        else if (labels)
+                            labels->links.push_back(std::make_pair(currentBlob->label, futileResister->label));
+                    }
+#endif
                     // Assimilate it's segments and moments
                     currentBlob->Assimilate(*(futileResister));
 
@@ -323,6 +338,10 @@ int CBlobAssembler::Add(const SSegment &segment) {
         return -1;
     }
     m_blobCount++;
+#ifndef PIXY
+    if (labels && segment.row == labels->labelRow)
+        newBlob->label= labels->nextLabel++;
+#endif
     newBlob->next= currentBlob;
     *previousBlobPtr= newBlob;
     previousBlobPtr= &newBlob->next;
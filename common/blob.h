@@ -56,6 +56,10 @@
 #include <assert.h>
 //#include <memory.h>
 #include <math.h>
+#ifndef PIXY
+#include <vector>
+#include <utility>
+#endif
 
 //#define INCLUDE_STATS
 
@@ -127,12 +131,13 @@ struct SMoments {
 };
 
 struct SSegment {
+    // wide enough for CAM_RES1 (640x400) q vals, still 6 bytes
     unsigned char  model    : 3 ; // which color channel
-    unsigned short row      : 9 ;
-    unsigned short startCol : 10; // inclusive
-    unsigned short endCol   : 10; // inclusive
+    unsigned short row      : 10;
+    unsigned short startCol : 11; // inclusive
+    unsigned short endCol   : 11; // inclusive
 
-    const static short invalid_row= 0x1ff;
+    const static short invalid_row= 0x3ff;
 
     // Sum 0^2 + 1^2 + 2^2 + ... + n^2 is (2n^3 + 3n^2 + n) / 6
     // Sum (a+1)^2 + (a+2)^2 ... b^2 is (2(b^3-a^3) + 3(b^2-a^2) + (b-a)) / 6
@@ -213,6 +218,12 @@ public:
 
     SMoments moments;
 
+#ifndef PIXY
+    // Label for following this blob across stripe seams (see SBlobLabels),
+    // -1 if none
+    int label;
+#endif
+
     static bool recordSegments;
     // Set to true for testing code only.  Very slow!
     static bool testMoments;
@@ -250,6 +261,18 @@ public:
     void UpdateBoundingBox(int newLeft, int newTop, int newRight);
 };
 
+#ifndef PIXY
+// Used when a frame is assembled in horizontal stripes (see StripeAssembler
+// in PixyMon).  Blobs started by a segment on labelRow get consecutive labels
+// beginning with nextLabel.  When a labeled blob is merged into another
+// labeled blob, the pair of labels is added to links.
+struct SBlobLabels {
+    short labelRow;
+    int nextLabel;
+    std::vector<std::pair<int, int> > links;
+};
+#endif
+
 // Strategy for using CBlobAssembler:
 //
 // Make one CBlobAssembler for each color channel.
@@ -290,6 +313,10 @@ public:
     CBlob *finishedBlobs;
     short maxRowDelta;
     static bool keepFinishedSorted;
+#ifndef PIXY
+    // NULL unless we're assembling a stripe
+    SBlobLabels *labels;
+#endif
 
 public:
     CBlobAssembler();
@@ -322,6 +349,13 @@ public:
     // Assert that finishedBlobs is in fact sorted.  For testing only.
     void AssertFinishedSorted();
 
+#ifndef PIXY
+    // Active blobs, for joining stripes
+    CBlob *GetActiveBlobs() {
+        return activeBlobs;
+    }
+#endif
+
 protected:
     // Manage currentBlob
     //
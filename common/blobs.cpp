@@ -14,6 +14,7 @@
 //
 
 #ifdef PIXY
+#include <string.h>
 #include "pixy_init.h"
 #include "misc.h"
 #else
@@ -35,12 +36,19 @@ Blobs::Blobs(Qqueue *qq)
     m_maxCodedDist = MAX_CODED_DIST;
 
     m_qq = qq;
+    m_wide = false;
+    m_qvalCopy = NULL;
+    m_qvalCopySize = 0;
+    m_qvalCopyLen = 0;
     m_blobs = new uint16_t[m_maxBlobs*5];
     m_numBlobs = 0;
     m_blobReadIndex = 0;
     m_endBlobs = m_blobs + m_maxBlobs*5 - 6;
 
 #ifdef PIXY
+    memset(m_stamps, 0, sizeof(m_stamps));
+    m_getBlockStamp = 0;
+    m_frameIndex = 0;
     m_clut = new ColorLUT((void *)LUT_MEMORY);
 #else
     m_lut = new uint8_t[CL_LUT_SIZE];
@@ -79,6 +87,36 @@ Blobs::~Blobs()
 // 4: bottom Y edge
 
 void Blobs::blobify()
+{
+#ifdef PIXY
+    // blocks of the last frame have been served (or not) by now
+    m_stamps[LAT_GETBLOCK] = m_getBlockStamp;
+    m_getBlockStamp = 0;
+#endif
+    unpack(); //mm as is clear in unpack(), at this point, we already know the model to which each blob belongs.
+    copyBlobs();
+#ifdef PIXY
+    setTimer(&m_stamps[LAT_BLOBIFY]);
+#endif
+}
+
+#ifndef PIXY
+// same as above, but the q vals come from memory instead of the queue
+void Blobs::blobify(const Qval *qvals, uint32_t numQvals)
+{
+    unpack(qvals, numQvals);
+    copyBlobs();
+}
+
+// same as above, but the segments have already been added to getAssemblers()
+void Blobs::blobifyAssembled()
+{
+    endFrame();
+    copyBlobs();
+}
+#endif
+
+void Blobs::copyBlobs()
 {
 	//mm not entirely sure yet, but I think this function might just "draw" the blobs, based on the color model of each pixel. the color model is already determined in the "packed" data (see unpack...color model information is extracted from the packed data there...)
 	
@@ -90,8 +128,6 @@ void Blobs::blobify()
     uint16_t left, top, right, bottom;
     //uint32_t timer, timer2=0;
 
-    unpack(); //mm as is clear in unpack(), at this point, we already know the model to which each blob belongs.
-
     // copy blobs into memory //mm does this refer to the unpack() above??
     invalid = 0;
 	
@@ -168,47 +204,120 @@ void Blobs::blobify()
 
 void Blobs::unpack()
 {
-    SSegment s;
     int32_t row;
     bool memfull;
     uint32_t i;
     Qval qval;
 
-    // q val:
-    // | 4 bits    | 7 bits      | 9 bits | 9 bits    | 3 bits |
-    // | shift val | shifted sum | length | begin col | model  |
-
     row = -1;
     memfull = false;
     i = 0;
+    if (m_qvalCopy)
+    {
+        m_qvalCopy[0] = m_wide ? QVAL_FRAME_START_WIDE : QVAL_FRAME_START;
+        m_qvalCopyLen = 1;
+    }
 
     while(1)
     {
         while (m_qq->dequeue(&qval)==0);
-        if (qval==0xffffffff)
+        // The start of the next frame ends this one.  It also tells us how the next frame
+        // is encoded.
+        if (QVAL_IS_FRAME_START(qval))
+        {
+            m_wide = qval==QVAL_FRAME_START_WIDE;
             break;
+        }
         i++;
-        if (qval==0)
+        if (m_qvalCopyLen<m_qvalCopySize)
+            m_qvalCopy[m_qvalCopyLen++] = qval;
+        addSegment(qval, &row, &memfull, i);
+    }
+    //cprintf("rows %d %d\n", row, i);
+    endFrame();
+#ifdef PIXY
+    // the M0 has finished this frame, it's started the next one
+    if (!m_qq->getStamp(m_frameIndex, &m_stamps[LAT_M0_START], &m_stamps[LAT_M0_END]))
+        m_stamps[LAT_M0_START] = m_stamps[LAT_M0_END] = 0;
+    m_frameIndex = m_qq->consumed()-1;
+    setTimer(&m_stamps[LAT_UNPACK]);
+#endif
+}
+
+#ifndef PIXY
+void Blobs::unpack(const Qval *qvals, uint32_t numQvals)
+{
+    int32_t row;
+    bool memfull;
+    uint32_t i;
+
+    row = -1;
+    memfull = false;
+    m_wide = false;
+
+    for (i=0; i<numQvals; i++)
+    {
+        if (QVAL_IS_FRAME_START(qvals[i]))
         {
-            row++;
+            // a start of frame at the beginning selects the encoding, anywhere else it ends the frame
+            if (i>0)
+                break;
+            m_wide = qvals[i]==QVAL_FRAME_START_WIDE;
             continue;
         }
-        s.model = qval&0x07;
-        if (s.model>0 && !memfull)
+        addSegment(qvals[i], &row, &memfull, i+1);
+    }
+    endFrame();
+}
+#endif
+
+bool Blobs::decode(Qval qval, bool wide, int32_t *row, SSegment *s)
+{
+    // see qqueue.h for the q val encodings
+
+    if (qval==0)
+    {
+        (*row)++;
+        return false;
+    }
+    s->model = qval&0x07;
+    if (s->model==0)
+        return false;
+    s->row = *row;
+    qval >>= 3;
+    if (wide)
+    {
+        s->startCol = qval&0x3ff;
+        qval >>= 10;
+        s->endCol = (qval&0x3ff) + s->startCol;
+    }
+    else
+    {
+        s->startCol = qval&0x1ff;
+        qval >>= 9;
+        s->endCol = (qval&0x1ff) + s->startCol;
+    }
+    return true;
+}
+
+void Blobs::addSegment(Qval qval, int32_t *row, bool *memfull, uint32_t i)
+{
+    SSegment s;
+
+    if (decode(qval, m_wide, row, &s) && !*memfull)
+    {
+        if (m_assembler[s.model-1].Add(s)<0)
         {
-            s.row = row;
-            qval >>= 3;
-            s.startCol = qval&0x1ff;
-            qval >>= 9;
-            s.endCol = (qval&0x1ff) + s.startCol;
-            if (m_assembler[s.model-1].Add(s)<0)
-            {
-                memfull = true;
-                cprintf("heap full %d\n", i);
-            }
+            *memfull = true;
+            cprintf("heap full %d\n", i);
         }
     }
-    //cprintf("rows %d %d\n", row, i);
+}
+
+void Blobs::endFrame()
+{
+    uint32_t i;
+
     // finish frame
     for (i=0; i<NUM_MODELS; i++)
     {
@@ -238,6 +347,10 @@ uint16_t Blobs::getBlock(uint8_t *buf, uint32_t buflen)
 
     if (m_blobReadIndex==0)	// beginning of frame, mark it with empty block
     {
+#ifdef PIXY
+        if (m_getBlockStamp==0)
+            setTimer(&m_getBlockStamp);
+#endif
         buf16[0] = BL_BEGIN_MARKER;
         len++;
         buf16++;
@@ -307,6 +420,26 @@ void Blobs::getBlobs(BlobA **blobs, uint32_t *len)
     *len = m_numBlobs;
 }
 
+void Blobs::setQvalCopy(Qval *qvals, uint32_t size)
+{
+    m_qvalCopy = qvals;
+    m_qvalCopySize = qvals ? size : 0;
+    m_qvalCopyLen = 0;
+}
+
+uint32_t Blobs::getQvalCopy(Qval **qvals)
+{
+    *qvals = m_qvalCopy;
+    return m_qvalCopyLen;
+}
+
+#ifdef PIXY
+void Blobs::getStamps(uint32_t *stamps)
+{
+    memcpy(stamps, m_stamps, sizeof(m_stamps));
+}
+#endif
+
 
 
 uint16_t Blobs::compress(uint16_t *blobs, uint16_t numBlobs)
@@ -39,9 +39,29 @@ public:
     Blobs(Qqueue *qq);
     ~Blobs();
     void blobify();
+#ifndef PIXY
+    void blobify(const Qval *qvals, uint32_t numQvals);
+    void blobifyAssembled();
+    // one assembler per model, for assembling outside of Blobs
+    CBlobAssembler *getAssemblers()
+    {
+        return m_assembler;
+    }
+#endif
+    // returns true if qval is a segment, keeps track of the row.  wide selects the
+    // CAM_RES1 encoding (QVAL_FRAME_START_WIDE frames).
+    static bool decode(Qval qval, bool wide, int32_t *row, SSegment *s);
     uint16_t getBlock(uint8_t *buf, uint32_t buflen);
     uint16_t *getMaxBlob(uint16_t signature=0);
     void getBlobs(BlobA **blobs, uint32_t *len);
+    // Keep a copy of the q vals blobify() unpacks from the queue, starting with the start of
+    // frame, up to size q vals (the rest aren't copied).  NULL stops copying.
+    void setQvalCopy(Qval *qvals, uint32_t size);
+    uint32_t getQvalCopy(Qval **qvals); // returns the number of q vals in the last frame
+#ifdef PIXY
+    // the last frame's stages, LAT_M0_START through LAT_GETBLOCK (see pixytypes.h)
+    void getStamps(uint32_t *stamps);
+#endif
 	int setParams(uint16_t maxBlobs, uint16_t maxBlobsPerModel, uint32_t minArea); 
 
     int generateLUT(uint8_t model, const Frame8 &frame, const RectA &region, ColorModel *pcmodel=NULL);
@@ -54,6 +74,12 @@ public:
 
 private:
     void unpack();
+#ifndef PIXY
+    void unpack(const Qval *qvals, uint32_t numQvals);
+#endif
+    void addSegment(Qval qval, int32_t *row, bool *memfull, uint32_t i);
+    void endFrame();
+    void copyBlobs();
     uint16_t combine(uint16_t *blobs, uint16_t numBlobs);
     uint16_t combine2(uint16_t *blobs, uint16_t numBlobs);
     uint16_t compress(uint16_t *blobs, uint16_t numBlobs);
@@ -73,7 +99,18 @@ private:
 	BlobB *m_codedBlobs;
 	uint16_t m_numCodedBlobs;
 
+    Qval *m_qvalCopy;
+    uint32_t m_qvalCopySize;
+    uint32_t m_qvalCopyLen;
+
+#ifdef PIXY
+    uint32_t m_stamps[LAT_DEVICE_STAGES];
+    uint32_t m_getBlockStamp; // first getBlock() since the last blobify()
+    uint16_t m_frameIndex; // where the start of frame being unpacked was in the queue
+#endif
+
     bool m_mutex;
+    bool m_wide; // q vals being unpacked use the wide encoding (set by the start of frame)
     uint16_t m_maxBlobs;
     uint16_t m_maxBlobsPerModel;
 
@@ -43,15 +43,47 @@ Chirp::Chirp(bool hinterested, bool client, Link *link)
     m_dataTimeout = CRP_DATA_TIMEOUT;
     m_idleTimeout = CRP_IDLE_TIMEOUT;
     m_sendTimeout = CRP_SEND_TIMEOUT;
+    m_pushTimeout = 0;
     m_call = false;
     m_connected = false;
     m_hinformer = false;
     m_hinterested = hinterested;
     m_client = client;
+    m_crcType = CRP_CRC_SUM;
+    m_window = 1;
+    m_windowMax = CRP_WINDOW;
+    m_crcTypeNext = CRP_CRC_SUM;
+    m_windowNext = 1;
+    m_maxPending = 0;
+    m_sendId = 0;
+    m_recvId = 0;
+    m_nextId = 0;
+#ifndef PIXY
+    m_pendingLen = 0;
+#endif
+    m_batchBuf = NULL;
+    m_batchSize = 0;
+    m_batchLen = 0;
+    m_batchDeadline = 0;
+    m_batchMax = 0;
+    m_batchArgs = NULL;
+    m_batchArgsLen = 0;
+    m_waiting = false;
 
     m_procTableSize = CRP_PROCTABLE_LEN;
+    m_procTableLen = 0;
     m_procTable = new (std::nothrow) ProcTableEntry[m_procTableSize];
     memset(m_procTable, 0, sizeof(ProcTableEntry)*m_procTableSize);
+    m_procHash = NULL;
+    m_procHashSize = 0;
+    rehashTable(m_procTableSize);
+#ifndef PIXY
+    m_remoteProcs = NULL;
+    m_remoteProcsSize = 0;
+    m_remoteProcsLen = 0;
+    m_remoteSignature = 0;
+    m_remoteTableLen = 0;
+#endif
 
     if (link)
         setLink(link);
@@ -59,15 +91,21 @@ Chirp::Chirp(bool hinterested, bool client, Link *link)
 
 Chirp::~Chirp()
 {
-    // if we're a client, disconnect (let server know)
-    if (m_client)
+    // if we're a client, disconnect (let server know), unless we never had a link (it didn't open)
+    if (m_client && m_link)
         remoteInit(false);
     if (!m_sharedMem)
     {
         restoreBuffer();
         delete[] m_buf;
     }
+    delete[] m_batchBuf;
     delete[] m_procTable;
+    delete[] m_procHash;
+#ifndef PIXY
+    clearRemote();
+    delete[] m_remoteProcs;
+#endif
 }
 
 int Chirp::init(bool connect)
@@ -131,6 +169,33 @@ int Chirp::assemble(uint8_t type, ...)
     return res;
 }
 
+int Chirp::assemble(ChirpWriter *writer)
+{
+    int res;
+    bool save = m_call;
+    uint32_t saveLen = m_len;
+
+    if (writer->m_type==CRP_XDATA)
+        m_call = false;
+
+    // writer has serialized args in m_buf, set length (don't include header)
+    if ((res=writer->len())>=0)
+    {
+        m_len = res - m_headerLen;
+        res = CRP_RES_OK;
+    }
+
+    if (writer->m_type==CRP_XDATA || (!m_call && res==CRP_RES_OK))
+    {
+        res = sendChirpRetry(CRP_XDATA, 0);
+        m_len = saveLen;
+    }
+
+    m_call = save;
+
+    return res;
+}
+
 int Chirp::vassemble(va_list *args)
 {
     int len;
@@ -151,6 +216,107 @@ bool Chirp::connected()
     return m_connected;
 }
 
+uint16_t Chirp::setPushTimeout(uint16_t timeoutMs)
+{
+    uint16_t prev = m_pushTimeout;
+
+    m_pushTimeout = timeoutMs;
+    return prev;
+}
+
+int Chirp::setBatch(uint32_t size, uint32_t deadline)
+{
+    flush();
+    delete[] m_batchBuf;
+    m_batchBuf = NULL;
+    m_batchSize = 0;
+    m_batchDeadline = deadline;
+    if (size==0)
+        return CRP_RES_OK;
+
+    // sendFull() always sends CRP_MAX_HEADER_LEN bytes, header included
+    if ((m_batchBuf=new (std::nothrow) uint8_t[size+CRP_MAX_HEADER_LEN])==NULL)
+        return CRP_RES_ERROR_MEMORY;
+    m_batchSize = size;
+
+    return CRP_RES_OK;
+}
+
+int Chirp::flush()
+{
+    int res;
+    uint8_t *buf, id;
+    uint32_t len, bufSize;
+
+    if (m_batchLen==0)
+        return CRP_RES_OK;
+
+    // send from the batch buffer, whatever is in m_buf is still to be sent
+    buf = m_buf;
+    bufSize = m_bufSize;
+    len = m_len;
+    id = m_sendId;
+    m_buf = m_batchBuf;
+    m_bufSize = m_batchSize+CRP_MAX_HEADER_LEN;
+    m_len = m_batchLen;
+    m_sendId = 0;
+    m_batchLen = 0;
+    res = sendChirpRetry(CRP_XDATA_BATCH, 0);
+    m_buf = buf;
+    m_bufSize = bufSize;
+    m_len = len;
+    m_sendId = id;
+
+    return res;
+}
+
+// add the XDATA chirp in m_buf to the batch
+int Chirp::batch()
+{
+    int res;
+    uint32_t len = m_len;
+    uint32_t size = m_batchSize<m_batchMax ? m_batchSize : m_batchMax;
+
+    ALIGN(len, 4);
+    if (m_batchLen+4+len>size && (res=flush())<0)
+        return res;
+    if (m_batchLen==0)
+        m_link->setTimer();
+    *(uint32_t *)(m_batchBuf+m_headerLen+m_batchLen) = m_len;
+    memcpy(m_batchBuf+m_headerLen+m_batchLen+4, m_buf+m_headerLen, m_len);
+    m_batchLen += 4+len;
+    if (m_link->getTimer()>=m_batchDeadline)
+        return flush();
+
+    return CRP_RES_OK;
+}
+
+// handle each chirp in the batch we just received as XDATA
+int Chirp::handleBatch()
+{
+    uint32_t i, len, batchLen = m_len;
+    uint8_t *buf = m_buf+m_headerLen;
+    void *args[CRP_MAX_ARGS+1];
+
+    // the rest of the batch is in m_buf, so the handler can't send or receive (same as with any
+    // XDATA, the args are only good until then), and the buffer can't be swapped
+    for (i=0; i+4<=batchLen; i+=len)
+    {
+        len = *(uint32_t *)(buf+i);
+        i += 4;
+        if (len>batchLen-i)
+            break;
+        m_batchArgs = buf+i;
+        m_batchArgsLen = len;
+        if (deserializeParse(buf+i, len, args)==CRP_RES_OK)
+            handleChirp(CRP_XDATA, 0, args);
+        ALIGN(len, 4);
+    }
+    m_batchArgs = NULL;
+
+    return CRP_RES_OK;
+}
+
 int Chirp::useBuffer(uint8_t *buf, uint32_t len)
 {
     int res;
@@ -183,6 +349,67 @@ void Chirp::restoreBuffer()
     }
 }
 
+#ifndef PIXY
+uint8_t *Chirp::swapBuffer(uint8_t *buf, uint32_t *size)
+{
+    uint8_t *prev;
+    uint32_t prevSize;
+
+    if (m_sharedMem || m_bufSave || m_batchArgs || *size<CRP_BUFSIZE)
+        return NULL;
+
+    prev = m_buf;
+    prevSize = m_bufSize;
+    m_buf = buf;
+    m_bufSize = *size;
+    *size = prevSize;
+
+    return prev;
+}
+
+uint8_t *Chirp::rawArgs(uint8_t type, uint32_t *len, uint8_t *id)
+{
+    if (m_batchArgs)
+    {
+        *len = m_batchArgsLen;
+        *id = 0;
+        return m_batchArgs;
+    }
+    // recvChirp() counts the space it made in front of responseInt
+    *len = type&CRP_RESPONSE ? m_len-4 : m_len;
+    *id = m_recvId;
+    return m_buf+m_headerLen;
+}
+
+uint8_t *Chirp::dataArgs(uint8_t type, uint32_t *len)
+{
+    uint8_t id;
+    uint8_t *args = rawArgs(type, len, &id);
+
+    // responseInt is 4-aligned, so what follows parses the same on its own
+    if ((type&CRP_RESPONSE) && !m_batchArgs)
+    {
+        *len -= 4;
+        args += 4;
+    }
+    return args;
+}
+
+int Chirp::sendRaw(uint8_t type, ChirpProc proc, uint8_t id, const uint8_t *args, uint32_t len)
+{
+    int res;
+
+    restoreBuffer();
+    if (len+m_headerLen>m_bufSize && (res=realloc(len+m_headerLen))<0)
+        return res;
+    if (args!=m_buf+m_headerLen)
+        memcpy(m_buf+m_headerLen, args, len);
+    m_len = len;
+    m_sendId = id;
+    return sendChirpRetry(type, proc);
+}
+#endif
+
 
 int Chirp::serialize(Chirp *chirp, uint8_t *buf, uint32_t bufSize, ...)
 {
@@ -349,6 +576,106 @@ int Chirp::vserialize(Chirp *chirp, uint8_t *buf, uint32_t bufSize, va_list *arg
 }
 
 
+ChirpWriter::ChirpWriter(Chirp *chirp, uint8_t type)
+{
+    m_type = type;
+    m_chirp = chirp;
+    m_error = 0;
+    m_hints = chirp->m_hinformer;
+    if (type==CRP_CALL)
+    {
+        // same as call()
+        chirp->m_len = 0;
+        chirp->restoreBuffer();
+    }
+    m_buf = chirp->m_buf;
+    m_bufSize = chirp->m_bufSize;
+    // reserve header, and responseint if we're returning (same as vserialize())
+    m_i = chirp->m_headerLen;
+    if (chirp->m_call && type!=CRP_XDATA)
+        m_i += 4;
+}
+
+ChirpWriter::ChirpWriter(Chirp *chirp, uint8_t *buf, uint32_t bufSize)
+{
+    m_type = 0;
+    m_chirp = NULL; // not our buffer, can't realloc
+    m_buf = buf;
+    m_bufSize = bufSize;
+    m_error = 0;
+    if (chirp)
+    {
+        m_hints = chirp->m_hinformer;
+        m_i = chirp->m_headerLen;
+        if (chirp->m_call)
+            m_i += 4;
+    }
+    else
+    {
+        m_hints = true;
+        m_i = 0;
+    }
+}
+
+ChirpWriter &ChirpWriter::operator<<(const char *s)
+{
+    uint32_t len = strlen(s)+1; // include null
+
+    if (reserve(len+1))
+    {
+        m_buf[m_i++] = CRP_STRING;
+        memcpy(m_buf+m_i, s, len);
+        m_i += len;
+    }
+    return *this;
+}
+
+ChirpWriter &ChirpWriter::skip(uint32_t len)
+{
+    if (reserve(len))
+        m_i += len;
+    return *this;
+}
+
+void ChirpWriter::putArray(uint8_t tag, uint32_t len, uint8_t size, const void *data)
+{
+    // type, alignment, length, alignment, data (if any)
+    if (!reserve(4+4+size+(data ? len*size : 0)))
+        return;
+    m_buf[m_i++] = tag;
+    ALIGN(m_i, 4);
+    m_buf[m_i-1] = tag;
+    *(uint32_t *)(m_buf+m_i) = len;
+    m_i += 4;
+    ALIGN(m_i, size);
+    if (data)
+    {
+        memcpy(m_buf+m_i, data, len*size);
+        m_i += len*size;
+    }
+}
+
+bool ChirpWriter::reserve(uint32_t size)
+{
+    int res;
+
+    if (m_error)
+        return false;
+    if (m_i+size<=m_bufSize-CRP_BUFPAD)
+        return true;
+    if (m_chirp==NULL)
+        res = CRP_RES_ERROR_MEMORY;
+    else if ((res=m_chirp->realloc(m_i+size))==CRP_RES_OK)
+    {
+        m_buf = m_chirp->m_buf;
+        m_bufSize = m_chirp->m_bufSize;
+        return true;
+    }
+    m_error = res;
+    return false;
+}
+
+
 // this isn't completely necessary, but it makes things a lot easier to use.
 // passing a pointer to a pointer and then having to dereference is just confusing....
 // so for scalars (ints, floats) you don't need to pass in ** pointers, just * pointers so
@@ -402,8 +729,7 @@ int Chirp::loadArgs(va_list *args, void *recvArgs[])
 
 int Chirp::call(uint8_t service, ChirpProc proc, ...)
 {
-    int res, i;
-    uint8_t type;
+    int res;
     va_list args;
 
     // if it's just a regular call (not init or enumerate), we need to be connected
@@ -415,52 +741,62 @@ int Chirp::call(uint8_t service, ChirpProc proc, ...)
     m_len = 0;
     // restore buffer in case it was changed
     restoreBuffer();
-    if ((res=vassemble(&args))<0)
-    {
-        va_end(args);
+    if ((res=vassemble(&args))==CRP_RES_OK)
+        res = vcall(service, proc, &args);
+    va_end(args);
+
+    return res;
+}
+
+int Chirp::callTyped(uint8_t service, ChirpProc proc, ChirpWriter *writer, ...)
+{
+    int res;
+    va_list args;
+
+    if (!(service&CRP_CALL) && !m_connected)
+        return CRP_RES_ERROR_NOT_CONNECTED;
+
+    // writer has assembled args in m_buf
+    if ((res=writer->len())<0)
         return res;
-    }
+    m_len = res - m_headerLen;
+
+    va_start(args, writer);
+    res = vcall(service, proc, &args);
+    va_end(args);
+
+    return res;
+}
+
+// send call in m_buf, wait for response and load result args
+int Chirp::vcall(uint8_t service, ChirpProc proc, va_list *args)
+{
+    int res, i;
+    uint8_t type, id;
+    void *recvArgs[CRP_MAX_ARGS+1];
 
     if (service&CRP_CALL) // special case for enumerate and init (internal calls)
     {
         type = service;
-        service = SYNC;
+        // older peers return fewer values from init, so let remoteInit() sort them out
+        service = type==CRP_CALL_INIT ? SYNC_RETURN_ARRAY : SYNC;
     }
     else
         type = CRP_CALL;
 
+    // regular calls get a request id (if the peer does them) so we can pick out our response
+    id = type==CRP_CALL && !(service&ASYNC) ? allocId() : 0;
+
     // send call data
+    m_sendId = id;
     if ((res=sendChirpRetry(type, proc))!=CRP_RES_OK) // convert call into response
-    {
-        va_end(args);
         return res;
-    }
-
 
     // if the service is synchronous, receive response while servicing other calls
     if (!(service&ASYNC))
     {
-        ChirpProc recvProc;
-        void *recvArgs[CRP_MAX_ARGS+1];
-        m_link->setTimer(); // set timer, so we can check to see if we're taking too much time
-
-        while(1)
-        {
-            if ((res=recvChirp(&type, &recvProc, recvArgs, true))==CRP_RES_OK)
-            {
-                if (type&CRP_RESPONSE)
-                    break;
-                else // handle calls as they come in
-                    handleChirp(type, recvProc, recvArgs);
-            }
-            else
-            {
-                va_end(args);
-                return res;
-            }
-            if (m_link->getTimer()>m_headerTimeout) // we could receive XDATA (for example) and never exit this while loop
-                return CRP_RES_ERROR_RECV_TIMEOUT;
-        }
+        if ((res=recvResponse(id, recvArgs))<0)
+            return res;
 
         // deal with args
         if (service&RETURN_ARRAY) // copy array of args
@@ -468,7 +804,7 @@ int Chirp::call(uint8_t service, ChirpProc proc, ...)
             void **recvArray;
             while(1)
             {
-                recvArray = va_arg(args, void **);
+                recvArray = va_arg(*args, void **);
                 if (recvArray!=NULL)
                     break;
             }
@@ -476,21 +812,203 @@ int Chirp::call(uint8_t service, ChirpProc proc, ...)
                 recvArray[i] = recvArgs[i];
             recvArray[i] = NULL;
         }
-        else if ((res=loadArgs(&args, recvArgs))<0)
-        {
-            va_end(args);
+        else if ((res=loadArgs(args, recvArgs))<0)
             return res;
+    }
+
+    return CRP_RES_OK;
+}
+
+// receive the response to the call with request id, handling calls and other responses in the meantime
+int Chirp::recvResponse(uint8_t id, void *args[])
+{
+    int res;
+    uint8_t type;
+    ChirpProc recvProc;
+    bool waiting = m_waiting;
+
+    m_waiting = true; // XDATA isn't batched while we have the timer
+    m_link->setTimer(); // set timer, so we can check to see if we're taking too much time
+    while(1)
+    {
+        if ((res=recvChirp(&type, &recvProc, args, true))<0)
+            break;
+        // if the peer doesn't do request ids, the first response is ours (nothing is pipelined)
+        if ((type&CRP_RESPONSE) && (m_maxPending==0 || m_recvId==id))
+        {
+            res = CRP_RES_OK;
+            break;
         }
+        dispatch(type, recvProc, args);
+        if (m_link->getTimer()>m_headerTimeout) // we could receive XDATA (for example) and never exit this while loop
+        {
+            res = CRP_RES_ERROR_RECV_TIMEOUT;
+            break;
+        }
+    }
+    m_waiting = waiting;
+
+    return res;
+}
+
+// handle something we received that we weren't waiting for
+void Chirp::dispatch(uint8_t type, ChirpProc proc, void *args[])
+{
+#ifndef PIXY
+    if ((type&CRP_RESPONSE) && handlePending(args))
+        return;
+#endif
+    handleChirp(type, proc, args);
+}
+
+uint8_t Chirp::allocId()
+{
+#ifndef PIXY
+    uint8_t i;
+#endif
+
+    if (m_maxPending==0)
+        return 0;
+    // 1 to 255, skipping ids that are outstanding
+    while(1)
+    {
+        if (++m_nextId==0)
+            m_nextId = 1;
+#ifndef PIXY
+        for (i=0; i<m_pendingLen && m_pending[i].id!=m_nextId; i++);
+        if (i<m_pendingLen)
+            continue;
+#endif
+        return m_nextId;
     }
+}
+
+#ifndef PIXY
+int Chirp::callPipelined(ChirpProc proc, ChirpCallback callback, void *data, ...)
+{
+    int res;
+    uint8_t id;
+    bool pipelined;
+    va_list args;
+    void *recvArgs[CRP_MAX_ARGS+1];
+
+    if (!m_connected)
+        return CRP_RES_ERROR_NOT_CONNECTED;
 
+    // The other end can't receive our next call while it's waiting for us to take its response,
+    // so we can only have calls outstanding if the link takes responses as they come.
+    // Without error correction each chirp waits for acks, so chirps can't cross either.
+    pipelined = m_maxPending && m_errorCorrected && (m_link->getFlags()&LINK_FLAG_BUFFERED_RECEIVE);
+    while (m_pendingLen && m_pendingLen>=m_maxPending)
+    {
+        if ((res=recvPending())<0)
+            return res;
+    }
 
+    va_start(args, data);
+    m_len = 0;
+    restoreBuffer();
+    res = vassemble(&args);
     va_end(args);
+    if (res<0)
+        return res;
+
+    id = allocId();
+    m_sendId = id;
+    if ((res=sendChirpRetry(CRP_CALL, proc))!=CRP_RES_OK)
+        return res;
+
+    if (!pipelined)
+    {
+        // one at a time, so just wait for the response
+        res = recvResponse(id, recvArgs);
+        (*callback)(data, res, res<0 ? NULL : recvArgs);
+        return res;
+    }
+
+    m_pending[m_pendingLen].id = id;
+    m_pending[m_pendingLen].callback = callback;
+    m_pending[m_pendingLen].data = data;
+    m_pendingLen++;
+
     return CRP_RES_OK;
 }
 
+int Chirp::waitPending()
+{
+    int res;
+
+    while (m_pendingLen)
+    {
+        if ((res=recvPending())<0)
+            return res;
+    }
+    return CRP_RES_OK;
+}
+
+int Chirp::getArgs(void *recvArgs[], ...)
+{
+    int res;
+    va_list args;
+
+    va_start(args, recvArgs);
+    res = loadArgs(&args, recvArgs);
+    va_end(args);
+
+    return res;
+}
+
+bool Chirp::handlePending(void *args[])
+{
+    uint8_t i;
+    ChirpPending pending;
+
+    for (i=0; i<m_pendingLen && m_pending[i].id!=m_recvId; i++);
+    if (i==m_pendingLen)
+        return false;
+
+    pending = m_pending[i];
+    m_pending[i] = m_pending[--m_pendingLen];
+    (*pending.callback)(pending.data, CRP_RES_OK, args);
+
+    return true;
+}
+
+// receive and handle one chirp while waiting for pipelined calls
+int Chirp::recvPending()
+{
+    int res;
+    uint8_t type;
+    ChirpProc recvProc;
+    void *args[CRP_MAX_ARGS+1];
+
+    if ((res=recvChirp(&type, &recvProc, args, true))<0)
+    {
+        // responses to outstanding calls are lost
+        failPending(res);
+        return res;
+    }
+    dispatch(type, recvProc, args);
+
+    return CRP_RES_OK;
+}
+
+void Chirp::failPending(int res)
+{
+    ChirpPending pending;
+
+    while (m_pendingLen)
+    {
+        pending = m_pending[--m_pendingLen];
+        (*pending.callback)(pending.data, res, NULL);
+    }
+}
+#endif
+
 int Chirp::sendChirpRetry(uint8_t type, ChirpProc proc)
 {
     int i, res=-1;
+    uint16_t timeout;
 
     if (!m_connected && !(type&CRP_INTRINSIC))
         return CRP_RES_ERROR_NOT_CONNECTED;
@@ -498,12 +1016,29 @@ int Chirp::sendChirpRetry(uint8_t type, ChirpProc proc)
     // but chirp calls can have no data of course
     if (m_len==0 && !(type&CRP_CALL))
         return CRP_RES_OK;
+    if (type==CRP_XDATA && m_batchSize && m_batchMax && !m_waiting &&
+            m_len+4<=(m_batchSize<m_batchMax ? m_batchSize : m_batchMax))
+        return batch();
+    // anything else goes after what's been batched
+    if (type!=CRP_XDATA_BATCH && (res=flush())<0)
+        return res;
+    if (type==CRP_XDATA && m_pushTimeout)
+    {
+        // one try, and failing doesn't mean we're disconnected (setPushTimeout())
+        timeout = m_sendTimeout;
+        m_sendTimeout = m_pushTimeout;
+        res = sendChirp(type, proc);
+        m_sendTimeout = timeout;
+        m_sendId = 0;
+        return res;
+    }
     for (i=0; i<m_retries; i++)
     {
         res = sendChirp(type, proc);
         if (res==CRP_RES_OK)
             break;
     }
+    m_sendId = 0; // request id is for this chirp only
 
     // if sending the chirp fails after retries, we should assume we're no longer connected
     if (res<0)
@@ -535,7 +1070,10 @@ int Chirp::handleChirp(uint8_t type, ChirpProc proc, void *args[])
 {
     int res;
     int32_t responseInt = 0;
-    uint8_t n;
+    uint8_t id = m_recvId; // the proc might receive something else before we respond
+
+    if (type==CRP_XDATA_BATCH)
+        return handleBatch();
 
     // default case, we return one integer (responseint)
     m_len = 4;
@@ -547,7 +1085,10 @@ int Chirp::handleChirp(uint8_t type, ChirpProc proc, void *args[])
         if (type==CRP_CALL_ENUMERATE)
             responseInt = handleEnumerate((char *)args[0], (ChirpProc *)args[1]);
         else if (type==CRP_CALL_INIT)
-            responseInt = handleInit((uint16_t *)args[0], (uint8_t *)args[1]);
+            responseInt = handleInit((uint16_t *)args[0], (uint8_t *)args[1], (uint8_t *)args[2],
+                                     args[2] ? (uint8_t *)args[3] : NULL,
+                                     args[2] && args[3] ? (uint8_t *)args[4] : NULL,
+                                     args[2] && args[3] && args[4] ? (uint16_t *)args[5] : NULL);
         else if (type==CRP_CALL_ENUMERATE_INFO)
             responseInt = handleEnumerateInfo((ChirpProc *)args[0]);
         else
@@ -564,54 +1105,94 @@ int Chirp::handleChirp(uint8_t type, ChirpProc proc, void *args[])
         if (proc>=m_procTableSize)
             return CRP_RES_ERROR; // index exceeded
 
-        ProcPtr ptr = m_procTable[proc].procPtr;
-        if (ptr==NULL)
+        if (m_procTable[proc].procPtr==NULL)
             return CRP_RES_ERROR; // some chirps are not meant to be called in both directions
 
-        // count args
-        for (n=0; args[n]!=NULL; n++);
-
         m_call = true; // indicate to ourselves that this is a chirp call
-        // this is probably overkill....
-        if (n==0)
-            responseInt = (*ptr)(this);
-        else if (n==1)
-            responseInt = (*(uint32_t(*)(void*,Chirp*))ptr)(args[0],this);
-        else if (n==2)
-            responseInt = (*(uint32_t(*)(void*,void*,Chirp*))ptr)(args[0],args[1],this);
-        else if (n==3)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],this);
-        else if (n==4)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],this);
-        else if (n==5)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],this);
-        else if (n==6)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],this);
-        else if (n==7)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],this);
-        else if (n==8)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7],this);
-        else if (n==9)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7],args[8],this);
-        else if (n==10)
-            responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7],args[8],args[9],this);
-        else
-            responseInt = CRP_RES_ERROR;
+        responseInt = invokeProc(proc, args);
         m_call = false;
     }
 
-    // if it's a chirp call, we need to send back the result
-    // result is in m_buf
-    if (type&CRP_CALL)
-    {
-        // write responseInt
-        *(uint32_t *)(m_buf+m_headerLen) = responseInt;
-        // send response
-        res = sendChirpRetry(CRP_RESPONSE | (type&~CRP_CALL), m_procTable[proc].chirpProc);	// convert call into response
-        restoreBuffer(); // restore buffer immediately!
-        if (res!=CRP_RES_OK) 
-            return res;
-    }
+    // if it's a chirp call, we need to send back the result
+    // result is in m_buf
+    if (type&CRP_CALL)
+    {
+        // write responseInt
+        *(uint32_t *)(m_buf+m_headerLen) = responseInt;
+        // send response with the call's request id
+        m_sendId = id;
+        res = sendChirpRetry(CRP_RESPONSE | (type&~CRP_CALL), m_procTable[proc].chirpProc);	// convert call into response
+        restoreBuffer(); // restore buffer immediately!
+        // init response is sent with the sum and stop-and-wait, switch to what we negotiated now
+        if (type==CRP_CALL_INIT)
+            setTransfer(m_crcTypeNext, m_windowNext);
+        if (res!=CRP_RES_OK) 
+            return res;
+    }
+
+    return CRP_RES_OK;
+}
+
+int32_t Chirp::invoke(ProcPtr ptr, void *args[])
+{
+    uint8_t n;
+    int32_t responseInt;
+
+    // count args
+    for (n=0; args[n]!=NULL; n++);
+
+    // this is probably overkill....
+    if (n==0)
+        responseInt = (*ptr)(this);
+    else if (n==1)
+        responseInt = (*(uint32_t(*)(void*,Chirp*))ptr)(args[0],this);
+    else if (n==2)
+        responseInt = (*(uint32_t(*)(void*,void*,Chirp*))ptr)(args[0],args[1],this);
+    else if (n==3)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],this);
+    else if (n==4)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],this);
+    else if (n==5)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],this);
+    else if (n==6)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],this);
+    else if (n==7)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],this);
+    else if (n==8)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7],this);
+    else if (n==9)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7],args[8],this);
+    else if (n==10)
+        responseInt = (*(uint32_t(*)(void*,void*,void*,void*,void*,void*,void*,void*,void*,void*,Chirp*))ptr)(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7],args[8],args[9],this);
+    else
+        responseInt = CRP_RES_ERROR;
+
+    return responseInt;
+}
+
+// call a proc in our table, bound or not
+int32_t Chirp::invokeProc(ChirpProc proc, void *args[])
+{
+#ifndef PIXY
+    if (m_procTable[proc].invoker)
+        return (*m_procTable[proc].invoker)(this, m_procTable[proc].procPtr, args);
+#endif
+    return invoke(m_procTable[proc].procPtr, args);
+}
+
+int Chirp::callLocal(ChirpProc proc, uint8_t *args, uint32_t len, int32_t *response)
+{
+    int res;
+    void *argv[CRP_MAX_ARGS+1];
+
+    if (proc<0 || proc>=m_procTableSize || m_procTable[proc].procPtr==NULL)
+        return CRP_RES_ERROR;
+    if ((res=deserializeParse(args, len, argv))!=CRP_RES_OK)
+        return res;
+
+    // m_call stays false, so what the proc returns goes out as XDATA
+    *response = invokeProc(proc, argv);
+    restoreBuffer(); // in case the proc used a buffer and didn't send it
 
     return CRP_RES_OK;
 }
@@ -626,6 +1207,12 @@ int Chirp::reallocTable()
     newProcTable = new (std::nothrow) ProcTableEntry[newProcTableSize];
     if (newProcTable==NULL)
         return CRP_RES_ERROR_MEMORY;
+    // bigger index to go with it
+    if (rehashTable(newProcTableSize)<0)
+    {
+        delete [] newProcTable;
+        return CRP_RES_ERROR_MEMORY;
+    }
     memset(newProcTable, 0, sizeof(ProcTableEntry)*newProcTableSize);
     // copy to new table
     memcpy(newProcTable, m_procTable, sizeof(ProcTableEntry)*m_procTableSize);
@@ -638,14 +1225,69 @@ int Chirp::reallocTable()
     return CRP_RES_OK;
 }
 
+// (re)build the index for a table of tableSize entries
+int Chirp::rehashTable(uint32_t tableSize)
+{
+    ChirpProc *newProcHash, proc;
+    uint32_t i, newProcHashSize;
+
+    for (newProcHashSize=1; newProcHashSize<2*tableSize; newProcHashSize<<=1);
+    newProcHash = new (std::nothrow) ChirpProc[newProcHashSize];
+    if (newProcHash==NULL)
+        return CRP_RES_ERROR_MEMORY;
+    for (i=0; i<newProcHashSize; i++)
+        newProcHash[i] = -1;
+    for (proc=0; proc<m_procTableLen; proc++)
+    {
+        for (i=hashName(m_procTable[proc].procName)&(newProcHashSize-1); newProcHash[i]>=0; i=(i+1)&(newProcHashSize-1));
+        newProcHash[i] = proc;
+    }
+    delete [] m_procHash;
+    m_procHash = newProcHash;
+    m_procHashSize = newProcHashSize;
+
+    return CRP_RES_OK;
+}
+
+// FNV-1a
+uint32_t Chirp::hashName(const char *procName)
+{
+    uint32_t hash;
+
+    for (hash=2166136261u; *procName; procName++)
+        hash = (hash^(uint8_t)*procName)*16777619;
+    return hash;
+}
+
+// identifies the names (and their order) in our table, so the remote side knows if its
+// cached proc indices are still good (see remoteInit())
+uint32_t Chirp::tableSignature()
+{
+    ChirpProc proc;
+    const char *s;
+    uint32_t hash;
+
+    for (proc=0, hash=2166136261u; proc<m_procTableLen; proc++)
+    {
+        for (s=m_procTable[proc].procName; true; s++)
+        {
+            hash = (hash^(uint8_t)*s)*16777619;
+            if (*s=='\0')
+                break;
+        }
+    }
+    return hash;
+}
+
 ChirpProc Chirp::lookupTable(const char *procName)
 {
-    ChirpProc i;
+    ChirpProc proc;
+    uint32_t i;
 
-    for(i=0; i<m_procTableSize; i++)
+    for (i=hashName(procName)&(m_procHashSize-1); (proc=m_procHash[i])>=0; i=(i+1)&(m_procHashSize-1))
     {
-        if (m_procTable[i].procName!=NULL && strcmp(m_procTable[i].procName, procName)==0)
-            return i;
+        if (strcmp(m_procTable[proc].procName, procName)==0)
+            return proc;
     }
     return -1;
 }
@@ -653,6 +1295,8 @@ ChirpProc Chirp::lookupTable(const char *procName)
 
 ChirpProc Chirp::updateTable(const char *procName, ProcPtr procPtr)
 {
+    uint32_t i;
+
     // if it exists already, update,
     // if it doesn't exist, add it
     if (procName==NULL)
@@ -661,17 +1305,19 @@ ChirpProc Chirp::updateTable(const char *procName, ProcPtr procPtr)
     ChirpProc proc = lookupTable(procName);
     if (proc<0) // next empty entry
     {
-        for (proc=0; proc<m_procTableSize && m_procTable[proc].procName; proc++);
-        if (proc==m_procTableSize)
-        {
-            reallocTable();
-            return updateTable(procName, procPtr);
-        }
+        if (m_procTableLen==m_procTableSize && reallocTable()<0)
+            return -1;
+        proc = m_procTableLen++;
+        for (i=hashName(procName)&(m_procHashSize-1); m_procHash[i]>=0; i=(i+1)&(m_procHashSize-1));
+        m_procHash[i] = proc;
     }
 
     // add to table
     m_procTable[proc].procName = procName;
     m_procTable[proc].procPtr = procPtr;
+#ifndef PIXY
+    m_procTable[proc].invoker = NULL; // bind() sets it after
+#endif
 
     return proc;
 }
@@ -683,6 +1329,11 @@ ChirpProc Chirp::getProc(const char *procName, ProcPtr callback)
 
     if (callback)
         cproc = updateTable(procName, callback);
+#ifndef PIXY
+    // the remote side needs to hear about callbacks, so only these come from the cache
+    else if ((cproc=lookupRemote(procName))>=0)
+        return cproc;
+#endif
 
     if (call(CRP_CALL_ENUMERATE, 0,
              STRING(procName), // send name
@@ -691,7 +1342,14 @@ ChirpProc Chirp::getProc(const char *procName, ProcPtr callback)
              &res, // get remote index
              END_IN_ARGS
              )>=0)
+    {
+#ifndef PIXY
+        // only cache procs that are covered by the remote table signature
+        if (callback==NULL && (ChirpProc)res>=0 && (ChirpProc)res<m_remoteTableLen)
+            cacheRemote(procName, res);
+#endif
         return res;
+    }
 
     // a negative ChirpProc is an error
     return -1;
@@ -700,22 +1358,57 @@ ChirpProc Chirp::getProc(const char *procName, ProcPtr callback)
 int Chirp::remoteInit(bool connect)
 {
     int res;
-    uint32_t responseInt;
-    uint8_t hinformer;
+    void *recvArgs[CRP_MAX_ARGS+1];
 
+#ifndef PIXY
+    // responses to outstanding calls won't be coming
+    failPending(CRP_RES_ERROR_NOT_CONNECTED);
+#endif
+    m_maxPending = 0;
+    m_batchMax = 0;
+    m_batchLen = 0; // what's batched was for the last connection
     res = call(CRP_CALL_INIT, 0,
                UINT16(connect ? m_blkSize : 0), // send block size
                UINT8(m_hinterested), // send whether we're interested in hints or not
+               UINT8(CRP_CRC_CAPS), // send which crcs we can do (older peers ignore this)
+               UINT8(m_windowMax), // send how many data chunks we can have outstanding (same)
+               UINT8(CRP_MAX_PENDING), // send how many calls we can have outstanding (same)
+               UINT16(m_sharedMem ? 0 : CRP_MAX_BATCH), // send how big a batch we take (same)
                END_OUT_ARGS,
-               &responseInt,
-               &hinformer,       // receive whether we should send hints
+               recvArgs,         // receive responseInt, whether we should send hints, crc type, window,
+                                 // signature and length of the remote proc table, max pending calls, max batch
                END_IN_ARGS
                );
     if (res>=0)
     {
+        if (recvArgs[0]==NULL || recvArgs[1]==NULL)
+            return CRP_RES_ERROR_PARSE;
         m_connected = connect;
-        m_hinformer = hinformer;
-        return responseInt;
+        // older peers don't do request ids
+        if (connect && recvArgs[2] && recvArgs[3] && recvArgs[4] && recvArgs[5] && recvArgs[6])
+        {
+            m_maxPending = *(uint8_t *)recvArgs[6];
+            // or batches, entries are 4-aligned, so the batch is too
+            if (recvArgs[7] && !m_sharedMem)
+                m_batchMax = (*(uint16_t *)recvArgs[7]<CRP_MAX_BATCH ? *(uint16_t *)recvArgs[7] : CRP_MAX_BATCH)&~3;
+        }
+        m_hinformer = *(uint8_t *)recvArgs[1];
+        // older peers don't send a crc type or window, so we stay with the sum and stop-and-wait
+        if (connect && recvArgs[2])
+            setTransfer(*(uint8_t *)recvArgs[2], recvArgs[3] ? *(uint8_t *)recvArgs[3] : 1);
+        else
+            setTransfer(CRP_CRC_SUM, 1);
+#ifndef PIXY
+        // the procs we've looked up are still good if the remote table is the same
+        if (connect && !(recvArgs[2] && recvArgs[3] && recvArgs[4] && recvArgs[5] &&
+                         *(uint32_t *)recvArgs[4]==m_remoteSignature && *(uint16_t *)recvArgs[5]==m_remoteTableLen))
+        {
+            clearRemote();
+            m_remoteSignature = recvArgs[2] && recvArgs[3] && recvArgs[4] && recvArgs[5] ? *(uint32_t *)recvArgs[4] : 0;
+            m_remoteTableLen = m_remoteSignature ? *(uint16_t *)recvArgs[5] : 0;
+        }
+#endif
+        return *(int32_t *)recvArgs[0];
     }
     return res;
 }
@@ -750,6 +1443,31 @@ int Chirp::setProc(const char *procName, ProcPtr proc, ProcTableExtension *exten
     return CRP_RES_OK;
 }
 
+#ifndef PIXY
+static int32_t invokeBound0(Chirp *chirp, ProcPtr fn, void *args[])
+{
+    if (args[0])
+        return CRP_RES_ERROR;
+    return (*fn)(chirp);
+}
+
+int Chirp::bind(const char *procName, ProcPtr fn, ProcTableExtension *extension)
+{
+    return setInvoker(procName, fn, invokeBound0, extension);
+}
+
+int Chirp::setInvoker(const char *procName, ProcPtr fn, ChirpInvoker invoker, ProcTableExtension *extension)
+{
+    ChirpProc cProc = updateTable(procName, fn);
+    if (cProc<0)
+        return CRP_RES_ERROR;
+
+    m_procTable[cProc].extension = extension;
+    m_procTable[cProc].invoker = invoker;
+    return CRP_RES_OK;
+}
+#endif
+
 int Chirp::registerModule(const ProcModule *module)
 {
     int i;
@@ -760,28 +1478,134 @@ int Chirp::registerModule(const ProcModule *module)
     return CRP_RES_OK;
 }
 
+#ifndef PIXY
+ChirpProc Chirp::lookupRemote(const char *procName)
+{
+    uint32_t i;
+
+    if (m_remoteProcsLen==0)
+        return -1;
+    for (i=hashName(procName)&(m_remoteProcsSize-1); m_remoteProcs[i].procName; i=(i+1)&(m_remoteProcsSize-1))
+    {
+        if (strcmp(m_remoteProcs[i].procName, procName)==0)
+            return m_remoteProcs[i].proc;
+    }
+    return -1;
+}
+
+void Chirp::cacheRemote(const char *procName, ChirpProc proc)
+{
+    RemoteProcEntry *newRemoteProcs;
+    uint32_t i, j, newRemoteProcsSize;
+
+    // keep it at most half full
+    if ((m_remoteProcsLen+1)*2>m_remoteProcsSize)
+    {
+        newRemoteProcsSize = m_remoteProcsSize ? m_remoteProcsSize*2 : CRP_PROCTABLE_LEN*2;
+        newRemoteProcs = new (std::nothrow) RemoteProcEntry[newRemoteProcsSize];
+        if (newRemoteProcs==NULL)
+            return;
+        memset(newRemoteProcs, 0, sizeof(RemoteProcEntry)*newRemoteProcsSize);
+        for (j=0; j<m_remoteProcsSize; j++)
+        {
+            if (m_remoteProcs[j].procName==NULL)
+                continue;
+            for (i=hashName(m_remoteProcs[j].procName)&(newRemoteProcsSize-1); newRemoteProcs[i].procName; i=(i+1)&(newRemoteProcsSize-1));
+            newRemoteProcs[i] = m_remoteProcs[j];
+        }
+        delete [] m_remoteProcs;
+        m_remoteProcs = newRemoteProcs;
+        m_remoteProcsSize = newRemoteProcsSize;
+    }
+
+    for (i=hashName(procName)&(m_remoteProcsSize-1); m_remoteProcs[i].procName; i=(i+1)&(m_remoteProcsSize-1))
+    {
+        if (strcmp(m_remoteProcs[i].procName, procName)==0)
+        {
+            m_remoteProcs[i].proc = proc;
+            return;
+        }
+    }
+    m_remoteProcs[i].procName = new (std::nothrow) char[strlen(procName)+1];
+    if (m_remoteProcs[i].procName==NULL)
+        return;
+    strcpy(m_remoteProcs[i].procName, procName);
+    m_remoteProcs[i].proc = proc;
+    m_remoteProcsLen++;
+}
+
+void Chirp::clearRemote()
+{
+    uint32_t i;
+
+    for (i=0; i<m_remoteProcsSize; i++)
+    {
+        delete [] m_remoteProcs[i].procName;
+        m_remoteProcs[i].procName = NULL;
+    }
+    m_remoteProcsLen = 0;
+}
+#endif
+
 int32_t Chirp::handleEnumerate(char *procName, ChirpProc *callback)
 {
     ChirpProc proc;
     // lookup in table
     proc = lookupTable(procName);
     // set remote index in table
-    m_procTable[proc].chirpProc = *callback;
+    if (proc>=0)
+        m_procTable[proc].chirpProc = *callback;
 
     return proc;
 }
 
-int32_t Chirp::handleInit(uint16_t *blkSize, uint8_t *hinformer)
+int32_t Chirp::handleInit(uint16_t *blkSize, uint8_t *hinformer, uint8_t *crcCaps, uint8_t *window, uint8_t *maxPending, uint16_t *batchMax)
 {
     int32_t responseInt;
+    uint8_t caps;
 
     bool connect = *blkSize ? true : false;
     responseInt = init(connect);
     m_connected = connect;
     m_blkSize = *blkSize;  // get block size, write it
     m_hinformer = *hinformer;
+    m_batchMax = 0;
+    m_batchLen = 0; // the other end has started over
 
-    CRP_RETURN(this, UINT8(m_hinterested), END);
+    if (crcCaps==NULL) // older peer, it doesn't know about crcs and doesn't expect a crc type back
+    {
+        m_crcTypeNext = CRP_CRC_SUM;
+        m_windowNext = 1;
+        CRP_RETURN(this, UINT8(m_hinterested), END);
+    }
+    else
+    {
+        // pick the best crc we can both do
+        caps = connect ? *crcCaps&CRP_CRC_CAPS : 0;
+        if (caps&CRP_CRC32)
+            m_crcTypeNext = CRP_CRC32;
+        else if (caps&CRP_CRC16)
+            m_crcTypeNext = CRP_CRC16;
+        else
+            m_crcTypeNext = CRP_CRC_SUM;
+        // smaller of the two windows
+        if (connect && window && *window>1)
+            m_windowNext = *window<m_windowMax ? *window : m_windowMax;
+        else
+            m_windowNext = 1;
+        // we always echo request ids, so we just let the caller know how many it can have outstanding
+        if (connect && maxPending)
+            m_maxPending = *maxPending<CRP_MAX_PENDING ? *maxPending : CRP_MAX_PENDING;
+        else
+            m_maxPending = 0;
+        // we can batch what we send if the caller takes batches, and it can batch if we do
+        // (a multiple of 4, entries are 4-aligned)
+        if (connect && batchMax && !m_sharedMem)
+            m_batchMax = (*batchMax<CRP_MAX_BATCH ? *batchMax : CRP_MAX_BATCH)&~3;
+        CRP_RETURN(this, UINT8(m_hinterested), UINT8(m_crcTypeNext), UINT8(m_windowNext),
+                   UINT32(tableSignature()), UINT16(m_procTableLen), UINT8(m_maxPending),
+                   UINT16(m_sharedMem ? 0 : CRP_MAX_BATCH), END);
+    }
 
     return responseInt;
 }
@@ -838,10 +1662,13 @@ int Chirp::service(bool all)
     ChirpProc recvProc;
     void *args[CRP_MAX_ARGS+1];
 
+    if (m_batchLen && m_link->getTimer()>=m_batchDeadline)
+        flush();
+
     for (i=0; true; i++)
     {
         if (recvChirp(&type, &recvProc, args)==CRP_RES_OK)
-            handleChirp(type, recvProc, args);
+            dispatch(type, recvProc, args);
         else
             break;
         if (!all)
@@ -883,6 +1710,13 @@ int Chirp::recvChirp(uint8_t *type, ChirpProc *proc, void *args[], bool wait) //
     if (res!=CRP_RES_OK)
         return res;
 
+    // handleChirp() unpacks batches
+    if (*type==CRP_XDATA_BATCH)
+    {
+        args[0] = NULL;
+        return CRP_RES_OK;
+    }
+
     // get responseInt from response
     if (*type&CRP_RESPONSE)
     {
@@ -966,10 +1800,10 @@ int Chirp::getArgList(uint8_t *buf, uint32_t len, uint8_t *argList)
 
 int Chirp::deserializeParse(uint8_t *buf, uint32_t len, void *args[])
 {
-    uint8_t dataType, size, a;
-    uint32_t i;
+    uint8_t dataType, size, a, *end;
+    uint32_t i, n;
 
-    // parse remaining args
+    // parse remaining args, each has to be all there (buf might be from a file, or garbled)
     for(i=0, a=0; i<len; a++)
     {
         if (a==CRP_MAX_ARGS)
@@ -979,26 +1813,39 @@ int Chirp::deserializeParse(uint8_t *buf, uint32_t len, void *args[])
         size = dataType&0x0f;
         if (!(dataType&CRP_ARRAY)) // if we're a scalar
         {
+            if (size==0)
+                return CRP_RES_ERROR;
             ALIGN(i, size);
+            if (i+size>len)
+                return CRP_RES_ERROR;
             args[a] = (void *)(buf+i);
-            i += dataType&0x0f; // extract size of scalar, add it
+            i += size; // extract size of scalar, add it
         }
         else // we're an array
         {
             if (dataType==CRP_STRING || dataType==CRP_HSTRING) // string is a special case
             {
+                if ((end=(uint8_t *)memchr(buf+i, '\0', len-i))==NULL)
+                    return CRP_RES_ERROR;
                 args[a] = (void *)(buf+i);
-                i += strlen((char *)(buf+i))+1; // +1 include null character
+                i = end-buf+1; // +1 include null character
             }
             else
             {
+                // the length and the array take 2 args
+                if (size==0 || a+1==CRP_MAX_ARGS)
+                    return CRP_RES_ERROR;
                 ALIGN(i, 4);
-                uint32_t len = *(uint32_t *)(buf+i);
+                if (i+4>len)
+                    return CRP_RES_ERROR;
+                n = *(uint32_t *)(buf+i);
                 args[a++] = (void *)(buf+i);
                 i += 4;
                 ALIGN(i, size);
+                if (i>len || n>(len-i)/size)
+                    return CRP_RES_ERROR;
                 args[a] = (void *)(buf+i);
-                i += len*size;
+                i += n*size;
             }
         }
     }
@@ -1024,6 +1871,144 @@ uint16_t Chirp::calcCrc(uint8_t *buf, uint32_t len)
     return crc;
 }
 
+#ifdef PIXY
+// nibble table for CRC-16, poly 0x1021, small enough for the device
+static const uint16_t g_crc16Table[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+// CRC-16/GENIBUS (init 0xffff, xor out 0xffff), pass the previous result in crc to continue
+uint16_t Chirp::calcCrc16(const uint8_t *buf, uint32_t len, uint16_t crc)
+{
+    uint32_t i;
+
+    crc = ~crc;
+    for (i=0; i<len; i++)
+    {
+        crc = (crc<<4) ^ g_crc16Table[(crc>>12) ^ (buf[i]>>4)];
+        crc = (crc<<4) ^ g_crc16Table[(crc>>12) ^ (buf[i]&0x0f)];
+    }
+    return ~crc;
+}
+#else
+static uint16_t g_crc16Table[8][256];
+static uint32_t g_crc32Table[16][256];
+
+// The tables are built during static initialization, before any thread can call calcCrc16() or calcCrc32().
+static struct CrcTables
+{
+    CrcTables();
+} g_crcTablesInit;
+
+CrcTables::CrcTables()
+{
+    uint32_t i, j, c;
+
+    for (i=0; i<256; i++)
+    {
+        for (j=0, c=i<<8; j<8; j++)
+            c = c&0x8000 ? (c<<1) ^ 0x1021 : c<<1;
+        g_crc16Table[0][i] = c;
+        for (j=0, c=i; j<8; j++)
+            c = c&1 ? (c>>1) ^ 0xedb88320 : c>>1;
+        g_crc32Table[0][i] = c;
+    }
+    for (i=0; i<256; i++)
+    {
+        for (j=1, c=g_crc16Table[0][i]; j<8; j++)
+        {
+            c = ((c<<8) ^ g_crc16Table[0][c>>8])&0xffff;
+            g_crc16Table[j][i] = c;
+        }
+        for (j=1, c=g_crc32Table[0][i]; j<16; j++)
+        {
+            c = (c>>8) ^ g_crc32Table[0][c&0xff];
+            g_crc32Table[j][i] = c;
+        }
+    }
+}
+
+// CRC-16/GENIBUS (init 0xffff, xor out 0xffff), pass the previous result in crc to continue.
+// Slicing-by-8 like calcCrc32(), the device uses a nibble table instead.
+uint16_t Chirp::calcCrc16(const uint8_t *buf, uint32_t len, uint16_t crc)
+{
+    crc = ~crc;
+    for (; len>=8; len-=8, buf+=8)
+    {
+        crc = g_crc16Table[7][(crc>>8) ^ buf[0]] ^ g_crc16Table[6][(crc&0xff) ^ buf[1]] ^
+                g_crc16Table[5][buf[2]] ^ g_crc16Table[4][buf[3]] ^
+                g_crc16Table[3][buf[4]] ^ g_crc16Table[2][buf[5]] ^
+                g_crc16Table[1][buf[6]] ^ g_crc16Table[0][buf[7]];
+    }
+    for (; len; len--, buf++)
+        crc = (crc<<8) ^ g_crc16Table[0][(crc>>8) ^ *buf];
+    return ~crc;
+}
+
+// CRC-32 (same as zlib's crc32()), pass the previous result in crc to continue.
+// Slicing-by-16: 16 bytes per step with 16 independent table lookups, no slower than calcCrc().
+uint32_t Chirp::calcCrc32(const uint8_t *buf, uint32_t len, uint32_t crc)
+{
+    uint32_t a, b, c, d;
+
+    crc = ~crc;
+    for (; len>=16; len-=16, buf+=16)
+    {
+        a = crc ^ ((uint32_t)buf[0] | ((uint32_t)buf[1]<<8) | ((uint32_t)buf[2]<<16) | ((uint32_t)buf[3]<<24));
+        b = (uint32_t)buf[4] | ((uint32_t)buf[5]<<8) | ((uint32_t)buf[6]<<16) | ((uint32_t)buf[7]<<24);
+        c = (uint32_t)buf[8] | ((uint32_t)buf[9]<<8) | ((uint32_t)buf[10]<<16) | ((uint32_t)buf[11]<<24);
+        d = (uint32_t)buf[12] | ((uint32_t)buf[13]<<8) | ((uint32_t)buf[14]<<16) | ((uint32_t)buf[15]<<24);
+        crc = g_crc32Table[15][a&0xff] ^ g_crc32Table[14][(a>>8)&0xff] ^
+                g_crc32Table[13][(a>>16)&0xff] ^ g_crc32Table[12][a>>24] ^
+                g_crc32Table[11][b&0xff] ^ g_crc32Table[10][(b>>8)&0xff] ^
+                g_crc32Table[9][(b>>16)&0xff] ^ g_crc32Table[8][b>>24] ^
+                g_crc32Table[7][c&0xff] ^ g_crc32Table[6][(c>>8)&0xff] ^
+                g_crc32Table[5][(c>>16)&0xff] ^ g_crc32Table[4][c>>24] ^
+                g_crc32Table[3][d&0xff] ^ g_crc32Table[2][(d>>8)&0xff] ^
+                g_crc32Table[1][(d>>16)&0xff] ^ g_crc32Table[0][d>>24];
+    }
+    for (; len; len--, buf++)
+        crc = (crc>>8) ^ g_crc32Table[0][(crc^*buf)&0xff];
+    return ~crc;
+}
+#endif
+
+void Chirp::setWindow(uint8_t window)
+{
+    if (window<1)
+        m_windowMax = 1;
+    else if (window>CRP_MAX_WINDOW)
+        m_windowMax = CRP_MAX_WINDOW;
+    else
+        m_windowMax = window;
+}
+
+void Chirp::setTransfer(uint8_t crcType, uint8_t window)
+{
+    // don't use something we can't do
+    m_crcType = crcType&CRP_CRC_CAPS ? crcType : CRP_CRC_SUM;
+    if (window<1)
+        m_window = 1;
+    else if (window>m_windowMax)
+        m_window = m_windowMax;
+    else
+        m_window = window;
+}
+
+// checksum for sendHeader(), recvHeader(), sendData() and recvData(), pass the previous result in crc to continue
+uint32_t Chirp::checksum(uint8_t crcType, const uint8_t *buf, uint32_t len, uint32_t crc)
+{
+    if (crcType==CRP_CRC16)
+        return calcCrc16(buf, len, crc);
+#ifndef PIXY
+    if (crcType==CRP_CRC32)
+        return calcCrc32(buf, len, crc);
+#endif
+    return (uint16_t)(crc + calcCrc((uint8_t *)buf, len));
+}
+
 
 int Chirp::sendFull(uint8_t type, ChirpProc proc)
 {
@@ -1031,6 +2016,7 @@ int Chirp::sendFull(uint8_t type, ChirpProc proc)
 
     *(uint32_t *)m_buf = CRP_START_CODE;
     *(uint8_t *)(m_buf+4) = type;
+    *(uint8_t *)(m_buf+5) = m_sendId;
     *(ChirpProc *)(m_buf+6) = proc;
     *(uint32_t *)(m_buf+8) = m_len;
     // send header
@@ -1049,29 +2035,35 @@ int Chirp::sendHeader(uint8_t type, ChirpProc proc)
 {
     int res;
     bool ack;
-    uint32_t chunk, startCode = CRP_START_CODE;
-    uint16_t crc;
+    uint32_t chunk, crc, startCode = CRP_START_CODE;
+
+    // init is always sent with the sum and stop-and-wait (the other end might not know about them,
+    // or it might have restarted)
+    if (type==CRP_CALL_INIT)
+        setTransfer(CRP_CRC_SUM, 1);
 
     if ((res=m_link->send((uint8_t *)&startCode, 4, m_sendTimeout))<0)
         return res;
 
     *(uint8_t *)m_buf = type;
+    *(uint8_t *)(m_buf+1) = m_sendId;
     *(uint16_t *)(m_buf+2) = proc;
     *(uint32_t *)(m_buf+4) = m_len;
     if ((res=m_link->send(m_buf, m_headerLen, m_sendTimeout))<0)
         return res;
-    crc = calcCrc(m_buf, m_headerLen);
+    crc = checksum(m_crcType, m_buf, m_headerLen);
 
-    if (m_len>=CRP_MAX_HEADER_LEN)
-        chunk = CRP_MAX_HEADER_LEN;
+    // same size first chunk as recvHeader()
+    if (m_len>=CRP_MAX_HEADER_LEN-m_headerLen)
+        chunk = CRP_MAX_HEADER_LEN-m_headerLen;
     else
         chunk = m_len;
-    if (m_link->send(m_buf, chunk, m_sendTimeout)<0)
+    if (m_link->send(m_buf+m_headerLen, chunk, m_sendTimeout)<0)
         return CRP_RES_ERROR_SEND_TIMEOUT;
 
     // send crc
-    crc += calcCrc(m_buf, chunk);
-    if (m_link->send((uint8_t *)&crc, 2, m_sendTimeout)<0)
+    crc = checksum(m_crcType, m_buf+m_headerLen, chunk, crc);
+    if (m_link->send((uint8_t *)&crc, CRP_CRC_LEN(m_crcType), m_sendTimeout)<0)
         return CRP_RES_ERROR_SEND_TIMEOUT;
 
     if ((res=recvAck(&ack, m_headerTimeout))<0)
@@ -1087,12 +2079,14 @@ int Chirp::sendHeader(uint8_t type, ChirpProc proc)
 
 int Chirp::sendData()
 {
-    uint16_t crc;
-    uint32_t chunk;
+    uint32_t chunk, crc;
     uint8_t sequence;
     bool ack;
     int res;
 
+    if (m_window>1)
+        return sendDataWindow();
+
     for (sequence=0; m_offset<m_len; )
     {
         if (m_len-m_offset>=m_blkSize)
@@ -1100,14 +2094,15 @@ int Chirp::sendData()
         else
             chunk = m_len-m_offset;
         // send data
-        if (m_link->send(m_buf+m_offset, chunk, m_sendTimeout)<0)
+        if (m_link->send(m_buf+m_headerLen+m_offset, chunk, m_sendTimeout)<0)
             return CRP_RES_ERROR_SEND_TIMEOUT;
         // send sequence
         if (m_link->send((uint8_t *)&sequence, 1, m_sendTimeout)<0)
             return CRP_RES_ERROR_SEND_TIMEOUT;
         // send crc
-        crc = calcCrc(m_buf+m_offset, chunk) + calcCrc((uint8_t *)&sequence, 1);
-        if (m_link->send((uint8_t *)&crc, 2, m_sendTimeout)<0)
+        crc = checksum(m_crcType, m_buf+m_headerLen+m_offset, chunk);
+        crc = checksum(m_crcType, &sequence, 1, crc);
+        if (m_link->send((uint8_t *)&crc, CRP_CRC_LEN(m_crcType), m_sendTimeout)<0)
             return CRP_RES_ERROR_SEND_TIMEOUT;
 
         if ((res=recvAck(&ack, m_dataTimeout))<0)
@@ -1121,6 +2116,90 @@ int Chirp::sendData()
     return CRP_RES_OK;
 }
 
+// Windowed version of sendData(), up to m_window chunks are sent before we wait for an ack.
+// The receiver acks (or nacks) every frame in the order it receives them, so each ack belongs to
+// the oldest frame in flight, and only the nacked chunks are sent again.  Every frame is m_blkSize
+// bytes (the last chunk is padded), so the receiver doesn't need to know which chunk is next.
+int Chirp::sendDataWindow()
+{
+    int res;
+    bool ack;
+    uint32_t chunks, base, next, c;
+    uint32_t inflight[CRP_MAX_WINDOW], retrans[CRP_MAX_WINDOW]; // fifos
+    uint8_t inflightIndex, inflightLen, retransIndex, retransLen;
+    bool acked[CRP_MAX_WINDOW];
+
+    chunks = (m_len-m_offset+m_blkSize-1)/m_blkSize;
+    memset(acked, 0, sizeof(acked));
+    inflightIndex = inflightLen = retransIndex = retransLen = 0;
+
+    // base is the oldest chunk that hasn't been acked, next is the next new chunk
+    for (base=next=0; base<chunks; )
+    {
+        // fill the window, retransmits first
+        while (inflightLen<m_window)
+        {
+            if (retransLen)
+            {
+                c = retrans[retransIndex];
+                retransIndex = (retransIndex+1)%CRP_MAX_WINDOW;
+                retransLen--;
+            }
+            else if (next<chunks && next<base+m_window)
+                c = next++;
+            else
+                break;
+            if ((res=sendFrame(c))<0)
+                return res;
+            inflight[(inflightIndex+inflightLen++)%CRP_MAX_WINDOW] = c;
+        }
+
+        if ((res=recvAck(&ack, m_dataTimeout))<0)
+            return res;
+        c = inflight[inflightIndex];
+        inflightIndex = (inflightIndex+1)%CRP_MAX_WINDOW;
+        inflightLen--;
+        if (ack)
+        {
+            acked[c%CRP_MAX_WINDOW] = true;
+            for (; base<next && acked[base%CRP_MAX_WINDOW]; base++)
+                acked[base%CRP_MAX_WINDOW] = false;
+        }
+        else
+            retrans[(retransIndex+retransLen++)%CRP_MAX_WINDOW] = c;
+    }
+    m_offset = m_len;
+
+    return CRP_RES_OK;
+}
+
+int Chirp::sendFrame(uint32_t chunk)
+{
+    static const uint8_t pad[16] = {0};
+    uint32_t offset, len, n, crc;
+    uint8_t sequence = chunk;
+
+    offset = m_offset + chunk*m_blkSize;
+    len = m_len-offset<m_blkSize ? m_len-offset : m_blkSize;
+    if (m_link->send(m_buf+m_headerLen+offset, len, m_sendTimeout)<0)
+        return CRP_RES_ERROR_SEND_TIMEOUT;
+    crc = checksum(m_crcType, m_buf+m_headerLen+offset, len);
+    for (; len<m_blkSize; len+=n)
+    {
+        n = m_blkSize-len<sizeof(pad) ? m_blkSize-len : sizeof(pad);
+        if (m_link->send(pad, n, m_sendTimeout)<0)
+            return CRP_RES_ERROR_SEND_TIMEOUT;
+        crc = checksum(m_crcType, pad, n, crc);
+    }
+    if (m_link->send(&sequence, 1, m_sendTimeout)<0)
+        return CRP_RES_ERROR_SEND_TIMEOUT;
+    crc = checksum(m_crcType, &sequence, 1, crc);
+    if (m_link->send((uint8_t *)&crc, CRP_CRC_LEN(m_crcType), m_sendTimeout)<0)
+        return CRP_RES_ERROR_SEND_TIMEOUT;
+
+    return CRP_RES_OK;
+}
+
 int Chirp::sendAck(bool ack) // false=nack
 {
     uint8_t c;
@@ -1139,48 +2218,60 @@ int Chirp::sendAck(bool ack) // false=nack
 int Chirp::recvHeader(uint8_t *type, ChirpProc *proc, bool wait)
 {
     int res;
-    uint8_t c;
-    uint32_t chunk, startCode = 0;
-    uint16_t crc, rcrc;
-
-    if ((res=m_link->receive(&c, 1, wait?m_headerTimeout:0))<0)
-        return res;
-    if (res<1)
-        return CRP_RES_ERROR;
+    uint8_t c, crcType, crcLen;
+    uint32_t chunk, crc, rcrc, startCode = CRP_START_CODE;
 
-    // find start code
-    while(1)
+    // find start code, all at once (with the header behind it) if the link can
+    if ((res=m_link->skipTo((uint8_t *)&startCode, 4, m_headerLen, wait?m_headerTimeout:0))==LINK_RESULT_ERROR)
     {
-        startCode >>= 8;
-        startCode |= (uint32_t)c<<24;
-        if (startCode==CRP_START_CODE)
-            break;
-        if ((res=m_link->receive(&c, 1, m_idleTimeout))<0)
+        startCode = 0;
+        if ((res=m_link->receive(&c, 1, wait?m_headerTimeout:0))<0)
             return res;
         if (res<1)
             return CRP_RES_ERROR;
+
+        while(1)
+        {
+            startCode >>= 8;
+            startCode |= (uint32_t)c<<24;
+            if (startCode==CRP_START_CODE)
+                break;
+            if ((res=m_link->receive(&c, 1, m_idleTimeout))<0)
+                return res;
+            if (res<1)
+                return CRP_RES_ERROR;
+        }
     }
+    else if (res<0)
+        return res;
     // receive rest of header
-    if (m_link->receive(m_buf, m_headerLen, m_idleTimeout)<0)
+    if ((res=m_link->receive(m_buf, m_headerLen, m_idleTimeout))<0)
         return CRP_RES_ERROR_RECV_TIMEOUT;
     if (res<(int)m_headerLen)
         return CRP_RES_ERROR;
     *type = *(uint8_t *)m_buf;
+    m_recvId = *(uint8_t *)(m_buf+1);
     *proc = *(ChirpProc *)(m_buf+2);
     m_len = *(uint32_t *)(m_buf+4);
-    crc = calcCrc(m_buf, m_headerLen);
+    // init is always sent with the sum, but don't switch until we know it's really an init
+    crcType = *type==CRP_CALL_INIT ? CRP_CRC_SUM : m_crcType;
+    crcLen = CRP_CRC_LEN(crcType);
+    crc = checksum(crcType, m_buf, m_headerLen);
 
     if (m_len>=CRP_MAX_HEADER_LEN-m_headerLen)
         chunk = CRP_MAX_HEADER_LEN-m_headerLen;
     else
         chunk = m_len;
-    if ((res=m_link->receive(m_buf, chunk+2, m_idleTimeout))<0) // +2 for crc
+    if ((res=m_link->receive(m_buf+m_headerLen, chunk+crcLen, m_idleTimeout))<0) // + for crc
         return res;
-    if (res<(int)chunk+2)
+    if (res<(int)(chunk+crcLen))
         return CRP_RES_ERROR;
-    copyAlign((char *)&rcrc, (char *)(m_buf+chunk), 2);
-    if (rcrc==crc+calcCrc(m_buf, chunk))
+    rcrc = 0;
+    copyAlign((char *)&rcrc, (char *)(m_buf+m_headerLen+chunk), crcLen);
+    if (rcrc==checksum(crcType, m_buf+m_headerLen, chunk, crc))
     {
+        if (*type==CRP_CALL_INIT)
+            setTransfer(CRP_CRC_SUM, 1);
         m_offset = chunk;
         sendAck(true);
     }
@@ -1213,6 +2304,7 @@ int Chirp::recvFull(uint8_t *type, ChirpProc *proc, bool wait)
             break;
     }
     *type = *(uint8_t *)(m_buf+4);
+    m_recvId = *(uint8_t *)(m_buf+5);
     *proc = *(ChirpProc *)(m_buf+6);
     m_len = *(uint32_t *)(m_buf+8);
 
@@ -1225,7 +2317,8 @@ int Chirp::recvFull(uint8_t *type, ChirpProc *proc, bool wait)
         recvd = CRP_MAX_HEADER_LEN;
         while(recvd<len)
         {
-            if ((res=m_link->receive(m_buf+recvd, len, m_idleTimeout))<0)
+            // just what's left, the next chirp can be right behind this one
+            if ((res=m_link->receive(m_buf+recvd, len-recvd, m_idleTimeout))<0)
                 return res;
             recvd += res;
         }
@@ -1259,11 +2352,13 @@ int Chirp::recvFull(uint8_t *type, ChirpProc *proc, bool wait)
 int Chirp::recvData()
 {
     int res;
-    uint32_t chunk;
-    uint16_t crc;
+    uint32_t chunk, crc, crcLen = CRP_CRC_LEN(m_crcType);
     uint8_t sequence, rsequence, naks;
 
-    if (m_len+3+m_headerLen>m_bufSize && (res=realloc(m_len+3+m_headerLen))<0) // +3 to read sequence, crc
+    if (m_window>1)
+        return recvDataWindow();
+
+    if (m_len+1+crcLen+m_headerLen>m_bufSize && (res=realloc(m_len+1+crcLen+m_headerLen))<0) // +1+crcLen to read sequence, crc
         return res;
 
     for (rsequence=0, naks=0; m_offset<m_len; )
@@ -1272,13 +2367,14 @@ int Chirp::recvData()
             chunk = m_blkSize;
         else
             chunk = m_len-m_offset;
-        if (m_link->receive(m_buf+m_offset, chunk+3, m_dataTimeout)<0) // +3 to read sequence, crc
+        if ((res=m_link->receive(m_buf+m_headerLen+m_offset, chunk+1+crcLen, m_dataTimeout))<0) // +1+crcLen to read sequence, crc
             return CRP_RES_ERROR_RECV_TIMEOUT;
-        if (res<(int)chunk+3)
+        if (res<(int)(chunk+1+crcLen))
             return CRP_RES_ERROR;
-        sequence = *(uint8_t *)(m_buf+m_offset+chunk);
-        copyAlign((char *)&crc, (char *)(m_buf+m_offset+chunk+1), 2);
-        if (crc==calcCrc(m_buf+m_offset, chunk+1))
+        sequence = *(uint8_t *)(m_buf+m_headerLen+m_offset+chunk);
+        crc = 0;
+        copyAlign((char *)&crc, (char *)(m_buf+m_headerLen+m_offset+chunk+1), crcLen);
+        if (crc==checksum(m_crcType, m_buf+m_headerLen+m_offset, chunk+1))
         {
             if (rsequence==sequence)
             {
@@ -1301,6 +2397,62 @@ int Chirp::recvData()
     return CRP_RES_OK;
 }
 
+// Windowed version of recvData(), see sendDataWindow().  Chunks can arrive out of order (after a
+// nack) and more than once (if the sender misses an ack), the sequence number tells us where they go.
+int Chirp::recvDataWindow()
+{
+    int res;
+    uint32_t chunks, base, c, offset, len, crc, frameLen, crcLen = CRP_CRC_LEN(m_crcType);
+    uint8_t *frame;
+    uint16_t naks;
+    int8_t d;
+    bool got[CRP_MAX_WINDOW];
+
+    // frames are received after the data, then copied into place
+    frameLen = m_blkSize+1+crcLen;
+    if (m_len+frameLen+m_headerLen>m_bufSize && (res=realloc(m_len+frameLen+m_headerLen))<0)
+        return res;
+    frame = m_buf+m_headerLen+m_len;
+
+    chunks = (m_len-m_offset+m_blkSize-1)/m_blkSize;
+    memset(got, 0, sizeof(got));
+
+    // base is the oldest chunk we don't have
+    for (base=0, naks=0; base<chunks; )
+    {
+        if ((res=m_link->receive(frame, frameLen, m_dataTimeout))<0)
+            return CRP_RES_ERROR_RECV_TIMEOUT;
+        if (res<(int)frameLen)
+            return CRP_RES_ERROR;
+        crc = 0;
+        copyAlign((char *)&crc, (char *)(frame+m_blkSize+1), crcLen);
+        d = frame[m_blkSize]-(uint8_t)base; // where this chunk is relative to base
+        if (crc!=checksum(m_crcType, frame, m_blkSize+1) || d>=m_window || (d>=0 && base+d>=chunks))
+        {
+            sendAck(false);
+            if (++naks>=m_maxNak*m_window)
+                return CRP_RES_ERROR_MAX_NAK;
+            continue;
+        }
+        // d<0 means we already have it
+        c = base+d;
+        if (d>=0 && !got[c%CRP_MAX_WINDOW])
+        {
+            offset = m_offset + c*m_blkSize;
+            len = m_len-offset<m_blkSize ? m_len-offset : m_blkSize;
+            memcpy(m_buf+m_headerLen+offset, frame, len);
+            got[c%CRP_MAX_WINDOW] = true;
+            for (; base<chunks && got[base%CRP_MAX_WINDOW]; base++)
+                got[base%CRP_MAX_WINDOW] = false;
+        }
+        sendAck(true);
+        naks = 0;
+    }
+    m_offset = m_len;
+
+    return CRP_RES_OK;
+}
+
 int Chirp::recvAck(bool *ack, uint16_t timeout) // false=nack
 {
     int res;
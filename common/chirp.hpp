@@ -37,6 +37,7 @@
 #define CRP_INTRINSIC          		0x20
 #define CRP_DATA                        0x10
 #define CRP_XDATA                       0x18 // data not associated with no associated procedure)
+#define CRP_XDATA_BATCH                 0x1c // several XDATA chirps sent as one (Chirp::setBatch())
 #define CRP_CALL_ENUMERATE    		(CRP_CALL | CRP_INTRINSIC | 0x00)
 #define CRP_CALL_INIT         		(CRP_CALL | CRP_INTRINSIC | 0x01)
 #define CRP_CALL_ENUMERATE_INFO         (CRP_CALL | CRP_INTRINSIC | 0x02)
@@ -45,6 +46,33 @@
 #define CRP_NACK                        0x95
 #define CRP_MAX_HEADER_LEN              64
 
+// crc types, negotiated with CRP_CALL_INIT.  Peers that don't negotiate get CRP_CRC_SUM,
+// and the init call and its response are always sent with CRP_CRC_SUM.
+#define CRP_CRC_SUM                     0x00 // 16 bit sum of bytes + length (original)
+#define CRP_CRC16                       0x01 // CRC-16/GENIBUS (poly 0x1021), 2 bytes
+#define CRP_CRC32                       0x02 // CRC-32 (zlib), 4 bytes
+#ifdef PIXY
+#define CRP_CRC_CAPS                    CRP_CRC16 // 16 entry table, small enough for the device
+#else
+#define CRP_CRC_CAPS                    (CRP_CRC16 | CRP_CRC32)
+#endif
+#define CRP_CRC_LEN(type)               ((type)==CRP_CRC32 ? 4 : 2)
+// data chunks sent before waiting for an ack, negotiated with CRP_CALL_INIT (1 = stop-and-wait).
+// CRP_WINDOW is what we offer unless setWindow() says otherwise, CRP_MAX_WINDOW sizes the fifos
+// sendDataWindow() and recvDataWindow() keep on the stack.
+#define CRP_WINDOW                      8
+#ifdef PIXY
+#define CRP_MAX_WINDOW                  CRP_WINDOW
+#else
+#define CRP_MAX_WINDOW                  64
+#endif
+// calls outstanding with request ids (callPipelined()), negotiated with CRP_CALL_INIT (0 = no request ids).
+// The request id goes in the header's pad byte, which older peers ignore.
+#define CRP_MAX_PENDING                 8
+// largest batch of XDATA chirps we take, negotiated with CRP_CALL_INIT (0 = no batches).
+// Each chirp in a batch is its length (uint32_t) and its serialized args, padded to 4 bytes.
+#define CRP_MAX_BATCH                   0x400
+
 #define CRP_ARRAY                       0x80 // bit
 #define CRP_FLT                         0x10 // bit
 #define CRP_NO_COPY                     (0x10 | 0x20)
@@ -164,11 +192,20 @@
 #define callSyncArray(...)              call(SYNC_RETURN_ARRAY, __VA_ARGS__, END)
 
 class Chirp;
+class ChirpWriter;
 
 typedef int16_t ChirpProc; // negative values are invalid
 
 typedef uint32_t (*ProcPtr)(Chirp *);
 
+#ifndef PIXY
+// calls a proc registered with Chirp::bind(), returns its responseInt
+typedef int32_t (*ChirpInvoker)(Chirp *chirp, ProcPtr ptr, void *args[]);
+// bound procs (Chirp::bind()) are kept as a ProcPtr, they're cast through this so it's clear
+// the cast isn't a mistake (and -Wcast-function-type stays quiet)
+typedef void (*ChirpAnyFn)();
+#endif
+
 struct ProcModule
 {
     char *procName;
@@ -196,8 +233,32 @@ struct ProcTableEntry
     ProcPtr procPtr;
     ChirpProc chirpProc;
     const ProcTableExtension *extension;
+#ifndef PIXY
+    ChirpInvoker invoker; // NULL unless the proc is bound (Chirp::bind())
+#endif
+};
+
+#ifndef PIXY
+struct RemoteProcEntry
+{
+    char *procName;
+    ChirpProc proc;
 };
 
+// called when the response to a pipelined call comes in (res==CRP_RES_OK), or when the call fails.
+// args are the same as for SYNC_RETURN_ARRAY (args[0] is responseInt), they're only valid during
+// the callback and are NULL if res<0.  Chirp::getArgs() unpacks them like callSync().  The callback
+// is called while chirp is receiving, so it shouldn't make calls.
+typedef void (*ChirpCallback)(void *data, int res, void *args[]);
+
+struct ChirpPending
+{
+    uint8_t id;
+    ChirpCallback callback;
+    void *data;
+};
+#endif
+
 class Chirp
 {
 public:
@@ -216,6 +277,71 @@ public:
     int service(bool all=true);
     int assemble(uint8_t type, ...);
     bool connected();
+    // While it's set, XDATA that's sent right away (not batched) is pushed: it's given timeoutMs
+    // instead of CRP_SEND_TIMEOUT, and it's tried once.  A push that fails returns an error but
+    // doesn't disconnect us, the other end is slow, not gone, and the caller counts it as dropped.
+    // 0 turns it off (the default).  Returns the timeout it replaces.
+    uint16_t setPushTimeout(uint16_t timeoutMs);
+
+    // typed equivalents of call() and assemble(), args are serialized beforehand with ChirpWriter
+    int callTyped(uint8_t service, ChirpProc proc, ChirpWriter *writer, ...); // result args, END_IN_ARGS
+    int assemble(ChirpWriter *writer);
+    // Send XDATA chirps that fit in size bytes together as one chirp, if the other end takes
+    // batches.  A batch goes out when it's full, before any other chirp, and when deadline (in
+    // Link::getTimer() units) has passed since it was started, which is checked when XDATA is
+    // added and in service().  Size 0 sends every XDATA chirp by itself (the default).
+    int setBatch(uint32_t size, uint32_t deadline);
+    int flush(); // send the batch now
+    // Data chunks we let be in flight before waiting for an ack, offered at the next init (set it
+    // before setLink() on the client) and negotiated down to what the other end offers.  1 is
+    // stop-and-wait, the most is CRP_MAX_WINDOW.  Links that are error corrected don't use it.
+    void setWindow(uint8_t window);
+#ifndef PIXY
+    // send a call without waiting for the response, callback gets the response (see ChirpCallback).
+    // Several calls can be outstanding if the peer supports request ids and the link is error
+    // corrected and buffers what it receives (LINK_FLAG_BUFFERED_RECEIVE).  Responses are matched
+    // to calls in whatever order they come in.  Otherwise the call completes before this returns.
+    // If this returns an error before the call is sent, callback isn't called.
+    int callPipelined(ChirpProc proc, ChirpCallback callback, void *data, ...); // args, END_OUT_ARGS
+    int waitPending(); // wait for all pipelined calls to complete
+    static int getArgs(void *recvArgs[], ...); // END_IN_ARGS
+    // Give chirp buf (allocated with new[], *size bytes, at least CRP_BUFSIZE) to send and receive
+    // with, and take the buffer the last chirp was received into, so its args stay valid after the
+    // next receive.  The caller owns the returned buffer, *size is set to its size.  Returns NULL
+    // and keeps buf if the buffer can't be swapped (shared memory link, or useBuffer() in effect).
+    uint8_t *swapBuffer(uint8_t *buf, uint32_t *size);
+    // For passing chirps on as they are, without unpacking and repacking them.  The serialized
+    // args of the chirp just received (a response's start with responseInt), and its request id.
+    uint8_t *rawArgs(uint8_t type, uint32_t *len, uint8_t *id);
+    // the same without a response's responseInt, i.e. the serialized args handleXdata() or a
+    // response's handler was given (after responseInt), for storing them as they came in
+    uint8_t *dataArgs(uint8_t type, uint32_t *len);
+    // send len bytes of serialized args with request id, args can be another chirp's rawArgs()
+    int sendRaw(uint8_t type, ChirpProc proc, uint8_t id, const uint8_t *args, uint32_t len);
+
+    // Same as setProc(), but fn is called with its own arg types instead of through invoke().
+    // The received args are checked against them, count and type tags, and a call that doesn't
+    // match returns CRP_RES_ERROR without calling fn.  Scalars are const T &, arrays are
+    // const uint32_t &len followed by const T *, strings are const char *.  For example
+    //
+    //     uint32_t setLamp(const uint8_t &upper, const uint8_t &lower, Chirp *chirp);
+    //     chirp->bind("led_setLamp", setLamp);
+    //
+    // Up to 6 args, procs with more use setProc().
+    int bind(const char *procName, ProcPtr fn, ProcTableExtension *extension=NULL);
+    template <typename P0>
+    int bind(const char *procName, uint32_t (*fn)(P0, Chirp *), ProcTableExtension *extension=NULL);
+    template <typename P0, typename P1>
+    int bind(const char *procName, uint32_t (*fn)(P0, P1, Chirp *), ProcTableExtension *extension=NULL);
+    template <typename P0, typename P1, typename P2>
+    int bind(const char *procName, uint32_t (*fn)(P0, P1, P2, Chirp *), ProcTableExtension *extension=NULL);
+    template <typename P0, typename P1, typename P2, typename P3>
+    int bind(const char *procName, uint32_t (*fn)(P0, P1, P2, P3, Chirp *), ProcTableExtension *extension=NULL);
+    template <typename P0, typename P1, typename P2, typename P3, typename P4>
+    int bind(const char *procName, uint32_t (*fn)(P0, P1, P2, P3, P4, Chirp *), ProcTableExtension *extension=NULL);
+    template <typename P0, typename P1, typename P2, typename P3, typename P4, typename P5>
+    int bind(const char *procName, uint32_t (*fn)(P0, P1, P2, P3, P4, P5, Chirp *), ProcTableExtension *extension=NULL);
+#endif
 
     // utility methods
     static int serialize(Chirp *chirp, uint8_t *buf, uint32_t bufSize, ...);
@@ -223,9 +349,18 @@ public:
     static int vserialize(Chirp *chirp, uint8_t *buf, uint32_t bufSize, va_list *args);
     static int vdeserialize(uint8_t *buf, uint32_t len, va_list *args);
     static int getArgList(uint8_t *buf, uint32_t len, uint8_t *argList);
+    static int deserializeParse(uint8_t *buf, uint32_t len, void *args[]); // args point into buf, null terminated, error if they don't fit in len
     int useBuffer(uint8_t *buf, uint32_t len);
+    // Call one of our own procs with args serialized as they are in a call chirp (the args a
+    // sendChirp() of the call would send, 4-byte aligned).  Not being a chirp call, whatever the
+    // proc returns (CRP_RETURN(), useBuffer()) is sent as XDATA.  Its responseInt is in response.
+    int callLocal(ChirpProc proc, uint8_t *args, uint32_t len, int32_t *response);
 
     static uint16_t calcCrc(uint8_t *buf, uint32_t len);
+    static uint16_t calcCrc16(const uint8_t *buf, uint32_t len, uint16_t crc=0);
+#ifndef PIXY
+    static uint32_t calcCrc32(const uint8_t *buf, uint32_t len, uint32_t crc=0);
+#endif
 
 protected:
     int remoteInit(bool connect);
@@ -233,6 +368,9 @@ protected:
     virtual int handleChirp(uint8_t type, ChirpProc proc, void *args[]); // null pointer terminates
     virtual void handleXdata(void *data[]) {}
     virtual int sendChirp(uint8_t type, ChirpProc proc);
+#ifndef PIXY
+    bool handlePending(void *args[]); // true if the response we just received was for a pipelined call
+#endif
 
     uint8_t *m_buf;
     uint8_t *m_bufSave;
@@ -249,38 +387,397 @@ protected:
     uint16_t m_dataTimeout;
     uint16_t m_idleTimeout;
     uint16_t m_sendTimeout;
+    uint16_t m_pushTimeout; // setPushTimeout(), 0 if we aren't pushing
 
 private:
     int sendHeader(uint8_t type, ChirpProc proc);
     int sendFull(uint8_t type, ChirpProc proc);
     int sendData();
+    int sendDataWindow();
+    int sendFrame(uint32_t chunk);
     int sendAck(bool ack); // false=nack
     int sendChirpRetry(uint8_t type, ChirpProc proc);
+    int batch();
+    int handleBatch();
     int recvHeader(uint8_t *type, ChirpProc *proc, bool wait);
     int recvFull(uint8_t *type, ChirpProc *proc, bool wait);
     int recvData();
+    int recvDataWindow();
     int recvAck(bool *ack, uint16_t timeout); // false=nack
     int32_t handleEnumerate(char *procName, ChirpProc *callback);
-    int32_t handleInit(uint16_t *blkSize, uint8_t *hintSource);
+    int32_t handleInit(uint16_t *blkSize, uint8_t *hintSource, uint8_t *crcCaps, uint8_t *window, uint8_t *maxPending, uint16_t *batchMax);
     int32_t handleEnumerateInfo(ChirpProc *proc);
+    int32_t invoke(ProcPtr ptr, void *args[]); // null pointer terminates
+    int32_t invokeProc(ChirpProc proc, void *args[]);
+#ifndef PIXY
+    int setInvoker(const char *procName, ProcPtr fn, ChirpInvoker invoker, ProcTableExtension *extension);
+#endif
     int vassemble(va_list *args);
-    static int deserializeParse(uint8_t *buf, uint32_t len, void *args[]);
+    int vcall(uint8_t service, ChirpProc proc, va_list *args);
+    int recvResponse(uint8_t id, void *args[]);
+    void dispatch(uint8_t type, ChirpProc proc, void *args[]);
+    uint8_t allocId();
+#ifndef PIXY
+    int recvPending();
+    void failPending(int res);
+#endif
     static int loadArgs(va_list *args, void *recvArgs[]);
     void restoreBuffer();
+    void setTransfer(uint8_t crcType, uint8_t window);
+    static uint32_t checksum(uint8_t crcType, const uint8_t *buf, uint32_t len, uint32_t crc=0);
 
     ChirpProc updateTable(const char *procName, ProcPtr procPtr);
     ChirpProc lookupTable(const char *procName);
     int realloc(uint32_t min=0);
     int reallocTable();
+    int rehashTable(uint32_t tableSize);
+    uint32_t tableSignature();
+    static uint32_t hashName(const char *procName);
+#ifndef PIXY
+    ChirpProc lookupRemote(const char *procName);
+    void cacheRemote(const char *procName, ChirpProc proc);
+    void clearRemote();
+#endif
 
     Link *m_link;
     ProcTableEntry *m_procTable;
     uint16_t m_procTableSize;
+    uint16_t m_procTableLen; // entries in use, entries are never removed
+    ChirpProc *m_procHash; // open addressed index into m_procTable by name, -1 is empty
+    uint32_t m_procHashSize; // power of 2, at least twice m_procTableSize
+#ifndef PIXY
+    // remote procs from getProc(), kept across inits as long as the remote table is the same
+    RemoteProcEntry *m_remoteProcs;
+    uint32_t m_remoteProcsSize; // power of 2
+    uint32_t m_remoteProcsLen;
+    uint32_t m_remoteSignature;
+    uint16_t m_remoteTableLen;
+#endif
     uint16_t m_blkSize;
+    uint8_t m_crcType;
+    uint8_t m_window;
+    uint8_t m_windowMax; // what we offer, setWindow()
+    // set by handleInit, take effect after the response is sent
+    uint8_t m_crcTypeNext;
+    uint8_t m_windowNext;
+    // request ids (header pad byte), 0 = none
+    uint8_t m_maxPending; // negotiated, 0 if the peer doesn't do request ids
+    uint8_t m_sendId;
+    uint8_t m_recvId;
+    uint8_t m_nextId;
+#ifndef PIXY
+    ChirpPending m_pending[CRP_MAX_PENDING];
+    uint8_t m_pendingLen;
+#endif
+    // XDATA batching, m_batchBuf has room for the header in front
+    uint8_t *m_batchBuf;
+    uint32_t m_batchSize;
+    uint32_t m_batchLen;
+    uint32_t m_batchDeadline;
+    uint16_t m_batchMax; // negotiated, 0 if the other end doesn't take batches
+    uint8_t *m_batchArgs; // chirp in the batch being handled
+    uint32_t m_batchArgsLen;
+    bool m_waiting; // in recvResponse(), which has the link timer
     uint8_t m_maxNak;
     uint8_t m_retries;
     bool m_call;
     bool m_connected;
+
+    friend class ChirpWriter;
+};
+
+// Typed args for ChirpWriter.  The type tag and size of each arg are known at compile time,
+// so there's no type parsing or va_arg promotion.  The wire format is the same as the
+// variadic args (UINT16(v) is the same as (uint16_t)v, HINT8(v) as CrpHint<uint8_t>(v), etc.)
+template <typename T> struct CrpType {};
+template <> struct CrpType<int8_t> { enum {tag=CRP_INT8}; };
+template <> struct CrpType<uint8_t> { enum {tag=CRP_UINT8}; };
+template <> struct CrpType<int16_t> { enum {tag=CRP_INT16}; };
+template <> struct CrpType<uint16_t> { enum {tag=CRP_UINT16}; };
+template <> struct CrpType<int32_t> { enum {tag=CRP_INT32}; };
+template <> struct CrpType<uint32_t> { enum {tag=CRP_UINT32}; };
+template <> struct CrpType<float> { enum {tag=CRP_FLT32}; };
+
+template <typename T> struct CrpHint
+{
+    CrpHint(T v) : val(v) {}
+    T val;
+};
+
+struct CrpHType // HTYPE()
+{
+    CrpHType(uint32_t v) : val(v) {}
+    uint32_t val;
+};
+
+template <typename T> struct CrpArray
+{
+    CrpArray(uint32_t l, const T *d) : len(l), data(d) {}
+    uint32_t len;
+    const T *data;
+};
+
+// array header only, the data is already in the buffer (UINTS8_NO_COPY(), etc.)
+template <typename T> struct CrpArrayNoCopy
+{
+    CrpArrayNoCopy(uint32_t l) : len(l) {}
+    uint32_t len;
+};
+
+// Serializes typed args, producing the same bytes as Chirp::vserialize().  Errors are
+// sticky and returned by len(), so args can be chained without checking each one:
+//
+//     ChirpWriter writer(chirp, 0);
+//     writer << CrpHType(FOURCC('C','C','B','1')) << CrpHint<uint8_t>(flags) << (uint16_t)width;
+//     return chirp->assemble(&writer);
+class ChirpWriter
+{
+public:
+    // assemble in chirp's buffer, type is CRP_CALL (callTyped()), 0 (CRP_RETURN) or CRP_XDATA
+    ChirpWriter(Chirp *chirp, uint8_t type);
+    // serialize into buf, same as Chirp::serialize() (chirp can be NULL)
+    ChirpWriter(Chirp *chirp, uint8_t *buf, uint32_t bufSize);
+
+    template <typename T> ChirpWriter &operator<<(T val)
+    {
+        put((uint8_t)CrpType<T>::tag, val);
+        return *this;
+    }
+    template <typename T> ChirpWriter &operator<<(const CrpHint<T> &hint)
+    {
+        put((uint8_t)(CrpType<T>::tag | CRP_HINT), hint.val);
+        return *this;
+    }
+    ChirpWriter &operator<<(const CrpHType &htype)
+    {
+        put((uint8_t)CRP_TYPE_HINT, htype.val);
+        return *this;
+    }
+    template <typename T> ChirpWriter &operator<<(const CrpArray<T> &array)
+    {
+        putArray((uint8_t)(CrpType<T>::tag | CRP_ARRAY), array.len, sizeof(T), array.data);
+        return *this;
+    }
+    template <typename T> ChirpWriter &operator<<(const CrpArrayNoCopy<T> &array)
+    {
+        putArray((uint8_t)(CrpType<T>::tag | CRP_ARRAY), array.len, sizeof(T), NULL);
+        return *this;
+    }
+    ChirpWriter &operator<<(const char *s);
+    // continue after len bytes of data written in place (after CrpArrayNoCopy)
+    ChirpWriter &skip(uint32_t len);
+
+    // length of serialized data (including header) or error (<0)
+    int len()
+    {
+        return m_error ? m_error : (int)m_i;
+    }
+
+    friend class Chirp;
+
+private:
+    template <typename T> void put(uint8_t tag, T val)
+    {
+        uint32_t si = m_i;
+
+        // tag, alignment and value
+        if (!reserve(sizeof(T)*2))
+            return;
+        m_buf[m_i++] = tag;
+        if (sizeof(T)>1)
+        {
+            ALIGN(m_i, sizeof(T));
+            // rewrite type so getType will work
+            m_buf[m_i-1] = tag;
+        }
+        *(T *)(m_buf+m_i) = val;
+        m_i += sizeof(T);
+
+        if (!m_hints && (tag&CRP_HINT))
+            m_i = si;
+    }
+    void putArray(uint8_t tag, uint32_t len, uint8_t size, const void *data);
+    bool reserve(uint32_t size);
+
+    uint8_t m_type;
+    Chirp *m_chirp; // non-NULL if we can realloc
+    uint8_t *m_buf;
+    uint32_t m_bufSize;
+    uint32_t m_i;
+    int m_error;
+    bool m_hints;
+};
+
+#ifndef PIXY
+// How Chirp::bind() checks and passes an arg, by the proc's parameter type.  The wire format has
+// no signedness, so int8_t and uint8_t are the same, etc.
+template <typename P> struct ChirpArg {};
+
+template <typename T> struct ChirpArg<const T &>
+{
+    static bool check(void *arg)
+    {
+        return arg && (Chirp::getType(arg)&~CRP_HINT)==CrpType<T>::tag;
+    }
+    static const T &get(void *arg)
+    {
+        return *(const T *)arg;
+    }
+};
+
+// also the length of an array, which has the array's type tag
+template <> struct ChirpArg<const uint32_t &>
+{
+    static bool check(void *arg)
+    {
+        uint8_t tag;
+
+        if (arg==NULL)
+            return false;
+        tag = Chirp::getType(arg)&~CRP_HINT;
+        return tag==CRP_UINT32 || ((tag&CRP_ARRAY) && tag!=CRP_STRING);
+    }
+    static const uint32_t &get(void *arg)
+    {
+        return *(const uint32_t *)arg;
+    }
+};
+
+// array data, after its length
+template <typename T> struct ChirpArg<const T *>
+{
+    static bool check(void *arg)
+    {
+        return arg!=NULL;
+    }
+    static const T *get(void *arg)
+    {
+        return (const T *)arg;
+    }
+};
+
+template <> struct ChirpArg<const char *>
+{
+    static bool check(void *arg)
+    {
+        return arg && (Chirp::getType(arg)&~CRP_HINT)==CRP_STRING;
+    }
+    static const char *get(void *arg)
+    {
+        return (const char *)arg;
+    }
+};
+
+// Chirp::bind() invokers, one per number of args
+template <typename P0> struct ChirpBound1
+{
+    typedef uint32_t (*Fn)(P0, Chirp *);
+    static int32_t invoke(Chirp *chirp, ProcPtr fn, void *args[])
+    {
+        if (!ChirpArg<P0>::check(args[0]) || args[1])
+            return CRP_RES_ERROR;
+        return (*(Fn)(ChirpAnyFn)fn)(ChirpArg<P0>::get(args[0]), chirp);
+    }
+};
+
+template <typename P0, typename P1> struct ChirpBound2
+{
+    typedef uint32_t (*Fn)(P0, P1, Chirp *);
+    static int32_t invoke(Chirp *chirp, ProcPtr fn, void *args[])
+    {
+        if (!ChirpArg<P0>::check(args[0]) || !ChirpArg<P1>::check(args[1]) || args[2])
+            return CRP_RES_ERROR;
+        return (*(Fn)(ChirpAnyFn)fn)(ChirpArg<P0>::get(args[0]), ChirpArg<P1>::get(args[1]), chirp);
+    }
+};
+
+template <typename P0, typename P1, typename P2> struct ChirpBound3
+{
+    typedef uint32_t (*Fn)(P0, P1, P2, Chirp *);
+    static int32_t invoke(Chirp *chirp, ProcPtr fn, void *args[])
+    {
+        if (!ChirpArg<P0>::check(args[0]) || !ChirpArg<P1>::check(args[1]) || !ChirpArg<P2>::check(args[2]) ||
+                args[3])
+            return CRP_RES_ERROR;
+        return (*(Fn)(ChirpAnyFn)fn)(ChirpArg<P0>::get(args[0]), ChirpArg<P1>::get(args[1]), ChirpArg<P2>::get(args[2]), chirp);
+    }
 };
 
+template <typename P0, typename P1, typename P2, typename P3> struct ChirpBound4
+{
+    typedef uint32_t (*Fn)(P0, P1, P2, P3, Chirp *);
+    static int32_t invoke(Chirp *chirp, ProcPtr fn, void *args[])
+    {
+        if (!ChirpArg<P0>::check(args[0]) || !ChirpArg<P1>::check(args[1]) || !ChirpArg<P2>::check(args[2]) ||
+                !ChirpArg<P3>::check(args[3]) || args[4])
+            return CRP_RES_ERROR;
+        return (*(Fn)(ChirpAnyFn)fn)(ChirpArg<P0>::get(args[0]), ChirpArg<P1>::get(args[1]), ChirpArg<P2>::get(args[2]),
+                           ChirpArg<P3>::get(args[3]), chirp);
+    }
+};
+
+template <typename P0, typename P1, typename P2, typename P3, typename P4> struct ChirpBound5
+{
+    typedef uint32_t (*Fn)(P0, P1, P2, P3, P4, Chirp *);
+    static int32_t invoke(Chirp *chirp, ProcPtr fn, void *args[])
+    {
+        if (!ChirpArg<P0>::check(args[0]) || !ChirpArg<P1>::check(args[1]) || !ChirpArg<P2>::check(args[2]) ||
+                !ChirpArg<P3>::check(args[3]) || !ChirpArg<P4>::check(args[4]) || args[5])
+            return CRP_RES_ERROR;
+        return (*(Fn)(ChirpAnyFn)fn)(ChirpArg<P0>::get(args[0]), ChirpArg<P1>::get(args[1]), ChirpArg<P2>::get(args[2]),
+                           ChirpArg<P3>::get(args[3]), ChirpArg<P4>::get(args[4]), chirp);
+    }
+};
+
+template <typename P0, typename P1, typename P2, typename P3, typename P4, typename P5> struct ChirpBound6
+{
+    typedef uint32_t (*Fn)(P0, P1, P2, P3, P4, P5, Chirp *);
+    static int32_t invoke(Chirp *chirp, ProcPtr fn, void *args[])
+    {
+        if (!ChirpArg<P0>::check(args[0]) || !ChirpArg<P1>::check(args[1]) || !ChirpArg<P2>::check(args[2]) ||
+                !ChirpArg<P3>::check(args[3]) || !ChirpArg<P4>::check(args[4]) || !ChirpArg<P5>::check(args[5]) ||
+                args[6])
+            return CRP_RES_ERROR;
+        return (*(Fn)(ChirpAnyFn)fn)(ChirpArg<P0>::get(args[0]), ChirpArg<P1>::get(args[1]), ChirpArg<P2>::get(args[2]),
+                           ChirpArg<P3>::get(args[3]), ChirpArg<P4>::get(args[4]), ChirpArg<P5>::get(args[5]), chirp);
+    }
+};
+
+template <typename P0>
+int Chirp::bind(const char *procName, uint32_t (*fn)(P0, Chirp *), ProcTableExtension *extension)
+{
+    return setInvoker(procName, (ProcPtr)(ChirpAnyFn)fn, ChirpBound1<P0>::invoke, extension);
+}
+
+template <typename P0, typename P1>
+int Chirp::bind(const char *procName, uint32_t (*fn)(P0, P1, Chirp *), ProcTableExtension *extension)
+{
+    return setInvoker(procName, (ProcPtr)(ChirpAnyFn)fn, ChirpBound2<P0, P1>::invoke, extension);
+}
+
+template <typename P0, typename P1, typename P2>
+int Chirp::bind(const char *procName, uint32_t (*fn)(P0, P1, P2, Chirp *), ProcTableExtension *extension)
+{
+    return setInvoker(procName, (ProcPtr)(ChirpAnyFn)fn, ChirpBound3<P0, P1, P2>::invoke, extension);
+}
+
+template <typename P0, typename P1, typename P2, typename P3>
+int Chirp::bind(const char *procName, uint32_t (*fn)(P0, P1, P2, P3, Chirp *), ProcTableExtension *extension)
+{
+    return setInvoker(procName, (ProcPtr)(ChirpAnyFn)fn, ChirpBound4<P0, P1, P2, P3>::invoke, extension);
+}
+
+template <typename P0, typename P1, typename P2, typename P3, typename P4>
+int Chirp::bind(const char *procName, uint32_t (*fn)(P0, P1, P2, P3, P4, Chirp *), ProcTableExtension *extension)
+{
+    return setInvoker(procName, (ProcPtr)(ChirpAnyFn)fn, ChirpBound5<P0, P1, P2, P3, P4>::invoke, extension);
+}
+
+template <typename P0, typename P1, typename P2, typename P3, typename P4, typename P5>
+int Chirp::bind(const char *procName, uint32_t (*fn)(P0, P1, P2, P3, P4, P5, Chirp *), ProcTableExtension *extension)
+{
+    return setInvoker(procName, (ProcPtr)(ChirpAnyFn)fn, ChirpBound6<P0, P1, P2, P3, P4, P5>::invoke, extension);
+}
+#endif
+
 #endif // CHIRP_H
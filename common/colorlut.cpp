@@ -13,7 +13,7 @@
 // end license header
 //
 
-#ifndef PIXY
+#if !defined(PIXY) && !defined(PIXY_HOST_NO_QT)
 #include <QString>
 #include <QFile>
 #include <QTextStream>
@@ -500,7 +500,7 @@ int ColorLUT::growRegion(RectA *result, const Frame8 &frame, const Point16 &seed
     }
 }
 
-#ifndef PIXY
+#if !defined(PIXY) && !defined(PIXY_HOST_NO_QT)
 void ColorLUT::matlabOut(const ColorModel *model)
 {
     unsigned int i;
@@ -60,7 +60,7 @@ private:
     uint32_t boundTest(const Line *line, float dir);
     bool checkBounds(const ColorModel *model, const HuePixel *pixel);
 
-#ifndef PIXY
+#if !defined(PIXY) && !defined(PIXY_HOST_NO_QT)
     void matlabOut(const ColorModel *model);
     void matlabOut();
 #endif
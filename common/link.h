@@ -20,6 +20,7 @@
 // flags
 #define LINK_FLAG_SHARED_MEM                            0x01
 #define	LINK_FLAG_ERROR_CORRECTED                       0x02
+#define LINK_FLAG_BUFFERED_RECEIVE                      0x04 // keeps receiving while we send, so the other end never waits on us
 
 // result codes
 #define LINK_RESULT_OK                                  0
@@ -67,6 +68,14 @@ public:
     {
         return LINK_RESULT_ERROR;
     }
+    // Discard what's received up to and including the next len bytes that match pattern, waiting
+    // up to timeoutMs for more while there's no match.  ahead bytes always follow a match, and a
+    // link can receive them with it.  Links that buffer what they receive can search it all at
+    // once, the rest return LINK_RESULT_ERROR and the caller reads a byte at a time.
+    virtual int skipTo(const uint8_t *pattern, uint32_t len, uint32_t ahead, uint16_t timeoutMs)
+    {
+        return LINK_RESULT_ERROR;
+    }
 
 protected:
     uint32_t m_flags;
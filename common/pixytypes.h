@@ -20,6 +20,24 @@
 #define RENDER_FLAG_FLUSH            0x01
 #define RENDER_FLAG_BLEND_BG         0x02
 
+// streams the device pushes to the host once subscribed (stream_subscribe), bits
+#define STREAM_CCB1                  0x01 // blocks, blobs program
+#define STREAM_CCQ1                  0x02 // run-length segments, blobs program
+#define STREAM_BA81                  0x04 // raw frames, video program
+
+// Stages of a frame's trip from the camera to the host, in the order they happen.  Streamed
+// frames carry the device's in a trailer, LPC_TIMER2 microseconds, 0 if a stage isn't known.
+#define LAT_M0_START                 0 // M0 starts reading the frame's lines (getRLSFrame)
+#define LAT_M0_END                   1 // M0 has read the last line
+#define LAT_UNPACK                   2 // M4 has unpacked the frame's q vals
+#define LAT_BLOBIFY                  3 // M4 has assembled the blobs
+#define LAT_GETBLOCK                 4 // first block served (SPI, I2C, UART), of the previous frame
+#define LAT_SEND                     5 // chirp starts sending the frame
+#define LAT_DEVICE_STAGES            6
+#define LAT_RECEIVE                  6 // host has received it
+#define LAT_RENDER                   7 // host has rendered (handled) it
+#define LAT_STAGES                   8
+
 #define PRM_FLAG_INTERNAL            0x01
 #define PRM_FLAG_ADVANCED            0x02
 #define PRM_FLAG_HEX_FORMAT          0x10
@@ -70,6 +70,22 @@ int Qqueue::enqueue(Qval val)
 
 #endif
 
+bool Qqueue::getStamp(uint16_t index, uint32_t *start, uint32_t *end)
+{
+    uint32_t i;
+
+    for (i=0; i<QQ_STAMPS; i++)
+    {
+        if (m_fields->stamps[i].index==index && m_fields->stamps[i].start)
+        {
+            *start = m_fields->stamps[i].start;
+            *end = m_fields->stamps[i].end;
+            return true;
+        }
+    }
+    return false;
+}
+
 uint32_t Qqueue::readAll(Qval *mem, uint32_t size)
 {
     uint16_t len = m_fields->produced - m_fields->consumed;
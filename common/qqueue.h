@@ -19,9 +19,33 @@
 typedef uint32_t Qval;
 struct QqueueFields;
 
+// Each frame of q vals begins with one of these.  The start of frame value selects the q val
+// encoding for the rest of the frame, 0 marks the beginning of each row.
+// q val (CAM_RES2, 320x200):
+// | 4 bits    | 7 bits      | 9 bits  | 9 bits    | 3 bits |
+// | shift val | shifted sum | length  | begin col | model  |
+// wide q val (CAM_RES1, 640x400):
+// | 3 bits    | 6 bits      | 10 bits | 10 bits   | 3 bits |
+// | shift val | shifted sum | length  | begin col | model  |
+// Neither can be produced as a q val at its resolution, so they're safe to use as markers.
+#define QVAL_FRAME_START       0xffffffff
+#define QVAL_FRAME_START_WIDE  0xfffffffe
+#define QVAL_IS_FRAME_START(q) ((q)>=QVAL_FRAME_START_WIDE)
+
 #define QQ_LOC        SRAM4_LOC
 #define QQ_SIZE       0x3000
 #define QQ_MEM_SIZE  ((QQ_SIZE-sizeof(struct QqueueFields)+sizeof(Qval))/sizeof(Qval))
+#define QQ_STAMPS     4 // must be a power of 2, the M4 is never more than a frame or so behind
+
+// When the M0 read a frame's lines, LPC_TIMER2 microseconds.  index is the produced count when
+// the frame's start of frame value was enqueued, which is how the M4 finds the frame's stamp.
+struct QqueueStamp
+{
+    uint16_t index;
+    uint16_t reserved;
+    uint32_t start;
+    uint32_t end; // 0 if the frame was cut short
+};
 
 struct QqueueFields
 {
@@ -31,6 +55,10 @@ struct QqueueFields
     uint16_t produced;
     uint16_t consumed;
 
+    uint16_t frames; // frames started, the last one's stamp is stamps[(frames-1)&(QQ_STAMPS-1)]
+    uint16_t reserved;
+    struct QqueueStamp stamps[QQ_STAMPS];
+
     // (array size below doesn't matter-- we're just going to cast a pointer to this struct)
     Qval data[1]; // data
 };
@@ -48,6 +76,13 @@ public:
 	{
 		return m_fields->produced - m_fields->consumed;
 	}
+    uint16_t consumed()
+    {
+        return m_fields->consumed;
+    }
+    // stamp of the frame whose start of frame value was at index (consumed count before it was
+    // dequeued), false if it's been overwritten or there isn't one
+    bool getStamp(uint16_t index, uint32_t *start, uint32_t *end);
 #ifndef PIXY
     int enqueue(Qval val);
 #endif
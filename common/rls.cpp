@@ -0,0 +1,256 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "rls.h"
+
+// same as intLog() in rls_m0.c
+static uint8_t intLog(int i)
+{
+    return 0;
+}
+
+RLS::RLS(const uint8_t *lut)
+{
+    m_lut = lut;
+    createLogLut();
+}
+
+void RLS::createLogLut()
+{
+    int i;
+
+    // The M0 only fills the first CAM_RES1_WIDTH entries.  We fill all of them so that
+    // segments that run off the end of the line have a defined shift.
+    for (i=0; i<RLS_LOG_LUT_SIZE; i++)
+        m_logLut[i] = intLog(i) + 3;
+}
+
+int32_t RLS::processFrame(const Frame8 &frame, Qval *qvals, uint32_t len)
+{
+    uint32_t row, width, n;
+    bool wide;
+    const uint8_t *line;
+
+    width = frame.m_width/2;
+    if (width>RLS_MAX_WIDTH || len==0)
+        return -1;
+    wide = width>RLS_MAX_NARROW_WIDTH;
+
+    // indicate start of frame and encoding
+    qvals[0] = wide ? QVAL_FRAME_START_WIDE : QVAL_FRAME_START;
+    for (row=0, n=1, line=frame.m_pixels; row<(uint32_t)frame.m_height/2; row++, line+=frame.m_width*2)
+    {
+        if (len-n<RLS_MAX_QVALS_PER_LINE(width)+1)
+            return -1;
+        // mark beginning of this row
+        qvals[n++] = 0;
+        n += processLine(line, line+frame.m_width, width, qvals+n, wide);
+    }
+    return n;
+}
+
+void RLS::lookup(const uint8_t *bgLine, const uint8_t *grLine, uint32_t width)
+{
+    uint32_t col;
+    int32_t c, bg;
+#ifdef __SSE2__
+    __m128i mask, bias, pixels, bgs, rgs;
+
+    mask = _mm_set1_epi16(0xff);
+    bias = _mm_set1_epi16(127);
+
+    // 8 columns at a time: each 16-bit lane holds a pixel pair, the first pixel in the low byte
+    for (col=0; col+8<=width; col+=8)
+    {
+        // lineProcessedRL0A: blue+green
+        pixels = _mm_loadu_si128((const __m128i *)(bgLine+col*2));
+        bgs = _mm_add_epi16(_mm_and_si128(pixels, mask), _mm_srli_epi16(pixels, 8));
+        bgs = _mm_and_si128(_mm_srai_epi16(_mm_sub_epi16(bgs, bias), 1), mask);
+        _mm_storel_epi64((__m128i *)(m_lineStore+col), _mm_packus_epi16(bgs, bgs));
+
+        // red+green, make it the higher 8 bits of the index
+        pixels = _mm_loadu_si128((const __m128i *)(grLine+col*2));
+        rgs = _mm_add_epi16(_mm_and_si128(pixels, mask), _mm_srli_epi16(pixels, 8));
+        rgs = _mm_slli_epi16(_mm_srai_epi16(_mm_sub_epi16(rgs, bias), 1), 8);
+        _mm_storeu_si128((__m128i *)(m_index+col), _mm_or_si128(rgs, bgs));
+    }
+#else
+    col = 0;
+#endif
+    for (; col<width; col++)
+    {
+        c = bgLine[col*2] + bgLine[col*2+1] - 127;
+        bg = (uint8_t)(c>>1);
+        m_lineStore[col] = bg;
+        c = grLine[col*2+1] + grLine[col*2] - 127;
+        m_index[col] = (((uint32_t)(c>>1)&0xff)<<8) | bg;
+    }
+    // The M0 can read up to 2 columns past the end of the line after writing a q val.  Those pixels
+    // are read during horizontal blanking-- we take them as 0, and the line store padding as 0.
+    for (; col<width+2; col++)
+    {
+        m_lineStore[col] = 0;
+        m_index[col] = ((uint32_t)(-127>>1)&0xff)<<8;
+    }
+
+    // the lut lookup itself is a gather, which we do one column at a time
+    for (col=0; col<width+2; col++)
+    {
+        m_lutVals[col] = m_lut[m_index[col]];
+        m_models[col] = m_lutVals[col]&0x07;
+    }
+}
+
+#ifdef __SSE2__
+static inline uint32_t firstSet(uint32_t mask)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(mask);
+#else
+    uint32_t i;
+    for (i=0; (mask&1)==0; i++, mask>>=1);
+    return i;
+#endif
+}
+#endif
+
+uint32_t RLS::nextModel(uint32_t col, uint32_t width)
+{
+#ifdef __SSE2__
+    uint32_t mask;
+    __m128i zero = _mm_setzero_si128();
+
+    for (; col+16<=width; col+=16)
+    {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(m_models+col)), zero));
+        if (mask!=0xffff)
+            return col + firstSet(~mask);
+    }
+#endif
+    for (; col<width && m_models[col]==0; col++);
+    return col;
+}
+
+uint32_t RLS::endOfRun(uint32_t col, uint32_t width, uint32_t model, uint32_t *sum)
+{
+#ifdef __SSE2__
+    uint32_t mask;
+    __m128i zero, models, acc;
+
+    zero = _mm_setzero_si128();
+    models = _mm_set1_epi8(model);
+    acc = zero;
+    for (; col+16<=width; col+=16)
+    {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(m_models+col)), models));
+        if (mask!=0xffff)
+            break;
+        // sum of the 16 lut vals ends up in the two 64-bit halves
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(m_lutVals+col)), zero));
+    }
+    *sum += _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    for (; col<width && m_models[col]==model; col++)
+        *sum += m_lutVals[col];
+    return col;
+}
+
+uint32_t RLS::processLine(const uint8_t *bgLine, const uint8_t *grLine, uint16_t width, Qval *qvals, bool wide)
+{
+    uint32_t col, end, start, sum, lutVal, last, model, len, shift, n;
+
+    // blue-green line store, lut index and lut val for each column
+    lookup(bgLine, grLine, width);
+
+    // lineProcessedRL1A: the labels and the order of operations below follow the assembly
+    // so that the sums, lengths and the pixel pair skipped after each q val match.
+    // Stretches of columns that don't change the state (no model, or same model as the
+    // run-length) are skipped with nextModel() and endOfRun().
+
+    // q val encodings are in qqueue.h (lineProcessedRL1A and lineProcessedRL1AW)
+#define QVAL() \
+    len = col - start; \
+    shift = m_logLut[len]; \
+    if (wide) \
+        qvals[n++] = (start<<3) | model | (len<<13) | ((sum>>shift)<<23) | (shift<<29); \
+    else \
+        qvals[n++] = (start<<3) | model | (len<<12) | ((sum>>shift)<<21) | (shift<<28)
+
+    col = 0;
+    sum = 0;
+    n = 0;
+    start = 0;
+    model = 0;
+    last = 0;
+
+zero0:
+    sum = 0;
+    col = nextModel(col, width);
+    if (col>=width)
+        goto eol;
+zero1:
+    lutVal = m_lutVals[col];
+    model = m_models[col++];
+    if (model==0)
+        goto zero0;
+    start = col;
+    sum += lutVal;
+    if (col>=width)
+        goto eol;
+    lutVal = m_lutVals[col];
+    if (m_models[col++]!=model)
+        goto zero0;
+one:
+    last = lutVal;
+    sum += lutVal;
+    end = endOfRun(col, width, model, &sum);
+    if (end>col)
+    {
+        last = m_lutVals[end-1];
+        col = end;
+    }
+    if (col>=width)
+        goto eol;
+    // 1st pixel not equal
+    col++;
+    // need to add something-- use last lut val
+    sum += last;
+    if (col>=width)
+        goto eol;
+    lutVal = m_lutVals[col];
+    if (m_models[col++]==model)
+        goto one;
+    // 2nd pixel not equal--- run length is done
+    QVAL();
+    sum = 0;
+    // the M0 skips a pixel pair while it writes the q val
+    col++;
+    goto zero1;
+
+eol:
+    // check for unfinished q val
+    if (sum)
+    {
+        QVAL();
+    }
+
+#undef QVAL
+
+    return n;
+}
@@ -0,0 +1,74 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+#ifndef RLS_H
+#define RLS_H
+
+#include <inttypes.h>
+#include "pixytypes.h"
+#include "qqueue.h"
+
+// maximum number of columns (green/red pixel pairs) in a line
+#define RLS_MAX_WIDTH                 640
+// lines wider than this (CAM_RES2_WIDTH) are encoded with wide q vals, like CAM_RES1 on the M0
+#define RLS_MAX_NARROW_WIDTH          320
+// worst case with noise filtering is a q val every 5 columns, plus the end of line q val
+#define RLS_MAX_QVALS_PER_LINE(width) ((width)/5 + 2)
+// segment lengths can run past the end of the line by 2 columns (see processLine)
+#define RLS_LOG_LUT_SIZE              (RLS_MAX_WIDTH + 4)
+
+// Host model of the M0 run-length segmentation (lineProcessedRL0A/lineProcessedRL1A in rls_m0.c).
+// It produces the same q vals, bit for bit, that the M0 produces for the same Bayer frame,
+// so the host can be used to reproduce and debug what Pixy sees.  The lut indexes are formed
+// and runs are detected with SSE2 when it's available.
+// Cost per frame is about proportional to the number of pixels: a 640x400 (CAM_RES1) frame
+// takes about 3 times as long as a 320x200 (CAM_RES2) frame and produces about twice the q vals
+// for the same scene.
+class RLS
+{
+public:
+    RLS(const uint8_t *lut);
+
+    void setLut(const uint8_t *lut)
+    {
+        m_lut = lut;
+    }
+
+    // Process a raw Bayer frame (BGBG.../GRGR... line pairs).  Like the M0, the frame begins
+    // with QVAL_FRAME_START, or QVAL_FRAME_START_WIDE if the frame is wider than
+    // RLS_MAX_NARROW_WIDTH columns.  For each line pair a 0 q val (beginning of row) is written,
+    // followed by the q vals for that row.
+    // Returns the number of q vals written, or -1 if qvals isn't large enough.
+    int32_t processFrame(const Frame8 &frame, Qval *qvals, uint32_t len);
+
+    // Process a single line pair, width in columns (pixel pairs).  qvals must have room for
+    // RLS_MAX_QVALS_PER_LINE(width) q vals.  Returns the number of q vals written.
+    uint32_t processLine(const uint8_t *bgLine, const uint8_t *grLine, uint16_t width, Qval *qvals, bool wide=false);
+
+private:
+    void createLogLut();
+    void lookup(const uint8_t *bgLine, const uint8_t *grLine, uint32_t width);
+    uint32_t nextModel(uint32_t col, uint32_t width);
+    uint32_t endOfRun(uint32_t col, uint32_t width, uint32_t model, uint32_t *sum);
+
+    const uint8_t *m_lut;
+    uint8_t m_logLut[RLS_LOG_LUT_SIZE];
+    // per column, including the 2 columns that can be read past the end of the line
+    uint8_t m_lineStore[RLS_MAX_WIDTH+2];
+    uint16_t m_index[RLS_MAX_WIDTH+2];
+    uint8_t m_lutVals[RLS_MAX_WIDTH+2];
+    uint8_t m_models[RLS_MAX_WIDTH+2];
+};
+
+#endif // RLS_H
@@ -0,0 +1,113 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef _STREAMCREDITS_H
+#define _STREAMCREDITS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define STREAM_NUM          3 // STREAM_CCB1, STREAM_CCQ1 and STREAM_BA81, index is the bit's position
+
+// What the device's stream_*() calls (device/video/stream.cpp) count for the streams a host has
+// subscribed to.  A stream is due every decimation frames, and a frame that's due is dropped (and
+// counted against its stream) if the host can't take it: the link isn't ready (not connected, or
+// still busy with the last send), the host has run out of credits (it hasn't acknowledged enough
+// of what we've sent), or the send fails.  Dropped frames don't use credits.
+class StreamCredits
+{
+public:
+    StreamCredits()
+    {
+        reset(0, 1, 0);
+    }
+
+    // new subscription, credits 0 is no limit
+    void reset(uint32_t streams, uint8_t decimation, uint8_t credits)
+    {
+        m_streams = streams;
+        m_decimation = decimation ? decimation : 1;
+        m_credits = credits;
+        m_seq = 0;
+        m_sent = 0;
+        m_consumed = 0;
+        memset(m_drops, 0, sizeof(m_drops));
+    }
+
+    // host has received consumed frames since subscribing
+    void ack(uint32_t consumed)
+    {
+        m_consumed = consumed;
+    }
+
+    // once per frame, before due()
+    void frame()
+    {
+        m_seq++;
+    }
+
+    bool subscribed(uint32_t streams) const
+    {
+        return (m_streams&streams)!=0;
+    }
+
+    // true if stream (bit) should be sent this frame, counts a drop if the link isn't ready for it
+    bool due(uint32_t stream, uint8_t index, bool ready)
+    {
+        if (!(m_streams&stream) || m_seq%m_decimation)
+            return false;
+        // signed, so a host that acks more than it got doesn't look like it's run out
+        if (!ready || (m_credits && (int32_t)(m_sent-m_consumed)>=(int32_t)m_credits))
+        {
+            m_drops[index]++;
+            return false;
+        }
+        return true;
+    }
+
+    // result of sending a frame that was due, passed through
+    int sent(int res, uint8_t index)
+    {
+        if (res>=0)
+            m_sent++;
+        else
+            m_drops[index]++;
+        return res;
+    }
+
+    uint32_t seq() const
+    {
+        return m_seq;
+    }
+    uint32_t drops(uint8_t index) const
+    {
+        return m_drops[index];
+    }
+    uint32_t sentFrames() const
+    {
+        return m_sent;
+    }
+
+private:
+    uint32_t m_streams;
+    uint8_t m_decimation;
+    uint8_t m_credits;
+    uint32_t m_seq;
+    uint32_t m_sent;
+    uint32_t m_consumed;
+    uint32_t m_drops[STREAM_NUM];
+};
+
+#endif
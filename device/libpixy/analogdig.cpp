@@ -66,13 +66,13 @@ int AnalogDig::update()
 		{
 			val = blob->m_left+(blob->m_right-blob->m_left)/2;
 			val *= (1<<16);
-			val /= CAM_RES2_WIDTH;
+			val /= CC_WIDTH(g_blobsRes);
 		}
 		else
 		{
-			val = CAM_RES2_HEIGHT-(blob->m_top+(blob->m_bottom-blob->m_top)/2);
+			val = CC_HEIGHT(g_blobsRes)-(blob->m_top+(blob->m_bottom-blob->m_top)/2);
 			val *= (1<<16);
-			val /= CAM_RES2_HEIGHT;
+			val /= CC_HEIGHT(g_blobsRes);
 		}
 		val &= 0x0000ffc0; // mask other bits (because datasheet instructs us to do so)
 
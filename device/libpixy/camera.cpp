@@ -25,7 +25,7 @@ static const ProcModule g_module[] =
 	(ProcPtr)cam_setMode, 
 	{CRP_INT8, END}, 
 	"Set camera mode"
-	"@p mode 0=25 FPS, 1280x800; 1=50 FPS, 640x400"
+	"@p mode 0=25 FPS, 1280x800; 1=50 FPS, 640x400; 2=12.5 FPS, 1280x800"
 	"@r 0 if success, negative if error"
 	},
 	{
@@ -288,6 +288,12 @@ int32_t cam_setMode(const uint8_t &mode)
 {
 	if (mode!=g_mode)
 	{
+		if (mode>CAM_MODE2)
+			return -1;
+		// restore pixel clock divider (see g_baseRegs)
+		if (g_mode==CAM_MODE2)
+			g_sccb->Write(0x11, 0x00);
+
 		if (mode==0)
 		{
 			cam_setRegs(g_mode0Regs, sizeof(g_mode0Regs));
@@ -298,8 +304,13 @@ int32_t cam_setMode(const uint8_t &mode)
 			cam_setRegs(g_mode1Regs, sizeof(g_mode1Regs));
 			g_mode = 1;
 		}
-		else 
-			return -1;
+		else
+		{
+			cam_setRegs(g_mode0Regs, sizeof(g_mode0Regs));
+			// divider (1+1)*2 instead of 2, half the pixel clock
+			g_sccb->Write(0x11, 0x01);
+			g_mode = 2;
+		}
 	}
 	return 0;
 }
@@ -507,9 +518,9 @@ int32_t cam_getFrame(uint8_t *memory, uint32_t memSize, uint8_t type, uint16_t x
 		return res;
 
 	// forward call to M0, get frame
-	g_chirpM0->callSync(g_getFrameM0, 
-		UINT8(type), UINT32((uint32_t)memory), UINT16(xOffset), UINT16(yOffset), UINT16(xWidth), UINT16(yWidth), END_OUT_ARGS,
-		&responseInt, END_IN_ARGS);
+	ChirpWriter writer(g_chirpM0, CRP_CALL);
+	writer << type << (uint32_t)memory << xOffset << yOffset << xWidth << yWidth;
+	g_chirpM0->callTyped(SYNC, g_getFrameM0, &writer, &responseInt, END_IN_ARGS);
 
 	if (responseInt==0)
 	{
@@ -532,7 +543,9 @@ int32_t cam_getFrameChirpFlags(const uint8_t &type, const uint16_t &xOffset, con
 	uint8_t *frame = (uint8_t *)SRAM1_LOC;
 
 	// fill buffer contents manually for return data 
-	len = Chirp::serialize(chirp, frame, SRAM1_SIZE, HTYPE(FOURCC('B','A','8','1')), HINT8(renderFlags), UINT16(xWidth), UINT16(yWidth), UINTS8_NO_COPY(xWidth*yWidth), END);
+	ChirpWriter writer(chirp, frame, SRAM1_SIZE);
+	writer << CrpHType(FOURCC('B','A','8','1')) << CrpHint<uint8_t>(renderFlags) << xWidth << yWidth << CrpArrayNoCopy<uint8_t>(xWidth*yWidth);
+	len = writer.len();
 	// write frame after chirp args
 	result = cam_getFrame(frame+len, SRAM1_SIZE-len, type, xOffset, yOffset, xWidth, yWidth);
 
@@ -18,6 +18,9 @@
 
 #define CAM_MODE0               0x00
 #define CAM_MODE1               0x01
+// same as CAM_MODE0 with half the pixel clock (12.5 FPS), so pixels come at the CAM_MODE1 rate
+// and the M0 can run-length segment 1280x800 (CAM_RES1 blobs)
+#define CAM_MODE2               0x02
 
 #define CAM_LIGHT_NORMAL        0
 #define CAM_LIGHT_LOW           1
@@ -14,6 +14,7 @@
 //
 
 #include <pixyvals.h>
+#include <cameravals.h>
 #include "chirp.h"
 #include "exec_m0.h"
 #include "rls_m0.h"
@@ -61,7 +62,10 @@ uint32_t g_lut = SRAM1_LOC + SRAM1_SIZE-LUT_MEMORY_SIZE;
 
 void loop0()
 {
-	getRLSFrame(&g_m0mem, &g_lut);	
+	// the program is the RLS resolution, CAM_RES1 or CAM_RES2 (0 is also CAM_RES2)
+	uint32_t res = g_program==CAM_RES1 ? CAM_RES1 : CAM_RES2;
+
+	getRLSFrame(&g_m0mem, &g_lut, &res);	
 }
 
 
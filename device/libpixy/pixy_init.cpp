@@ -192,6 +192,7 @@ void pixyInit(uint32_t slaveRomStart, const unsigned char slaveImage[], uint32_t
 	// initialize chirp objects
 	USBLink *usbLink = new USBLink;
 	g_chirpUsb = new Chirp(false, false, usbLink);
+	g_chirpUsb->setBatch(USB_BATCH_SIZE, USB_BATCH_DEADLINE);
 	SMLink *smLink = new SMLink;
   	g_chirpM0 = new Chirp(false, true, smLink);
 
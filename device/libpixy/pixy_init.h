@@ -33,6 +33,10 @@ extern uint8_t *__Vectors;
 #define STACK_GUARD           *(uint16_t *)(__Vectors - 0x600)
 #define STACK_GUARD_WORD      0xABCD
 
+// prints, block lists, etc. are sent to the host together (Chirp::setBatch())
+#define USB_BATCH_SIZE        0x200
+#define USB_BATCH_DEADLINE    1000 // us
+
 void pixyInit(uint32_t slaveRomStart, const unsigned char slaveImage[], uint32_t imageSize);
 void pixySimpleInit(void);
 
@@ -13,6 +13,7 @@
 // end license header
 //
 
+#include "lpc43xx.h"
 #include "rls_m0.h"
 #include "frame_m0.h"
 #include "chirp.h"
@@ -20,7 +21,7 @@
 
 
 //#define RLTEST
-#define MAX_QVALS_PER_LINE 	CAM_RES2_WIDTH/5	 // width/5 because that's the worst case with noise filtering
+#define MAX_QVALS_PER_LINE(width) 	((width)/5)	 // width/5 because that's the worst case with noise filtering
 
 uint8_t *g_logLut = NULL;
 
@@ -528,6 +529,249 @@ ecpy	LSRS    r0, #2 // return number of qvals
 		POP		{r1-r7, pc}
 } 
 
+__asm uint32_t lineProcessedRL1AW(uint32_t *gpio, Qval *memory, uint8_t *lut, uint8_t *linestore, uint32_t width, uint8_t *shiftLut, 
+	Qval *qqMem, uint32_t qqIndex, uint32_t qqSize) // width in bytes
+{
+// Same as lineProcessedRL1A, but the q vals are wide q vals (see qqueue.h) for CAM_RES1 (640 columns).  
+// Only the QVAL macro differs-- it takes the same number of cycles, so pixel sync is the same.  
+// This is run in CAM_MODE2, where the pixel clock is half of CAM_MODE0's, so the pixels come at the 
+// CAM_MODE1 rate and the same pixel sync (callSyncM1) and cycle counts work.
+// Register use is the same as lineProcessedRL1A. 
+
+#ifndef RLTEST
+		MACRO 
+$lx		REDW		
+$lx		LDRB 	r6, [r0] // load red pixel 
+		// cycle
+		MEND
+
+		MACRO 
+$lx		GREENW		
+$lx		LDRB 	r5, [r0] // load green pixel 
+		// cycle
+		MEND
+#else // RLTEST
+		MACRO 
+$lx		REDW
+$lx		LDRB 	r6, [r0, r4] // load red pixel 
+		// cycle
+		MEND
+
+		MACRO 
+$lx		GREENW		
+$lx		LDRB 	r5, [r0, r4] // load green pixel 
+		ADDS	r4, #1		
+		// cycle
+		MEND
+#endif	// RLTEST
+
+		MACRO // create index, lookup, inc col, extract model
+$lx		LEXTW	$rx
+$lx		REDW
+		// cycle
+		//SUBS	r6, r5   // red-green
+		ADDS	r6, r5   //MJLM: ADD red and green, rather than subtracting them, to retain luminance info.
+		SUBS	r6, #127 //MJLM: added line to subtract 127 to go back to -127:127 scale
+		ASRS	r6, #1	 // reduce 9 to 8 bits arithmetically
+		LSLS	r6, #24  // shift red-green and get rid of higher-order bits
+		LSRS	r6, #16  // shift red-green back, make it the higher 8 bits of the index
+		LDRB	r5, [r3, r4] // load blue-green val
+		// cycle
+		ORRS	r5, r6   // form 16-bit index
+		LDRB	r1, [r2, r5] // load lut val mjlm: ldrb ra, [rb, rc] loads into ra from address rb plus shift rc. here, it loads from lut (r2), shifted by the hue index in r5.
+		// cycle
+		ADDS 	r4, #1 // inc col 
+		// *** PIXEL SYNC
+		GREENW
+		// cycle
+		LSLS	$rx, r1, #29 // knock off msb's
+		LSRS	$rx, #29 // extract model, put in rx
+		MEND
+
+		MACRO // check for end of line
+$lx		EOL_CHECKW
+$lx		CMP 	r4, r9
+		BGE		eolW
+	   	MEND
+
+		// wide q val:
+		// | 3 bits    | 6 bits      | 10 bits | 10 bits   | 3 bits |
+		// | shift val | shifted sum | length  | begin col | model  |
+		MACRO // create q val
+$lx		QVALW
+		MOV 	r5, r10 // r5 gets beginning column 
+		LSLS 	r6, r5, #3 // r6 gets shifted beginning column
+		ORRS	r6, r7 // add model
+		SUBS  	r1, r4, r5 // r1 gets length
+		LSLS 	r5, r1, #13 // r5 gets shifted length
+		ORRS 	r6, r5 // combine
+		// *** PIXEL SYNC (red)
+		LDR		r5, [sp, #0x24] // bring in shift lut 
+		// cycle
+		LDRB 	r1, [r1, r5] // look up	number of shifts (log2)
+		// cycle
+		MOV 	r5, r8 // bring in sum
+		LSRS 	r5, r1 // shift it the required amount-- biased by 3 
+		LSLS	r5, #23 // make room for shifted sum
+		ORRS 	r6, r5 // combine shifted sum
+		LSLS 	r1, #29 // shift shift-val
+		ORRS	r6, r1 // save shift number
+		MOV 	r1, r12 // bring in q mem
+		MOVS 	r7, #4
+		// *** PIXEL SYNC (green)
+		GREENW
+		// cycle
+		STR 	r6, [r1] // store q val
+		// cycle
+		ADD  	r12, r7 // increment q mem
+		MEND
+
+		PRESERVE8
+		IMPORT 	callSyncM1
+
+		PUSH	{r1-r7, lr}
+		// bring in ending column
+		LDR		r4, [sp, #0x20]
+	   	MOV		r9, r4
+	  	MOVS	r5, #0x1
+		LSLS	r5, #11
+
+		PUSH	{r0-r3} // save args
+		BL.W	callSyncM1 // get pixel sync
+		POP		{r0-r3}	// restore args
+
+	   	// pixel sync starts here
+		
+		// wait for hsync to go high
+dest12AW	LDR 	r6, [r0] 	// 2
+		TST		r6, r5		// 1
+		BEQ		dest12AW		// 3
+
+		// variable delay --- get correct phase for sampling
+		MOV		r12, r1 // save q memory
+		MOVS	r4, #0 // clear column value
+
+		// *** PIXEL SYNC (start reading pixels)
+		GREENW
+		// cycle
+		NOP
+		NOP
+		NOP
+		NOP
+		NOP
+		NOP
+zero0W	MOVS	r6, #0 
+		MOV		r8, r6	// clear sum (so we don't think we have an outstanding segment)
+		EOL_CHECKW
+		// cycle
+		// *** PIXEL SYNC (check for nonzero lut value)
+zero1W	LEXTW 	r7
+		// cycle
+		// cycle
+		// cycle
+		CMP 	r7, #0
+		BEQ 	zero0W 
+		MOV		r10, r4 // save start column
+		ADD		r8, r1 // add to sum
+		EOL_CHECKW
+		// cycle
+		NOP
+		NOP
+		// *** PIXEL SYNC (check nonzero value for consistency)
+		LEXTW 	r6
+		// cycle
+		// cycle
+		// cycle
+		CMP		r6, r7
+		BNE		zero0W
+		NOP
+		NOP
+oneW		MOV		r11, r1	// save last lut val
+		ADD		r8, r1 // add to sum
+		EOL_CHECKW
+		// cycle
+		// *** PIXEL SYNC (run-length segment)
+		LEXTW 	r6
+		// cycle
+		// cycle
+		// cycle
+		CMP		r6, r7
+		BEQ		oneW
+		ADD		r8, r11 // need to add something-- use last lut val
+		EOL_CHECKW
+		// cycle
+		NOP
+		NOP
+		NOP
+		// *** PIXEL SYNC (1st pixel not equal)
+		LEXTW 	r6
+		// cycle
+		// cycle
+		// cycle
+		CMP		r6, r7
+		BEQ		oneW	
+		// 2nd pixel not equal--- run length is done
+		QVALW
+		// cycle
+		// cycle
+		// cycle
+		// cycle
+		MOVS	r6, #0
+		MOV		r8, r6 // clear sum
+		ADDS	r4, #1 // add column
+		NOP
+		B 		zero1W
+			
+eolW	    
+		// check r8 for unfinished q val
+		MOVS	r6, #0
+		CMP		r8, r6
+		BEQ		eol0W
+		QVALW		
+
+	   	// wait for hsync to go low
+eol0W	MOVS	r5, #0x1
+		LSLS	r5, #11
+dest20AW	LDR 	r6, [r0] 	// 2
+		TST		r6, r5		// 1
+		BNE		dest20AW		// 3
+
+	    // maximum qvals/line = 640/5 = 128, copying them takes about 1700 cycles (13 cycles/qval), 
+		// which is less than the 1800 cycles of horizontal blanking in lineProcessedRL1A.  
+		// In CAM_MODE2 blanking is also twice as long as in CAM_MODE0 (in cycles).
+		// See lineProcessedRL1A.
+		MOV		r0, r12  // qval pointer
+		LDR		r1, [sp] // bring in original q memory location 
+		SUBS	r0, r1 // get number of qvals*4
+
+		LDR		r2, [sp, #0x28] // bring in qq memory pointer 
+		LDR		r3, [sp, #0x2c] // bring in qq index
+		LSLS 	r3, #2 // qq index in bytes (4 bytes/qval)
+		LDR		r4, [sp, #0x30] // bring in qq size
+		LSLS 	r4, #2 // qq size in bytes (4 bytes/qval)
+
+		MOVS	r5, #0
+
+lcpyW	CMP		r0, r5	  // 1 end condition
+		BEQ		ecpyW	  // 1 exit
+
+		LDR		r6, [r1, r5]  // 2 copy (read)
+		STR		r6, [r2, r3]  // 2 copy (write)
+
+		ADDS	r3, #4	  // 1 inc qq index
+		ADDS	r5, #4	  // 1 inc counter
+
+		CMP		r4, r3    // 1 check for qq index wrap
+		BEQ		wrapW	  // 1
+		B		lcpyW	  // 3
+
+wrapW	MOVS	r3, #0    // reset qq index
+		B lcpyW
+
+ecpyW	LSRS    r0, #2 // return number of qvals
+		POP		{r1-r7, pc}
+} 
+
 
 uint8_t intLog(int i)
 {
@@ -538,7 +782,8 @@ void createLogLut(void)
 {
 	int i;
 	
-	for (i=0; i<CAM_RES2_WIDTH; i++)
+	// segment lengths go up to the line width (CAM_RES1_WIDTH) plus 2
+	for (i=0; i<CAM_RES1_WIDTH+4; i++)
 		g_logLut[i] = intLog(i) + 3;
 }
 
@@ -555,19 +800,42 @@ uint32_t rgData[] =
 #endif
 
 
-int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
+// Cost per frame:
+// CAM_RES2: 320x200 in CAM_MODE1, 50 fps, 20ms per frame, at most 64 qvals per line.
+// CAM_RES1: 640x400 in CAM_MODE2, 12.5 fps, 80ms per frame, at most 128 qvals per line.
+// The M0 is busy for the whole frame either way (it processes pixels as they arrive).  
+// CAM_RES1 has 4 times the pixels.  For the same scene there are twice the rows and about twice the
+// qvals per frame (measured with the host model in common/rls.cpp), so blob assembly on the M4 takes 
+// about twice as long per frame, at a quarter of the frame rate.  
+// The qqueue holds 0x3000 bytes, ~24 CAM_RES1 lines of worst-case qvals, so the M4 needs to keep up.  
+int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut, uint32_t *res)
 {
 	uint8_t *lut2 = (uint8_t *)*lut;
 	Qval *qvalStore = (Qval *)*m0Mem;
 	uint32_t line;
 	uint32_t numQvals;
 	uint32_t totalQvals;
+	uint32_t width, height, maxQvals;
 	uint8_t *lineStore;
 	uint8_t *logLut;
+	struct QqueueStamp *stamp;
 
-	lineStore = (uint8_t *)(qvalStore + MAX_QVALS_PER_LINE);
-	logLut = lineStore + CAM_RES2_WIDTH + 4;
-	// m0mem needs to be at least 64*4 + CAM_RES2_WIDTH*2 + 4 =	900 ~ 1024
+	if (*res==CAM_RES1)
+	{
+		width = CAM_RES1_WIDTH;
+		height = CAM_RES1_HEIGHT;
+	}
+	else
+	{
+		width = CAM_RES2_WIDTH;
+		height = CAM_RES2_HEIGHT;
+	}
+	maxQvals = MAX_QVALS_PER_LINE(width);
+
+	// same layout for both resolutions so the log lut stays put
+	lineStore = (uint8_t *)(qvalStore + MAX_QVALS_PER_LINE(CAM_RES1_WIDTH));
+	logLut = lineStore + CAM_RES1_WIDTH + 4;
+	// m0mem needs to be at least 128*4 + CAM_RES1_WIDTH*2 + 8 = 1800 ~ 2048
 
 	if (g_logLut!=logLut)
 	{
@@ -576,22 +844,32 @@ int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
 	}
 
 	// don't even attempt to grab lines if we're lacking space...
-	if (qq_free()<MAX_QVALS_PER_LINE)
+	if (qq_free()<maxQvals)
 		return -1; 
 
-	// indicate start of frame
-	qq_enqueue(0xffffffff); 
+	// stamp the frame so the M4 can tell how long it's been in the pipeline (stream trailers)
+	stamp = &g_qqueue->stamps[g_qqueue->frames++&(QQ_STAMPS-1)];
+	stamp->index = g_qqueue->produced;
+	stamp->start = 0;
+	stamp->end = 0;
+
+	// indicate start of frame, and how the qvals are encoded
+	qq_enqueue(*res==CAM_RES1 ? QVAL_FRAME_START_WIDE : QVAL_FRAME_START); 
 	skipLines(0);
-	for (line=0, totalQvals=1; line<CAM_RES2_HEIGHT; line++)  // start totalQvals at 1 because of start of frame value
+	stamp->start = LPC_TIMER2->TC;
+	for (line=0, totalQvals=1; line<height; line++)  // start totalQvals at 1 because of start of frame value
 	{
 		// not enough space--- return error
-		if (qq_free()<MAX_QVALS_PER_LINE)
+		if (qq_free()<maxQvals)
 			return -1; 
 		// mark beginning of this row (column 0 = 0)
 		// column 1 is the first real column of pixels
 		qq_enqueue(0); 
-		lineProcessedRL0A((uint32_t *)&CAM_PORT, lineStore, CAM_RES2_WIDTH); 
-		numQvals = lineProcessedRL1A((uint32_t *)&CAM_PORT, qvalStore, lut2, lineStore, CAM_RES2_WIDTH, g_logLut, g_qqueue->data, g_qqueue->writeIndex, QQ_MEM_SIZE);
+		lineProcessedRL0A((uint32_t *)&CAM_PORT, lineStore, width); 
+		if (*res==CAM_RES1)
+			numQvals = lineProcessedRL1AW((uint32_t *)&CAM_PORT, qvalStore, lut2, lineStore, width, g_logLut, g_qqueue->data, g_qqueue->writeIndex, QQ_MEM_SIZE);
+		else
+			numQvals = lineProcessedRL1A((uint32_t *)&CAM_PORT, qvalStore, lut2, lineStore, width, g_logLut, g_qqueue->data, g_qqueue->writeIndex, QQ_MEM_SIZE);
 		// modify qq to reflect added data
 		g_qqueue->writeIndex += numQvals;
 		if (g_qqueue->writeIndex>=QQ_MEM_SIZE)
@@ -599,6 +877,7 @@ int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut)
 		g_qqueue->produced += numQvals;
 		totalQvals += numQvals+1; // +1 because of beginning of line 
 	}
+	stamp->end = LPC_TIMER2->TC;
 	return 0;
 }
 
@@ -19,6 +19,6 @@
 #include <inttypes.h>
 
 int rls_init(void);
-int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut);
+int32_t getRLSFrame(uint32_t *m0Mem, uint32_t *lut, uint32_t *res); // res is CAM_RES1 or CAM_RES2
 
 #endif
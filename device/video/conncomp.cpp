@@ -29,6 +29,8 @@
 
 Qqueue *g_qqueue;
 Blobs *g_blobs;
+uint8_t g_rlsRes = CAM_RES2;
+uint8_t g_blobsRes = CAM_RES2;
 
 int g_loop = 0;
 
@@ -164,6 +166,8 @@ void cc_loadParams(void)
 		"@c Signature_creation Sets how inclusive the color signatures are with respect to hue. Applies during teaching. (default 1.0)", FLT32(1.0), END);
 	prm_add("Saturation spread", 0,
 		"@c Signature_creation Sets how inclusive the color signatures are with respect to saturation. Applies during teaching. (default 1.0)", FLT32(1.0), END);
+	prm_add("High resolution", 0,
+		"@c Signature_creation Finds blocks in 640x400 images at 12.5 frames per second instead of 320x200 images at 50 frames per second, 0=disable, 1=enable. (default 0)", UINT8(0), END);
 
 	// load
 	float minSat, hueTol, satTol;
@@ -179,6 +183,10 @@ void cc_loadParams(void)
 	prm_get("Min block area", &minArea, END);
 	g_blobs->setParams(maxBlobs, maxBlobsPerModel, minArea);
 
+	uint8_t highRes;
+	prm_get("High resolution", &highRes, END);
+	g_rlsRes = highRes ? CAM_RES1 : CAM_RES2;
+
 	cc_loadLut();
 
 }
@@ -333,39 +341,41 @@ int32_t cc_getRLSFrameChirpFlags(Chirp *chirp, uint8_t renderFlags)
 	g_qqueue->flush();
 
 	// figure out prebuf length (we need the prebuf length and the number of runlength segments, but there's a chicken and egg problem...)
-	len = Chirp::serialize(chirp, RLS_MEMORY, RLS_MEMORY_SIZE,  HTYPE(0), UINT16(0), UINT16(0), UINTS32_NO_COPY(0), END);
+	ChirpWriter prebuf(chirp, RLS_MEMORY, RLS_MEMORY_SIZE);
+	prebuf << CrpHType(0) << (uint16_t)0 << (uint16_t)0 << CrpArrayNoCopy<uint32_t>(0);
+	len = prebuf.len();
 
-	result = cc_getRLSFrame((uint32_t *)(RLS_MEMORY+len), LUT_MEMORY);
+	result = cc_getRLSFrame((uint32_t *)(RLS_MEMORY+len), LUT_MEMORY, true, g_rlsRes);
 	// copy from IPC memory to RLS_MEMORY
 	numRls = g_qqueue->readAll((Qval *)(RLS_MEMORY+len), (RLS_MEMORY_SIZE-len)/sizeof(Qval));
-	Chirp::serialize(chirp, RLS_MEMORY, RLS_MEMORY_SIZE,  HTYPE(FOURCC('C','C','Q','1')), HINT8(renderFlags), UINT16(CAM_RES2_WIDTH), UINT16(CAM_RES2_HEIGHT), UINTS32_NO_COPY(numRls), END);
+	ChirpWriter writer(chirp, RLS_MEMORY, RLS_MEMORY_SIZE);
+	writer << CrpHType(FOURCC('C','C','Q','1')) << CrpHint<uint8_t>(renderFlags) << (uint16_t)CC_WIDTH(g_rlsRes) << (uint16_t)CC_HEIGHT(g_rlsRes) << CrpArrayNoCopy<uint32_t>(numRls);
 	// send frame, use in-place buffer
 	chirp->useBuffer(RLS_MEMORY, len+numRls*4);
 
 	return result;
 }
 
-int32_t cc_getRLSFrame(uint32_t *memory, uint8_t *lut, bool sync)
+int32_t cc_getRLSFrame(uint32_t *memory, uint8_t *lut, bool sync, uint8_t res)
 {
-	int32_t res;
+	int32_t result;
 	int32_t responseInt = -1;
 
 	// check mode, set if necessary
-	if ((res=cam_setMode(CAM_MODE1))<0)
-		return res;
+	if ((result=cam_setMode(CC_CAM_MODE(res)))<0)
+		return result;
 
 	// forward call to M0, get frame
+	ChirpWriter writer(g_chirpM0, CRP_CALL);
+	writer << (uint32_t)memory << (uint32_t)lut << (uint32_t)res;
 	if (sync)
 	{
-		g_chirpM0->callSync(g_getRLSFrameM0, 
-			UINT32((uint32_t)memory), UINT32((uint32_t)lut), END_OUT_ARGS,
-			&responseInt, END_IN_ARGS);
+		g_chirpM0->callTyped(SYNC, g_getRLSFrameM0, &writer, &responseInt, END_IN_ARGS);
 		return responseInt;
 	}
 	else
 	{
-		g_chirpM0->callAsync(g_getRLSFrameM0, 
-			UINT32((uint32_t)memory), UINT32((uint32_t)lut), END_OUT_ARGS);
+		g_chirpM0->callTyped(ASYNC, g_getRLSFrameM0, &writer);
 		return 0;
 	}
 
@@ -381,9 +391,12 @@ int32_t cc_setMemory(const uint32_t &location, const uint32_t &len, const uint8_
 	return len;
 }
 
-int cc_sendBlobs(Chirp *chirp, const BlobA *blobs, uint32_t len, uint8_t renderFlags)
+int cc_sendBlobs(Chirp *chirp, const BlobA *blobs, uint32_t len, uint8_t renderFlags, uint8_t res)
 {
-	CRP_RETURN(chirp, HTYPE(FOURCC('C','C','B','1')), HINT8(renderFlags), HINT16(CAM_RES2_WIDTH), HINT16(CAM_RES2_HEIGHT), UINTS16(len*sizeof(BlobA)/sizeof(uint16_t), blobs), END);
+	ChirpWriter writer(chirp, 0);
+	writer << CrpHType(FOURCC('C','C','B','1')) << CrpHint<uint8_t>(renderFlags) << CrpHint<uint16_t>(CC_WIDTH(res)) << CrpHint<uint16_t>(CC_HEIGHT(res)) <<
+		CrpArray<uint16_t>(len*sizeof(BlobA)/sizeof(uint16_t), (const uint16_t *)blobs);
+	chirp->assemble(&writer);
 	return 0;
 }
 
@@ -16,12 +16,18 @@
 #ifndef _CONNCOMP_H
 #define _CONNCOMP_H
 #include "chirp.hpp"
+#include "cameravals.h"
 #include <blob.h>
 #include "blobs.h"
 
 #define RLS_MEMORY          ((uint8_t *)SRAM1_LOC)
 #define RLS_MEMORY_SIZE     (SRAM1_SIZE-CL_LUT_SIZE) // bytes
 
+// RLS/blob resolution (CAM_RES1 or CAM_RES2) -> image size and camera mode
+#define CC_WIDTH(res)       ((res)==CAM_RES1 ? CAM_RES1_WIDTH : CAM_RES2_WIDTH)
+#define CC_HEIGHT(res)      ((res)==CAM_RES1 ? CAM_RES1_HEIGHT : CAM_RES2_HEIGHT)
+#define CC_CAM_MODE(res)    ((res)==CAM_RES1 ? CAM_MODE2 : CAM_MODE1)
+
 int cc_init(Chirp *chirp);
 
 int32_t cc_setSigRegion(const uint8_t &model, const uint16_t &xoffset, const uint16_t &yoffset, const uint16_t &width, const uint16_t &height);
@@ -31,9 +37,9 @@ int32_t cc_clearAllSig();
 int32_t cc_setMemory(const uint32_t &location, const uint32_t &len, const uint8_t *data);
 int32_t cc_getRLSFrameChirp(Chirp *chirp);
 int32_t cc_getRLSFrameChirpFlags(Chirp *chirp, uint8_t renderFlags=RENDER_FLAG_FLUSH);
-int32_t cc_getRLSFrame(uint32_t *memory, uint8_t *lut, bool sync=true);
+int32_t cc_getRLSFrame(uint32_t *memory, uint8_t *lut, bool sync=true, uint8_t res=CAM_RES2);
 
-int cc_sendBlobs(Chirp *chirp, const BlobA *blobs, uint32_t len, uint8_t renderFlags=RENDER_FLAG_FLUSH);
+int cc_sendBlobs(Chirp *chirp, const BlobA *blobs, uint32_t len, uint8_t renderFlags=RENDER_FLAG_FLUSH, uint8_t res=CAM_RES2);
 int cc_loadLut(void);
 
 void cc_loadParams(void);
@@ -42,6 +48,8 @@ void cc_setLED();
 
 extern Qqueue *g_qqueue;
 extern Blobs *g_blobs;
+extern uint8_t g_rlsRes; // resolution of the blobs program, from the "High resolution" parameter
+extern uint8_t g_blobsRes; // resolution of the blobs in g_blobs, set by the program that runs the M0
 extern const uint32_t g_colors[];
 
 #endif
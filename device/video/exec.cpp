@@ -114,12 +114,16 @@ int exec_init(Chirp *chirp)
 }
 
 
-int exec_addProg(Program *prog, bool video)
+int exec_addProg(Program *prog, uint8_t progNum)
 {
 	int i;
 
-	if (video)
-		g_progTable[EXEC_VIDEO_PROG-1] = prog;
+	if (progNum)
+	{
+		if (progNum>EXEC_MAX_PROGS)
+			return -1;
+		g_progTable[progNum-1] = prog;
+	}
 	else
 	{
 		for (i=0; g_progTable[i]; i++)
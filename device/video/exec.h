@@ -24,6 +24,7 @@
 
 #define EXEC_MAX_PROGS   8
 #define EXEC_VIDEO_PROG  EXEC_MAX_PROGS
+#define EXEC_HOST_PROG   (EXEC_MAX_PROGS-1) // the program the host uploaded (hostprog.h)
 
 typedef int (*ProgFunc)();
 
@@ -38,7 +39,7 @@ struct Program
 void exec_loop();
 int exec_init(Chirp *chirp);
 void exec_select();
-int exec_addProg(Program *prog, bool video=false);
+int exec_addProg(Program *prog, uint8_t progNum=0); // progNum puts it at a fixed program number
 
 int exec_runM0(uint8_t prog);
 int exec_stopM0();
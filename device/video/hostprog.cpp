@@ -0,0 +1,131 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <new>
+#include <string.h>
+#include "pixy_init.h"
+#include "hostprog.h"
+
+static const ProcModule g_module[] =
+{
+	{
+	"hostprog_add",
+	(ProcPtr)hostprog_add,
+	{CRP_UINT16, CRP_UINTS8, END},
+	"Add a call to the end of the uploaded program"
+	"@p proc procedure to call"
+	"@p args the call's args, serialized as they are sent in a call chirp"
+	"@r 0 if successful, -1 if out of memory, -2 if the program is full"
+	},
+	{
+	"hostprog_clear",
+	(ProcPtr)hostprog_clear,
+	{END},
+	"Remove all of the uploaded program's calls"
+	"@r always returns 0"
+	},
+	{
+	"hostprog_run",
+	(ProcPtr)hostprog_run,
+	{END},
+	"Run the uploaded program, its calls are made over and over until it's stopped"
+	"@r 0 if successful, -1 if there are no calls"
+	},
+	END
+};
+
+Program g_progHost =
+{
+	"host",
+	"calls uploaded by the host",
+	hostSetup,
+	hostLoop
+};
+
+// each call is one of these followed by its args, padded to 4 bytes so the args stay aligned
+struct HostCall
+{
+	uint16_t proc;
+	uint16_t len;
+};
+
+#define HOSTPROG_CALL_SIZE(len)  (sizeof(HostCall)+(((len)+3)&~3))
+
+static uint8_t *g_prog = NULL;
+static uint32_t g_len = 0;
+
+int hostprog_init(Chirp *chirp)
+{
+	chirp->registerModule(g_module);
+	return 0;
+}
+
+int32_t hostprog_add(const uint16_t &proc, const uint32_t &len, const uint8_t *args)
+{
+	HostCall *call;
+
+	if (g_prog==NULL && (g_prog=new (std::nothrow) uint8_t[HOSTPROG_SIZE])==NULL)
+		return -1;
+	// check len by itself first so that HOSTPROG_CALL_SIZE() can't wrap
+	if (len>HOSTPROG_SIZE || HOSTPROG_CALL_SIZE(len)>HOSTPROG_SIZE-g_len)
+		return -2;
+
+	call = (HostCall *)(g_prog+g_len);
+	call->proc = proc;
+	call->len = len;
+	memcpy(call+1, args, len);
+	g_len += HOSTPROG_CALL_SIZE(len);
+
+	return 0;
+}
+
+int32_t hostprog_clear()
+{
+	delete [] g_prog;
+	g_prog = NULL;
+	g_len = 0;
+
+	return 0;
+}
+
+int32_t hostprog_run()
+{
+	if (g_len==0)
+		return -1;
+
+	return exec_runprog(EXEC_HOST_PROG);
+}
+
+int hostSetup()
+{
+	return g_len ? 0 : -1;
+}
+
+int hostLoop()
+{
+	uint32_t i;
+	int32_t response;
+	HostCall *call;
+
+	// the calls' responseInts have nowhere to go, but a call that can't be made stops us
+	for (i=0; i<g_len; i+=HOSTPROG_CALL_SIZE(call->len))
+	{
+		call = (HostCall *)(g_prog+i);
+		if (g_chirpUsb->callLocal(call->proc, (uint8_t *)(call+1), call->len, &response)<0)
+			return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,41 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef _HOSTPROG_H
+#define _HOSTPROG_H
+
+#include "chirp.hpp"
+#include "exec.h"
+
+#define HOSTPROG_SIZE        0x400 // bytes of uploaded calls, serialized args plus 4 bytes each
+
+// A program defined on the host (PixyMon's "do ... done") and uploaded once with hostprog_add,
+// a call at a time, serialized as the host would send it.  Run as program EXEC_HOST_PROG, it
+// makes the calls over and over.  They aren't chirp calls, so whatever they return (frames,
+// etc.) is pushed to the host as XDATA, the same as the video program's frames, and the host
+// only has to receive.
+
+extern Program g_progHost;
+
+int hostprog_init(Chirp *chirp);
+
+int32_t hostprog_add(const uint16_t &proc, const uint32_t &len, const uint8_t *args);
+int32_t hostprog_clear();
+int32_t hostprog_run();
+
+int hostSetup();
+int hostLoop();
+
+#endif
@@ -29,6 +29,8 @@
 #include "progpt.h"
 #include "param.h"
 #include "serial.h"
+#include "stream.h"
+#include "hostprog.h"
 
 // M0 code 
 const // so m0 program goes into RO memory
@@ -57,12 +59,15 @@ int main(void)
 	cc_init(g_chirpUsb);
 	ser_init();
 	exec_init(g_chirpUsb);
+	stream_init(g_chirpUsb);
+	hostprog_init(g_chirpUsb);
 
 #if 1
 	exec_addProg(&g_progBlobs);
 	ptLoadParams();
 	exec_addProg(&g_progPt);
-	exec_addProg(&g_progVideo, true);
+	exec_addProg(&g_progVideo, EXEC_VIDEO_PROG);
+	exec_addProg(&g_progHost, EXEC_HOST_PROG);
 	exec_loop(); //mm frame grabbing loop?
 #endif  
 
@@ -19,6 +19,7 @@
 #include "conncomp.h"
 #include "serial.h"
 #include "rcservo.h"
+#include "stream.h"
 
 
 Program g_progBlobs =
@@ -36,7 +37,7 @@ int blobsSetup()
 	uint8_t c;
 
 	// setup camera mode
-	cam_setMode(CAM_MODE1);
+	cam_setMode(CC_CAM_MODE(g_rlsRes));
  	
 	// load lut if we've grabbed any frames lately
 	if (g_rawFrame.m_pixels)
@@ -44,7 +45,8 @@ int blobsSetup()
 
 	// setup qqueue and M0
 	g_qqueue->flush();
-	exec_runM0(0);
+	g_blobsRes = g_rlsRes;
+	exec_runM0(g_rlsRes); // M0 program is the resolution
 
 	// flush serial receive queue
 	while(ser_getSerial()->receive(&c, 1));
@@ -97,6 +99,8 @@ int blobsLoop()
 	BlobA *blobs;
 	uint32_t numBlobs;
 
+	stream_frame();
+
 	// create blobs
 	g_blobs->blobify();
 
@@ -105,7 +109,14 @@ int blobsLoop()
 
 	// send blobs
 	g_blobs->getBlobs(&blobs, &numBlobs);
-	cc_sendBlobs(g_chirpUsb, blobs, numBlobs);
+	if (stream_subscribed(STREAM_CCB1 | STREAM_CCQ1))
+	{
+		// q vals are rendered first, blobs go on top of them
+		stream_sendQvals(g_chirpUsb, stream_subscribed(STREAM_CCB1) ? 0 : RENDER_FLAG_FLUSH, g_blobsRes);
+		stream_sendBlobs(g_chirpUsb, blobs, numBlobs, RENDER_FLAG_FLUSH, g_blobsRes);
+	}
+	else
+		cc_sendBlobs(g_chirpUsb, blobs, numBlobs, RENDER_FLAG_FLUSH, g_blobsRes);
 
 	ser_getSerial()->update();
 
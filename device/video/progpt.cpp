@@ -106,6 +106,7 @@ int ptSetup()
 
 	// setup qqueue and M0
 	g_qqueue->flush();
+	g_blobsRes = CAM_RES2; // CAM_MODE1, 320x200 blobs
 	exec_runM0(0);
 
 	return 0;
@@ -20,6 +20,7 @@
 //#include "colorlut.h"
 #include "blobs.h"
 #include "param.h"
+#include "stream.h"
 #include <string.h>
 
 static bool g_loadModels;
@@ -83,7 +84,11 @@ void sendCMV1(uint8_t renderFlags=RENDER_FLAG_FLUSH)
 
 int videoLoop()
 {
-	if (g_execArg==0)
+	stream_frame();
+
+	if (stream_subscribed(STREAM_BA81))
+		stream_sendFrame(g_chirpUsb, CAM_GRAB_M1R2, CAM_RES2_WIDTH, CAM_RES2_HEIGHT);
+	else if (g_execArg==0)
 		cam_getFrameChirp(CAM_GRAB_M1R2, 0, 0, CAM_RES2_WIDTH, CAM_RES2_HEIGHT, g_chirpUsb);
 	else 
 		sendCMV1();
@@ -0,0 +1,196 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <new>
+#include <string.h>
+#include "pixy_init.h"
+#include "misc.h"
+#include "camera.h"
+#include "conncomp.h"
+#include "streamcredits.h"
+#include "stream.h"
+
+static const ProcModule g_module[] =
+{
+	{
+	"stream_subscribe",
+	(ProcPtr)stream_subscribe,
+	{CRP_UINT32, CRP_UINT8, CRP_UINT8, END},
+	"Have frames pushed to us as the running program produces them"
+	"@p streams bitmap of streams, STREAM_CCB1 (0x01), STREAM_CCQ1 (0x02), STREAM_BA81 (0x04), 0 to unsubscribe"
+	"@p decimation send every nth frame, 0 or 1 for every frame"
+	"@p credits number of frames that can be sent without being acknowledged (stream_ack), 0 for no limit"
+	"@r 0 if successful, -1 if out of memory"
+	},
+	{
+	"stream_ack",
+	(ProcPtr)stream_ack,
+	{CRP_UINT32, END},
+	"Acknowledge pushed frames, which returns their credits"
+	"@p consumed number of frames received since subscribing"
+	"@r always returns 0"
+	},
+	{
+	"stream_time",
+	(ProcPtr)stream_time,
+	{END},
+	"Get the clock that stream trailers are stamped with, for matching it to the host's"
+	"@r microseconds, wraps around every 71.6 minutes"
+	},
+	END
+};
+
+// index of each stream's drop counter
+#define STREAM_INDEX_CCB1    0
+#define STREAM_INDEX_CCQ1    1
+#define STREAM_INDEX_BA81    2
+
+// ms the host gets to take a pushed frame before it's dropped (Chirp::setPushTimeout()), so a host
+// that's stopped reading holds up the program this long instead of CRP_RETRIES times
+// CRP_SEND_TIMEOUT, and stays connected.  The timeout is reset by each chunk the host takes, so it
+// doesn't limit how big a frame can be.
+#define STREAM_SEND_TIMEOUT  5
+
+static StreamCredits g_account;
+static Qval *g_qvals = NULL;
+
+int stream_init(Chirp *chirp)
+{
+	chirp->registerModule(g_module);
+	return 0;
+}
+
+int32_t stream_subscribe(const uint32_t &streams, const uint8_t &decimation, const uint8_t &credits)
+{
+	// CCQ1 needs a copy of the q vals, blobify() consumes them
+	if (streams&STREAM_CCQ1)
+	{
+		if (g_qvals==NULL && (g_qvals=new (std::nothrow) Qval[STREAM_MAX_QVALS])==NULL)
+			return -1;
+	}
+	else
+	{
+		delete [] g_qvals;
+		g_qvals = NULL;
+	}
+	g_blobs->setQvalCopy(g_qvals, STREAM_MAX_QVALS);
+
+	g_account.reset(streams, decimation, credits);
+
+	return 0;
+}
+
+int32_t stream_ack(const uint32_t &consumed)
+{
+	g_account.ack(consumed);
+	return 0;
+}
+
+uint32_t stream_time()
+{
+	uint32_t time;
+
+	setTimer(&time);
+	return time;
+}
+
+bool stream_subscribed(uint32_t streams)
+{
+	return g_account.subscribed(streams);
+}
+
+void stream_frame()
+{
+	g_account.frame();
+}
+
+// true if stream should be sent this frame, counts a drop if it can't be
+static bool due(Chirp *chirp, uint32_t stream, uint8_t index)
+{
+	return g_account.due(stream, index, chirp->connected());
+}
+
+// push what's been assembled in chirp's buffer (writer) or in buf, and count it as sent or dropped
+static int push(Chirp *chirp, ChirpWriter *writer, uint8_t *buf, uint32_t len, uint8_t index)
+{
+	int res;
+	uint16_t timeout;
+
+	timeout = chirp->setPushTimeout(STREAM_SEND_TIMEOUT);
+	res = writer ? chirp->assemble(writer) : chirp->useBuffer(buf, len);
+	chirp->setPushTimeout(timeout);
+	return g_account.sent(res, index);
+}
+
+int stream_sendQvals(Chirp *chirp, uint8_t renderFlags, uint8_t res)
+{
+	Qval *qvals;
+	uint32_t len;
+	uint32_t stamps[LAT_DEVICE_STAGES];
+
+	if (!due(chirp, STREAM_CCQ1, STREAM_INDEX_CCQ1))
+		return 0;
+
+	len = g_blobs->getQvalCopy(&qvals);
+	g_blobs->getStamps(stamps);
+	setTimer(&stamps[LAT_SEND]);
+	ChirpWriter writer(chirp, CRP_XDATA);
+	writer << CrpHType(FOURCC('C','C','Q','1')) << CrpHint<uint8_t>(renderFlags) << (uint16_t)CC_WIDTH(res) << (uint16_t)CC_HEIGHT(res) <<
+		CrpArray<uint32_t>(len, qvals) << g_account.seq() << g_account.drops(STREAM_INDEX_CCQ1) << CrpArray<uint32_t>(LAT_DEVICE_STAGES, stamps);
+	return push(chirp, &writer, NULL, 0, STREAM_INDEX_CCQ1);
+}
+
+int stream_sendBlobs(Chirp *chirp, const BlobA *blobs, uint32_t len, uint8_t renderFlags, uint8_t res)
+{
+	uint32_t stamps[LAT_DEVICE_STAGES];
+
+	if (!due(chirp, STREAM_CCB1, STREAM_INDEX_CCB1))
+		return 0;
+
+	g_blobs->getStamps(stamps);
+	setTimer(&stamps[LAT_SEND]);
+	ChirpWriter writer(chirp, CRP_XDATA);
+	writer << CrpHType(FOURCC('C','C','B','1')) << CrpHint<uint8_t>(renderFlags) << CrpHint<uint16_t>(CC_WIDTH(res)) << CrpHint<uint16_t>(CC_HEIGHT(res)) <<
+		CrpArray<uint16_t>(len*sizeof(BlobA)/sizeof(uint16_t), (const uint16_t *)blobs) << g_account.seq() << g_account.drops(STREAM_INDEX_CCB1) <<
+		CrpArray<uint32_t>(LAT_DEVICE_STAGES, stamps);
+	return push(chirp, &writer, NULL, 0, STREAM_INDEX_CCB1);
+}
+
+int stream_sendFrame(Chirp *chirp, uint8_t type, uint16_t width, uint16_t height)
+{
+	int32_t len;
+	uint8_t *frame = (uint8_t *)SRAM1_LOC;
+	uint32_t stamps[LAT_DEVICE_STAGES];
+
+	// grab every frame regardless, it's what paces the program
+	ChirpWriter writer(chirp, frame, SRAM1_SIZE);
+	writer << CrpHType(FOURCC('B','A','8','1')) << CrpHint<uint8_t>(RENDER_FLAG_FLUSH) << width << height << CrpArrayNoCopy<uint8_t>(width*height);
+	if ((len=writer.len())<0)
+		return len;
+	// no q vals or blobs, the M0's grab is all there is
+	memset(stamps, 0, sizeof(stamps));
+	setTimer(&stamps[LAT_M0_START]);
+	cam_getFrame(frame+len, SRAM1_SIZE-len, type, 0, 0, width, height);
+	setTimer(&stamps[LAT_M0_END]);
+
+	if (!due(chirp, STREAM_BA81, STREAM_INDEX_BA81))
+		return 0;
+
+	setTimer(&stamps[LAT_SEND]);
+	writer.skip(width*height) << g_account.seq() << g_account.drops(STREAM_INDEX_BA81) << CrpArray<uint32_t>(LAT_DEVICE_STAGES, stamps);
+	if ((len=writer.len())<0)
+		return len;
+	return push(chirp, NULL, frame, len, STREAM_INDEX_BA81);
+}
@@ -0,0 +1,47 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef _STREAM_H
+#define _STREAM_H
+
+#include "chirp.hpp"
+#include "pixytypes.h"
+#include "blob.h"
+
+#define STREAM_MAX_QVALS     0x800 // q vals per CCQ1 frame, the rest are left out
+
+// Streams are pushed as CRP_XDATA in the same format as the calls that get them
+// (cc_getRLSFrame, cam_getFrame, etc.), followed by UINT32 frame sequence number, UINT32
+// number of frames of this stream dropped so far, and a trailer, a UINT32 array of when the frame
+// passed each stage (LAT_M0_START, etc., pixytypes.h) in stream_time() microseconds.  A frame is
+// dropped if the host has run out of credits, i.e. it hasn't acknowledged (stream_ack) enough of
+// what we've sent, or if it doesn't take the frame within a few ms, so a slow host never holds up
+// the program for long (StreamCredits, streamcredits.h, does the counting).
+
+int stream_init(Chirp *chirp);
+
+int32_t stream_subscribe(const uint32_t &streams, const uint8_t &decimation, const uint8_t &credits);
+int32_t stream_ack(const uint32_t &consumed);
+uint32_t stream_time();
+
+bool stream_subscribed(uint32_t streams);
+
+// called by the programs, stream_frame() once per frame before the others
+void stream_frame();
+int stream_sendQvals(Chirp *chirp, uint8_t renderFlags, uint8_t res);
+int stream_sendBlobs(Chirp *chirp, const BlobA *blobs, uint32_t len, uint8_t renderFlags, uint8_t res);
+int stream_sendFrame(Chirp *chirp, uint8_t type, uint16_t width, uint16_t height);
+
+#endif
@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# chirpbench, Chirp benchmarks that don't need a Pixy
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = chirpbench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    ../pixymon/loopbacklink.cpp \
+    ../pixymon/bufferedlink.cpp \
+    ../../common/chirp.cpp
+
+HEADERS += ../pixymon/loopbacklink.h \
+    ../pixymon/bufferedlink.h \
+    ../pixymon/sleeper.h \
+    ../../common/chirp.hpp \
+    ../../common/link.h
+
+INCLUDEPATH += ../../common ../pixymon
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+}
+
+win32 {
+    DEFINES += __WINDOWS__
+}
@@ -0,0 +1,854 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// chirpbench, benchmarks for Chirp without a Pixy attached.
+//
+//   chirpbench crc     checksum throughput: the sum, CRC-16 and CRC-32, in MB/s and ns/byte
+//   chirpbench bind    ns per call of procs registered with setProc() and with bind(), and ns per
+//                      message serialized with ChirpWriter and with Chirp::serialize() (vserialize())
+//   chirpbench link [loopback|socketpair] [-l latency_us] [-b bytes_per_sec] [-e bit_error_rate] [-w window] [-t ms]
+//                      calls/s for small calls and frames/s and MB/s for 320x200 (64000 byte) BA81
+//                      frames, Chirp at both ends of a simulated link.  With no options each link
+//                      is run ideal, like USB 2.0 (125 us, 20 MB/s) and like USB 2.0 with bit errors.
+//                      A link with bit errors isn't error corrected, so Chirp acks its data chunks,
+//                      and it's run with the largest window (CRP_MAX_WINDOW), the default one
+//                      (CRP_WINDOW) and stop-and-wait (window 1), unless -w picks the window.
+//                      Each of those is run again with a BufferedLink at both ends.
+//   chirpbench msg [loopback|socketpair] [-l latency_us] [-b bytes_per_sec] [-e bit_error_rate] [-t ms]
+//                      msgs/s and console KB/s for prints and CCB1 block lists the device sends as
+//                      XDATA, one chirp each and batched the way the firmware does it (setBatch()
+//                      with the firmware's batch size).  With no options each link is run ideal and like USB
+//                      2.0, error corrected and with Chirp acking each chirp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QAtomicInt>
+#include "chirp.hpp"
+#include "pixytypes.h"
+#include "loopbacklink.h"
+#include "bufferedlink.h"
+
+#define BENCH_FRAME_WIDTH     320
+#define BENCH_FRAME_HEIGHT    200
+#define BENCH_FRAME_SIZE      (BENCH_FRAME_WIDTH*BENCH_FRAME_HEIGHT)
+#define BENCH_MAX_FAILS       100 // failed calls in a row
+
+static uint32_t g_seed = 1;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+// checksum throughput ------------------------------------------------------
+
+// same as Chirp::checksum()
+static uint32_t checksum(uint8_t crcType, const uint8_t *buf, uint32_t len, uint32_t crc)
+{
+    if (crcType==CRP_CRC16)
+        return Chirp::calcCrc16(buf, len, crc);
+    if (crcType==CRP_CRC32)
+        return Chirp::calcCrc32(buf, len, crc);
+    return (uint16_t)(crc + Chirp::calcCrc((uint8_t *)buf, len));
+}
+
+#define CRC_REPS     7 // best of, so other processes and frequency changes don't count
+
+// bit at a time CRC-16/GENIBUS, what calcCrc16()'s tables must agree with
+static uint16_t refCrc16(const uint8_t *buf, uint32_t len)
+{
+    uint32_t i, j;
+    uint16_t crc=0xffff;
+
+    for (i=0; i<len; i++)
+    {
+        crc ^= buf[i]<<8;
+        for (j=0; j<8; j++)
+            crc = crc&0x8000 ? (crc<<1) ^ 0x1021 : crc<<1;
+    }
+    return ~crc;
+}
+
+static double crcRate(uint8_t crcType, const uint8_t *buf, uint32_t len, uint32_t *result)
+{
+    QElapsedTimer timer;
+    uint32_t i, rep, iters, crc=0;
+    qint64 ns, best=0;
+
+    // at least 16MB, and at least 20 ms per rep
+    for (iters=(16<<20)/len; true; iters*=2)
+    {
+        timer.start();
+        for (i=0; i<iters; i++)
+            crc = checksum(crcType, buf, len, crc);
+        best = timer.nsecsElapsed();
+        if (best>=20000000)
+            break;
+    }
+    for (rep=1; rep<CRC_REPS; rep++)
+    {
+        timer.start();
+        for (i=0; i<iters; i++)
+            crc = checksum(crcType, buf, len, crc);
+        ns = timer.nsecsElapsed();
+        if (ns<best)
+            best = ns;
+    }
+    *result = crc; // so the loop isn't optimized away
+    return (double)best/((double)iters*len);
+}
+
+static int crcBench()
+{
+    static const uint32_t sizes[] = {16, 64, 1024, 0x10000};
+    static const struct
+    {
+        uint8_t type;
+        const char *name;
+    } types[] = {{CRP_CRC_SUM, "sum"}, {CRP_CRC16, "crc16"}, {CRP_CRC32, "crc32"}};
+    std::vector<uint8_t> buf(0x10000);
+    uint32_t i, j, result;
+    double ns, sumNs=0;
+    int res=0;
+
+    // check values for "123456789"
+    if (Chirp::calcCrc16((const uint8_t *)"123456789", 9)!=0xd64e ||
+            Chirp::calcCrc32((const uint8_t *)"123456789", 9)!=0xcbf43926)
+    {
+        printf("crc check values are wrong\n");
+        return 1;
+    }
+
+    for (i=0; i<buf.size(); i++)
+        buf[i] = rnd();
+
+    // every tail length, and continuing from a previous result
+    for (i=0; i<100; i++)
+    {
+        if (Chirp::calcCrc16(&buf[0], i)!=refCrc16(&buf[0], i) ||
+                Chirp::calcCrc16(&buf[i/3], i-i/3, Chirp::calcCrc16(&buf[0], i/3))!=refCrc16(&buf[0], i))
+        {
+            printf("crc16 of %u bytes is wrong\n", i);
+            return 1;
+        }
+    }
+
+    printf("%-6s %8s %10s %10s %10s\n", "", "bytes", "MB/s", "ns/byte", "vs sum");
+    for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+    {
+        for (j=0; j<sizeof(types)/sizeof(types[0]); j++)
+        {
+            ns = crcRate(types[j].type, &buf[0], sizes[i], &result);
+            if (types[j].type==CRP_CRC_SUM)
+                sumNs = ns;
+            printf("%-6s %8u %10.1f %10.3f %9.2fx\n", types[j].name, sizes[i], 1000.0/ns, ns, ns/sumNs);
+            // CRC-32 is what a link without error correction negotiates-- it shouldn't cost more than the sum
+            if (types[j].type==CRP_CRC32 && sizes[i]>=1024 && ns>sumNs*1.1)
+            {
+                printf("crc32 is slower per byte than the sum at %u bytes (%.3f vs %.3f ns)\n", sizes[i], ns, sumNs);
+                res = 1;
+            }
+        }
+    }
+    if (res==0)
+        printf("crc32 is not slower than the sum at 1024 bytes and up\n");
+    return res;
+}
+
+// proc call overhead -------------------------------------------------------
+
+static uint32_t g_total;
+
+static uint32_t servosTyped(const uint16_t &s0, const uint16_t &s1, Chirp *chirp)
+{
+    g_total += s0 + s1;
+    return 0;
+}
+
+static uint32_t servosUntyped(uint16_t *s0, uint16_t *s1, Chirp *chirp)
+{
+    g_total += *s0 + *s1;
+    return 0;
+}
+
+static uint32_t dataTyped(const uint8_t &type, const uint32_t &len, const uint8_t *data, Chirp *chirp)
+{
+    g_total += type + len + data[0];
+    return len;
+}
+
+static uint32_t dataUntyped(uint8_t *type, uint32_t *len, uint8_t *data, Chirp *chirp)
+{
+    g_total += *type + *len + data[0];
+    return *len;
+}
+
+static double callRate(Chirp *chirp, ChirpProc proc, uint8_t *args, uint32_t len)
+{
+    QElapsedTimer timer;
+    uint32_t i, iters=1000000;
+    int32_t response;
+
+    timer.start();
+    for (i=0; i<iters; i++)
+        chirp->callLocal(proc, args, len, &response);
+    return (double)timer.nsecsElapsed()/iters;
+}
+
+// the same messages serialized both ways, what a call, an array and a CCB1 frame of blocks send
+#define SERIALIZE_SERVOS    0
+#define SERIALIZE_ARRAY     1
+#define SERIALIZE_BLOCKS    2
+
+static uint16_t g_blocks[5*20];
+
+static int serializeMsg(int msg, bool typed, uint8_t *buf, uint32_t size)
+{
+    static const uint8_t data[16] = {0};
+
+    if (typed)
+    {
+        ChirpWriter writer(NULL, buf, size);
+        if (msg==SERIALIZE_SERVOS)
+            writer << (uint16_t)500 << (uint16_t)600;
+        else if (msg==SERIALIZE_ARRAY)
+            writer << (uint8_t)1 << CrpArray<uint8_t>(sizeof(data), data);
+        else
+            writer << CrpHType(FOURCC('C','C','B','1')) << CrpHint<uint8_t>(RENDER_FLAG_FLUSH) << CrpHint<uint16_t>(320) <<
+                      CrpHint<uint16_t>(200) << CrpArray<uint16_t>(sizeof(g_blocks)/sizeof(uint16_t), g_blocks);
+        return writer.len();
+    }
+    if (msg==SERIALIZE_SERVOS)
+        return Chirp::serialize(NULL, buf, size, UINT16(500), UINT16(600), END);
+    if (msg==SERIALIZE_ARRAY)
+        return Chirp::serialize(NULL, buf, size, UINT8(1), UINTS8(sizeof(data), data), END);
+    return Chirp::serialize(NULL, buf, size, HTYPE(FOURCC('C','C','B','1')), HINT8(RENDER_FLAG_FLUSH), HINT16(320),
+                            HINT16(200), UINTS16(sizeof(g_blocks)/sizeof(uint16_t), g_blocks), END);
+}
+
+static double serializeRate(int msg, bool typed)
+{
+    QElapsedTimer timer;
+    uint32_t buf[0x100];
+    uint32_t i, iters=1000000;
+    int total=0;
+
+    timer.start();
+    for (i=0; i<iters; i++)
+        total += serializeMsg(msg, typed, (uint8_t *)buf, sizeof(buf));
+    g_total += total; // so the loop isn't optimized away
+    return (double)timer.nsecsElapsed()/iters;
+}
+
+static int serializeBench()
+{
+    static const struct
+    {
+        int msg;
+        const char *name;
+    } msgs[] = {{SERIALIZE_SERVOS, "2 args"}, {SERIALIZE_ARRAY, "array"}, {SERIALIZE_BLOCKS, "CCB1, 20 blocks"}};
+    uint32_t typedBuf[0x100], untypedBuf[0x100];
+    uint32_t i;
+    double typedNs, untypedNs;
+    int typedLen, untypedLen, res=0;
+
+    for (i=0; i<sizeof(g_blocks)/sizeof(uint16_t); i++)
+        g_blocks[i] = rnd();
+
+    printf("%-20s %12s %12s\n", "", "vserialize", "ChirpWriter");
+    for (i=0; i<sizeof(msgs)/sizeof(msgs[0]); i++)
+    {
+        // same bytes both ways
+        typedLen = serializeMsg(msgs[i].msg, true, (uint8_t *)typedBuf, sizeof(typedBuf));
+        untypedLen = serializeMsg(msgs[i].msg, false, (uint8_t *)untypedBuf, sizeof(untypedBuf));
+        if (typedLen<=0 || typedLen!=untypedLen || memcmp(typedBuf, untypedBuf, typedLen)!=0)
+        {
+            printf("%s: ChirpWriter and vserialize() don't agree\n", msgs[i].name);
+            res = 1;
+            continue;
+        }
+        untypedNs = serializeRate(msgs[i].msg, false);
+        typedNs = serializeRate(msgs[i].msg, true);
+        printf("%-20s %9.1f ns %9.1f ns %9.2fx\n", msgs[i].name, untypedNs, typedNs, typedNs/untypedNs);
+    }
+    return res;
+}
+
+static int bindBench()
+{
+    Chirp chirp;
+    uint32_t buf[64];
+    uint8_t *args = (uint8_t *)buf;
+    uint8_t data[16] = {0};
+    int servosLen, dataLen, wrongLen, res=0;
+    int32_t response;
+
+    // procs are numbered in the order they're added
+    chirp.setProc("servosUntyped", (ProcPtr)(ChirpAnyFn)servosUntyped);
+    chirp.bind("servosTyped", servosTyped);
+    chirp.setProc("dataUntyped", (ProcPtr)(ChirpAnyFn)dataUntyped);
+    chirp.bind("dataTyped", dataTyped);
+
+    ChirpWriter servos(NULL, args, sizeof(buf));
+    servos << (uint16_t)500 << (uint16_t)600;
+    servosLen = servos.len();
+
+    // bound procs check the args, these go to servosTyped() as a uint8_t and a uint16_t
+    ChirpWriter wrong(NULL, args+0x80, sizeof(buf)-0x80);
+    wrong << (uint8_t)5 << (uint16_t)600;
+    wrongLen = wrong.len();
+    if (chirp.callLocal(1, args+0x80, wrongLen, &response)<0 || response!=CRP_RES_ERROR)
+    {
+        printf("bound proc didn't reject the wrong arg types\n");
+        res = 1;
+    }
+
+    printf("%-20s %10s\n", "", "ns/call");
+    printf("%-20s %10.1f\n", "2 args, setProc", callRate(&chirp, 0, args, servosLen));
+    printf("%-20s %10.1f\n", "2 args, bind", callRate(&chirp, 1, args, servosLen));
+
+    ChirpWriter array(NULL, args, sizeof(buf));
+    array << (uint8_t)1 << CrpArray<uint8_t>(sizeof(data), data);
+    dataLen = array.len();
+    printf("%-20s %10.1f\n", "array, setProc", callRate(&chirp, 2, args, dataLen));
+    printf("%-20s %10.1f\n", "array, bind", callRate(&chirp, 3, args, dataLen));
+    if (chirp.callLocal(3, args, dataLen, &response)<0 || response!=sizeof(data))
+    {
+        printf("bound proc didn't get the array\n");
+        res = 1;
+    }
+
+    printf("\n");
+    res |= serializeBench();
+    return res;
+}
+
+// calls over a link ----------------------------------------------------------
+
+struct LinkSettings
+{
+    LinkSettings(uint32_t l=0, uint32_t b=0, double e=0.0, uint8_t w=CRP_WINDOW) : latency(l), bandwidth(b), ber(e), window(w), buffered(false) {}
+
+    uint32_t latency; // us
+    uint32_t bandwidth; // bytes/s
+    double ber;
+    uint8_t window; // both ends offer it, only used if there are bit errors
+    bool buffered; // both ends receive through a BufferedLink, only used if there are bit errors
+};
+
+static uint8_t g_frame[BENCH_FRAME_SIZE];
+
+static uint32_t setServos(const uint16_t &s0, const uint16_t &s1, Chirp *chirp)
+{
+    return s0 + s1;
+}
+
+// what the device's cam_getFrame returns: the raw Bayer frame
+static uint32_t getFrame(const uint8_t &mode, const uint16_t &xOffset, const uint16_t &yOffset,
+                         const uint16_t &width, const uint16_t &height, Chirp *chirp)
+{
+    CRP_RETURN(chirp, HTYPE(FOURCC('B','A','8','1')), UINT16(width), UINT16(height),
+               UINTS8(width*height, g_frame), END);
+    return 0;
+}
+
+// the device end, services calls until it's stopped
+class DeviceThread : public QThread
+{
+public:
+    DeviceThread(Link *link, uint8_t window) : m_link(link), m_window(window), m_stop(0) {}
+
+    void stop()
+    {
+        m_stop.storeRelease(1);
+        wait();
+    }
+
+protected:
+    virtual void run()
+    {
+        Chirp chirp;
+
+        chirp.setWindow(m_window);
+        chirp.setLink(m_link);
+        chirp.bind("rcs_setPos", setServos);
+        chirp.bind("cam_getFrame", getFrame);
+        while (!m_stop.loadAcquire())
+            chirp.service(false);
+    }
+
+private:
+    Link *m_link;
+    uint8_t m_window;
+    QAtomicInt m_stop;
+};
+
+static void impair(SimLink *link, const LinkSettings &settings)
+{
+    link->setLatency(settings.latency);
+    link->setBandwidth(settings.bandwidth);
+    link->setBitErrorRate(settings.ber);
+}
+
+static int runCalls(const char *name, SimLink *host, SimLink *device, const LinkSettings &settings, uint32_t ms)
+{
+    QElapsedTimer timer;
+    ChirpProc setPos, getFrame;
+    uint32_t calls, frames, fails, errors=0, len;
+    int32_t response;
+    uint16_t width, height;
+    uint8_t *data;
+    double secs;
+
+    impair(host, settings);
+    impair(device, settings);
+
+    BufferedLink bufferedHost(host), bufferedDevice(device);
+    DeviceThread thread(settings.buffered ? (Link *)&bufferedDevice : device, settings.window);
+    thread.start();
+    {
+        Chirp chirp(false, true);
+
+        chirp.setWindow(settings.window);
+        chirp.setLink(settings.buffered ? (Link *)&bufferedHost : host);
+        setPos = chirp.getProc("rcs_setPos");
+        getFrame = chirp.getProc("cam_getFrame");
+        if (setPos<0 || getFrame<0)
+        {
+            printf("%-11s can't get procs\n", name);
+            thread.stop();
+            return 1;
+        }
+
+        // only calls that succeed count, and we give up if they stop succeeding
+        timer.start();
+        for (calls=0, fails=0; timer.elapsed()<ms && fails<BENCH_MAX_FAILS; )
+        {
+            if (chirp.callSync(setPos, UINT16(500), UINT16(600), END_OUT_ARGS, &response, END_IN_ARGS)<0 || response!=1100)
+                errors++, fails++;
+            else
+                calls++, fails=0;
+        }
+        secs = timer.nsecsElapsed()/1e9;
+        printf("%-11s %6u us %6.1f MB/s  ber %-7g  window ", name, settings.latency, settings.bandwidth/1e6, settings.ber);
+        if (settings.ber>0.0)
+            printf("%-2u  %-8s", settings.window, settings.buffered ? "buffered" : "-");
+        else
+            printf("-   -       ");
+        printf("  small %8.0f calls/s", calls/secs);
+
+        timer.start();
+        for (frames=0, fails=0; timer.elapsed()<ms && fails<BENCH_MAX_FAILS; )
+        {
+            if (chirp.callSync(getFrame, UINT8(0x21), UINT16(0), UINT16(0), UINT16(BENCH_FRAME_WIDTH),
+                               UINT16(BENCH_FRAME_HEIGHT), END_OUT_ARGS, &response, &width, &height, &len, &data,
+                               END_IN_ARGS)<0 || len!=BENCH_FRAME_SIZE || memcmp(data, g_frame, len)!=0)
+                errors++, fails++;
+            else
+                frames++, fails=0;
+        }
+        secs = timer.nsecsElapsed()/1e9;
+        printf("  BA81 %7.1f frames/s %7.1f MB/s", frames/secs, frames*(double)BENCH_FRAME_SIZE/secs/1e6);
+        if (errors)
+            printf("  %u failed calls", errors);
+        if (!chirp.connected())
+            printf(", disconnected"); // a send failed after its retries
+        else if (fails>=BENCH_MAX_FAILS)
+            printf(", gave up");
+        printf("\n");
+    }
+    thread.stop();
+    return errors ? 1 : 0;
+}
+
+static int runLink(const char *type, const LinkSettings &settings, uint32_t ms)
+{
+    int res;
+
+    if (strcmp(type, "loopback")==0)
+    {
+        LoopbackLink device;
+        LoopbackLink *host = new LoopbackLink(device);
+        res = runCalls(type, host, &device, settings, ms);
+        delete host; // the other end goes first
+        return res;
+    }
+#ifndef __WINDOWS__
+    if (strcmp(type, "socketpair")==0)
+    {
+        SocketPairLink device;
+        SocketPairLink *host = new SocketPairLink(device);
+        res = runCalls(type, host, &device, settings, ms);
+        delete host;
+        return res;
+    }
+#endif
+    printf("unknown link %s\n", type);
+    return 1;
+}
+
+// the link with each window, if it has bit errors and the window wasn't picked, and each of those
+// without and with a BufferedLink at both ends
+static int runWindows(const char *type, const LinkSettings &settings, bool window, uint32_t ms)
+{
+    static const uint8_t windows[] = {CRP_MAX_WINDOW, CRP_WINDOW, 1};
+    LinkSettings windowed = settings;
+    uint32_t i, j;
+    int res=0;
+
+    if (settings.ber==0.0)
+        return runLink(type, settings, ms);
+    for (i=0; i<sizeof(windows)/sizeof(windows[0]); i++)
+    {
+        if (!window)
+            windowed.window = windows[i];
+        else if (i>0)
+            break;
+        for (j=0; j<2; j++)
+        {
+            windowed.buffered = j==1;
+            res |= runLink(type, windowed, ms);
+        }
+    }
+    return res;
+}
+
+static int linkBench(int argc, char *argv[])
+{
+#ifdef __WINDOWS__
+    static const char *types[] = {"loopback"};
+#else
+    static const char *types[] = {"loopback", "socketpair"};
+#endif
+    static const LinkSettings presets[] =
+    {
+        LinkSettings(),
+        LinkSettings(125, 20000000),
+        LinkSettings(125, 20000000, 1e-7)
+    };
+    LinkSettings settings, preset;
+    const char *type = NULL;
+    bool options = false, window = false;
+    uint32_t i, j, ms=1000;
+    int a, res=0;
+
+    for (i=0; i<sizeof(g_frame); i++)
+        g_frame[i] = rnd();
+
+    for (a=2; a<argc; a++)
+    {
+        if (a+1<argc && strcmp(argv[a], "-l")==0)
+            settings.latency = strtoul(argv[++a], NULL, 0), options = true;
+        else if (a+1<argc && strcmp(argv[a], "-b")==0)
+            settings.bandwidth = strtoul(argv[++a], NULL, 0), options = true;
+        else if (a+1<argc && strcmp(argv[a], "-e")==0)
+            settings.ber = strtod(argv[++a], NULL), options = true;
+        else if (a+1<argc && strcmp(argv[a], "-w")==0)
+            settings.window = strtoul(argv[++a], NULL, 0), window = true;
+        else if (a+1<argc && strcmp(argv[a], "-t")==0)
+            ms = strtoul(argv[++a], NULL, 0);
+        else if (argv[a][0]!='-')
+            type = argv[a];
+        else
+            return -1;
+    }
+
+    for (i=0; i<sizeof(types)/sizeof(types[0]); i++)
+    {
+        if (type && strcmp(type, types[i])!=0)
+            continue;
+        if (options)
+            res |= runWindows(types[i], settings, window, ms);
+        else
+        {
+            for (j=0; j<sizeof(presets)/sizeof(presets[0]); j++)
+            {
+                preset = presets[j];
+                if (window)
+                    preset.window = settings.window;
+                res |= runWindows(types[i], preset, window, ms);
+            }
+        }
+    }
+    return res;
+}
+
+// small messages over a link --------------------------------------------------
+
+#define MSG_CCB1_EVERY      4 // every 4th message is a CCB1 block list, the rest are prints
+#define MSG_BLOCKS          3
+#define MSG_SERVICE_EVERY   16 // the device services the link every 16 messages, like its exec loop
+#define MSG_BATCH_SIZE      0x200 // the firmware's USB_BATCH_SIZE
+#define MSG_BATCH_DEADLINE  1 // ms, the firmware's USB_BATCH_DEADLINE
+
+// the device end, sends prints and CCB1 block lists, as fast as the link takes them, until it's
+// stopped
+class MsgDeviceThread : public QThread
+{
+public:
+    MsgDeviceThread(SimLink *link, uint32_t batch) : m_link(link), m_batch(batch), m_stop(0), m_done(0) {}
+
+    void stop()
+    {
+        m_stop.storeRelease(1);
+    }
+    bool done()
+    {
+        return m_done.loadAcquire()!=0;
+    }
+
+protected:
+    virtual void run()
+    {
+        Chirp chirp;
+        uint16_t blocks[5*MSG_BLOCKS] = {0};
+        char print[64];
+        uint32_t seq;
+
+        chirp.setBatch(m_batch, MSG_BATCH_DEADLINE);
+        chirp.setLink(m_link);
+        while (!m_stop.loadAcquire() && !chirp.connected())
+            chirp.service(false);
+        for (seq=0; !m_stop.loadAcquire(); seq++)
+        {
+            // the sequence number is in each message, so the host can check they're all there
+            if (seq%MSG_CCB1_EVERY==0)
+            {
+                blocks[0] = seq;
+                CRP_SEND_XDATA((&chirp), HTYPE(FOURCC('C','C','B','1')), HINT8(RENDER_FLAG_FLUSH), HINT16(320),
+                               HINT16(200), UINTS16(sizeof(blocks)/sizeof(uint16_t), blocks));
+            }
+            else
+            {
+                sprintf(print, "msg %08u: 3 blocks, sig 1, 12 ms\n", seq);
+                CRP_SEND_XDATA((&chirp), HSTRING(print));
+            }
+            if (seq%MSG_SERVICE_EVERY==0)
+                chirp.service(false);
+        }
+        chirp.flush();
+        m_done.storeRelease(1);
+    }
+
+private:
+    SimLink *m_link;
+    uint32_t m_batch;
+    QAtomicInt m_stop;
+    QAtomicInt m_done;
+};
+
+// the host end, counts what arrives the way ChirpMon hands it to the Interpreter
+class MsgCounter : public Chirp
+{
+public:
+    MsgCounter() : Chirp(true, true), m_msgs(0), m_consoleBytes(0), m_lost(0), m_next(0) {}
+
+    uint32_t m_msgs;
+    uint64_t m_consoleBytes;
+    uint32_t m_lost;
+
+protected:
+    virtual void handleXdata(void *data[])
+    {
+        uint32_t seq;
+
+        if (data[0]==NULL)
+            return;
+        if (Chirp::getType(data[0])==CRP_TYPE_HINT)
+            seq = *(uint16_t *)data[5] | (m_next&~0xffff);
+        else if (Chirp::getType(data[0])==CRP_HSTRING && sscanf((char *)data[0], "msg %u", &seq)==1)
+            m_consoleBytes += strlen((char *)data[0]);
+        else
+            return;
+        if (seq!=m_next)
+            m_lost++;
+        m_next = seq+1;
+        m_msgs++;
+    }
+
+private:
+    uint32_t m_next;
+};
+
+static int runMsgs(const char *name, SimLink *host, SimLink *device, const LinkSettings &settings, uint32_t batch,
+                   uint32_t ms)
+{
+    QElapsedTimer timer;
+    uint32_t msgs;
+    uint64_t consoleBytes;
+    double secs;
+
+    impair(host, settings);
+    impair(device, settings);
+
+    MsgDeviceThread thread(device, batch);
+    thread.start();
+    {
+        MsgCounter chirp;
+
+        chirp.setLink(host);
+        if (!chirp.connected())
+        {
+            printf("%-11s can't connect\n", name);
+            thread.stop();
+            thread.wait();
+            return 1;
+        }
+
+        // the first message is the one the device sends once it's connected
+        timer.start();
+        while (timer.elapsed()<ms)
+            chirp.service(false);
+        secs = timer.nsecsElapsed()/1e9;
+        msgs = chirp.m_msgs;
+        consoleBytes = chirp.m_consoleBytes;
+
+        // the device sends what it has before it stops
+        thread.stop();
+        while (!thread.done())
+            chirp.service(false);
+        thread.wait();
+        while (chirp.service(false));
+
+        printf("%-11s %6u us %6.1f MB/s  %-9s batch %3u  %9.0f msgs/s %8.1f KB/s console", name, settings.latency,
+               settings.bandwidth/1e6, settings.ber>0.0 ? "acked" : "corrected", batch, msgs/secs, consoleBytes/secs/1e3);
+        if (chirp.m_lost)
+            printf(", %u lost or out of order", chirp.m_lost);
+        printf("\n");
+        return chirp.m_lost ? 1 : 0;
+    }
+}
+
+// batching off and on, the link type and settings as for the link bench
+static int runMsgLink(const char *type, const LinkSettings &settings, uint32_t ms)
+{
+    static const uint32_t batches[] = {0, MSG_BATCH_SIZE};
+    uint32_t i;
+    int res=0;
+
+    for (i=0; i<sizeof(batches)/sizeof(batches[0]); i++)
+    {
+        if (strcmp(type, "loopback")==0)
+        {
+            LoopbackLink device;
+            LoopbackLink *host = new LoopbackLink(device);
+            res |= runMsgs(type, host, &device, settings, batches[i], ms);
+            delete host;
+        }
+#ifndef __WINDOWS__
+        else if (strcmp(type, "socketpair")==0)
+        {
+            SocketPairLink device;
+            SocketPairLink *host = new SocketPairLink(device);
+            res |= runMsgs(type, host, &device, settings, batches[i], ms);
+            delete host;
+        }
+#endif
+        else
+        {
+            printf("unknown link %s\n", type);
+            return 1;
+        }
+    }
+    return res;
+}
+
+static int msgBench(int argc, char *argv[])
+{
+#ifdef __WINDOWS__
+    static const char *types[] = {"loopback"};
+#else
+    static const char *types[] = {"loopback", "socketpair"};
+#endif
+    // a bit error rate too small to flip anything, so Chirp acks each chirp but never resends
+    static const LinkSettings presets[] =
+    {
+        LinkSettings(),
+        LinkSettings(125, 20000000),
+        LinkSettings(0, 0, 1e-15),
+        LinkSettings(125, 20000000, 1e-15)
+    };
+    LinkSettings settings;
+    const char *type = NULL;
+    bool options = false;
+    uint32_t i, j, ms=1000;
+    int a, res=0;
+
+    for (a=2; a<argc; a++)
+    {
+        if (a+1<argc && strcmp(argv[a], "-l")==0)
+            settings.latency = strtoul(argv[++a], NULL, 0), options = true;
+        else if (a+1<argc && strcmp(argv[a], "-b")==0)
+            settings.bandwidth = strtoul(argv[++a], NULL, 0), options = true;
+        else if (a+1<argc && strcmp(argv[a], "-e")==0)
+            settings.ber = strtod(argv[++a], NULL), options = true;
+        else if (a+1<argc && strcmp(argv[a], "-t")==0)
+            ms = strtoul(argv[++a], NULL, 0);
+        else if (argv[a][0]!='-')
+            type = argv[a];
+        else
+            return -1;
+    }
+
+    for (i=0; i<sizeof(types)/sizeof(types[0]); i++)
+    {
+        if (type && strcmp(type, types[i])!=0)
+            continue;
+        if (options)
+            res |= runMsgLink(types[i], settings, ms);
+        else
+        {
+            for (j=0; j<sizeof(presets)/sizeof(presets[0]); j++)
+                res |= runMsgLink(types[i], presets[j], ms);
+        }
+    }
+    return res;
+}
+
+static void usage()
+{
+    printf("usage: chirpbench crc|bind\n");
+    printf("       chirpbench link [loopback|socketpair] [-l latency_us] [-b bytes_per_sec] [-e bit_error_rate] [-w window] [-t ms]\n");
+    printf("       chirpbench msg [loopback|socketpair] [-l latency_us] [-b bytes_per_sec] [-e bit_error_rate] [-t ms]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int res;
+
+    if (argc<2)
+    {
+        usage();
+        return 1;
+    }
+    if (strcmp(argv[1], "crc")==0)
+        return crcBench();
+    if (strcmp(argv[1], "bind")==0)
+        return bindBench();
+    if (strcmp(argv[1], "link")==0 && (res=linkBench(argc, argv))>=0)
+        return res;
+    if (strcmp(argv[1], "msg")==0 && (res=msgBench(argc, argv))>=0)
+        return res;
+    usage();
+    return 1;
+}
@@ -0,0 +1,66 @@
+#-------------------------------------------------
+#
+# libpixyhost, Pixy over USB (or through pixymux) without Qt
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = pixyhost
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += pixyhost.cpp \
+    ../pixymon/usblink.cpp \
+    ../pixymon/usbbackend.cpp \
+    ../pixymux/muxclient.cpp \
+    ../pixymux/muxring.cpp \
+    ../pixymux/socketlink.cpp \
+    ../pixymon/processblobs.cpp \
+    ../pixymon/recording.cpp \
+    ../pixymon/batchprocessor.cpp \
+    ../pixymon/latency.cpp \
+    ../../common/chirp.cpp \
+    ../../common/blobs.cpp \
+    ../../common/blob.cpp \
+    ../../common/colorlut.cpp \
+    ../../common/qqueue.cpp \
+    ../../common/rls.cpp
+
+HEADERS += pixyhost.h \
+    ../pixymon/usblink.h \
+    ../pixymon/usbbackend.h \
+    ../pixymux/muxclient.h \
+    ../pixymux/muxring.h \
+    ../pixymux/socketlink.h \
+    ../pixymon/processblobs.h \
+    ../pixymon/recording.h \
+    ../pixymon/batchprocessor.h \
+    ../pixymon/latency.h \
+    ../pixymon/hostsync.h \
+    ../pixymon/pixymon.h \
+    ../../common/chirp.hpp \
+    ../../common/link.h \
+    ../../common/blobs.h \
+    ../../common/blob.h \
+    ../../common/colorlut.h \
+    ../../common/qqueue.h \
+    ../../common/rls.h \
+    ../../common/pixytypes.h
+
+INCLUDEPATH += ../../common ../pixymon ../pixymux
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+    INCLUDEPATH += /opt/local/include/libusb-1.0
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    INCLUDEPATH += /usr/include/libusb-1.0
+}
@@ -0,0 +1,738 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "pixyhost.h"
+#include "usblink.h"
+#include "chirp.hpp"
+#include "muxclient.h"
+#include "processblobs.h"
+#include "recording.h"
+#include "batchprocessor.h"
+#include "latency.h"
+#include "hostsync.h"
+
+#define PH_STREAM_CREDITS     4     // streamed frames Pixy can send before we acknowledge them, same as PixyMon
+#define PH_MAX_CALL           0x100 // serialized args of a program call
+#define PH_MAX_WORDS          (CRP_MAX_ARGS*4+1)
+
+class PixyHost;
+
+// a program call, serialized once and sent as is each time
+struct ProgramCall
+{
+    ChirpProc proc;
+    uint32_t len;
+    uint8_t args[PH_MAX_CALL]; // after len, so it's 4-aligned like the chirp buffer it's written for
+};
+
+// over USB, or through pixymux if it's open()ed
+class HostChirp : public MuxClient
+{
+public:
+    HostChirp(PixyHost *host);
+
+    // receive and handle chirps until a response if wait, otherwise one chirp if there is one
+    int serviceChirp(bool wait);
+    int execute(const ProgramCall &call);
+    int parse(const char *text, ProgramCall *call);
+
+protected:
+    virtual int handleChirp(uint8_t type, ChirpProc proc, void *args[]);
+    virtual void handleData(void *args[]);
+
+private:
+    PixyHost *m_host;
+    int32_t m_response;
+};
+
+class PixyHost
+{
+public:
+    PixyHost();
+    ~PixyHost();
+
+    int open(const char *muxPath);
+    int subscribe(uint32_t streams, uint8_t decimation);
+    int callInt(const char *procName, int *response);
+    int service();
+    int record(const char *filename);
+    int play(const char *filename);
+
+    void handleData(void *args[], uint8_t chirpType);
+    void syncClock();
+
+    Latency m_latency;
+
+    pixy_frame_handler m_handler;
+    void *m_context;
+    std::vector<ProgramCall> m_program;
+    bool m_uploaded; // m_program is running on Pixy
+    bool m_local; // m_program doesn't fit in Pixy, service() makes its calls
+    USBLink m_link; // before m_chirp, which says goodbye over it when it's destroyed
+    HostChirp m_chirp;
+
+private:
+    void decode(void *args[], uint64_t timestamp);
+    void deliver(pixy_frame *frame);
+    int ackStream();
+    int uploadProgram();
+
+    bool m_mux; // m_chirp is talking to pixymux
+    ProcessBlobs m_blobs;
+    RecordingWriter m_recording;
+    uint64_t m_recordStart;
+    uint64_t m_lastSync;
+    uint32_t m_streams;
+    uint32_t m_streamConsumed;
+    uint32_t m_streamAcked;
+    uint32_t m_sequence;
+    uint32_t m_frames; // delivered this service()
+};
+
+// hands batch-processed frames to the handler, stamped like PixyHost::play() does
+class BatchDeliver : public BatchWriter
+{
+public:
+    BatchDeliver(pixy_frame_handler handler, void *context)
+    {
+        m_handler = handler;
+        m_context = context;
+    }
+    virtual int write(const BatchFrame *frame);
+
+private:
+    pixy_frame_handler m_handler;
+    void *m_context;
+};
+
+
+HostChirp::HostChirp(PixyHost *host)
+{
+    m_host = host;
+    m_response = 0;
+}
+
+int HostChirp::serviceChirp(bool wait)
+{
+    uint8_t type;
+    ChirpProc recvProc;
+    void *args[CRP_MAX_ARGS+1];
+    int res;
+
+    while(1)
+    {
+        if ((res=recvChirp(&type, &recvProc, args, wait))<0)
+            return wait || res!=CRP_RES_ERROR_RECV_TIMEOUT ? res : 0;
+        // responses to pipelined calls aren't the one we're waiting for
+        if ((type&CRP_RESPONSE) && handlePending(args))
+            continue;
+        handleChirp(type, recvProc, args);
+        if (!wait || (type&CRP_RESPONSE))
+            break;
+    }
+    return 0;
+}
+
+// same as ChirpMon::execute()
+int HostChirp::execute(const ProgramCall &call)
+{
+    int res;
+
+    memcpy(m_buf+m_headerLen, call.args, call.len);
+    m_len = call.len;
+    if ((res=sendChirp(CRP_CALL, call.proc))<0)
+        return res;
+    if ((res=serviceChirp(true))<0)
+        return res;
+
+    return m_response<0 ? PIXY_HOST_ERROR_RESPONSE : 0;
+}
+
+// Same syntax and arg types as PixyMon's console (Interpreter::call()), plus floats and strings.
+int HostChirp::parse(const char *text, ProgramCall *call)
+{
+    char buf[0x100], *words[PH_MAX_WORDS], *end;
+    uint8_t types[0x100];
+    uint32_t fourcc;
+    int i, n, numWords, res;
+    ProcInfo info;
+
+    if (strlen(text)>=sizeof(buf))
+        return PIXY_HOST_ERROR_ARG;
+    strcpy(buf, text);
+    for (numWords=0, end=strtok(buf, " \t(),"); end && numWords<PH_MAX_WORDS; end=strtok(NULL, " \t(),"))
+        words[numWords++] = end;
+    if (numWords==0 || end)
+        return PIXY_HOST_ERROR_ARG;
+
+    if ((call->proc=getProc(words[0]))<0 || getProcInfo(call->proc, &info)<0)
+        return PIXY_HOST_ERROR_PROC;
+
+    // region and point hints are typed in as their coordinates (Interpreter::augmentProcInfo())
+    n = strlen((char *)info.argTypes);
+    for (i=0, res=0; i<n && res<(int)sizeof(types)-4; i++)
+    {
+        if (info.argTypes[i]==CRP_TYPE_HINT && i+4<n)
+        {
+            memcpy(&fourcc, &info.argTypes[i+1], 4);
+            if (fourcc==FOURCC('R','E','G','1') || fourcc==FOURCC('P','N','T','1'))
+            {
+                memset(types+res, CRP_UINT16, fourcc==FOURCC('R','E','G','1') ? 4 : 2);
+                res += fourcc==FOURCC('R','E','G','1') ? 4 : 2;
+                i += 4;
+                continue;
+            }
+        }
+        types[res++] = info.argTypes[i];
+    }
+    types[res] = 0;
+
+    ChirpWriter writer(this, call->args, sizeof(call->args));
+    for (i=0; types[i]; i++)
+    {
+        if (i+1>=numWords)
+            return PIXY_HOST_ERROR_ARG; // too few
+        if (types[i]==CRP_STRING)
+        {
+            writer << (const char *)words[i+1];
+            continue;
+        }
+        if (types[i]==CRP_INT8)
+            writer << (uint8_t)strtol(words[i+1], &end, 0);
+        else if (types[i]==CRP_INT16)
+            writer << (uint16_t)strtol(words[i+1], &end, 0);
+        else if (types[i]==CRP_INT32)
+            writer << (uint32_t)strtoul(words[i+1], &end, 0);
+        else if (types[i]==CRP_FLT32)
+            writer << (float)strtod(words[i+1], &end);
+        else
+            return PIXY_HOST_ERROR_ARG;
+        if (*end)
+            return PIXY_HOST_ERROR_ARG;
+    }
+    if ((res=writer.len())<0)
+        return res;
+    // the writer leaves room for the header, which is written when the call is sent
+    call->len = res-m_headerLen;
+    memmove(call->args, call->args+m_headerLen, call->len);
+
+    return 0;
+}
+
+int HostChirp::handleChirp(uint8_t type, ChirpProc proc, void *args[])
+{
+    if (type==CRP_RESPONSE)
+    {
+        m_response = *(int32_t *)args[0];
+        m_host->handleData(args+1, CRP_RESPONSE);
+        return 0;
+    }
+
+    return Chirp::handleChirp(type, proc, args);
+}
+
+void HostChirp::handleData(void *args[])
+{
+    m_host->handleData(args, CRP_XDATA);
+}
+
+
+PixyHost::PixyHost() : m_chirp(this)
+{
+    m_handler = NULL;
+    m_context = NULL;
+    m_uploaded = false;
+    m_local = false;
+    m_mux = false;
+    m_streams = 0;
+    m_streamConsumed = 0;
+    m_streamAcked = 0;
+    m_sequence = 0;
+    m_frames = 0;
+    m_recordStart = 0;
+    m_lastSync = 0;
+}
+
+PixyHost::~PixyHost()
+{
+}
+
+// over USB if muxPath is NULL, otherwise through the pixymux serving Pixy there
+int PixyHost::open(const char *muxPath)
+{
+    int res;
+
+    if (muxPath)
+    {
+        if (m_chirp.open(muxPath)<0)
+            return PIXY_HOST_ERROR_MUX_OPEN;
+        m_mux = true;
+        // pixymux only passes frames on to the clients that asked for them, and we want what
+        // the running program pushes (older firmware can't be subscribed, nothing's pushed then)
+        res = subscribe(0, 1);
+        return res==PIXY_HOST_ERROR_PROC ? 0 : res;
+    }
+    if (m_link.open()<0)
+        return PIXY_HOST_ERROR_USB_OPEN;
+    if ((res=m_chirp.setLink(&m_link))<0)
+        return res;
+
+    return 0;
+}
+
+int PixyHost::subscribe(uint32_t streams, uint8_t decimation)
+{
+    int res, response;
+    ChirpProc proc;
+
+    if ((proc=m_chirp.getProc("stream_subscribe"))<0)
+        return PIXY_HOST_ERROR_PROC;
+    res = m_chirp.callSync(proc, UINT32(m_mux ? streams|MUX_STREAM_OTHER : streams), UINT8(decimation), UINT8(PH_STREAM_CREDITS),
+                           END_OUT_ARGS, &response, END_IN_ARGS);
+    if (res<0)
+        return res;
+    if (response<0)
+        return PIXY_HOST_ERROR_RESPONSE;
+    m_streams = streams;
+    m_streamConsumed = 0;
+    m_streamAcked = 0;
+
+    return 0;
+}
+
+// call a proc without args that returns an int
+int PixyHost::callInt(const char *procName, int *response)
+{
+    int res;
+    ChirpProc proc;
+
+    if ((proc=m_chirp.getProc(procName))<0)
+        return PIXY_HOST_ERROR_PROC;
+    if ((res=m_chirp.callSync(proc, END_OUT_ARGS, response, END_IN_ARGS))<0)
+        return res;
+
+    return 0;
+}
+
+int PixyHost::service()
+{
+    uint32_t i;
+    int res;
+
+    m_frames = 0;
+    if (m_program.size() && !m_uploaded)
+    {
+        if ((res=m_local ? 0 : uploadProgram())<0)
+            return res;
+        if (res==0) // Pixy can't run it, make the calls ourselves
+        {
+            for (i=0; i<m_program.size(); i++)
+            {
+                if ((res=m_chirp.execute(m_program[i]))<0)
+                    return res;
+            }
+            return m_frames;
+        }
+    }
+
+    if ((res=m_chirp.serviceChirp(false))<0)
+        return res;
+    if ((res=ackStream())<0)
+        return res;
+    syncClock();
+
+    return m_frames;
+}
+
+// Have Pixy run the program (Interpreter::uploadProgram()), after which the calls' results are
+// pushed to us.  Returns 1 if it's running, 0 if Pixy's firmware can't run uploaded programs or
+// the program doesn't fit (HOSTPROG_SIZE).
+int PixyHost::uploadProgram()
+{
+    uint32_t i;
+    int res, response;
+    ChirpProc clear, add, run;
+
+    if ((clear=m_chirp.getProc("hostprog_clear"))<0 || (add=m_chirp.getProc("hostprog_add"))<0 ||
+            (run=m_chirp.getProc("hostprog_run"))<0)
+        return 0;
+    if ((res=m_chirp.callSync(clear, END_OUT_ARGS, &response, END_IN_ARGS))<0)
+        return res;
+    for (i=0; i<m_program.size(); i++)
+    {
+        res = m_chirp.callSync(add, UINT16(m_program[i].proc), UINTS8(m_program[i].len, m_program[i].args),
+                               END_OUT_ARGS, &response, END_IN_ARGS);
+        if (res<0)
+            return res;
+        if (response<0) // doesn't fit, don't leave part of it behind
+        {
+            if ((res=m_chirp.callSync(clear, END_OUT_ARGS, &response, END_IN_ARGS))<0)
+                return res;
+            m_local = true;
+            return 0;
+        }
+    }
+    if ((res=m_chirp.callSync(run, END_OUT_ARGS, &response, END_IN_ARGS))<0)
+        return res;
+    if (response<0)
+        return PIXY_HOST_ERROR_RESPONSE;
+
+    m_uploaded = true;
+    return 1;
+}
+
+// return credits to Pixy (Interpreter::ackStream())
+int PixyHost::ackStream()
+{
+    int res, response;
+    ChirpProc proc;
+
+    if (m_streams==0 || m_streamConsumed-m_streamAcked<PH_STREAM_CREDITS/2)
+        return 0;
+    if ((proc=m_chirp.getProc("stream_ack"))<0)
+        return PIXY_HOST_ERROR_PROC;
+    if ((res=m_chirp.callSync(proc, UINT32(m_streamConsumed), END_OUT_ARGS, &response, END_IN_ARGS))<0)
+        return res;
+    m_streamAcked = m_streamConsumed;
+
+    return 0;
+}
+
+// start recording to filename, or stop if it's NULL
+int PixyHost::record(const char *filename)
+{
+    if (m_recording.close()<0)
+        return RECORDING_ERROR_FILE;
+    if (filename==NULL)
+        return 0;
+    m_recordStart = hostTime();
+    return m_recording.open(filename);
+}
+
+// decode a recording's frames as fast as we can, stamped with when they were recorded
+int PixyHost::play(const char *filename)
+{
+    RecordingReader reader;
+    const RecordHeader *header;
+    void *args[CRP_MAX_ARGS+1];
+    uint32_t i;
+    int res;
+
+    if ((res=reader.open(filename))<0)
+        return res;
+    m_frames = 0;
+    for (i=0; i<reader.records(); i++)
+    {
+        if ((header=reader.args(i, args))!=NULL)
+            decode(args, header->timestamp);
+    }
+    return m_frames;
+}
+
+// sample Pixy's clock every so often to put stream trailers on ours (Interpreter::syncClock())
+void PixyHost::syncClock()
+{
+    uint32_t device;
+    uint64_t sent;
+    ChirpProc proc;
+
+    if (m_streams==0 || hostTime()-m_lastSync<LATENCY_SYNC_PERIOD*1000)
+        return;
+    m_lastSync = hostTime();
+    if ((proc=m_chirp.getProc("stream_time"))<0)
+        return;
+    sent = hostTime();
+    if (m_chirp.callSync(proc, END_OUT_ARGS, &device, END_IN_ARGS)>=0)
+        m_latency.clockSample(sent, device, hostTime());
+}
+
+// Frame data, straight from chirp's buffer.  The timestamp is taken first thing, so it's when the
+// chirp came in.
+void PixyHost::handleData(void *args[], uint8_t chirpType)
+{
+    uint64_t timestamp = hostTime();
+    uint32_t len;
+    uint8_t *data;
+
+    if (args[0]==NULL || Chirp::getType(args[0])!=CRP_TYPE_HINT)
+        return;
+    if (m_recording.isOpen())
+    {
+        data = m_chirp.dataArgs(chirpType, &len);
+        if (m_recording.write(timestamp-m_recordStart, chirpType, *(uint32_t *)args[0], data, len)<0)
+            m_recording.close();
+    }
+    decode(args, timestamp);
+}
+
+// same args as Renderer::render() gets, with the type hint
+void PixyHost::decode(void *args[], uint64_t timestamp)
+{
+    uint32_t n, type, stream;
+    uint32_t numBlobs, i;
+    BlobA *blobs;
+    uint32_t numQvals;
+    Qval *qvals;
+    float *cmodels;
+    pixy_frame frame;
+
+    if (args[0]==NULL || Chirp::getType(args[0])!=CRP_TYPE_HINT)
+        return;
+    frame.timestamp = timestamp;
+    memset(frame.stamps, 0, sizeof(frame.stamps));
+    frame.stamps[LAT_RECEIVE] = timestamp;
+    type = *(uint32_t *)args[0];
+    for (n=0; args[n]; n++);
+
+    // every frame of a subscribed stream uses up a credit, whether it's handed on or not (same
+    // as Interpreter::handleStream()), streamed frames have 5 args of frame data, then sequence
+    // and drops
+    if (type==FOURCC('C','C','B','1'))
+        stream = STREAM_CCB1;
+    else if (type==FOURCC('C','C','Q','1'))
+        stream = STREAM_CCQ1;
+    else if (type==FOURCC('B','A','8','1'))
+        stream = STREAM_BA81;
+    else
+        stream = 0;
+    if ((m_streams&stream) && n>=8)
+        m_streamConsumed++;
+
+    if (type==FOURCC('C','C','B','1') && n>=6)
+    {
+        // renderFlags, width, height, blob array, then sequence and drops if it's streamed
+        frame.width = *(uint16_t *)args[2];
+        frame.height = *(uint16_t *)args[3];
+        frame.numBlocks = *(uint32_t *)args[4]*sizeof(uint16_t)/sizeof(BlobA);
+        frame.blocks = (const pixy_block *)args[5]; // same layout as BlobA
+        if (n>=8)
+        {
+            frame.sequence = *(uint32_t *)args[6];
+            frame.dropped = *(uint32_t *)args[7];
+        }
+        else
+        {
+            frame.sequence = m_sequence++;
+            frame.dropped = 0;
+        }
+        if (n>=10)
+        {
+            m_latency.frame((uint32_t *)args[9], *(uint32_t *)args[8], timestamp, frame.stamps);
+            frame.stamps[LAT_RENDER] = 0;
+            deliver(&frame);
+            m_latency.done(hostTime());
+        }
+        else
+            deliver(&frame);
+    }
+    else if (type==FOURCC('C','M','V','1') && n>=8)
+    {
+        // renderFlags, color models, width, height, frame (Renderer::renderCMV1())
+        if (*(uint32_t *)args[2]>=sizeof(ColorModel)*NUM_MODELS/sizeof(float))
+        {
+            cmodels = (float *)args[3];
+            m_blobs.m_blobs->m_clut->clear();
+            for (i=0; i<NUM_MODELS; i++, cmodels+=sizeof(ColorModel)/sizeof(float))
+                m_blobs.m_blobs->m_clut->add((ColorModel *)cmodels, i+1);
+        }
+        m_blobs.process(Frame8((uint8_t *)args[7], *(uint16_t *)args[4], *(uint16_t *)args[5]), &numBlobs, &blobs, &numQvals, &qvals);
+        frame.width = *(uint16_t *)args[4]/2;
+        frame.height = *(uint16_t *)args[5]/2;
+        frame.numBlocks = numBlobs;
+        frame.blocks = (const pixy_block *)blobs;
+        frame.sequence = m_sequence++;
+        frame.dropped = 0;
+        deliver(&frame);
+    }
+}
+
+void PixyHost::deliver(pixy_frame *frame)
+{
+    m_frames++;
+    if (m_handler)
+        (*m_handler)(m_context, frame);
+}
+
+
+int BatchDeliver::write(const BatchFrame *frame)
+{
+    pixy_frame pframe;
+
+    pframe.timestamp = frame->m_timestamp;
+    memset(pframe.stamps, 0, sizeof(pframe.stamps));
+    pframe.stamps[LAT_RECEIVE] = frame->m_timestamp;
+    pframe.width = frame->m_frame.m_width/2;
+    pframe.height = frame->m_frame.m_height/2;
+    pframe.numBlocks = frame->m_numBlobs;
+    pframe.blocks = (const pixy_block *)frame->m_blobs;
+    pframe.sequence = frame->m_index;
+    pframe.dropped = 0;
+    if (m_handler)
+        (*m_handler)(m_context, &pframe);
+
+    return 0;
+}
+
+
+int pixy_host_open(pixy_host **host)
+{
+    int res;
+    PixyHost *h = new PixyHost;
+
+    if ((res=h->open(NULL))<0)
+    {
+        delete h;
+        return res;
+    }
+    *host = (pixy_host *)h;
+
+    return 0;
+}
+
+int pixy_host_open_mux(pixy_host **host, const char *path)
+{
+    int res;
+    PixyHost *h = new PixyHost;
+
+    if ((res=h->open(path ? path : MUX_DEFAULT_PATH))<0)
+    {
+        delete h;
+        return res;
+    }
+    *host = (pixy_host *)h;
+
+    return 0;
+}
+
+void pixy_host_close(pixy_host *host)
+{
+    delete (PixyHost *)host;
+}
+
+void pixy_host_set_handler(pixy_host *host, pixy_frame_handler handler, void *context)
+{
+    ((PixyHost *)host)->m_handler = handler;
+    ((PixyHost *)host)->m_context = context;
+}
+
+int pixy_host_subscribe(pixy_host *host, uint32_t streams, uint8_t decimation)
+{
+    return ((PixyHost *)host)->subscribe(streams, decimation);
+}
+
+int pixy_host_run(pixy_host *host)
+{
+    int res, response;
+
+    if ((res=((PixyHost *)host)->callInt("run", &response))<0)
+        return res;
+    return response<0 ? PIXY_HOST_ERROR_RESPONSE : 0;
+}
+
+int pixy_host_stop(pixy_host *host)
+{
+    int res, response;
+
+    if ((res=((PixyHost *)host)->callInt("stop", &response))<0)
+        return res;
+    return response<0 ? PIXY_HOST_ERROR_RESPONSE : 0;
+}
+
+int pixy_host_running(pixy_host *host, int *running)
+{
+    return ((PixyHost *)host)->callInt("running", running);
+}
+
+int pixy_host_program_add(pixy_host *host, const char *call)
+{
+    int res;
+    ProgramCall pc;
+    PixyHost *h = (PixyHost *)host;
+
+    if ((res=h->m_chirp.parse(call, &pc))<0)
+        return res;
+    h->m_program.push_back(pc);
+    h->m_uploaded = false;
+    h->m_local = false;
+
+    return 0;
+}
+
+void pixy_host_program_clear(pixy_host *host)
+{
+    ((PixyHost *)host)->m_program.clear();
+    ((PixyHost *)host)->m_uploaded = false;
+    ((PixyHost *)host)->m_local = false;
+}
+
+int pixy_host_service(pixy_host *host)
+{
+    return ((PixyHost *)host)->service();
+}
+
+int pixy_host_record(pixy_host *host, const char *filename)
+{
+    return ((PixyHost *)host)->record(filename);
+}
+
+int pixy_host_play(const char *filename, pixy_frame_handler handler, void *context)
+{
+    PixyHost host;
+
+    host.m_handler = handler;
+    host.m_context = context;
+    return host.play(filename);
+}
+
+int pixy_host_batch(const char *filename, int workers, pixy_frame_handler handler, void *context)
+{
+    int res;
+    RecordingReader recording;
+
+    if ((res=recording.open(filename))<0)
+        return res;
+
+    RecordingBatchReader reader(&recording);
+    BatchDeliver writer(handler, context);
+    BatchProcessor processor(workers);
+
+    return processor.process(&reader, &writer);
+}
+
+int pixy_host_latency(pixy_host *host, uint8_t stage, uint32_t *p50, uint32_t *p99, uint32_t *count)
+{
+    LatencyHistogram *histogram;
+
+    if (stage>=LAT_STAGES)
+        return PIXY_HOST_ERROR_ARG;
+    histogram = &((PixyHost *)host)->m_latency.m_stages[stage];
+    *p50 = histogram->percentile(50);
+    *p99 = histogram->percentile(99);
+    *count = histogram->count();
+    return 0;
+}
+
+void pixy_host_latency_clear(pixy_host *host)
+{
+    ((PixyHost *)host)->m_latency.clear();
+}
+
+uint64_t pixy_host_time(void)
+{
+    return hostTime();
+}
@@ -0,0 +1,153 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef PIXYHOST_H
+#define PIXYHOST_H
+
+#include <stdint.h>
+
+// libpixyhost: Pixy over USB without Qt or a display.  Blocks are delivered straight from the
+// thread that calls pixy_host_service(), as soon as they're received and decoded.
+//
+//     pixy_host *host;
+//     if (pixy_host_open(&host)<0)
+//         ...
+//     pixy_host_set_handler(host, handleFrame, context);
+//     pixy_host_subscribe(host, PIXY_STREAM_CCB1, 1); // or pixy_host_program_add() calls
+//     while (running)
+//         pixy_host_service(host);
+//     pixy_host_close(host);
+//
+// A pixy_host is used by one thread at a time.  Functions return 0 (or a count) if successful,
+// otherwise a negative error code, one of the below or a chirp or libusb error code.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIXY_HOST_ERROR_USB_OPEN    -100 // no Pixy, or we don't have permission to open it
+#define PIXY_HOST_ERROR_PROC        -101 // Pixy's firmware doesn't have this procedure
+#define PIXY_HOST_ERROR_ARG         -102 // call text didn't parse
+#define PIXY_HOST_ERROR_RESPONSE    -103 // Pixy returned an error
+#define PIXY_HOST_ERROR_MUX_OPEN    -104 // pixymux isn't serving Pixy at that path
+
+// streams for pixy_host_subscribe(), same as the firmware's
+#define PIXY_STREAM_CCB1            0x01
+
+// stages of a streamed frame's trip, pixy_frame.stamps and pixy_host_latency(), same as
+// LAT_M0_START, etc. in pixytypes.h
+#define PIXY_LATENCY_M0_START       0 // Pixy starts reading the frame from the sensor
+#define PIXY_LATENCY_M0_END         1 // has read it
+#define PIXY_LATENCY_UNPACK         2 // has unpacked its run-length segments
+#define PIXY_LATENCY_BLOBIFY        3 // has found its blocks
+#define PIXY_LATENCY_GETBLOCK       4 // has served the first block over SPI, I2C or UART
+#define PIXY_LATENCY_SEND           5 // starts sending it over USB
+#define PIXY_LATENCY_RECEIVE        6 // we've received it
+#define PIXY_LATENCY_HANDLED        7 // the frame handler has returned
+#define PIXY_LATENCY_STAGES         8
+
+typedef struct pixy_host pixy_host;
+
+typedef struct
+{
+    uint16_t model; // color signature, 1-7
+    uint16_t left;
+    uint16_t right;
+    uint16_t top;
+    uint16_t bottom;
+} pixy_block;
+
+// Fields are only ever added to the end.
+typedef struct
+{
+    uint64_t timestamp; // microseconds, pixy_host_time(), when the frame was received
+    uint32_t sequence; // Pixy's frame number if it's streamed, otherwise counted here
+    uint32_t dropped; // streamed frames Pixy has had to drop so far, 0 if not streamed
+    uint16_t width; // resolution the blocks are in
+    uint16_t height;
+    uint32_t numBlocks;
+    const pixy_block *blocks; // only valid during the handler
+    // When the frame passed each stage, microseconds on pixy_host_time()'s clock, 0 if it's not
+    // known.  Only streamed frames have stages before PIXY_LATENCY_RECEIVE, and only once Pixy's
+    // clock has been sampled.  GETBLOCK and HANDLED are never known yet, they're after the
+    // frame was sent and during the handler.
+    uint64_t stamps[PIXY_LATENCY_STAGES];
+} pixy_frame;
+
+// Called for each frame of blocks, whether Pixy found them (CCB1) or we did from a frame and
+// color models it sent (CMV1).
+typedef void (*pixy_frame_handler)(void *context, const pixy_frame *frame);
+
+int pixy_host_open(pixy_host **host);
+// Through pixymux instead, which shares Pixy among processes, path is its socket, NULL for its
+// default (/tmp/pixymux).  Everything works the same, streamed frames are read from pixymux's
+// shared memory.
+int pixy_host_open_mux(pixy_host **host, const char *path);
+void pixy_host_close(pixy_host *host);
+
+void pixy_host_set_handler(pixy_host *host, pixy_frame_handler handler, void *context);
+
+// Have Pixy push frames of the streams as its running program produces them (see run and
+// stop), every decimation-th one.  0 unsubscribes.  Only PIXY_STREAM_CCB1 frames are handed to
+// the handler, the firmware's other streams can be subscribed and are kept flowing, but not
+// decoded.
+int pixy_host_subscribe(pixy_host *host, uint32_t streams, uint8_t decimation);
+
+// Start and stop Pixy's own program, running is set to whether it is.
+int pixy_host_run(pixy_host *host);
+int pixy_host_stop(pixy_host *host);
+int pixy_host_running(pixy_host *host, int *running);
+
+// Calls made over and over instead of waiting for pushed frames, same as PixyMon's "do ... done"
+// programs.  call is the procedure and its arguments as they're typed in PixyMon's console,
+// "cam_getFrame 0x21 0 0 320 200" for example.  The call is parsed and serialized once, here.
+// The next pixy_host_service() uploads the program and Pixy runs it, pushing the results (stop
+// it with pixy_host_stop()).  With older firmware, or if the program doesn't fit in Pixy,
+// pixy_host_service() makes the calls itself.
+int pixy_host_program_add(pixy_host *host, const char *call);
+void pixy_host_program_clear(pixy_host *host);
+
+// Make the program's calls once each, or if there isn't a program, handle what Pixy has pushed,
+// waiting up to 50 ms for it.  Returns the number of frames handed to the handler.
+int pixy_host_service(pixy_host *host);
+
+// Record the frame data Pixy sends to filename, as it's received, in PixyMon's recording format
+// (recording.h, PixyMon's "record" command).  NULL stops recording.  Returns a recording error
+// code (RECORDING_ERROR_*) if the file can't be created or written.
+int pixy_host_record(pixy_host *host, const char *filename);
+
+// Hand a recording's frames to handler as fast as they can be decoded, without a Pixy.  Frame
+// timestamps are microseconds since the recording started.  Returns the number of frames.
+int pixy_host_play(const char *filename, pixy_frame_handler handler, void *context);
+
+// Find the blocks in a recording's frames (CMV1) with workers threads, 0 for one per core, and
+// hand them to handler in frame order, from the calling thread.  The blocks are the same as
+// pixy_host_play() finds in them, but the blocks Pixy found itself (CCB1) are left out.  Returns
+// the number of frames.
+int pixy_host_batch(const char *filename, int workers, pixy_frame_handler handler, void *context);
+
+// Latency of streamed frames from PIXY_LATENCY_M0_START to stage, since they were last cleared.
+// p50 and p99 are in microseconds, count is the number of frames.
+int pixy_host_latency(pixy_host *host, uint8_t stage, uint32_t *p50, uint32_t *p99, uint32_t *count);
+void pixy_host_latency_clear(pixy_host *host);
+
+// microseconds from a monotonic clock, what frame timestamps are in
+uint64_t pixy_host_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIXYHOST_H
@@ -0,0 +1,278 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "pixyhost.h"
+#include "muxring.h"
+
+#define OUTPUT_CSV      0
+#define OUTPUT_BINARY   1
+#define OUTPUT_SHM      2
+
+#define CLI_MAX_BLOCKS  0x100 // per frame in a shm record, the rest are left out
+
+// binary and shm output, one per frame followed by numBlocks pixy_blocks, little endian
+struct FrameRecord
+{
+    uint64_t timestamp;
+    uint32_t sequence;
+    uint32_t dropped;
+    uint16_t width;
+    uint16_t height;
+    uint32_t numBlocks;
+};
+
+struct Output
+{
+    int type;
+    FILE *file;
+    FILE *latency;
+    MuxRing ring;
+    uint8_t record[sizeof(FrameRecord)+CLI_MAX_BLOCKS*sizeof(pixy_block)];
+};
+
+static volatile bool g_run = true;
+
+static void handleSignal(int sig)
+{
+    g_run = false;
+}
+
+static void handleFrame(void *context, const pixy_frame *frame)
+{
+    uint32_t i, n;
+    Output *output = (Output *)context;
+    FrameRecord *record = (FrameRecord *)output->record;
+
+    // each stage relative to when Pixy started reading the frame, blank if it's not known
+    if (output->latency && frame->stamps[PIXY_LATENCY_M0_START])
+    {
+        fprintf(output->latency, "%u", frame->sequence);
+        for (i=PIXY_LATENCY_M0_START+1; i<PIXY_LATENCY_STAGES; i++)
+        {
+            if (frame->stamps[i]>=frame->stamps[PIXY_LATENCY_M0_START])
+                fprintf(output->latency, ",%llu", (unsigned long long)(frame->stamps[i]-frame->stamps[PIXY_LATENCY_M0_START]));
+            else
+                fprintf(output->latency, ",");
+        }
+        fprintf(output->latency, "\n");
+    }
+
+    if (output->type==OUTPUT_CSV)
+    {
+        for (i=0; i<frame->numBlocks; i++)
+            fprintf(output->file, "%llu,%u,%u,%u,%u,%u,%u\n", (unsigned long long)frame->timestamp, frame->sequence,
+                    frame->blocks[i].model, frame->blocks[i].left, frame->blocks[i].right, frame->blocks[i].top, frame->blocks[i].bottom);
+        return;
+    }
+
+    n = frame->numBlocks<CLI_MAX_BLOCKS ? frame->numBlocks : CLI_MAX_BLOCKS;
+    record->timestamp = frame->timestamp;
+    record->sequence = frame->sequence;
+    record->dropped = frame->dropped;
+    record->width = frame->width;
+    record->height = frame->height;
+    record->numBlocks = n;
+    if (output->type==OUTPUT_SHM)
+    {
+        // copied straight out of chirp's buffer into the ring
+        memcpy(output->record+sizeof(FrameRecord), frame->blocks, n*sizeof(pixy_block));
+        output->ring.write(output->record, sizeof(FrameRecord)+n*sizeof(pixy_block));
+    }
+    else
+    {
+        record->numBlocks = frame->numBlocks;
+        fwrite(record, sizeof(FrameRecord), 1, output->file);
+        fwrite(frame->blocks, sizeof(pixy_block), frame->numBlocks, output->file);
+    }
+}
+
+static void printLatency(pixy_host *host)
+{
+    static const char *names[PIXY_LATENCY_STAGES] = {"", "m0_end", "unpack", "blobify", "getblock", "send", "receive", "handled"};
+    uint8_t i;
+    uint32_t p50, p99, count;
+
+    fprintf(stderr, "stage         frames   p50 us   p99 us\n");
+    for (i=PIXY_LATENCY_M0_START+1; i<PIXY_LATENCY_STAGES; i++)
+    {
+        if (pixy_host_latency(host, i, &p50, &p99, &count)==0)
+            fprintf(stderr, "%-12s %7u %8u %8u\n", names[i], count, p50, p99);
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: pixycli [-o csv|bin|shm:name] [-m socket] [-d decimation] [-c call]... [-r] [-w recording] [-l file]\n"
+            "       pixycli [-o csv|bin|shm:name] -p recording\n"
+            "       pixycli [-o csv|bin|shm:name] [-j workers] -b recording\n"
+            "  -o  output, CSV (timestamp_us,sequence,model,left,right,top,bottom) or binary records\n"
+            "      on stdout, or binary records in a shared memory ring (default csv)\n"
+            "  -m  use Pixy through pixymux, listening on socket (its default is /tmp/pixymux),\n"
+            "      so other programs can use it at the same time\n"
+            "  -d  subscribe to every nth frame of blocks (default 1)\n"
+            "  -c  call for Pixy to make over and over instead of subscribing, as typed in PixyMon,\n"
+            "      \"cc_getRLSCCChirp\" for example\n"
+            "  -r  run Pixy's program first, and stop it on the way out\n"
+            "  -w  record the frame data Pixy sends, as PixyMon does\n"
+            "  -l  write each streamed frame's latency to file, CSV of microseconds from when Pixy\n"
+            "      started reading it to each stage, and print p50 and p99 of each on the way out\n"
+            "  -p  play back a recording as fast as it decodes, instead of using Pixy\n"
+            "  -b  find the blocks in a recording's frames on every core, output in frame order, the\n"
+            "      same blocks as -p but without the ones Pixy found itself\n"
+            "  -j  threads for -b (default one per core)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int i, res;
+    int decimation = 1, workers = 0;
+    bool run = false, program = false;
+    const char *recording = NULL, *playback = NULL, *batch = NULL, *mux = NULL;
+    pixy_host *host;
+    Output *output = new Output;
+
+    output->type = OUTPUT_CSV;
+    output->file = stdout;
+    output->latency = NULL;
+
+    for (i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-o")==0 && i+1<argc)
+        {
+            i++;
+            if (strcmp(argv[i], "csv")==0)
+                output->type = OUTPUT_CSV;
+            else if (strcmp(argv[i], "bin")==0)
+                output->type = OUTPUT_BINARY;
+            else if (strncmp(argv[i], "shm:", 4)==0)
+            {
+                output->type = OUTPUT_SHM;
+                if (output->ring.create(argv[i]+4)<0)
+                {
+                    fprintf(stderr, "pixycli: unable to create %s\n", argv[i]+4);
+                    return 1;
+                }
+            }
+            else
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-m")==0 && i+1<argc)
+            mux = argv[++i];
+        else if (strcmp(argv[i], "-d")==0 && i+1<argc)
+            decimation = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c")==0 && i+1<argc)
+        {
+            program = true;
+            i++;
+        }
+        else if (strcmp(argv[i], "-r")==0)
+            run = true;
+        else if (strcmp(argv[i], "-w")==0 && i+1<argc)
+            recording = argv[++i];
+        else if (strcmp(argv[i], "-p")==0 && i+1<argc)
+            playback = argv[++i];
+        else if (strcmp(argv[i], "-b")==0 && i+1<argc)
+            batch = argv[++i];
+        else if (strcmp(argv[i], "-j")==0 && i+1<argc)
+            workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l")==0 && i+1<argc)
+        {
+            if ((output->latency=fopen(argv[++i], "w"))==NULL)
+            {
+                fprintf(stderr, "pixycli: unable to create %s\n", argv[i]);
+                return 1;
+            }
+            fprintf(output->latency, "sequence,m0_end_us,unpack_us,blobify_us,getblock_us,send_us,receive_us,handled_us\n");
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (output->type==OUTPUT_CSV)
+        fprintf(output->file, "timestamp_us,sequence,model,left,right,top,bottom\n");
+
+    if (playback || batch)
+    {
+        if (playback)
+            res = pixy_host_play(playback, handleFrame, output);
+        else
+            res = pixy_host_batch(batch, workers, handleFrame, output);
+        if (res<0)
+            fprintf(stderr, "pixycli: unable to play %s (%d)\n", playback ? playback : batch, res);
+        fflush(output->file);
+        delete output;
+        return res<0 ? 1 : 0;
+    }
+
+    if ((res=mux ? pixy_host_open_mux(&host, mux) : pixy_host_open(&host))<0)
+    {
+        fprintf(stderr, "pixycli: unable to open Pixy (%d)\n", res);
+        return 1;
+    }
+    // calls are added once Pixy's procedures are known
+    for (i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-c")==0 && (res=pixy_host_program_add(host, argv[++i]))<0)
+        {
+            fprintf(stderr, "pixycli: can't call \"%s\" (%d)\n", argv[i], res);
+            pixy_host_close(host);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    pixy_host_set_handler(host, handleFrame, output);
+    if (recording && (res=pixy_host_record(host, recording))<0)
+        fprintf(stderr, "pixycli: unable to record to %s (%d)\n", recording, res);
+    else if (!program && (res=pixy_host_subscribe(host, PIXY_STREAM_CCB1, decimation))<0)
+        fprintf(stderr, "pixycli: unable to subscribe (%d)\n", res);
+    else if (run && (res=pixy_host_run(host))<0)
+        fprintf(stderr, "pixycli: unable to run (%d)\n", res);
+
+    while(g_run && res>=0)
+        res = pixy_host_service(host);
+    if (res<0)
+        fprintf(stderr, "pixycli: lost Pixy (%d)\n", res);
+
+    if (!program)
+        pixy_host_subscribe(host, 0, 0);
+    if (run || program)
+        pixy_host_stop(host);
+    if (recording)
+        pixy_host_record(host, NULL);
+    if (output->latency)
+    {
+        printLatency(host);
+        fclose(output->latency);
+    }
+    pixy_host_close(host);
+    fflush(output->file);
+    delete output;
+
+    return res<0 ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# pixycli, streams Pixy's blocks to stdout or shared memory
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = pixycli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp
+
+HEADERS += ../libpixyhost/pixyhost.h \
+    ../pixymux/muxring.h \
+    ../pixymon/hostsync.h
+
+INCLUDEPATH += ../libpixyhost ../pixymux ../pixymon
+
+LIBS += -L../libpixyhost -lpixyhost
+PRE_TARGETDEPS += ../libpixyhost/libpixyhost.a
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+    LIBS += -L/opt/local/lib -lusb-1.0
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    LIBS += -lusb-1.0 -lrt -lpthread
+}
@@ -0,0 +1,273 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include "batchprocessor.h"
+#include "chirp.hpp"
+
+BatchFrame::BatchFrame(uint32_t index, uint64_t timestamp, const Frame8 &frame, bool copy)
+{
+    uint32_t len = frame.m_width*frame.m_height;
+
+    m_index = index;
+    m_timestamp = timestamp;
+    if (copy)
+    {
+        m_copy = new uint8_t[len];
+        memcpy(m_copy, frame.m_pixels, len);
+        m_frame = Frame8(m_copy, frame.m_width, frame.m_height);
+    }
+    else
+    {
+        m_copy = NULL;
+        m_frame = frame;
+    }
+    m_blobs = NULL;
+    m_numBlobs = 0;
+}
+
+BatchFrame::~BatchFrame()
+{
+    delete [] m_copy;
+    delete [] m_blobs;
+}
+
+
+RecordingBatchReader::RecordingBatchReader(RecordingReader *recording)
+{
+    m_recording = recording;
+    m_record = 0;
+}
+
+int RecordingBatchReader::read(Frame8 *frame, uint64_t *timestamp, const ColorModel **cmodels)
+{
+    const RecordHeader *header;
+    void *args[CRP_MAX_ARGS+1];
+    uint32_t n;
+
+    for (; m_record<m_recording->records(); m_record++)
+    {
+        // renderFlags, color models, width, height, frame (PixyHost::decode())
+        if ((header=m_recording->args(m_record, args))==NULL || header->fourcc!=FOURCC('C','M','V','1'))
+            continue;
+        for (n=0; args[n]; n++);
+        if (n<8 || *(uint32_t *)args[6]<(uint32_t)*(uint16_t *)args[4]**(uint16_t *)args[5])
+            continue;
+
+        *frame = Frame8((uint8_t *)args[7], *(uint16_t *)args[4], *(uint16_t *)args[5]);
+        *timestamp = header->timestamp;
+        if (*(uint32_t *)args[2]>=sizeof(ColorModel)*NUM_MODELS/sizeof(float))
+            *cmodels = (const ColorModel *)args[3];
+        else
+            *cmodels = NULL;
+        m_record++;
+        return 0;
+    }
+    return -1;
+}
+
+
+BatchWorker::BatchWorker(BatchProcessor *processor, const uint8_t *lut)
+{
+    m_processor = processor;
+    m_blobs.setLut(lut);
+}
+
+void BatchWorker::run()
+{
+    BatchFrame *frame;
+    BlobA *blobs;
+    uint32_t numQvals;
+    Qval *qvals;
+
+    while((frame=m_processor->getFrame()))
+    {
+        m_blobs.process(frame->m_frame, &frame->m_numBlobs, &blobs, &numQvals, &qvals);
+        // blobs belong to m_blobs, so make a copy
+        frame->m_blobs = new BlobA[frame->m_numBlobs];
+        memcpy(frame->m_blobs, blobs, frame->m_numBlobs*sizeof(BlobA));
+        m_processor->putFrame(frame);
+    }
+}
+
+
+BatchProcessor::BatchProcessor(int numWorkers)
+{
+    int i;
+
+    m_lut = new uint8_t[CL_LUT_SIZE];
+    memset(m_lut, 0, CL_LUT_SIZE);
+    m_clut = new ColorLUT(m_lut);
+
+    if (numWorkers<=0)
+        numWorkers = HostThread::idealThreadCount();
+    if (numWorkers<=0)
+        numWorkers = 1;
+    for (i=0; i<numWorkers; i++)
+        m_workers.push_back(new BatchWorker(this, m_lut));
+
+    m_pending = 0;
+    m_writeIndex = 0;
+    m_done = false;
+}
+
+BatchProcessor::~BatchProcessor()
+{
+    uint32_t i;
+
+    for (i=0; i<m_workers.size(); i++)
+        delete m_workers[i];
+    delete m_clut;
+    delete [] m_lut;
+}
+
+int BatchProcessor::process(BatchReader *reader, BatchWriter *writer)
+{
+    uint32_t i, index;
+    int res;
+    uint64_t timestamp;
+    Frame8 frame;
+    const ColorModel *cmodels;
+    BatchFrame *bframe;
+
+    m_pending = 0;
+    m_writeIndex = 0;
+    m_done = false;
+    for (i=0; i<m_workers.size(); i++)
+        m_workers[i]->start();
+
+    res = 0;
+    for (index=0; reader->read(&frame, &timestamp, &cmodels)==0; index++)
+    {
+        bframe = new BatchFrame(index, timestamp, frame, !reader->framesStay());
+
+        m_mutex.lock();
+        if (cmodels)
+        {
+            // the frames so far go with the old lut, finish them before it changes
+            if ((res=writeFrames(writer, true))==0)
+            {
+                m_clut->clear();
+                for (i=0; i<NUM_MODELS; i++)
+                    m_clut->add(cmodels+i, i+1);
+            }
+        }
+        if (res==0)
+        {
+            m_frames.push_back(bframe);
+            m_pending++;
+            m_frameReady.wakeOne();
+            // write what we can, wait if we're too far ahead
+            res = writeFrames(writer, false);
+        }
+        else
+            delete bframe;
+        m_mutex.unlock();
+        if (res<0)
+            break;
+    }
+    if (res==0)
+    {
+        m_mutex.lock();
+        res = writeFrames(writer, true);
+        m_mutex.unlock();
+    }
+
+    stop();
+
+    return res<0 ? -1 : (int)index;
+}
+
+// called with m_mutex locked
+int BatchProcessor::writeFrames(BatchWriter *writer, bool all)
+{
+    int res;
+    BatchFrame *frame;
+    std::map<uint32_t, BatchFrame *>::iterator it;
+
+    while(1)
+    {
+        // write in frame order
+        while ((it=m_results.find(m_writeIndex))==m_results.end())
+        {
+            if (m_pending==0 || (!all && m_pending<m_workers.size()*BP_FRAMES_PER_WORKER))
+                return 0;
+            m_resultReady.wait(&m_mutex);
+        }
+        frame = it->second;
+        m_results.erase(it);
+        m_writeIndex++;
+        m_pending--;
+
+        m_mutex.unlock();
+        res = writer->write(frame);
+        delete frame;
+        m_mutex.lock();
+
+        if (res<0)
+            return -1;
+    }
+}
+
+BatchFrame *BatchProcessor::getFrame()
+{
+    BatchFrame *frame;
+
+    m_mutex.lock();
+    while (m_frames.empty() && !m_done)
+        m_frameReady.wait(&m_mutex);
+    if (m_done)
+        frame = NULL;
+    else
+    {
+        frame = m_frames.front();
+        m_frames.pop_front();
+    }
+    m_mutex.unlock();
+
+    return frame;
+}
+
+void BatchProcessor::putFrame(BatchFrame *frame)
+{
+    m_mutex.lock();
+    m_results[frame->m_index] = frame;
+    m_resultReady.wakeOne();
+    m_mutex.unlock();
+}
+
+void BatchProcessor::stop()
+{
+    uint32_t i;
+    std::map<uint32_t, BatchFrame *>::iterator it;
+
+    m_mutex.lock();
+    m_done = true;
+    m_frameReady.wakeAll();
+    m_mutex.unlock();
+
+    for (i=0; i<m_workers.size(); i++)
+        m_workers[i]->wait();
+
+    // if the writer failed there may be frames left over
+    while (!m_frames.empty())
+    {
+        delete m_frames.front();
+        m_frames.pop_front();
+    }
+    for (it=m_results.begin(); it!=m_results.end(); it++)
+        delete it->second;
+    m_results.clear();
+}
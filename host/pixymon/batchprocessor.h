@@ -0,0 +1,141 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <deque>
+#include <map>
+#include <vector>
+#include "hostsync.h"
+#include "processblobs.h"
+#include "recording.h"
+
+// maximum number of frames waiting to be processed or written, per worker
+#define BP_FRAMES_PER_WORKER    4
+
+struct BatchFrame
+{
+    BatchFrame(uint32_t index, uint64_t timestamp, const Frame8 &frame, bool copy);
+    ~BatchFrame();
+
+    uint32_t m_index; // 0, 1, 2... in the order they were read
+    uint64_t m_timestamp;
+    Frame8 m_frame;
+    uint8_t *m_copy; // m_frame's pixels if they had to be copied
+    BlobA *m_blobs;
+    uint32_t m_numBlobs;
+};
+
+// where the frames come from, e.g. a recording (RecordingBatchReader)
+class BatchReader
+{
+public:
+    virtual ~BatchReader() {}
+    // Returns 0 and fills in frame and its timestamp, or -1 if there are no more frames.  The
+    // pixels only need to stay valid until the next call.  cmodels is set to the NUM_MODELS color
+    // models the frame goes with if they've changed, otherwise NULL.
+    virtual int read(Frame8 *frame, uint64_t *timestamp, const ColorModel **cmodels) = 0;
+    // true if the pixels stay valid until process() returns, so they don't have to be copied
+    virtual bool framesStay()
+    {
+        return false;
+    }
+};
+
+// where the blocks go, called in frame order
+class BatchWriter
+{
+public:
+    virtual ~BatchWriter() {}
+    // returns 0 if successful, < 0 stops processing
+    virtual int write(const BatchFrame *frame) = 0;
+};
+
+// The CMV1 frames in a recording and the color models they came with, the rest of the records
+// are skipped.  Frames are stamped with when they were recorded.
+class RecordingBatchReader : public BatchReader
+{
+public:
+    RecordingBatchReader(RecordingReader *recording);
+    virtual int read(Frame8 *frame, uint64_t *timestamp, const ColorModel **cmodels);
+    virtual bool framesStay()
+    {
+        return true; // they're in the mapping
+    }
+
+private:
+    RecordingReader *m_recording;
+    uint32_t m_record; // next one to look at
+};
+
+class BatchProcessor;
+
+class BatchWorker : public HostThread
+{
+public:
+    BatchWorker(BatchProcessor *processor, const uint8_t *lut);
+
+protected:
+    virtual void run();
+
+private:
+    BatchProcessor *m_processor;
+    ProcessBlobs m_blobs;
+};
+
+// Processes a sequence of frames (BA81 or CMV1 Bayer frames) with a worker thread per core.
+// Each worker has its own ProcessBlobs (Blobs, assemblers, q val memory) and all workers
+// share m_lut.  When the reader has new color models, the frames before them are finished and
+// written before m_lut is rebuilt, so each frame is processed with its own models, the same as
+// one ProcessBlobs going through them in order.  Doesn't need Qt, so it's in libpixyhost too.
+class BatchProcessor
+{
+public:
+    BatchProcessor(int numWorkers=0); // 0 = one worker per core
+    ~BatchProcessor();
+
+    // returns the number of frames processed, or -1 if the writer failed
+    int process(BatchReader *reader, BatchWriter *writer);
+    uint32_t workers()
+    {
+        return m_workers.size();
+    }
+
+    // the lut is built with this, the same way as Blobs::m_clut
+    ColorLUT *m_clut;
+    uint8_t *m_lut;
+
+    friend class BatchWorker;
+
+private:
+    BatchFrame *getFrame();
+    void putFrame(BatchFrame *frame);
+    int writeFrames(BatchWriter *writer, bool all);
+    void stop();
+
+    std::vector<BatchWorker *> m_workers;
+
+    HostMutex m_mutex;
+    HostWaitCondition m_frameReady;   // a frame is waiting to be processed
+    HostWaitCondition m_resultReady;  // a frame has been processed
+    std::deque<BatchFrame *> m_frames;
+    std::map<uint32_t, BatchFrame *> m_results;
+    uint32_t m_pending; // frames queued or being processed
+    uint32_t m_writeIndex;
+    bool m_done;
+};
+
+#endif // BATCHPROCESSOR_H
@@ -0,0 +1,113 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include "bufferedlink.h"
+
+BufferedLink::BufferedLink(Link *link, uint32_t size)
+{
+    m_link = link;
+    m_size = size;
+    m_buf = new uint8_t[size];
+    m_head = 0;
+    m_tail = 0;
+}
+
+BufferedLink::~BufferedLink()
+{
+    delete [] m_buf;
+}
+
+int BufferedLink::send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    return m_link->send(data, len, timeoutMs);
+}
+
+int BufferedLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    int res;
+    uint32_t n;
+
+    if (m_head==m_tail)
+        return m_link->receive(data, len, timeoutMs);
+
+    n = m_tail-m_head>len ? len : m_tail-m_head;
+    memcpy(data, m_buf+m_head, n);
+    m_head += n;
+    if (n==len)
+        return n;
+    if ((res=m_link->receive(data+n, len-n, timeoutMs))<0)
+        return n;
+    return n+res;
+}
+
+void BufferedLink::setTimer()
+{
+    m_link->setTimer();
+}
+
+uint32_t BufferedLink::getTimer()
+{
+    return m_link->getTimer();
+}
+
+uint32_t BufferedLink::getFlags(uint8_t index)
+{
+    return m_link->getFlags(index);
+}
+
+uint32_t BufferedLink::blockSize()
+{
+    return m_link->blockSize();
+}
+
+int BufferedLink::skipTo(const uint8_t *pattern, uint32_t len, uint32_t ahead, uint16_t timeoutMs)
+{
+    int res;
+    uint32_t want;
+    uint8_t *p, *end;
+
+    if (len+ahead>m_size)
+        return LINK_RESULT_ERROR;
+
+    while(1)
+    {
+        // look for the first byte, then compare the rest (or as much as we have)
+        end = m_buf+m_tail;
+        for (p=m_buf+m_head; (p=(uint8_t *)memchr(p, pattern[0], end-p)); p++)
+        {
+            if (memcmp(p, pattern, (uint32_t)(end-p)<len ? end-p : len)==0)
+                break;
+        }
+        if (p && (uint32_t)(end-p)>=len)
+        {
+            m_head = p+len-m_buf;
+            return LINK_RESULT_OK;
+        }
+
+        // keep what might be the start of the pattern at the front, and receive the rest of it
+        // and what follows it, no more
+        m_head = p ? p-m_buf : m_tail;
+        memmove(m_buf, m_buf+m_head, m_tail-m_head);
+        m_tail -= m_head;
+        m_head = 0;
+        want = len+ahead-m_tail;
+        if ((res=m_link->receive(m_buf+m_tail, want, timeoutMs))<0)
+            return res;
+        if (res==0)
+            return LINK_RESULT_ERROR_RECV_TIMEOUT;
+        m_tail += res;
+    }
+}
@@ -0,0 +1,53 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef BUFFEREDLINK_H
+#define BUFFEREDLINK_H
+
+#include <link.h>
+
+#define BUFFEREDLINK_SIZE       0x100
+
+// Lets Chirp find a start code in one receive on a link that isn't error corrected, instead of
+// a receive per byte.  skipTo() receives the start code and the header behind it all at once,
+// finds the start code with memchr(), and hands out what's left from memory.  It only ever asks
+// the link for bytes that are sure to come, and nothing without waiting, so there's no extra
+// receive.  Receives go straight to the link once the buffer is empty.
+//
+// Only worth wrapping a link that isn't error corrected.  Chirp reads an error corrected link
+// with whole-header receives (recvFull()), and never calls skipTo().
+class BufferedLink : public Link
+{
+public:
+    BufferedLink(Link *link, uint32_t size=BUFFEREDLINK_SIZE);
+    virtual ~BufferedLink();
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual void setTimer();
+    virtual uint32_t getTimer();
+    virtual uint32_t getFlags(uint8_t index=LINK_FLAG_INDEX_FLAGS);
+    virtual uint32_t blockSize();
+    virtual int skipTo(const uint8_t *pattern, uint32_t len, uint32_t ahead, uint16_t timeoutMs);
+
+private:
+    Link *m_link;
+    uint8_t *m_buf;
+    uint32_t m_size;
+    uint32_t m_head; // next byte to hand out
+    uint32_t m_tail; // end of what's been received
+};
+
+#endif // BUFFEREDLINK_H
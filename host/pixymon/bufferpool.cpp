@@ -0,0 +1,113 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include "bufferpool.h"
+
+PooledBuffer::PooledBuffer(BufferPool *pool)
+{
+    m_pool = pool;
+    m_buf = NULL;
+    m_size = 0;
+}
+
+PooledBuffer::~PooledBuffer()
+{
+    delete [] m_buf;
+}
+
+void PooledBuffer::ref()
+{
+    m_refs.ref();
+}
+
+void PooledBuffer::release()
+{
+    if (!m_refs.deref())
+        m_pool->put(this);
+}
+
+
+BufferPool::BufferPool()
+{
+    m_allocations = 0;
+}
+
+BufferPool::~BufferPool()
+{
+    uint32_t i;
+
+    for (i=0; i<m_free.size(); i++)
+        delete m_free[i];
+}
+
+PooledBuffer *BufferPool::take(Chirp *chirp)
+{
+    uint32_t i, j;
+    uint8_t *buf;
+    uint32_t size;
+    PooledBuffer *buffer;
+
+    m_mutex.lock();
+    if (m_free.size())
+    {
+        // give chirp the biggest one so it doesn't have to grow it
+        for (i=1, j=0; i<m_free.size(); i++)
+        {
+            if (m_free[i]->m_size>m_free[j]->m_size)
+                j = i;
+        }
+        buffer = m_free[j];
+        m_free[j] = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        buffer = new PooledBuffer(this);
+        buffer->m_buf = new uint8_t[CRP_BUFSIZE];
+        buffer->m_size = CRP_BUFSIZE;
+        m_allocations++;
+    }
+    m_mutex.unlock();
+
+    size = buffer->m_size;
+    if ((buf=chirp->swapBuffer(buffer->m_buf, &size))==NULL)
+    {
+        put(buffer);
+        return NULL;
+    }
+    buffer->m_buf = buf;
+    buffer->m_size = size;
+    buffer->m_refs.storeRelease(1);
+
+    return buffer;
+}
+
+uint32_t BufferPool::available()
+{
+    uint32_t n;
+
+    m_mutex.lock();
+    n = m_free.size();
+    m_mutex.unlock();
+
+    return n;
+}
+
+void BufferPool::put(PooledBuffer *buffer)
+{
+    m_mutex.lock();
+    m_free.push_back(buffer);
+    m_mutex.unlock();
+}
@@ -0,0 +1,76 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <vector>
+#include "hostsync.h"
+#include "chirp.hpp"
+
+class BufferPool;
+
+// A buffer chirp has received into, reference counted.  The last release() returns it to the
+// pool it came from.  Release from any thread.
+class PooledBuffer
+{
+public:
+    void ref();
+    void release();
+
+    uint8_t *m_buf;
+    uint32_t m_size;
+
+private:
+    friend class BufferPool;
+    PooledBuffer(BufferPool *pool);
+    ~PooledBuffer();
+
+    BufferPool *m_pool;
+    HostAtomicInt m_refs;
+};
+
+// Keeps received data around without copying it.  take() hands over the buffer chirp just
+// received into, and gives chirp a free buffer to receive the next chirp into.  Buffers are only
+// allocated until there are enough to go around (chirp's, the ones being held, and a spare), then
+// they're recycled.  Every buffer has to be released before the pool is deleted.
+class BufferPool
+{
+public:
+    BufferPool();
+    ~BufferPool();
+
+    // The buffer with the args of the chirp just received, with one reference, or NULL if chirp
+    // can't give it up.  Call from the thread that's using chirp.
+    PooledBuffer *take(Chirp *chirp);
+
+    // number of buffers allocated so far, the pool has reached steady state when it stops going up
+    uint32_t allocations()
+    {
+        return m_allocations;
+    }
+    // number of buffers that have been released and are waiting to be taken again
+    uint32_t available();
+
+private:
+    friend class PooledBuffer;
+    void put(PooledBuffer *buffer);
+
+    HostMutex m_mutex;
+    std::vector<PooledBuffer *> m_free;
+    uint32_t m_allocations;
+};
+
+#endif // BUFFERPOOL_H
@@ -45,6 +45,9 @@ int ChirpMon::serviceChirp()
     {
         if ((res=recvChirp(&type, &recvProc, args, true))<0)
             return res;
+        // responses to pipelined calls aren't the one we're waiting for
+        if ((type&CRP_RESPONSE) && handlePending(args))
+            continue;
         handleChirp(type, recvProc, args);
         if (type&CRP_RESPONSE)
             break;
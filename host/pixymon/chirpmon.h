@@ -32,6 +32,28 @@ struct ChirpCallData
         memcpy(m_buf, buf, len);
         m_len = len;
     }
+    // the program vector copies these, each copy has its own args
+    ChirpCallData(const ChirpCallData &data)
+    {
+        m_type = data.m_type;
+        m_proc = data.m_proc;
+        m_buf = new uint8_t[data.m_len];
+        memcpy(m_buf, data.m_buf, data.m_len);
+        m_len = data.m_len;
+    }
+    ChirpCallData &operator=(const ChirpCallData &data)
+    {
+        uint8_t *buf;
+
+        buf = new uint8_t[data.m_len];
+        memcpy(buf, data.m_buf, data.m_len);
+        delete [] m_buf;
+        m_type = data.m_type;
+        m_proc = data.m_proc;
+        m_buf = buf;
+        m_len = data.m_len;
+        return *this;
+    }
     ~ChirpCallData()
     {
         delete [] m_buf;
@@ -50,52 +50,82 @@ QString typeString(uint8_t type)
     }
 }
 
+static void loadParam(void *data, int res, void *args[])
+{
+    ParamLoad *param = (ParamLoad *)data;
+    int response;
+    char *id, *desc;
+    uint8_t *argList, *paramData;
+
+    // response is negative past the last param
+    if (res<0 || *(int32_t *)args[0]<0)
+        return;
+    if (Chirp::getArgs(args, &response, &param->m_flags, &argList, &id, &desc, &param->m_len, &paramData, END_IN_ARGS)<0)
+        return;
+    if (param->m_len>sizeof(param->m_data))
+        return;
+    param->m_type = argList[0];
+    param->m_id = id;
+    param->m_desc = desc;
+    memcpy(param->m_data, paramData, param->m_len);
+    param->m_valid = true;
+}
+
 void ConfigWorker::load()
 {
     qDebug("loading...");
     QMutexLocker locker(&m_dialog->m_interpreter->m_chirp->m_mutex);
-    uint i;
-    char *id, *desc;
-    uint32_t len;
-    uint32_t flags;
-    int response;
-    uint8_t *data, *argList;
+    ChirpMon *chirp = m_dialog->m_interpreter->m_chirp;
+    uint i, j;
+    bool done;
+    ParamLoad params[CRP_MAX_PENDING];
 
-    ChirpProc prm_getAll = m_dialog->m_interpreter->m_chirp->getProc("prm_getAll");
+    ChirpProc prm_getAll = chirp->getProc("prm_getAll");
     if (prm_getAll<0)
         return;
 
-    int res;
-    for (i=0; true; i++)
+    // get params a batch at a time with pipelined calls, until an index fails
+    for (i=0, done=false; !done; i+=CRP_MAX_PENDING)
     {
-        QString category;
+        for (j=0; j<CRP_MAX_PENDING; j++)
+            params[j].m_valid = false;
+        for (j=0; j<CRP_MAX_PENDING; j++)
+        {
+            if (chirp->callPipelined(prm_getAll, loadParam, &params[j], UINT16(i+j), END_OUT_ARGS)<0)
+                break;
+        }
+        chirp->waitPending();
 
-        res = m_dialog->m_interpreter->m_chirp->callSync(prm_getAll, UINT16(i), END_OUT_ARGS, &response, &flags, &argList, &id, &desc, &len, &data, END_IN_ARGS);
-        if (res<0)
-            break;
+        for (j=0; j<CRP_MAX_PENDING; j++)
+        {
+            ParamLoad &param = params[j];
+            QString category;
+            QString sdesc(param.m_desc);
 
-        QString sdesc(desc);
+            if (!param.m_valid)
+            {
+                done = true;
+                break;
+            }
 
-        if (response<0)
-            break;
+            if (param.m_flags&PRM_FLAG_INTERNAL)
+                continue;
 
-        if (flags&PRM_FLAG_INTERNAL)
-            continue;
+            // deal with param category
+            QStringList words = param.m_desc.split(QRegExp("\\s+"));
+            int k = words.indexOf("@c");
+            if (k>=0 && words.size()>k+1)
+            {
+                category = words[k+1];
+                sdesc = sdesc.remove("@c "); // remove form description
+                sdesc = sdesc.remove(category + " "); // remove from description
+                category = category.replace('_', ' '); // make it look prettier
+            }
+            else
+                category = CD_GENERAL;
 
-        // deal with param category
-        QStringList words = QString(desc).split(QRegExp("\\s+"));
-        int i = words.indexOf("@c");
-        if (i>=0 && words.size()>i+1)
-        {
-            category = words[i+1];
-            sdesc = sdesc.remove("@c "); // remove form description
-            sdesc = sdesc.remove(category + " "); // remove from description
-            category = category.replace('_', ' '); // make it look prettier
+            m_dialog->m_paramList.push_back(Param(param.m_id, category, "("+typeString(param.m_type)+") "+sdesc, param.m_type, param.m_flags, param.m_len, param.m_data));
         }
-        else
-            category = CD_GENERAL;
-
-        m_dialog->m_paramList.push_back(Param(id, category, "("+typeString(argList[0])+") "+sdesc, argList[0], flags, len, data));
     }
 
     qDebug("loaded");
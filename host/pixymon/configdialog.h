@@ -62,6 +62,18 @@ struct Param
 // If gui thread blocks and worker thread in Interpreter is blocking (because there's a mutex in the paint call)---
 // then we have deadlock.
 // The nice thing is that we can load and save all the parameters while streaming and rendering image data without any issues.
+// prm_getAll response, filled in by loadParam() when the pipelined call completes
+struct ParamLoad
+{
+    bool m_valid;
+    uint32_t m_flags;
+    uint8_t m_type;
+    QString m_id;
+    QString m_desc;
+    uint32_t m_len;
+    uint8_t m_data[0x100];
+};
+
 class ConfigWorker : public QObject
 {
     Q_OBJECT
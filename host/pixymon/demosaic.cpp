@@ -0,0 +1,267 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <QThread>
+#include "demosaic.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define DEMOSAIC_SSE2
+#include <emmintrin.h>
+#endif
+
+#define RGB32(r, g, b)  ((0x40<<24) | ((r)<<16) | ((g)<<8) | (b))
+
+DemosaicJob::DemosaicJob(Demosaic *demosaic, uint32_t band)
+{
+    m_demosaic = demosaic;
+    m_band = band;
+    setAutoDelete(false);
+}
+
+void DemosaicJob::run()
+{
+    m_demosaic->band(m_band);
+}
+
+
+// Even rows go blue, green, ... and odd rows green, red, ..., so starting at an odd x, the first
+// pixel of each pair is green (red on odd rows) and the second is blue (green on odd rows).
+// Same math as the old per-pixel interpolation, which the output matches bit for bit.
+template <int ODD> static inline void bilinearPair(const uint8_t *p, int w, uint32_t *line)
+{
+    const uint8_t *q = p+1;
+
+    if (ODD)
+    {
+        line[0] = RGB32(p[0], (p[-1]+p[1]+p[w]+p[-w])>>2, (p[-w-1]+p[-w+1]+p[w-1]+p[w+1])>>2);
+        line[1] = RGB32((q[-1]+q[1])>>1, q[0], (q[-w]+q[w])>>1);
+    }
+    else
+    {
+        line[0] = RGB32((p[-w]+p[w])>>1, p[0], (p[-1]+p[1])>>1);
+        line[1] = RGB32((q[-w-1]+q[-w+1]+q[w-1]+q[w+1])>>2, (q[-1]+q[1]+q[w]+q[-w])>>2, q[0]);
+    }
+}
+
+#ifdef DEMOSAIC_SSE2
+// interleave 16 blue, green and red values into 16 RGB32 pixels
+static inline void storePixels(__m128i b, __m128i g, __m128i r, uint32_t *line)
+{
+    __m128i a = _mm_set1_epi8(0x40);
+    __m128i bg = _mm_unpacklo_epi8(b, g);
+    __m128i ra = _mm_unpacklo_epi8(r, a);
+
+    _mm_storeu_si128((__m128i *)line, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *)(line+4), _mm_unpackhi_epi16(bg, ra));
+    bg = _mm_unpackhi_epi8(b, g);
+    ra = _mm_unpackhi_epi8(r, a);
+    _mm_storeu_si128((__m128i *)(line+8), _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i *)(line+12), _mm_unpackhi_epi16(bg, ra));
+}
+
+// first pixel of each pair from a, second from b
+static inline __m128i selectPair(__m128i a, __m128i b)
+{
+    __m128i mask = _mm_set1_epi32(0x0000ffff);
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// 8 pixels (4 pairs), 16 bits per value
+template <int ODD> static inline void bilinear8(const __m128i *v, __m128i *r, __m128i *g, __m128i *b)
+{
+    // v is left, center, right of the row above, this row, and the row below
+    __m128i h = _mm_add_epi16(v[3], v[5]);
+    __m128i vert = _mm_add_epi16(v[1], v[7]);
+    __m128i cross = _mm_srli_epi16(_mm_add_epi16(h, vert), 2);
+    __m128i diag = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(v[0], v[2]), _mm_add_epi16(v[6], v[8])), 2);
+
+    h = _mm_srli_epi16(h, 1);
+    vert = _mm_srli_epi16(vert, 1);
+    if (ODD)
+    {
+        *r = selectPair(v[4], h);
+        *g = selectPair(cross, v[4]);
+        *b = selectPair(diag, vert);
+    }
+    else
+    {
+        *r = selectPair(vert, diag);
+        *g = selectPair(v[4], cross);
+        *b = selectPair(h, v[4]);
+    }
+}
+
+// 16 pixels, starting at an odd x
+template <int ODD> static inline void bilinear16(const uint8_t *p, int w, uint32_t *line)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i bytes[9], lo[9], hi[9];
+    __m128i r[2], g[2], b[2];
+
+    // spelled out, -O2 doesn't unroll a loop here
+    bytes[0] = _mm_loadu_si128((const __m128i *)(p-w-1));
+    bytes[1] = _mm_loadu_si128((const __m128i *)(p-w));
+    bytes[2] = _mm_loadu_si128((const __m128i *)(p-w+1));
+    bytes[3] = _mm_loadu_si128((const __m128i *)(p-1));
+    bytes[4] = _mm_loadu_si128((const __m128i *)p);
+    bytes[5] = _mm_loadu_si128((const __m128i *)(p+1));
+    bytes[6] = _mm_loadu_si128((const __m128i *)(p+w-1));
+    bytes[7] = _mm_loadu_si128((const __m128i *)(p+w));
+    bytes[8] = _mm_loadu_si128((const __m128i *)(p+w+1));
+#define UNPACK(i)  lo[i] = _mm_unpacklo_epi8(bytes[i], zero), hi[i] = _mm_unpackhi_epi8(bytes[i], zero)
+    UNPACK(0); UNPACK(1); UNPACK(2); UNPACK(3); UNPACK(4); UNPACK(5); UNPACK(6); UNPACK(7); UNPACK(8);
+#undef UNPACK
+    bilinear8<ODD>(lo, &r[0], &g[0], &b[0]);
+    bilinear8<ODD>(hi, &r[1], &g[1], &b[1]);
+    storePixels(_mm_packus_epi16(b[0], b[1]), _mm_packus_epi16(g[0], g[1]), _mm_packus_epi16(r[0], r[1]), line);
+}
+#endif
+
+template <int ODD> static void bilinearRow(const uint8_t *p, int width, uint32_t *line)
+{
+    int x = 1;
+
+#ifdef DEMOSAIC_SSE2
+    for (; x+17<=width; x+=16, p+=16, line+=16)
+        bilinear16<ODD>(p, width, line);
+#endif
+    for (; x+2<width; x+=2, p+=2, line+=2)
+        bilinearPair<ODD>(p, width, line);
+    if (x<width-1) // odd width, one left over
+    {
+        uint32_t pair[2];
+        bilinearPair<ODD>(p, width, pair);
+        *line = pair[0];
+    }
+}
+
+static void halfResRow(const uint8_t *p, int width, uint32_t *line)
+{
+    const uint8_t *q = p+width;
+    int x = 0;
+
+#ifdef DEMOSAIC_SSE2
+    __m128i mask = _mm_set1_epi16(0x00ff);
+    __m128i row0[2], row1[2], g[2];
+    int i;
+
+    for (; x+32<=width; x+=32, p+=32, q+=32, line+=16)
+    {
+        for (i=0; i<2; i++)
+        {
+            row0[i] = _mm_loadu_si128((const __m128i *)(p+i*16));
+            row1[i] = _mm_loadu_si128((const __m128i *)(q+i*16));
+            g[i] = _mm_srli_epi16(_mm_add_epi16(_mm_srli_epi16(row0[i], 8), _mm_and_si128(row1[i], mask)), 1);
+        }
+        storePixels(_mm_packus_epi16(_mm_and_si128(row0[0], mask), _mm_and_si128(row0[1], mask)),
+                    _mm_packus_epi16(g[0], g[1]),
+                    _mm_packus_epi16(_mm_srli_epi16(row1[0], 8), _mm_srli_epi16(row1[1], 8)), line);
+    }
+#endif
+    for (; x+2<=width; x+=2, p+=2, q+=2, line++)
+        *line = RGB32(q[1], (p[1]+q[0])>>1, p[0]);
+}
+
+
+Demosaic::Demosaic(uint32_t numBands)
+{
+    uint32_t i;
+
+    if (numBands==0)
+        numBands = QThread::idealThreadCount()>0 ? QThread::idealThreadCount() : 1;
+    m_numBands = numBands;
+    m_bands = 1;
+    m_pool.setMaxThreadCount(numBands);
+
+    for (i=0; i<numBands; i++)
+        m_jobs.push_back(new DemosaicJob(this, i));
+}
+
+Demosaic::~Demosaic()
+{
+    uint32_t i;
+
+    for (i=0; i<m_jobs.size(); i++)
+        delete m_jobs[i];
+}
+
+void Demosaic::bilinear(const uint8_t *frame, uint16_t width, uint16_t height, uint32_t *image, uint32_t stride)
+{
+    if (width<3 || height<3)
+        return;
+    m_half = false;
+    m_frame = frame;
+    m_width = width;
+    m_image = image;
+    m_stride = stride;
+    run(height-2, width-2);
+}
+
+void Demosaic::halfRes(const uint8_t *frame, uint16_t width, uint16_t height, uint32_t *image, uint32_t stride)
+{
+    if (width<2 || height<2)
+        return;
+    m_half = true;
+    m_frame = frame;
+    m_width = width;
+    m_image = image;
+    m_stride = stride;
+    run(height/2, width/2);
+}
+
+void Demosaic::run(uint32_t rows, uint32_t cols)
+{
+    uint32_t k;
+
+    m_rows = rows;
+    m_bands = rows*cols/DEMOSAIC_BAND_PIXELS;
+    if (m_bands>m_numBands)
+        m_bands = m_numBands;
+    if (m_bands>rows)
+        m_bands = rows;
+
+    if (m_bands<=1)
+    {
+        m_bands = 1;
+        band(0);
+    }
+    else
+    {
+        for (k=0; k<m_bands; k++)
+            m_pool.start(m_jobs[k]);
+        m_pool.waitForDone();
+    }
+}
+
+void Demosaic::band(uint32_t band)
+{
+    uint32_t i, end = (band+1)*m_rows/m_bands;
+    const uint8_t *pixel;
+
+    for (i=band*m_rows/m_bands; i<end; i++)
+    {
+        if (m_half)
+            halfResRow(m_frame + 2*i*m_width, m_width, m_image + i*m_stride);
+        else
+        {
+            // output row i is frame row i+1, starting at column 1
+            pixel = m_frame + (i+1)*m_width + 1;
+            if (i&1)
+                bilinearRow<0>(pixel, m_width, m_image + i*m_stride);
+            else
+                bilinearRow<1>(pixel, m_width, m_image + i*m_stride);
+        }
+    }
+}
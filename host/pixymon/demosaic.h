@@ -0,0 +1,74 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef DEMOSAIC_H
+#define DEMOSAIC_H
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <vector>
+#include <stdint.h>
+
+#define DEMOSAIC_BAND_PIXELS    0x10000 // don't bother with more bands than this many pixels each
+
+class Demosaic;
+
+class DemosaicJob : public QRunnable
+{
+public:
+    DemosaicJob(Demosaic *demosaic, uint32_t band);
+    virtual void run();
+
+private:
+    Demosaic *m_demosaic;
+    uint32_t m_band;
+};
+
+// Turns BA81 Bayer frames into RGB32 pixels, in horizontal bands, one thread per band for large
+// frames.  The inner loops don't branch on pixel color; each row is done a pair of pixels at a
+// time (SSE2, 16 pixels at a time, where the compiler has it).
+class Demosaic
+{
+public:
+    Demosaic(uint32_t numBands=0); // 0 = one band per core
+    ~Demosaic();
+
+    // Bilinear interpolation, (width-2)x(height-2) pixels because the outermost rows and
+    // columns are missing neighbors.  image has stride pixels per line.
+    void bilinear(const uint8_t *frame, uint16_t width, uint16_t height, uint32_t *image, uint32_t stride);
+    // Cheaper preview, one pixel per 2x2 quad, (width/2)x(height/2) pixels.
+    void halfRes(const uint8_t *frame, uint16_t width, uint16_t height, uint32_t *image, uint32_t stride);
+
+    friend class DemosaicJob;
+
+private:
+    void run(uint32_t rows, uint32_t cols);
+    void band(uint32_t band);
+
+    uint32_t m_numBands;
+    uint32_t m_bands; // bands in this frame
+    QThreadPool m_pool;
+    std::vector<DemosaicJob *> m_jobs;
+
+    // the frame being done
+    bool m_half;
+    const uint8_t *m_frame;
+    uint16_t m_width;
+    uint32_t m_rows;
+    uint32_t *m_image;
+    uint32_t m_stride;
+};
+
+#endif // DEMOSAIC_H
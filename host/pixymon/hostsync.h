@@ -0,0 +1,276 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef HOSTSYNC_H
+#define HOSTSYNC_H
+
+// Threads, locks and timers for the host code that's shared with libpixyhost (USBLink, chirp),
+// which is built without Qt (PIXY_HOST_NO_QT).  With Qt these are Qt's, so PixyMon and pixymux
+// are unchanged.  Without Qt they're the same subset of Qt's interface on top of pthreads, and
+// the atomics need GCC or clang.
+
+#ifdef PIXY_HOST_NO_QT
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+class HostMutex
+{
+public:
+    HostMutex()
+    {
+        pthread_mutex_init(&m_mutex, NULL);
+    }
+    ~HostMutex()
+    {
+        pthread_mutex_destroy(&m_mutex);
+    }
+    void lock()
+    {
+        pthread_mutex_lock(&m_mutex);
+    }
+    bool tryLock()
+    {
+        return pthread_mutex_trylock(&m_mutex)==0;
+    }
+    void unlock()
+    {
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+private:
+    friend class HostWaitCondition;
+    pthread_mutex_t m_mutex;
+};
+
+// monotonic microseconds
+inline uint64_t hostTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+class HostWaitCondition
+{
+public:
+    HostWaitCondition()
+    {
+        pthread_condattr_t attr;
+
+        pthread_condattr_init(&attr);
+#ifndef __MACOS__ // mac only waits on the realtime clock
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+        pthread_cond_init(&m_cond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+    ~HostWaitCondition()
+    {
+        pthread_cond_destroy(&m_cond);
+    }
+    // false if timeMs went by without a wake
+    bool wait(HostMutex *mutex, unsigned long timeMs)
+    {
+        struct timespec ts;
+
+#ifdef __MACOS__
+        clock_gettime(CLOCK_REALTIME, &ts);
+#else
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+        ts.tv_sec += timeMs/1000;
+        ts.tv_nsec += (timeMs%1000)*1000000;
+        if (ts.tv_nsec>=1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        return pthread_cond_timedwait(&m_cond, &mutex->m_mutex, &ts)!=ETIMEDOUT;
+    }
+    bool wait(HostMutex *mutex)
+    {
+        return pthread_cond_wait(&m_cond, &mutex->m_mutex)==0;
+    }
+    void wakeOne()
+    {
+        pthread_cond_signal(&m_cond);
+    }
+    void wakeAll()
+    {
+        pthread_cond_broadcast(&m_cond);
+    }
+
+private:
+    pthread_cond_t m_cond;
+};
+
+class HostElapsedTimer
+{
+public:
+    HostElapsedTimer()
+    {
+        m_start = 0;
+    }
+    void start()
+    {
+        m_start = hostTime();
+    }
+    int64_t elapsed() // ms
+    {
+        return (hostTime()-m_start)/1000;
+    }
+
+private:
+    uint64_t m_start;
+};
+
+class HostThread
+{
+public:
+    HostThread()
+    {
+        m_running = false;
+    }
+    virtual ~HostThread()
+    {
+    }
+    void start()
+    {
+        m_running = pthread_create(&m_thread, NULL, entry, this)==0;
+    }
+    bool wait()
+    {
+        if (m_running)
+            pthread_join(m_thread, NULL);
+        m_running = false;
+        return true;
+    }
+    static void msleep(unsigned long msecs)
+    {
+        ::usleep(msecs*1000);
+    }
+    static void usleep(unsigned long usecs)
+    {
+        ::usleep(usecs);
+    }
+    static int idealThreadCount()
+    {
+        return sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+protected:
+    virtual void run() = 0;
+
+private:
+    static void *entry(void *thread)
+    {
+        ((HostThread *)thread)->run();
+        return NULL;
+    }
+
+    pthread_t m_thread;
+    bool m_running;
+};
+
+// what we use of QAtomicInt, same size so it can go in shared memory that Qt builds map too
+class HostAtomicInt
+{
+public:
+    HostAtomicInt(int value=0)
+    {
+        m_value = value;
+    }
+    int loadAcquire() const
+    {
+        return __atomic_load_n(&m_value, __ATOMIC_ACQUIRE);
+    }
+    void storeRelease(int value)
+    {
+        __atomic_store_n(&m_value, value, __ATOMIC_RELEASE);
+    }
+    // like Qt's, false if the value is 0 afterwards
+    bool ref()
+    {
+        return __atomic_add_fetch(&m_value, 1, __ATOMIC_ACQ_REL)!=0;
+    }
+    bool deref()
+    {
+        return __atomic_sub_fetch(&m_value, 1, __ATOMIC_ACQ_REL)!=0;
+    }
+
+private:
+    int m_value;
+};
+
+inline void hostDebug(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+#else
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QAtomicInt>
+#include <QDebug>
+
+typedef QMutex HostMutex;
+typedef QWaitCondition HostWaitCondition;
+typedef QElapsedTimer HostElapsedTimer;
+typedef QAtomicInt HostAtomicInt;
+
+class HostThread : public QThread
+{
+public:
+    // public here, QThread's are protected in Qt 4
+    static void msleep(unsigned long msecs)
+    {
+        QThread::msleep(msecs);
+    }
+    static void usleep(unsigned long usecs)
+    {
+        QThread::usleep(usecs);
+    }
+};
+
+#define hostDebug qDebug
+
+// monotonic microseconds, since the first call
+inline uint64_t hostTime()
+{
+    static QElapsedTimer timer;
+
+    if (!timer.isValid())
+        timer.start();
+    return timer.nsecsElapsed()/1000;
+}
+
+#endif
+
+#endif // HOSTSYNC_H
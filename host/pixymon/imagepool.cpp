@@ -0,0 +1,52 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include "imagepool.h"
+
+ImagePool::ImagePool()
+{
+    m_allocations = 0;
+}
+
+QImage *ImagePool::take(int width, int height, QImage::Format format)
+{
+    uint32_t i;
+    int free = -1;
+
+    // a null image can't be detached, don't let them pile up
+    if (width<=0 || height<=0)
+    {
+        m_null = QImage();
+        return &m_null;
+    }
+
+    for (i=0; i<m_images.size(); i++)
+    {
+        if (!m_images[i].isDetached())
+            continue; // still shared with someone
+        if (m_images[i].width()==width && m_images[i].height()==height && m_images[i].format()==format)
+            return &m_images[i];
+        free = i;
+    }
+
+    m_allocations++;
+    if (free>=0)
+    {
+        m_images[free] = QImage(width, height, format);
+        return &m_images[free];
+    }
+    m_images.push_back(QImage(width, height, format));
+    return &m_images.back();
+}
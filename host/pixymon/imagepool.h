@@ -0,0 +1,48 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef IMAGEPOOL_H
+#define IMAGEPOOL_H
+
+#include <QImage>
+#include <vector>
+#include <stdint.h>
+
+// Recycles the images the renderer draws into, so steady-state video doesn't allocate.  QImage
+// is implicitly shared: an image we emit is shared with whoever holds a copy (queued signal,
+// VideoWidget), and once they've all let go of it, it's ours again to draw into in place.
+// Images of the wrong size are replaced (the video widget has been resized, say).
+class ImagePool
+{
+public:
+    ImagePool();
+
+    // An image that nobody else has a copy of, contents undefined.  It stays in the pool, so
+    // don't hold on to the pointer past the next take(), hold a copy.  Call from one thread.
+    QImage *take(int width, int height, QImage::Format format);
+
+    // number of images allocated so far, the pool has reached steady state when it stops going up
+    uint32_t allocations()
+    {
+        return m_allocations;
+    }
+
+private:
+    std::vector<QImage> m_images;
+    QImage m_null;
+    uint32_t m_allocations;
+};
+
+#endif // IMAGEPOOL_H
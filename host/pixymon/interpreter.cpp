@@ -43,6 +43,17 @@ Interpreter::Interpreter(ConsoleWidget *console, VideoWidget *video) : m_mutexPr
     m_pendingCommand = NONE;
     m_running = -1; // set to bogus value to force update
     m_chirp = NULL;
+    m_hostprog_clear = -1;
+    m_hostprog_add = -1;
+    m_hostprog_run = -1;
+    m_streams = 0;
+    m_streamConsumed = 0;
+    m_streamAcked = 0;
+    memset(m_streamDrops, 0, sizeof(m_streamDrops));
+    m_playSpeed = 1.0f;
+    m_latencyPeriod = 0;
+    m_latencyPrint = false;
+    m_latencyTime.start();
 
     m_renderer = new Renderer(m_video);
 
@@ -86,6 +97,26 @@ int Interpreter::execute()
 {
     int res;
 
+    // Pixy runs the program itself if it can and pushes the calls' results, which we handle as
+    // we do any running program's, without a round trip per call.  If it doesn't fit in Pixy,
+    // we make the calls ourselves.
+    if (m_hostprog_run>=0)
+    {
+        if ((res=uploadProgram())<0)
+        {
+            m_localProgramRunning = false;
+            emit textOut("Error uploading program to Pixy.\n");
+            prompt();
+            return res;
+        }
+        if (res>0)
+        {
+            m_localProgramRunning = false;
+            getRunning();
+            return 0;
+        }
+    }
+
     emit runState(true);
     emit enableConsole(false);
 
@@ -115,6 +146,37 @@ end:
     return res;
 }
 
+// send the program's calls as they were serialized when it was defined, and run it, returns 1 if
+// Pixy's running it, 0 if it doesn't fit (HOSTPROG_SIZE)
+int Interpreter::uploadProgram()
+{
+    QMutexLocker locker(&m_mutexProg);
+    QMutexLocker chirpLocker(&m_chirp->m_mutex);
+    int res, response;
+    uint32_t i;
+
+    if (m_hostprog_clear<0 || m_hostprog_add<0)
+        return -1;
+    if ((res=m_chirp->callSync(m_hostprog_clear, END_OUT_ARGS, &response, END_IN_ARGS))<0)
+        return res;
+    for (i=0; i<m_program.size(); i++)
+    {
+        res = m_chirp->callSync(m_hostprog_add, UINT16(m_program[i].m_proc),
+                                UINTS8(m_program[i].m_len, m_program[i].m_buf), END_OUT_ARGS, &response, END_IN_ARGS);
+        if (res<0)
+            return res;
+        if (response<0) // doesn't fit, don't leave part of it behind
+            return m_chirp->callSync(m_hostprog_clear, END_OUT_ARGS, &response, END_IN_ARGS)<0 ? -1 : 0;
+    }
+    m_fastPoll = true;
+    if ((res=m_chirp->callSync(m_hostprog_run, END_OUT_ARGS, &response, END_IN_ARGS))<0)
+        return res;
+    if (response<0)
+        return response;
+
+    return 1;
+}
+
 
 QString Interpreter::printArgType(uint8_t *type, int &index)
 {
@@ -301,12 +363,16 @@ void Interpreter::handleResponse(void *args[])
             QString::number(*(int *)args[0]) + " (0x" + QString::number((uint)*(uint *)args[0], 16) + ") ";
 
     // render rest of response, if present
-    handleData(args+1);
+    handleData(args+1, CRP_RESPONSE);
 }
 
-void Interpreter::handleData(void *args[])
+void Interpreter::handleData(void *args[], uint8_t chirpType)
 {
+    uint64_t received = hostTime();
+    uint32_t len;
+    uint8_t *data;
     uint8_t type;
+    PooledBuffer *buffer;
     QColor color = CW_DEFAULT_COLOR;
 
     if (args[0])
@@ -315,7 +381,22 @@ void Interpreter::handleData(void *args[])
         if (type==CRP_TYPE_HINT)
         {
             m_print += printType(*(uint32_t *)args[0]) + " frame data\n";
-            m_renderer->render(*(uint32_t *)args[0], args+1);
+            if (m_recording.isOpen())
+            {
+                data = m_chirp->dataArgs(chirpType, &len);
+                if (m_recording.write(m_recordTime.nsecsElapsed()/1000, chirpType, *(uint32_t *)args[0], data, len)<0)
+                {
+                    m_recording.close();
+                    emit error("Unable to write recording, stopped recording.\n");
+                }
+            }
+            // the args are in this buffer, the renderer keeps a reference if it needs them later
+            buffer = m_bufferPool.take(m_chirp);
+            m_renderer->render(*(uint32_t *)args[0], args+1, buffer);
+            if (m_streams)
+                handleStream(args, received);
+            if (buffer)
+                buffer->release();
         }
         else if (type==CRP_HSTRING)
         {
@@ -415,6 +496,170 @@ int Interpreter::sendStop()
     return response;
 }
 
+int Interpreter::subscribe(uint32_t streams, uint8_t decimation)
+{
+    QMutexLocker locker(&m_chirp->m_mutex);
+    int res, response;
+    ChirpProc proc;
+
+    if ((proc=m_chirp->getProc("stream_subscribe"))<0)
+    {
+        emit error("Pixy's firmware doesn't support streams.\n");
+        return -1;
+    }
+    res = m_chirp->callSync(proc, UINT32(streams), UINT8(decimation), UINT8(STREAM_CREDITS), END_OUT_ARGS, &response, END_IN_ARGS);
+    if (res<0 || response<0)
+    {
+        emit error("Unable to subscribe.\n");
+        return -1;
+    }
+    m_streams = streams;
+    m_streamConsumed = 0;
+    m_streamAcked = 0;
+    memset(m_streamDrops, 0, sizeof(m_streamDrops));
+
+    return 0;
+}
+
+// streamed frames end with the frame sequence number and the number of frames of that stream
+// dropped so far
+void Interpreter::handleStream(void *args[], uint64_t received)
+{
+    uint32_t i, n, drops, type = *(uint32_t *)args[0];
+
+    // index of stream, STREAM_CCB1 is bit 0, etc.
+    if (type==FOURCC('C','C','B','1'))
+        i = 0;
+    else if (type==FOURCC('C','C','Q','1'))
+        i = 1;
+    else if (type==FOURCC('B','A','8','1'))
+        i = 2;
+    else
+        return;
+    if (!(m_streams&(1<<i))) // not streamed, so no sequence number or drops
+        return;
+
+    m_streamConsumed++;
+    // all three have 5 args of frame data, then sequence, drops and the trailer
+    for (n=0; args[n]; n++);
+    if (n<8)
+        return;
+    drops = *(uint32_t *)args[7];
+    if (drops>m_streamDrops[i])
+        m_print += printType(type) + " frame " + QString::number(*(uint32_t *)args[6]) + ", " + QString::number(drops) + " dropped\n";
+    m_streamDrops[i] = drops;
+
+    // the frame has been rendered once its flush comes in
+    if (n>=10 && (*(uint8_t *)args[1]&RENDER_FLAG_FLUSH))
+    {
+        m_latency.frame((uint32_t *)args[9], *(uint32_t *)args[8], received);
+        m_latency.done(hostTime());
+    }
+}
+
+// return credits to Pixy, call with chirp's mutex held
+void Interpreter::ackStream()
+{
+    int response;
+    ChirpProc proc;
+
+    if (m_streams==0 || m_streamConsumed-m_streamAcked<STREAM_CREDITS/2)
+        return;
+    if ((proc=m_chirp->getProc("stream_ack"))<0)
+        return;
+    if (m_chirp->callSync(proc, UINT32(m_streamConsumed), END_OUT_ARGS, &response, END_IN_ARGS)>=0)
+        m_streamAcked = m_streamConsumed;
+}
+
+// sample Pixy's clock every so often to put stream trailers on ours
+void Interpreter::syncClock()
+{
+    uint32_t device;
+    uint64_t sent;
+    ChirpProc proc;
+
+    if (m_streams==0 || (m_latencySync.isValid() && m_latencySync.elapsed()<LATENCY_SYNC_PERIOD))
+        return;
+    m_latencySync.start();
+    if ((proc=m_chirp->getProc("stream_time"))<0)
+        return;
+    sent = hostTime();
+    if (m_chirp->callSync(proc, END_OUT_ARGS, &device, END_IN_ARGS)>=0)
+        m_latency.clockSample(sent, device, hostTime());
+}
+
+void Interpreter::printLatency()
+{
+    char buf[0x400];
+
+    if (!m_latencyPrint && (m_latencyPeriod==0 || m_latencyTime.elapsed()<(qint64)m_latencyPeriod*1000))
+        return;
+    m_latencyPrint = false;
+    m_latencyTime.start();
+    if (m_latency.print(buf, sizeof(buf))>0)
+        emit textOut(QString(buf) + (m_latency.synced() ? "" : "(not synced with Pixy's clock yet, so no host stages)\n"));
+    // each print is the latency since the last one
+    m_latency.clear();
+}
+
+// start recording the frame data we receive to filename, or stop if it's empty
+int Interpreter::record(const QString &filename)
+{
+    if (m_chirp==NULL)
+        return -1;
+    QMutexLocker locker(&m_chirp->m_mutex);
+
+    if (m_recording.isOpen())
+    {
+        emit textOut(QString::number(m_recording.records()) + " frames recorded.\n");
+        if (m_recording.close()<0)
+            emit error("Unable to finish recording.\n");
+    }
+    if (filename=="")
+        return 0;
+    if (m_recording.open(filename.toLocal8Bit().constData())<0)
+    {
+        emit error("Unable to create " + filename + ".\n");
+        return -1;
+    }
+    m_recordTime.start();
+
+    return 0;
+}
+
+// render a recording, paced by its timestamps, until it ends or play is typed again
+void Interpreter::play()
+{
+    RecordingReader reader;
+    const RecordHeader *header;
+    void *args[CRP_MAX_ARGS+1];
+    QElapsedTimer time;
+    uint64_t start = 0;
+    int64_t wait;
+    uint32_t i, rendered;
+    int res;
+
+    if ((res=reader.open(m_playFile.toLocal8Bit().constData()))<0)
+    {
+        emit error(res==RECORDING_ERROR_FORMAT ? m_playFile + " isn't a recording.\n" : "Unable to open " + m_playFile + ".\n");
+        return;
+    }
+
+    time.start();
+    for (i=0, rendered=0; i<reader.records() && m_run && m_pendingCommand==PLAY; i++)
+    {
+        if ((header=reader.args(i, args))==NULL || args[0]==NULL || Chirp::getType(args[0])!=CRP_TYPE_HINT)
+            continue;
+        if (rendered==0)
+            start = header->timestamp;
+        if (m_playSpeed>0.0f && (wait=(int64_t)((header->timestamp-start)/m_playSpeed)-time.nsecsElapsed()/1000)>0)
+            usleep(wait);
+        m_renderer->render(header->fourcc, args+1);
+        rendered++;
+    }
+    emit textOut(QString::number(rendered) + " frames played in " + QString::number(time.elapsed()) + " ms.\n");
+}
+
 
 
 void Interpreter::handlePendingCommand()
@@ -431,6 +676,10 @@ void Interpreter::handlePendingCommand()
     case RUN:
         sendRun();
         break;
+
+    case PLAY:
+        play();
+        break;
     }
     m_pendingCommand = NONE;
 }
@@ -472,6 +721,10 @@ void Interpreter::run()
         m_exec_stop = m_chirp->getProc("stop");
         if (m_exec_run<0 || m_exec_running<0 || m_exec_stop<0)
             throw std::runtime_error("Communication error with Pixy.");
+        // older firmware doesn't have these, we make the program's calls ourselves (execute())
+        m_hostprog_clear = m_chirp->getProc("hostprog_clear");
+        m_hostprog_add = m_chirp->getProc("hostprog_add");
+        m_hostprog_run = m_chirp->getProc("hostprog_run");
     }
     catch (std::runtime_error &exception)
     {
@@ -497,9 +750,12 @@ void Interpreter::run()
             if (m_running && m_chirp->m_mutex.tryLock())
             {
                 m_chirp->service(false);
+                ackStream();
+                syncClock();
                 m_chirp->m_mutex.unlock();
             }
         }
+        printLatency();
         handlePendingCommand();
         if (!m_running)
         {
@@ -697,6 +953,45 @@ void Interpreter::command(const QString &command)
         else
             emit textOut("Missing mode parameter.\n");
     }
+    else if (words[0]=="halfres")
+    {
+        if (words.size()>1)
+            m_renderer->setHalfRes(words[1].toInt()!=0);
+        else
+            emit textOut("Missing on/off parameter.\n");
+    }
+    else if (words[0]=="imageallocs")
+        emit textOut(QString::number(m_renderer->imageAllocations()) + " images allocated for rendering so far.\n");
+    else if (words[0]=="renderdrops")
+        emit textOut(QString::number(m_renderer->pipelineDrops()) + " CMV1 frames dropped because rendering fell behind.\n");
+    else if (words[0]=="latency")
+    {
+        // p50 and p99 of each stage of streamed frames, now or every so many seconds
+        if (words.size()>1)
+            m_latencyPeriod = words[1].toUInt();
+        else
+            m_latencyPrint = true;
+    }
+    else if (words[0]=="record")
+        record(words.size()>1 ? words[1] : "");
+    else if (words[0]=="play")
+    {
+        if (words.size()>1)
+        {
+            m_playFile = words[1];
+            m_playSpeed = words.size()>2 ? words[2].toFloat() : 1.0f;
+            m_pendingCommand = PLAY;
+        }
+        else if (m_pendingCommand==PLAY)
+            m_pendingCommand = NONE; // stops playing
+    }
+    else if (words[0]=="subscribe")
+    {
+        if (words.size()>1)
+            subscribe(words[1].toUInt(0, 0), words.size()>2 ? words[2].toUInt() : 1);
+        else
+            emit textOut("Missing streams parameter.\n");
+    }
 #if 0
     else if (words[0]=="set")
     {
@@ -20,6 +20,7 @@
 #include <QMutex>
 #include <QStringList>
 #include <QColor>
+#include <QElapsedTimer>
 #include <vector>
 #include <utility>
 #include "chirpmon.h"
@@ -27,10 +28,14 @@
 #include "connectevent.h"
 #include "disconnectevent.h"
 #include "usblink.h"
+#include "bufferpool.h"
+#include "recording.h"
+#include "latency.h"
 
 #define PROMPT  ">"
 #define RUN_POLL_PERIOD_SLOW   500 // msecs
 #define RUN_POLL_PERIOD_FAST   10  // msecs
+#define STREAM_CREDITS         4   // streamed frames Pixy can send before we acknowledge them
 
 class ConsoleWidget;
 class Renderer;
@@ -99,15 +104,23 @@ private:
     void listProgram();
     int call(const QStringList &argv, bool interactive=false);
     void handleResponse(void *args[]);
-    void handleData(void *args[]);
+    void handleData(void *args[], uint8_t chirpType=CRP_XDATA);
     int addProgram(ChirpCallData data);
     int addProgram(const QStringList &argv);
     int execute();
+    int uploadProgram();
 
     void getRunning();
     int sendRun();
     int sendStop();
     void handlePendingCommand();
+    int subscribe(uint32_t streams, uint8_t decimation);
+    void handleStream(void *args[], uint64_t received);
+    void ackStream();
+    void syncClock();
+    void printLatency();
+    int record(const QString &filename);
+    void play();
 
     void prompt();
     QStringList getSections(const QString &id, const QString &string);
@@ -117,17 +130,38 @@ private:
     void augmentProcInfo(ProcInfo *info);
 
     USBLink m_link;
+    BufferPool m_bufferPool; // so the renderer can hold on to frames
 
     // for thread
     QMutex m_mutexProg;
     QMutex m_mutexInput;
     QWaitCondition m_waitInput;
-    enum {NONE, STOP, RUN} m_pendingCommand;
+    enum {NONE, STOP, RUN, PLAY} m_pendingCommand;
 
     unsigned int m_pc;
     ChirpProc m_exec_run;
     ChirpProc m_exec_running;
     ChirpProc m_exec_stop;
+    ChirpProc m_hostprog_clear; // negative if Pixy can't run uploaded programs
+    ChirpProc m_hostprog_add;
+    ChirpProc m_hostprog_run;
+
+    // for streams
+    uint32_t m_streams; // subscribed streams, STREAM_CCB1, etc.
+    uint32_t m_streamConsumed; // frames received since subscribing
+    uint32_t m_streamAcked; // frames acknowledged
+    uint32_t m_streamDrops[3]; // frames Pixy has dropped, per stream
+    Latency m_latency; // of streamed frames
+    QElapsedTimer m_latencySync; // since the last clock sample
+    QElapsedTimer m_latencyTime; // since latency was last printed
+    uint32_t m_latencyPeriod; // seconds between printing latency, 0 for never
+    bool m_latencyPrint; // print it now
+
+    // for recording and playing back frame data
+    RecordingWriter m_recording;
+    QElapsedTimer m_recordTime;
+    QString m_playFile;
+    float m_playSpeed; // 1 is real time, 0 is as fast as it renders
 
     // for program
     bool m_programming;
@@ -0,0 +1,204 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "latency.h"
+
+static const char *g_stageNames[LAT_STAGES] =
+{
+    "M0 frame start",
+    "M0 frame end",
+    "unpack",
+    "blobify",
+    "first getBlock",
+    "chirp send",
+    "host receive",
+    "host render"
+};
+
+// 0-7 are exact, then LATENCY_SUB_BUCKETS per power of 2
+static uint32_t bucket(uint32_t us)
+{
+    uint32_t e;
+
+    if (us<LATENCY_SUB_BUCKETS)
+        return us;
+    for (e=3; (us>>e)>1; e++); // e is the top bit
+    us = (e-2)*LATENCY_SUB_BUCKETS + ((us>>(e-3))&(LATENCY_SUB_BUCKETS-1));
+    return us<LATENCY_BUCKETS ? us : LATENCY_BUCKETS-1;
+}
+
+static uint32_t bucketTop(uint32_t b)
+{
+    uint32_t e;
+
+    if (b<LATENCY_SUB_BUCKETS)
+        return b;
+    e = b/LATENCY_SUB_BUCKETS+2;
+    return ((LATENCY_SUB_BUCKETS+(b&(LATENCY_SUB_BUCKETS-1))+1)<<(e-3))-1;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::add(uint32_t us)
+{
+    m_buckets[bucket(us)]++;
+    m_count++;
+}
+
+void LatencyHistogram::clear()
+{
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t percent)
+{
+    uint32_t i, n, target;
+
+    if (m_count==0)
+        return 0;
+    // smallest bucket with at least percent of the counts at or below it
+    target = ((uint64_t)m_count*percent+99)/100;
+    for (i=0, n=0; i<LATENCY_BUCKETS; i++)
+    {
+        n += m_buckets[i];
+        if (n>=target && n)
+            return bucketTop(i);
+    }
+    return bucketTop(LATENCY_BUCKETS-1);
+}
+
+
+Latency::Latency()
+{
+    m_numSamples = 0;
+    m_sampleIndex = 0;
+    m_offset = 0;
+    m_device = 0;
+    m_deviceValid = false;
+    memset(m_stamps, 0, sizeof(m_stamps));
+    m_prevStart = 0;
+    m_pending = false;
+}
+
+// Device time is 32-bit microseconds, which wraps every 71.6 minutes.  It's extended to 64 bits
+// by taking whichever value is closest to the last one we saw.
+uint64_t Latency::unwrap(uint32_t device)
+{
+    if (!m_deviceValid)
+    {
+        m_device = device;
+        m_deviceValid = true;
+    }
+    else
+        m_device += (int32_t)(device-(uint32_t)m_device);
+    return m_device;
+}
+
+void Latency::clockSample(uint64_t sent, uint32_t device, uint64_t received)
+{
+    uint32_t i, best;
+    ClockSample *sample = &m_samples[m_sampleIndex];
+
+    sample->rtt = received-sent;
+    // assume the device read its clock halfway through the round trip
+    sample->offset = (int64_t)unwrap(device) - (int64_t)(sent+sample->rtt/2);
+    m_sampleIndex = (m_sampleIndex+1)%LATENCY_CLOCK_SAMPLES;
+    if (m_numSamples<LATENCY_CLOCK_SAMPLES)
+        m_numSamples++;
+
+    for (i=1, best=0; i<m_numSamples; i++)
+    {
+        if (m_samples[i].rtt<m_samples[best].rtt)
+            best = i;
+    }
+    m_offset = m_samples[best].offset;
+}
+
+uint64_t Latency::toHost(uint32_t device)
+{
+    return unwrap(device)-m_offset;
+}
+
+void Latency::frame(const uint32_t *trailer, uint32_t len, uint64_t received, uint64_t *stamps)
+{
+    uint32_t i;
+
+    if (len<LAT_DEVICE_STAGES)
+        return;
+    for (i=0; i<LAT_DEVICE_STAGES; i++)
+        m_stamps[i] = trailer[i] ? toHost(trailer[i]) : 0;
+    m_stamps[LAT_RECEIVE] = received;
+    m_stamps[LAT_RENDER] = 0;
+
+    // first block served was the previous frame's
+    if (m_stamps[LAT_GETBLOCK] && m_prevStart && m_stamps[LAT_GETBLOCK]>m_prevStart)
+        m_stages[LAT_GETBLOCK].add(m_stamps[LAT_GETBLOCK]-m_prevStart);
+    m_stamps[LAT_GETBLOCK] = 0;
+    m_prevStart = m_stamps[LAT_M0_START];
+    m_pending = true;
+
+    if (stamps)
+        memcpy(stamps, m_stamps, sizeof(m_stamps));
+}
+
+void Latency::done(uint64_t time)
+{
+    uint32_t i;
+    uint64_t start = m_stamps[LAT_M0_START];
+
+    if (!m_pending || start==0)
+        return;
+    m_pending = false;
+    m_stamps[LAT_RENDER] = time;
+    for (i=LAT_M0_START+1; i<LAT_STAGES; i++)
+    {
+        if (i==LAT_GETBLOCK || m_stamps[i]<start || (i>=LAT_RECEIVE && !synced()))
+            continue;
+        m_stages[i].add(m_stamps[i]-start);
+    }
+}
+
+void Latency::clear()
+{
+    uint32_t i;
+
+    for (i=0; i<LAT_STAGES; i++)
+        m_stages[i].clear();
+}
+
+int Latency::print(char *buf, uint32_t size)
+{
+    uint32_t i, len;
+    int res;
+
+    res = snprintf(buf, size, "%-16s %8s %10s %10s\n", "stage", "frames", "p50 ms", "p99 ms");
+    for (i=LAT_M0_START+1, len=0; i<LAT_STAGES && res>=0 && (len+=res)<size; i++)
+        res = snprintf(buf+len, size-len, "%-16s %8u %10.3f %10.3f\n", g_stageNames[i], m_stages[i].count(),
+                       m_stages[i].percentile(50)/1000.0, m_stages[i].percentile(99)/1000.0);
+    if (res>=0)
+        len += res;
+    return len<size ? (int)len : (int)size-1;
+}
+
+const char *Latency::stageName(uint8_t stage)
+{
+    return stage<LAT_STAGES ? g_stageNames[stage] : "";
+}
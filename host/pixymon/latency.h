@@ -0,0 +1,99 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "pixytypes.h"
+
+#define LATENCY_SUB_BUCKETS     8  // per power of 2, so percentiles are within 1/8
+#define LATENCY_BUCKETS         (27*LATENCY_SUB_BUCKETS) // up to 2^29 microseconds, about 9 minutes
+#define LATENCY_CLOCK_SAMPLES   4  // offset is from the quickest of the last few
+#define LATENCY_SYNC_PERIOD     500 // ms between clock samples, short enough that drift doesn't matter
+
+// Histogram of microsecond latencies, log scaled.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(uint32_t us);
+    void clear();
+    uint32_t count()
+    {
+        return m_count;
+    }
+    uint32_t percentile(uint32_t percent); // in microseconds, upper end of the bucket
+
+private:
+    uint32_t m_buckets[LATENCY_BUCKETS];
+    uint32_t m_count;
+};
+
+// Where a streamed frame's time went, from the M0 starting to read it (LAT_M0_START) to each
+// later stage (pixytypes.h).  Device stamps come in the stream trailer and are put on the host's
+// clock with an offset estimated from stream_time calls, NTP style: the offset of the call with
+// the shortest round trip is the most accurate.  Until there is one, only stages on the device
+// are counted.  Call from one thread.
+class Latency
+{
+public:
+    Latency();
+
+    // host microseconds before and after the stream_time call, and the device time it returned
+    void clockSample(uint64_t sent, uint32_t device, uint64_t received);
+    bool synced()
+    {
+        return m_numSamples>0;
+    }
+    uint64_t toHost(uint32_t device);
+
+    // A frame's trailer and when we received it.  stamps (LAT_STAGES, optional) is set to each
+    // stage on the host's clock, 0 if it's not known.  The trailer's LAT_GETBLOCK is the previous
+    // frame's, so it's counted with that one.
+    void frame(const uint32_t *trailer, uint32_t len, uint64_t received, uint64_t *stamps=NULL);
+    // the last frame has been rendered or handled, counts its stages
+    void done(uint64_t time);
+
+    void clear();
+    // one line per stage, count, p50 and p99 in milliseconds
+    int print(char *buf, uint32_t size);
+    static const char *stageName(uint8_t stage);
+
+    LatencyHistogram m_stages[LAT_STAGES]; // microseconds from LAT_M0_START
+
+private:
+    struct ClockSample
+    {
+        uint64_t rtt;
+        int64_t offset; // device - host
+    };
+
+    uint64_t unwrap(uint32_t device);
+
+    ClockSample m_samples[LATENCY_CLOCK_SAMPLES];
+    uint32_t m_numSamples;
+    uint32_t m_sampleIndex;
+    int64_t m_offset;
+    uint64_t m_device; // last device time seen, unwrapped
+    bool m_deviceValid;
+
+    uint64_t m_stamps[LAT_STAGES]; // last frame's
+    uint64_t m_prevStart;
+    bool m_pending;
+};
+
+#endif // LATENCY_H
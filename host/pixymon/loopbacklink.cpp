@@ -0,0 +1,445 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include <math.h>
+#ifndef __WINDOWS__
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+#include "loopbacklink.h"
+#include "sleeper.h"
+
+#define SIMLINK_FRAME_TIMEOUT   1000 // ms, for the rest of a frame that has started
+#define LOOPBACK_SPINS          100  // yields before we start sleeping
+#define LOOPBACK_POLL_US        20
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL            0
+#endif
+
+static QElapsedTimer g_clock;
+
+static void pause(uint32_t i)
+{
+    if (i<LOOPBACK_SPINS)
+        QThread::yieldCurrentThread();
+    else
+        Sleeper::usleep(LOOPBACK_POLL_US);
+}
+
+
+LinkImpairment::LinkImpairment()
+{
+    m_latency = 0;
+    m_bandwidth = 0;
+    m_ber = 0.0;
+    m_seed = 1;
+    m_busyUntil = 0;
+    m_nextError = 0;
+}
+
+void LinkImpairment::setLatency(uint32_t us)
+{
+    m_latency = us;
+}
+
+void LinkImpairment::setBandwidth(uint32_t bytesPerSec)
+{
+    m_bandwidth = bytesPerSec;
+    m_busyUntil = 0;
+}
+
+void LinkImpairment::setBitErrorRate(double ber, uint32_t seed)
+{
+    m_ber = ber<0.0 ? 0.0 : (ber>0.5 ? 0.5 : ber);
+    m_seed = seed ? seed : 1;
+    if (m_ber>0.0)
+        m_nextError = nextError();
+}
+
+uint64_t LinkImpairment::arrival(uint64_t now, uint32_t len)
+{
+    if (m_bandwidth)
+    {
+        // bytes go out one after the other at the bandwidth
+        if (m_busyUntil<now)
+            m_busyUntil = now;
+        m_busyUntil += (uint64_t)len*1000000/m_bandwidth;
+        now = m_busyUntil;
+    }
+    return now + m_latency;
+}
+
+void LinkImpairment::corrupt(uint8_t *data, uint32_t len)
+{
+    uint64_t bit, bits;
+
+    if (m_ber==0.0)
+        return;
+
+    bits = (uint64_t)len*8;
+    for (bit=m_nextError; bit<bits; bit+=nextError()+1)
+        data[bit>>3] ^= 1<<(bit&0x07);
+    m_nextError = bit-bits;
+}
+
+uint64_t LinkImpairment::nextError()
+{
+    double u;
+
+    // xorshift, then the number of good bits before the next bad one is geometric
+    m_seed ^= m_seed<<13;
+    m_seed ^= m_seed>>17;
+    m_seed ^= m_seed<<5;
+    u = (m_seed+1.0)/4294967297.0;
+    return (uint64_t)(log(u)/log(1.0-m_ber));
+}
+
+
+SimLink::SimLink()
+{
+    if (!g_clock.isValid())
+        g_clock.start();
+    m_flags = LINK_FLAG_ERROR_CORRECTED | LINK_FLAG_BUFFERED_RECEIVE;
+    m_blockSize = 64;
+    m_frame = new uint8_t[sizeof(FrameHeader)+SIMLINK_MAX_FRAME];
+    m_frameLeft = 0;
+}
+
+SimLink::~SimLink()
+{
+    delete [] m_frame;
+}
+
+void SimLink::setLatency(uint32_t us)
+{
+    m_impairment.setLatency(us);
+}
+
+void SimLink::setBandwidth(uint32_t bytesPerSec)
+{
+    m_impairment.setBandwidth(bytesPerSec);
+}
+
+void SimLink::setBitErrorRate(double ber, uint32_t seed)
+{
+    m_impairment.setBitErrorRate(ber, seed);
+    // Chirp has to do its own error correction now
+    if (m_impairment.bitErrorRate()>0.0)
+        m_flags &= ~LINK_FLAG_ERROR_CORRECTED;
+    else
+        m_flags |= LINK_FLAG_ERROR_CORRECTED;
+}
+
+uint64_t SimLink::usecs()
+{
+    return g_clock.nsecsElapsed()/1000;
+}
+
+int SimLink::send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    int res;
+    uint32_t sent, n;
+    FrameHeader *header = (FrameHeader *)m_frame;
+
+    for (sent=0; sent<len; sent+=n)
+    {
+        n = len-sent>SIMLINK_MAX_FRAME ? SIMLINK_MAX_FRAME : len-sent;
+        header->len = n;
+        header->reserved = 0;
+        header->arrival = m_impairment.arrival(usecs(), n);
+        memcpy(m_frame+sizeof(FrameHeader), data+sent, n);
+        m_impairment.corrupt(m_frame+sizeof(FrameHeader), n);
+        if ((res=write(m_frame, sizeof(FrameHeader)+n, timeoutMs))<0)
+            return res;
+    }
+    return len;
+}
+
+int SimLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    int res;
+    uint32_t recvd, n;
+    uint64_t now, idle, timeout = (uint64_t)timeoutMs*1000;
+
+    // the timeout is for being continuously idle, so it starts over with each frame
+    for (recvd=0, idle=usecs(); recvd<len; idle=usecs())
+    {
+        if (m_frameLeft==0)
+        {
+            if ((res=readFrameHeader(timeoutMs))<0)
+                return res;
+            if (res==0)
+                break;
+        }
+
+        // not here yet
+        now = usecs();
+        if (m_header.arrival>now)
+        {
+            if (m_header.arrival-idle>timeout)
+            {
+                if (idle+timeout>now)
+                    Sleeper::usleep(idle+timeout-now);
+                break;
+            }
+            Sleeper::usleep(m_header.arrival-now);
+        }
+
+        n = len-recvd>m_frameLeft ? m_frameLeft : len-recvd;
+        if ((res=readAll(data+recvd, n))<0)
+            return res;
+        recvd += n;
+        m_frameLeft -= n;
+    }
+
+    if (recvd==0)
+        return LINK_RESULT_ERROR_RECV_TIMEOUT;
+    return recvd;
+}
+
+void SimLink::setTimer()
+{
+    m_timer.start();
+}
+
+uint32_t SimLink::getTimer()
+{
+    return m_timer.elapsed();
+}
+
+int SimLink::readFrameHeader(uint32_t timeoutMs)
+{
+    int res;
+
+    if ((res=read((uint8_t *)&m_header, sizeof(FrameHeader), timeoutMs))<=0)
+        return res;
+    // frames are written whole, so the rest is right behind
+    if ((uint32_t)res<sizeof(FrameHeader) && (res=readAll((uint8_t *)&m_header+res, sizeof(FrameHeader)-res))<0)
+        return res;
+    m_frameLeft = m_header.len;
+    return 1;
+}
+
+int SimLink::readAll(uint8_t *data, uint32_t len)
+{
+    int res;
+    uint32_t recvd;
+
+    for (recvd=0; recvd<len; recvd+=res)
+    {
+        if ((res=read(data+recvd, len-recvd, SIMLINK_FRAME_TIMEOUT))<0)
+            return res;
+        if (res==0)
+            return LINK_RESULT_ERROR;
+    }
+    return len;
+}
+
+
+LoopbackRing::LoopbackRing(uint32_t size)
+{
+    m_mem = new uint8_t[size];
+    m_size = size;
+    m_head.storeRelease(0);
+    m_tail.storeRelease(0);
+}
+
+LoopbackRing::~LoopbackRing()
+{
+    delete [] m_mem;
+}
+
+uint32_t LoopbackRing::write(const uint8_t *data, uint32_t len)
+{
+    uint32_t head, i, n;
+
+    head = m_head.loadAcquire();
+    if (len>writable())
+        len = writable();
+    i = head&(m_size-1);
+    n = m_size-i<len ? m_size-i : len;
+    memcpy(m_mem+i, data, n);
+    memcpy(m_mem, data+n, len-n);
+    // publish after the data is in
+    m_head.storeRelease(head+len);
+
+    return len;
+}
+
+uint32_t LoopbackRing::read(uint8_t *data, uint32_t len)
+{
+    uint32_t tail, i, n;
+
+    tail = m_tail.loadAcquire();
+    if (len>readable())
+        len = readable();
+    i = tail&(m_size-1);
+    n = m_size-i<len ? m_size-i : len;
+    memcpy(data, m_mem+i, n);
+    memcpy(data+n, m_mem, len-n);
+    // free the space after the data is out
+    m_tail.storeRelease(tail+len);
+
+    return len;
+}
+
+
+LoopbackLink::LoopbackLink(uint32_t ringSize)
+{
+    m_owner = true;
+    m_in = new LoopbackRing(ringSize);
+    m_out = new LoopbackRing(ringSize);
+}
+
+LoopbackLink::LoopbackLink(LoopbackLink &peer)
+{
+    m_owner = false;
+    m_in = peer.m_out;
+    m_out = peer.m_in;
+}
+
+LoopbackLink::~LoopbackLink()
+{
+    if (m_owner)
+    {
+        delete m_in;
+        delete m_out;
+    }
+}
+
+int LoopbackLink::write(const uint8_t *data, uint32_t len, uint32_t timeoutMs)
+{
+    uint32_t i;
+    uint64_t start;
+
+    for (i=0, start=usecs(); m_out->writable()<len; i++)
+    {
+        if (usecs()-start>=(uint64_t)timeoutMs*1000)
+            return LINK_RESULT_ERROR_SEND_TIMEOUT;
+        pause(i);
+    }
+    return m_out->write(data, len);
+}
+
+int LoopbackLink::read(uint8_t *data, uint32_t len, uint32_t timeoutMs)
+{
+    uint32_t i;
+    uint64_t start;
+
+    for (i=0, start=usecs(); m_in->readable()==0; i++)
+    {
+        if (usecs()-start>=(uint64_t)timeoutMs*1000)
+        {
+            // if we're being polled, give the other end a chance to run
+            QThread::yieldCurrentThread();
+            return 0;
+        }
+        pause(i);
+    }
+    return m_in->read(data, len);
+}
+
+
+#ifndef __WINDOWS__
+SocketPairLink::SocketPairLink(uint32_t bufSize)
+{
+    int i, fds[2], size = bufSize;
+
+    m_fd = m_peerFd = -1;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)<0)
+        return;
+    for (i=0; i<2; i++)
+    {
+        setsockopt(fds[i], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+#ifdef __MACOS__
+        int on = 1;
+        setsockopt(fds[i], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    }
+    m_fd = fds[0];
+    m_peerFd = fds[1];
+}
+
+SocketPairLink::SocketPairLink(SocketPairLink &peer)
+{
+    m_fd = peer.m_peerFd;
+    m_peerFd = -1;
+    peer.m_peerFd = -1;
+}
+
+SocketPairLink::~SocketPairLink()
+{
+    if (m_fd>=0)
+        close(m_fd);
+    if (m_peerFd>=0)
+        close(m_peerFd);
+}
+
+int SocketPairLink::write(const uint8_t *data, uint32_t len, uint32_t timeoutMs)
+{
+    int res;
+    uint32_t sent;
+    struct pollfd pfd;
+
+    if (m_fd<0)
+        return LINK_RESULT_ERROR;
+
+    pfd.fd = m_fd;
+    pfd.events = POLLOUT;
+    for (sent=0; sent<len; sent+=res)
+    {
+        // once the frame has started, it has to finish
+        if ((res=poll(&pfd, 1, sent ? SIMLINK_FRAME_TIMEOUT : timeoutMs))<=0)
+            return sent ? LINK_RESULT_ERROR : LINK_RESULT_ERROR_SEND_TIMEOUT;
+        if ((res=::send(m_fd, data+sent, len-sent, MSG_NOSIGNAL))<0)
+        {
+            if (errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
+                return LINK_RESULT_ERROR;
+            res = 0;
+        }
+    }
+    return len;
+}
+
+int SocketPairLink::read(uint8_t *data, uint32_t len, uint32_t timeoutMs)
+{
+    int res;
+    struct pollfd pfd;
+
+    if (m_fd<0)
+        return LINK_RESULT_ERROR;
+
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    if ((res=poll(&pfd, 1, timeoutMs))<=0)
+        return 0;
+    if ((res=::recv(m_fd, data, len, 0))<0)
+    {
+        if (errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
+            return LINK_RESULT_ERROR;
+        return 0;
+    }
+    if (res==0) // the other end is gone
+        return LINK_RESULT_ERROR;
+    return res;
+}
+#endif
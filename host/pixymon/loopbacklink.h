@@ -0,0 +1,173 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef LOOPBACKLINK_H
+#define LOOPBACKLINK_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <link.h>
+
+#define LOOPBACK_RING_SIZE      0x100000 // must be a power of 2
+#define SIMLINK_MAX_FRAME       0x4000   // largest send that goes out as a single frame
+
+// What a simulated link does to the data sent over it, in one direction.
+class LinkImpairment
+{
+public:
+    LinkImpairment();
+
+    void setLatency(uint32_t us); // one way, 0 = none
+    void setBandwidth(uint32_t bytesPerSec); // 0 = unlimited
+    void setBitErrorRate(double ber, uint32_t seed=1); // chance of each bit flipping, 0 = none
+    double bitErrorRate()
+    {
+        return m_ber;
+    }
+
+    // time (in us) that len bytes sent at time now arrive at the other end
+    uint64_t arrival(uint64_t now, uint32_t len);
+    // flip bits at the bit error rate
+    void corrupt(uint8_t *data, uint32_t len);
+
+private:
+    uint64_t nextError();
+
+    uint32_t m_latency;
+    uint32_t m_bandwidth;
+    double m_ber;
+    uint32_t m_seed;
+    uint64_t m_busyUntil;
+    uint64_t m_nextError; // bits until the next flipped bit
+};
+
+// A Link over a reliable byte stream between two threads or processes, for running Chirp
+// without hardware.  Each send goes out as one or more frames, each stamped with the time it
+// arrives at the other end, so latency and bandwidth are simulated without holding up the
+// sender.  The receiver doesn't see a frame before its arrival time.  Both ends should run in
+// the same process if there's latency or bandwidth (they share the clock).
+//
+// The link buffers what's sent to it (LINK_FLAG_BUFFERED_RECEIVE) and is error corrected,
+// until it's given a bit error rate.  Timeouts of 0 mean don't wait.
+class SimLink : public Link
+{
+public:
+    SimLink();
+    virtual ~SimLink();
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual void setTimer();
+    virtual uint32_t getTimer();
+
+    // these apply to what this end sends
+    void setLatency(uint32_t us);
+    void setBandwidth(uint32_t bytesPerSec);
+    void setBitErrorRate(double ber, uint32_t seed=1);
+
+    static uint64_t usecs(); // the clock both ends share
+
+protected:
+    // Write all len bytes to the stream or nothing, returns len or LINK_RESULT_ERROR_SEND_TIMEOUT
+    // if there isn't room within timeoutMs.
+    virtual int write(const uint8_t *data, uint32_t len, uint32_t timeoutMs) = 0;
+    // Read up to len bytes, waiting up to timeoutMs for the first one.  Returns the number of
+    // bytes read (0 if none) or a negative result code.
+    virtual int read(uint8_t *data, uint32_t len, uint32_t timeoutMs) = 0;
+
+private:
+    int readFrameHeader(uint32_t timeoutMs);
+    int readAll(uint8_t *data, uint32_t len);
+
+    struct FrameHeader
+    {
+        uint32_t len;
+        uint32_t reserved;
+        uint64_t arrival;
+    };
+
+    LinkImpairment m_impairment;
+    uint8_t *m_frame;
+    FrameHeader m_header; // frame being received
+    uint32_t m_frameLeft;
+    QElapsedTimer m_timer;
+};
+
+// Single producer, single consumer byte ring, lock-free.
+class LoopbackRing
+{
+public:
+    LoopbackRing(uint32_t size);
+    ~LoopbackRing();
+
+    uint32_t readable()
+    {
+        return (uint32_t)m_head.loadAcquire() - (uint32_t)m_tail.loadAcquire();
+    }
+    uint32_t writable()
+    {
+        return m_size - readable();
+    }
+    // these copy as much as they can and return how much that was
+    uint32_t write(const uint8_t *data, uint32_t len);
+    uint32_t read(uint8_t *data, uint32_t len);
+
+private:
+    uint8_t *m_mem;
+    uint32_t m_size;
+    QAtomicInt m_head; // written by the producer only, free running
+    QAtomicInt m_tail; // written by the consumer only, free running
+};
+
+// SimLink over a pair of rings in memory, one for each direction.  The first end is constructed
+// by itself and owns the rings, the other end is constructed from it and should be deleted first.
+class LoopbackLink : public SimLink
+{
+public:
+    LoopbackLink(uint32_t ringSize=LOOPBACK_RING_SIZE);
+    LoopbackLink(LoopbackLink &peer);
+    ~LoopbackLink();
+
+protected:
+    virtual int write(const uint8_t *data, uint32_t len, uint32_t timeoutMs);
+    virtual int read(uint8_t *data, uint32_t len, uint32_t timeoutMs);
+
+private:
+    bool m_owner;
+    LoopbackRing *m_in;
+    LoopbackRing *m_out;
+};
+
+#ifndef __WINDOWS__
+// SimLink over a Unix socketpair, so the kernel's socket path is part of what's measured.  The
+// first end creates the pair, the other end is constructed from it and takes the other socket.
+class SocketPairLink : public SimLink
+{
+public:
+    SocketPairLink(uint32_t bufSize=LOOPBACK_RING_SIZE);
+    SocketPairLink(SocketPairLink &peer);
+    ~SocketPairLink();
+
+protected:
+    virtual int write(const uint8_t *data, uint32_t len, uint32_t timeoutMs);
+    virtual int read(uint8_t *data, uint32_t len, uint32_t timeoutMs);
+
+private:
+    int m_fd;
+    int m_peerFd; // until the other end takes it
+};
+#endif
+
+#endif // LOOPBACKLINK_H
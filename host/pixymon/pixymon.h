@@ -16,8 +16,13 @@
 #ifndef PIXYMON_H
 #define PIXYMON_H
 
+#ifdef PIXY_HOST_NO_QT // libpixyhost
+#include <stdio.h>
+#define cprintf printf
+#else
 #include <QDebug>
 
 #define cprintf qDebug
+#endif
 
 #endif // PIXYMON_H
@@ -28,9 +28,21 @@ SOURCES += main.cpp\
     ../../common/blob.cpp \
     ../../common/blobs.cpp \
     processblobs.cpp \
+    batchprocessor.cpp \
+    stripeassembler.cpp \
     ../../common/qqueue.cpp \
+    ../../common/rls.cpp \
     configdialog.cpp \
-    aboutdialog.cpp
+    aboutdialog.cpp \
+    loopbacklink.cpp \
+    bufferedlink.cpp \
+    bufferpool.cpp \
+    usbbackend.cpp \
+    demosaic.cpp \
+    imagepool.cpp \
+    recording.cpp \
+    latency.cpp \
+    renderpipeline.cpp
 
 HEADERS  += mainwindow.h \
     videowidget.h \
@@ -54,12 +66,25 @@ HEADERS  += mainwindow.h \
     ../../common/blob.h \
     ../../common/blobs.h \
     processblobs.h \
+    batchprocessor.h \
+    stripeassembler.h \
     ../../common/qqueue.h \
+    ../../common/rls.h \
     pixymon.h \
     configdialog.h \
     ../../common/link.h \
     sleeper.h \
-    aboutdialog.h
+    aboutdialog.h \
+    loopbacklink.h \
+    bufferedlink.h \
+    bufferpool.h \
+    hostsync.h \
+    usbbackend.h \
+    demosaic.h \
+    imagepool.h \
+    recording.h \
+    latency.h \
+    renderpipeline.h
 
 INCLUDEPATH += ../../common
 
@@ -17,6 +17,9 @@
 #define PROCESSBLOBS_H
 
 #include "blobs.h"
+#include "rls.h"
+
+#define PB_QMEM_SIZE     0x10000
 
 class ProcessBlobs
 {
@@ -25,6 +28,8 @@ public:
     ~ProcessBlobs();
 
     void process(const Frame8 &frame, uint32_t *numBlobs, BlobA **blobs, uint32_t *numQvals, Qval **qMem);
+    // use another lut (read-only) instead of m_blobs->m_lut, NULL reverts to m_blobs->m_lut
+    void setLut(const uint8_t *lut);
 
     Blobs *m_blobs;
 
@@ -33,7 +38,7 @@ private:
 
     uint32_t *m_qMem;
     uint32_t m_numQvals;
-    Qqueue *m_qq;
+    RLS *m_rls;
 };
 
 #endif // PROCESSBLOBS_H
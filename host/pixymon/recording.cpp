@@ -0,0 +1,265 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#ifdef __WINDOWS__
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "chirp.hpp"
+#include "recording.h"
+
+static const uint8_t g_pad[RECORDING_ALIGN] = {0};
+
+#define PADDING(len)    ((RECORDING_ALIGN-((len)&(RECORDING_ALIGN-1)))&(RECORDING_ALIGN-1))
+
+RecordingWriter::RecordingWriter()
+{
+    m_file = NULL;
+    m_offset = 0;
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    close();
+}
+
+int RecordingWriter::open(const char *filename)
+{
+    RecordingHeader header;
+
+    close();
+    if ((m_file=fopen(filename, "wb"))==NULL)
+        return RECORDING_ERROR_FILE;
+    setvbuf(m_file, NULL, _IOFBF, RECORDING_WRITE_BUFFER);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = RECORDING_MAGIC;
+    header.version = RECORDING_VERSION;
+    header.headerSize = sizeof(header);
+    if (fwrite(&header, sizeof(header), 1, m_file)!=1)
+    {
+        close();
+        return RECORDING_ERROR_FILE;
+    }
+    m_offset = sizeof(header);
+    m_index.clear();
+
+    return 0;
+}
+
+int RecordingWriter::write(uint64_t timestamp, uint8_t type, uint32_t fourcc, const uint8_t *data, uint32_t len)
+{
+    RecordHeader record;
+
+    if (m_file==NULL)
+        return RECORDING_ERROR_FILE;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp = timestamp;
+    record.fourcc = fourcc;
+    record.type = type;
+    record.len = len;
+    if (fwrite(&record, sizeof(record), 1, m_file)!=1 || fwrite(data, 1, len, m_file)!=len ||
+            fwrite(g_pad, 1, PADDING(len), m_file)!=PADDING(len))
+        return RECORDING_ERROR_FILE;
+    m_index.push_back(m_offset);
+    m_offset += sizeof(record) + len + PADDING(len);
+
+    return 0;
+}
+
+int RecordingWriter::close()
+{
+    int res = 0;
+    RecordingHeader header;
+
+    if (m_file==NULL)
+        return 0;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = RECORDING_MAGIC;
+    header.version = RECORDING_VERSION;
+    header.headerSize = sizeof(header);
+    header.indexOffset = m_offset;
+    header.numRecords = m_index.size();
+    // index goes on the end, then the header is rewritten to point to it
+    if ((m_index.size() && fwrite(&m_index[0], sizeof(uint64_t), m_index.size(), m_file)!=m_index.size()) ||
+            fseek(m_file, 0, SEEK_SET)!=0 || fwrite(&header, sizeof(header), 1, m_file)!=1)
+        res = RECORDING_ERROR_FILE;
+    if (fclose(m_file)!=0)
+        res = RECORDING_ERROR_FILE;
+    m_file = NULL;
+    m_index.clear();
+
+    return res;
+}
+
+
+RecordingReader::RecordingReader()
+{
+    m_map = NULL;
+    m_size = 0;
+    m_index = NULL;
+    m_numRecords = 0;
+#ifdef __WINDOWS__
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+#endif
+}
+
+RecordingReader::~RecordingReader()
+{
+    close();
+}
+
+int RecordingReader::open(const char *filename)
+{
+    uint64_t offset, end;
+    const RecordingHeader *header;
+    const RecordHeader *record;
+
+    close();
+#ifdef __WINDOWS__
+    LARGE_INTEGER size;
+
+    m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (m_file==INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size))
+    {
+        close();
+        return RECORDING_ERROR_FILE;
+    }
+    if ((uint64_t)size.QuadPart<sizeof(RecordingHeader))
+    {
+        close();
+        return RECORDING_ERROR_FORMAT;
+    }
+    // copy-on-write so that the args can be written to without touching the file
+    if ((m_mapping=CreateFileMappingA(m_file, NULL, PAGE_WRITECOPY, 0, 0, NULL))==NULL ||
+            (m_map=(uint8_t *)MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0))==NULL)
+    {
+        close();
+        return RECORDING_ERROR_FILE;
+    }
+    m_size = size.QuadPart;
+#else
+    int fd;
+    struct stat st;
+    void *map;
+
+    if ((fd=::open(filename, O_RDONLY))<0)
+        return RECORDING_ERROR_FILE;
+    if (fstat(fd, &st)<0)
+    {
+        ::close(fd);
+        return RECORDING_ERROR_FILE;
+    }
+    if ((uint64_t)st.st_size<sizeof(RecordingHeader))
+    {
+        ::close(fd);
+        return RECORDING_ERROR_FORMAT;
+    }
+    // private (copy-on-write) so that the args can be written to without touching the file
+    map = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map==MAP_FAILED)
+        return RECORDING_ERROR_FILE;
+    m_map = (uint8_t *)map;
+    m_size = st.st_size;
+#endif
+
+    header = (const RecordingHeader *)m_map;
+    if (header->magic!=RECORDING_MAGIC || header->version>RECORDING_VERSION || header->headerSize<sizeof(RecordingHeader))
+    {
+        close();
+        return RECORDING_ERROR_FORMAT;
+    }
+
+    // the index has to be all there (the offsets in it are checked by record())
+    if (header->indexOffset && header->indexOffset<=m_size &&
+            header->numRecords<=(m_size-header->indexOffset)/sizeof(uint64_t))
+    {
+        m_index = (const uint64_t *)(m_map+header->indexOffset);
+        m_numRecords = header->numRecords;
+    }
+    else
+    {
+        // wasn't closed, index what made it into the file, leaving off a partly written record (or
+        // if it's the index that's cut off, the records end where it starts).  An index that was
+        // written without the header being rewritten has 0 where a record has its chirp type.
+        end = header->indexOffset && header->indexOffset<=m_size ? header->indexOffset : m_size;
+        for (offset=header->headerSize; offset+sizeof(RecordHeader)<=end; )
+        {
+            record = (const RecordHeader *)(m_map+offset);
+            if (record->type==0 || offset+sizeof(RecordHeader)+record->len>end)
+                break;
+            m_scanned.push_back(offset);
+            offset += sizeof(RecordHeader) + record->len + PADDING(record->len);
+        }
+        m_index = m_scanned.size() ? &m_scanned[0] : NULL;
+        m_numRecords = m_scanned.size();
+    }
+
+    return 0;
+}
+
+void RecordingReader::close()
+{
+#ifdef __WINDOWS__
+    if (m_map)
+        UnmapViewOfFile(m_map);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file!=INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+    m_mapping = NULL;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_map)
+        munmap(m_map, m_size);
+#endif
+    m_map = NULL;
+    m_size = 0;
+    m_index = NULL;
+    m_numRecords = 0;
+    m_scanned.clear();
+}
+
+const RecordHeader *RecordingReader::record(uint32_t index, uint8_t **data)
+{
+    const RecordHeader *header;
+
+    if (index>=m_numRecords || m_index[index]+sizeof(RecordHeader)>m_size)
+        return NULL;
+    header = (const RecordHeader *)(m_map+m_index[index]);
+    if (m_index[index]+sizeof(RecordHeader)+header->len>m_size)
+        return NULL;
+    *data = (uint8_t *)header + sizeof(RecordHeader);
+    return header;
+}
+
+const RecordHeader *RecordingReader::args(uint32_t index, void *args[])
+{
+    uint8_t *data;
+    const RecordHeader *header;
+
+    if ((header=record(index, &data))==NULL || Chirp::deserializeParse(data, header->len, args)<0)
+        return NULL;
+    return header;
+}
@@ -0,0 +1,118 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+#define RECORDING_MAGIC         0x43525850 // "PXRC"
+#define RECORDING_VERSION       1
+#define RECORDING_ALIGN         8
+#define RECORDING_WRITE_BUFFER  0x100000
+
+#define RECORDING_ERROR_FILE     -1 // can't open, create or write the file
+#define RECORDING_ERROR_FORMAT   -2 // not a recording, or a newer version
+#define RECORDING_ERROR_INDEX    -3 // no such record
+
+// A recording of the frame data Pixy sends (BA81, CMV1, CCQ1, CCB1...), stored as it's received,
+// i.e. chirp's serialized args starting with the type hint, so playing it back is
+// Chirp::deserializeParse() and then whatever handles the live data.
+//
+// The file is a RecordingHeader, the records, each a RecordHeader followed by its data padded to
+// RECORDING_ALIGN bytes, and then an index, the file offset of each record.  Records are only
+// ever appended.  The index is written when the recording is closed; a recording that wasn't
+// closed (crash, pulled cable) is indexed by scanning it when it's opened.
+
+struct RecordingHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize; // records start here
+    uint64_t indexOffset; // 0 if the recording wasn't closed
+    uint32_t numRecords;
+    uint32_t reserved[3];
+};
+
+struct RecordHeader
+{
+    uint64_t timestamp; // microseconds since the recording started
+    uint32_t fourcc; // type hint, FOURCC('B','A','8','1'), etc.
+    uint8_t type; // chirp it came in, CRP_XDATA or CRP_RESPONSE
+    uint8_t reserved[3];
+    uint32_t len; // bytes of data that follow
+    uint32_t reserved2;
+};
+
+// Appends records, buffered so it keeps up with the frames coming in.
+class RecordingWriter
+{
+public:
+    RecordingWriter();
+    ~RecordingWriter();
+
+    int open(const char *filename);
+    int write(uint64_t timestamp, uint8_t type, uint32_t fourcc, const uint8_t *data, uint32_t len);
+    int close(); // writes the index
+    bool isOpen()
+    {
+        return m_file!=NULL;
+    }
+    uint32_t records()
+    {
+        return m_index.size();
+    }
+
+private:
+    FILE *m_file;
+    uint64_t m_offset;
+    std::vector<uint64_t> m_index;
+};
+
+// Maps a recording into memory, any record is a lookup in the index away.  The data is mapped
+// copy-on-write, so it can be handed to code that expects a writable buffer.
+class RecordingReader
+{
+public:
+    RecordingReader();
+    ~RecordingReader();
+
+    int open(const char *filename);
+    void close();
+    uint32_t records()
+    {
+        return m_numRecords;
+    }
+    // the header of record index and its data, valid until close()
+    const RecordHeader *record(uint32_t index, uint8_t **data);
+    // parsed args of record index (Chirp::deserializeParse()), returns its header, or NULL if
+    // there's no such record or its args don't fit in it
+    const RecordHeader *args(uint32_t index, void *args[]);
+
+private:
+    uint8_t *m_map;
+    uint64_t m_size;
+    const uint64_t *m_index; // in the file, or m_scanned if it had to be rebuilt
+    uint32_t m_numRecords;
+    std::vector<uint64_t> m_scanned;
+#ifdef __WINDOWS__
+    void *m_file;
+    void *m_mapping;
+#endif
+};
+
+#endif // RECORDING_H
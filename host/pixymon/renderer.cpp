@@ -22,195 +22,124 @@
 #include "calc.h"
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define RENDER_SSE2
+#include <emmintrin.h>
+#endif
+
+// same colors as renderCCQ1(), blended half and half with the frame
+static const uint32_t g_segmentColors[] =
+{0x00000000, // 0 no model
+ 0x40ff0000, // 1 red
+ 0x40ff4000, // 2 orange
+ 0x40ffff00, // 3 yellow
+ 0x4000ff00, // 4 green
+ 0x4000ffff, // 5 cyan
+ 0x400000ff, // 6 blue
+ 0x40ff00ff  // 7 violet
+};
+
+#define BOX_COLOR    0x40ffffff
+
+// each byte the average of a and b, rounded up like _mm_avg_epu8()
+static inline uint32_t average(uint32_t a, uint32_t b)
+{
+    return (a|b) - (((a^b)>>1)&0x7f7f7f7f);
+}
+
+static void blendSpan(uint32_t *line, uint32_t len, uint32_t color)
+{
+    uint32_t i = 0;
+
+#ifdef RENDER_SSE2
+    __m128i c = _mm_set1_epi32(color);
+    for (; i+4<=len; i+=4)
+        _mm_storeu_si128((__m128i *)(line+i), _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(line+i)), c));
+#endif
+    for (; i<len; i++)
+        line[i] = average(line[i], color);
+}
+
+// 1/8 of the way to white, about what renderCCB1()'s 0x20 alpha brush does
+static void lightenSpan(uint32_t *line, uint32_t len)
+{
+    uint32_t i;
+
+    for (i=0; i<len; i++)
+        line[i] += (~line[i]>>3)&0x001f1f1f;
+}
+
+static void fillSpan(uint32_t *line, uint32_t len, uint32_t color)
+{
+    uint32_t i;
+
+    for (i=0; i<len; i++)
+        line[i] = color;
+}
+
 Renderer::Renderer(VideoWidget *video) : m_background(0, 0)
 {
     m_video = video;
 
-    m_rawFrame.m_pixels = new uint8_t[0x10000];
+    m_buffer = NULL;
+    m_rawFrameBuffer = NULL;
+    m_rawFrameCopy = NULL;
+    m_rawFrameCopySize = 0;
 
     m_backgroundFrame = true;
 
     m_mode = 3;
+    m_halfRes = false;
 
     connect(this, SIGNAL(image(QImage)), m_video, SLOT(handleImage(QImage))); // Qt::BlockingQueuedConnection);
     connect(this, SIGNAL(flushImage()), m_video, SLOT(handleFlush())); //, Qt::BlockingQueuedConnection);
+
+    m_pipeline = new RenderPipeline(this);
 }
 
 
 Renderer::~Renderer()
 {
-    delete[] m_rawFrame.m_pixels;
+    delete m_pipeline; // first, its render stage uses us
+    if (m_rawFrameBuffer)
+        m_rawFrameBuffer->release();
+    delete[] m_rawFrameCopy;
 }
 
 
-inline void Renderer::interpolateBayer(unsigned int width, unsigned int x, unsigned int y, unsigned char *pixel, unsigned int &r, unsigned int &g, unsigned int &b)
+// demosaic and images are the calling thread's
+QImage *Renderer::demosaic(Demosaic *demosaic, ImagePool *images, bool halfRes, uint16_t width, uint16_t height, uint8_t *frame)
 {
-#if 1
-    if (y&1)
-    {
-        if (x&1)
-        {
-            r = *pixel;
-            g = (*(pixel-1)+*(pixel+1)+*(pixel+width)+*(pixel-width))>>2;
-            b = (*(pixel-width-1)+*(pixel-width+1)+*(pixel+width-1)+*(pixel+width+1))>>2;
-        }
-        else
-        {
-            r = (*(pixel-1)+*(pixel+1))>>1;
-            g = *pixel;
-            b = (*(pixel-width)+*(pixel+width))>>1;
-        }
-    }
-    else
-    {
-        if (x&1)
-        {
-            r = (*(pixel-width)+*(pixel+width))>>1;
-            g = *pixel;
-            b = (*(pixel-1)+*(pixel+1))>>1;
-        }
-        else
-        {
-            r = (*(pixel-width-1)+*(pixel-width+1)+*(pixel+width-1)+*(pixel+width+1))>>2;
-            g = (*(pixel-1)+*(pixel+1)+*(pixel+width)+*(pixel-width))>>2;
-            b = *pixel;
-        }
-    }
-#endif
-#if 0
-    if (y&1)
-    {
-        if (x&1)
-        {
-            r = *pixel;
-            g = (*(pixel-1)+*(pixel+1))>>1;
-            b = (*(pixel-width-1)+*(pixel-width+1))>>1;
-        }
-        else
-        {
-            r = (*(pixel-1)+*(pixel+1))>>1;
-            g = *pixel;
-            b = *(pixel-width);
-        }
-    }
-    else
-    {
-        if (x&1)
-        {
-            r = *(pixel+width);
-            g = *pixel;
-            b = (*(pixel-1)+*(pixel+1))>>1;
-        }
-        else
-        {
-            r = (*(pixel+width-1)+*(pixel+width+1))>>1;
-            g = (*(pixel-1)+*(pixel+1))>>1;
-            b = *pixel;
-        }
-    }
-#endif
-#if 0
-    if (y&1)
-    {
-        if (x&1)
-        {
-            r = *pixel;
-            g = (*(pixel-1)+*(pixel+1))>>1;
-            b = (*(pixel-width-1)+*(pixel-width+1))>>1;
-        }
-        else
-        {
-            r = (*(pixel-1)+*(pixel+1))>>1;
-            g = *pixel;
-            b = *(pixel-width);
-        }
-    }
-    else
-    {
-        if (x&1)
-        {
-            r = *(pixel-width);
-            g = *pixel;
-            b = (*(pixel-1)+*(pixel+1))>>1;
-        }
-        else
-        {
-            r = (*(pixel-width-1)+*(pixel-width+1))>>1;
-            g = (*(pixel-1)+*(pixel+1))>>1;
-            b = *pixel;
-        }
-    }
-#endif
-#if 0
-    if (y&1)
+    QImage *img;
+
+    if (halfRes)
     {
-        if (x&1)
-        {
-            r = *pixel;
-            g = *(pixel-1);
-            b = *(pixel-width-1);
-        }
-        else
-        {
-            r = *(pixel-1);
-            g = *pixel;
-            b = *(pixel-width);
-        }
+        img = images->take(width/2, height/2, QImage::Format_RGB32);
+        demosaic->halfRes(frame, width, height, (uint32_t *)img->bits(), img->bytesPerLine()/sizeof(uint32_t));
     }
     else
     {
-        if (x&1)
-        {
-            r = *(pixel-width);
-            g = *pixel;
-            b = *(pixel-1);
-        }
-        else
-        {
-            r = *(pixel-width-1);
-            g = *(pixel-1);
-            b = *pixel;
-        }
+        // don't render top and bottom rows, and left and rightmost columns because of color
+        // interpolation
+        img = images->take(width-2, height-2, QImage::Format_RGB32);
+        demosaic->bilinear(frame, width, height, (uint32_t *)img->bits(), img->bytesPerLine()/sizeof(uint32_t));
     }
-#endif
-}
-
 
+    return img;
+}
 
 int Renderer::renderBA81(uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t frameLen, uint8_t *frame)
 {
-    uint16_t x, y;
-    uint32_t *line;
-    uint32_t r, g, b;
+    QImage *img;
 
-    memcpy(m_rawFrame.m_pixels, frame, width*height);
-    m_rawFrame.m_width = width;
-    m_rawFrame.m_height = height;
+    holdRawFrame(width, height, frame);
+    img = demosaic(&m_demosaic, &m_images, m_halfRes, width, height, frame);
 
-    // skip first line
-    frame += width;
-
-    // don't render top and bottom rows, and left and rightmost columns because of color
-    // interpolation
-    QImage img(width-2, height-2, QImage::Format_RGB32);
-
-    for (y=1; y<height-1; y++)
-    {
-        line = (unsigned int *)img.scanLine(y-1);
-        frame++;
-        for (x=1; x<width-1; x++, frame++)
-        {
-            interpolateBayer(width, x, y, frame, r, g, b);
-            // simulate 15 bit color r >>= 4; g >>= 4; b >>= 4; r <<= 4; g <<= 4; b <<= 4;
-            *line++ = (0x40<<24) | (r<<16) | (g<<8) | (b<<0);
-        }
-        frame++;
-    }
     // send image to ourselves across threads
     // from chirp thread to gui thread
-    emitImage(img);
+    emitImage(*img);
 
-    m_background = img;
+    m_background = *img;
 
     if (renderFlags&RENDER_FLAG_FLUSH)
         emitFlushImage();
@@ -222,7 +151,7 @@ int Renderer::renderCCB1(uint8_t renderFlags, uint16_t width, uint16_t height, u
 {
     uint16_t i, left, right, top, bottom;
     float scale = (float)m_video->activeWidth()/width;
-    QImage img(width*scale, height*scale, QImage::Format_ARGB32);
+    QImage *img;
     QPainter p;
     uint16_t model;
     QString str;
@@ -233,13 +162,14 @@ int Renderer::renderCCB1(uint8_t renderFlags, uint16_t width, uint16_t height, u
 
     // render background so we can blend ontop of it
     if (renderFlags&RENDER_FLAG_BLEND_BG)
-        renderBackground();
+        emitBackground();
 
+    img = m_images.take(width*scale, height*scale, QImage::Format_ARGB32);
     if (m_backgroundFrame) // if we're the background, we should be opaque
-        img.fill(0xff000000);
+        img->fill(0xff000000);
     else
-        img.fill(0x00000000); // otherwise, we're transparent
-    p.begin(&img);
+        img->fill(0x00000000); // otherwise, we're transparent
+    p.begin(img);
     p.setBrush(QBrush(QColor(0xff, 0xff, 0xff, 0x20)));
     p.setPen(QPen(QColor(0xff, 0xff, 0xff, 0xff)));
 #ifdef __MACOS__
@@ -318,7 +248,7 @@ int Renderer::renderCCB1(uint8_t renderFlags, uint16_t width, uint16_t height, u
 #endif
     p.end();
 
-    emitImage(img);
+    emitImage(*img);
     if (renderFlags&RENDER_FLAG_FLUSH)
         emitFlushImage();
 
@@ -328,17 +258,18 @@ int Renderer::renderCCB1(uint8_t renderFlags, uint16_t width, uint16_t height, u
 int Renderer::renderRect(uint16_t width, uint16_t height, const RectA &rect)
 {
     float scale = (float)m_video->activeWidth()/width;
-    QImage img(width*scale, height*scale, QImage::Format_ARGB32);
+    QImage *img = m_images.take(width*scale, height*scale, QImage::Format_ARGB32);
     QPainter p;
+    QMutexLocker locker(&m_emitMutex);
 
-    img.fill(0x00000000);
-    p.begin(&img);
+    img->fill(0x00000000);
+    p.begin(img);
     p.setBrush(QBrush(QColor(0xff, 0xff, 0xff, 0x20)));
     p.setPen(QPen(QColor(0xff, 0xff, 0xff, 0xff)));
     p.drawRect(scale*rect.m_xOffset, scale*rect.m_yOffset, scale*rect.m_width, scale*rect.m_height);
     p.end();
 
-    emitImage(img);
+    emitImage(*img);
 
     return 0;
 }
@@ -358,9 +289,10 @@ void Renderer::handleRL(QImage *image, uint color, uint row, uint startCol, uint
 int Renderer::renderCCQ1(uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t numVals, uint32_t *qVals)
 {
     int32_t row;
-    uint32_t i, startCol, length;
-    uint8_t model;
-    QImage img(width, height, QImage::Format_ARGB32);
+    uint32_t i;
+    bool wide;
+    SSegment s;
+    QImage *img = m_images.take(width, height, QImage::Format_ARGB32);
     unsigned int palette[] =
     {0x00000000, // 0 no model (transparent)
      0x80ff0000, // 1 red
@@ -381,59 +313,161 @@ int Renderer::renderCCQ1(uint8_t renderFlags, uint16_t width, uint16_t height, u
 
     qDebug() << numVals;
 
-    // q val:
-    // | 4 bits    | 7 bits      | 9 bits | 9 bits    | 3 bits |
-    // | shift val | shifted sum | length | begin col | model  |
-
-    img.fill(palette[0]);
-    for (i=0, row=-1; i<numVals; i++)
+    img->fill(palette[0]);
+    for (i=0, row=-1, wide=false; i<numVals; i++)
     {
-        if (qVals[i]==0xffffffff)
-            continue;
-        if (qVals[i]==0)
+        // start of frame selects the q val encoding
+        if (QVAL_IS_FRAME_START(qVals[i]))
         {
-            row++;
+            wide = qVals[i]==QVAL_FRAME_START_WIDE;
             continue;
         }
-        model = qVals[i]&0x07;
-        qVals[i] >>= 3;
-        startCol = qVals[i]&0x1ff;
-        qVals[i] >>= 9;
-        length = qVals[i]&0x1ff;
-        handleRL(&img, palette[model], row, startCol, length);
+        if (Blobs::decode(qVals[i], wide, &row, &s))
+            handleRL(img, palette[s.model], row, s.startCol, s.endCol-s.startCol);
     }
-    emitImage(img);
+    emitImage(*img);
     if (renderFlags&RENDER_FLAG_FLUSH)
         emitFlushImage();
 
     return 0;
 }
 
+// the rest happens in m_pipeline, so we're back to receiving right away
 int Renderer::renderCMV1(uint8_t renderFlags, uint32_t cmodelsLen, float *cmodels, uint16_t width, uint16_t height, uint32_t frameLen, uint8_t *frame)
 {
-    int i;
-    uint32_t numBlobs;
-    BlobA *blobs;
-    uint32_t numQvals;
-    uint32_t *qVals;
+    holdRawFrame(width, height, frame);
+    // models only come with the first frame, or after Pixy thinks we've missed some
+    m_pipeline->put(cmodelsLen>=sizeof(ColorModel)*NUM_MODELS/sizeof(float) ? cmodels : NULL,
+                    Frame8(frame, width, height), m_buffer, m_mode, m_halfRes);
+
+    return 0;
+}
 
-    if (cmodelsLen>=sizeof(ColorModel)*NUM_MODELS/sizeof(float)) // create lookup table
+void Renderer::composeCMV1(PipelineFrame *frame)
+{
+    QImage *img, background;
+    uint16_t width = frame->m_frame.m_width, height = frame->m_frame.m_height;
+    bool ccq1 = frame->m_mode&RENDER_MODE_CCQ1 && frame->m_qvals.size();
+    bool ccb1 = frame->m_mode&RENDER_MODE_CCB1 && frame->m_blobs.size();
+
+    // Composite the overlays onto the frame instead of sending separate layers for the video
+    // widget to blend.  The frame by itself becomes m_background, so the overlays go onto a copy
+    // of it.  Both images are pooled, holding background keeps take() from handing it out again.
+    img = demosaic(&m_cmv1Demosaic, &m_cmv1Images, frame->m_halfRes, width, height, frame->m_frame.m_pixels);
+    background = *img;
+    if (ccq1 || ccb1)
     {
-        m_blobs.m_blobs->m_clut->clear();
-        for (i=0; i<NUM_MODELS; i++, cmodels+=sizeof(ColorModel)/sizeof(float))
-            m_blobs.m_blobs->m_clut->add((ColorModel *)cmodels, i+1);
+        img = m_cmv1Images.take(background.width(), background.height(), background.format());
+        memcpy(img->bits(), background.constBits(), background.byteCount());
+        if (ccq1)
+            compositeCCQ1(img, width/2, height/2, frame->m_qvals.size(), &frame->m_qvals[0]);
+        if (ccb1)
+            compositeCCB1(img, width/2, height/2, frame->m_blobs.size(), &frame->m_blobs[0]);
     }
 
-    m_blobs.process(Frame8(frame, width, height), &numBlobs, &blobs, &numQvals, &qVals);
+    m_emitMutex.lock();
+    m_background = background;
+    emitImage(*img);
+    emitFlushImage();
+    m_emitMutex.unlock();
+}
 
-    renderBA81(0, width, height, frameLen, frame);
-    renderCCQ1(0, width/2, height/2, numQvals, qVals);
-    renderCCB1(RENDER_FLAG_FLUSH, width/2, height/2, numBlobs*sizeof(BlobA)/sizeof(uint16_t), (uint16_t *)blobs);
+// width and height are the segments' resolution, which gets scaled to the image's
+void Renderer::compositeCCQ1(QImage *image, uint16_t width, uint16_t height, uint32_t numVals, uint32_t *qVals)
+{
+    int32_t row;
+    uint32_t i, y, y0, y1, x0, x1;
+    uint32_t imageWidth = image->width(), imageHeight = image->height();
+    bool wide;
+    SSegment s;
 
-    return 0;
+    for (i=0, row=-1, wide=false; i<numVals; i++)
+    {
+        // start of frame selects the q val encoding
+        if (QVAL_IS_FRAME_START(qVals[i]))
+        {
+            wide = qVals[i]==QVAL_FRAME_START_WIDE;
+            continue;
+        }
+        if (!Blobs::decode(qVals[i], wide, &row, &s) || s.model==0)
+            continue;
+        if ((uint32_t)row>=height || s.startCol>=width || s.endCol>width || s.startCol>=s.endCol)
+            continue;
+
+        y0 = row*imageHeight/height;
+        y1 = (row+1)*imageHeight/height;
+        x0 = s.startCol*imageWidth/width;
+        x1 = s.endCol*imageWidth/width;
+        for (y=y0; y<y1; y++)
+            blendSpan((uint32_t *)image->scanLine(y)+x0, x1-x0, g_segmentColors[s.model]);
+    }
 }
 
-// need this because we need synchronized knowledge of whether we're the background image or not
+// same boxes and labels as renderCCB1(), drawn straight into the image
+void Renderer::compositeCCB1(QImage *image, uint16_t width, uint16_t height, uint32_t numBlobs, BlobA *blobs)
+{
+    uint32_t i;
+    int y, left, right, top, bottom;
+    int imageWidth = image->width(), imageHeight = image->height();
+    float xScale = (float)imageWidth/width, yScale = (float)imageHeight/height;
+    uint32_t *line;
+    QPainter p;
+    QString str;
+
+    for (i=0; i<numBlobs; i++)
+    {
+        left = xScale*blobs[i].m_left;
+        right = xScale*blobs[i].m_right;
+        top = yScale*blobs[i].m_top;
+        bottom = yScale*blobs[i].m_bottom;
+        if (left>=imageWidth || top>=imageHeight || right<left || bottom<top)
+            continue;
+        if (right>=imageWidth)
+            right = imageWidth-1;
+        if (bottom>=imageHeight)
+            bottom = imageHeight-1;
+
+        fillSpan((uint32_t *)image->scanLine(top)+left, right-left+1, BOX_COLOR);
+        for (y=top+1; y<bottom; y++)
+        {
+            line = (uint32_t *)image->scanLine(y);
+            line[left] = BOX_COLOR;
+            if (right>left+1)
+                lightenSpan(line+left+1, right-left-1);
+            line[right] = BOX_COLOR;
+        }
+        if (bottom>top)
+            fillSpan((uint32_t *)image->scanLine(bottom)+left, right-left+1, BOX_COLOR);
+    }
+
+    // text still needs a painter, but only when there's some
+    for (i=0; i<numBlobs; i++)
+    {
+        if (blobs[i].m_model==0)
+            continue;
+        if (!p.isActive())
+        {
+            p.begin(image);
+#ifdef __MACOS__
+            p.setFont(QFont("verdana", 18));
+#else
+            p.setFont(QFont("verdana", 12));
+#endif
+        }
+        left = xScale*blobs[i].m_left;
+        top = yScale*blobs[i].m_top;
+        str = str.sprintf("s=%d", blobs[i].m_model);
+        p.setPen(QPen(QColor(0, 0, 0, 0xff)));
+        p.drawText(left+1, top+1, str);
+        p.setPen(QPen(QColor(0xff, 0xff, 0xff, 0xff)));
+        p.drawText(left, top, str);
+    }
+    if (p.isActive())
+        p.end();
+}
+
+// need this because we need synchronized knowledge of whether we're the background image or not,
+// these are called with m_emitMutex locked
 void Renderer::emitImage(const QImage &img)
 {
     m_backgroundFrame = false;
@@ -447,10 +481,14 @@ void Renderer::emitFlushImage()
 }
 
 
-int Renderer::render(uint32_t type, void *args[])
+int Renderer::render(uint32_t type, void *args[], PooledBuffer *buffer)
 {
     int res;
 
+    m_buffer = buffer;
+    // CMV1 frames are emitted by m_pipeline, the rest by us
+    if (type!=FOURCC('C', 'M', 'V', '1'))
+        m_emitMutex.lock();
     // choose fourcc for representing formats fourcc.org
     if (type==FOURCC('B','A','8','1'))
         res = renderBA81(*(uint8_t *)args[0], *(uint16_t *)args[1], *(uint16_t *)args[2], *(uint32_t *)args[3], (uint8_t *)args[4]);
@@ -461,15 +499,56 @@ int Renderer::render(uint32_t type, void *args[])
     else if (type==FOURCC('C', 'M', 'V', '1'))
         res = renderCMV1(*(uint8_t *)args[0], *(uint32_t *)args[1], (float *)args[2], *(uint16_t *)args[3], *(uint32_t *)args[4], *(uint32_t *)args[5], (uint8_t *)args[6]);
     else // format not recognized
-        return -1;
+        res = -1;
+    if (type!=FOURCC('C', 'M', 'V', '1'))
+        m_emitMutex.unlock();
+    m_buffer = NULL;
 
     return res;
 }
 
+void Renderer::holdRawFrame(uint16_t width, uint16_t height, uint8_t *frame)
+{
+    uint32_t len = width*height;
+
+    if (m_rawFrameBuffer)
+    {
+        m_rawFrameBuffer->release();
+        m_rawFrameBuffer = NULL;
+    }
+    if (m_buffer) // keep the buffer the frame is in instead of copying it
+    {
+        m_buffer->ref();
+        m_rawFrameBuffer = m_buffer;
+        m_rawFrame.m_pixels = frame;
+    }
+    else
+    {
+        if (len>m_rawFrameCopySize)
+        {
+            delete[] m_rawFrameCopy;
+            m_rawFrameCopy = new uint8_t[len];
+            m_rawFrameCopySize = len;
+        }
+        memcpy(m_rawFrameCopy, frame, len);
+        m_rawFrame.m_pixels = m_rawFrameCopy;
+    }
+    m_rawFrame.m_width = width;
+    m_rawFrame.m_height = height;
+}
+
 int Renderer::renderBackground()
 {
-    if (m_background.width()!=0)
-        emitImage(m_background);
+    QMutexLocker locker(&m_emitMutex);
+
+    emitBackground();
 
     return 0;
 }
+
+// called with m_emitMutex locked
+void Renderer::emitBackground()
+{
+    if (m_background.width()!=0)
+        emitImage(m_background);
+}
@@ -17,14 +17,23 @@
 #define RENDERER_H
 #include <QObject>
 #include <QImage>
+#include <QMutex>
 #include "pixytypes.h"
 #include "processblobs.h"
+#include "bufferpool.h"
+#include "demosaic.h"
+#include "imagepool.h"
+#include "renderpipeline.h"
+
+// rendermode bits, the overlays renderCMV1() composites onto the frame
+#define RENDER_MODE_CCQ1             0x01 // color connected segments
+#define RENDER_MODE_CCB1             0x02 // blob boxes
 
 class Interpreter;
 
 class VideoWidget;
 
-class Renderer : public QObject
+class Renderer : public QObject, public PipelineRenderer
 {
     Q_OBJECT
 
@@ -32,15 +41,27 @@ public:
     Renderer(VideoWidget *video);
     ~Renderer();
 
-    int render(uint32_t type, void *args[]);
+    int render(uint32_t type, void *args[], PooledBuffer *buffer=NULL); // buffer has the args, if pooled
     int renderBackground();
     int renderRect(uint16_t width, uint16_t height, const RectA &rect);
-    void emitFlushImage();
 
     void setMode(uint32_t mode)
     {
         m_mode = mode;
     }
+    void setHalfRes(bool halfRes) // cheaper BA81 preview, one pixel per 2x2 quad
+    {
+        m_halfRes = halfRes;
+    }
+    uint32_t imageAllocations()
+    {
+        return m_images.allocations() + m_cmv1Images.allocations();
+    }
+    uint32_t pipelineDrops()
+    {
+        return m_pipeline->drops();
+    }
+    virtual void composeCMV1(PipelineFrame *frame); // m_pipeline's render stage, on its thread
 
     Frame8 m_rawFrame;
     ProcessBlobs m_blobs;
@@ -51,23 +72,43 @@ signals:
     void flushImage();
 
 private:
-    inline void interpolateBayer(unsigned int width, unsigned int x, unsigned int y, unsigned char *pixel, unsigned int &r, unsigned int &g, unsigned int &b);
-
     int renderCCQ1(uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t numVals, uint32_t *qVals);
     int renderBA81(uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t frameLen, uint8_t *frame);
     int renderCCB1(uint8_t renderFlags, uint16_t width, uint16_t height, uint32_t numBlobs, uint16_t *blobs);
     int renderCMV1(uint8_t renderFlags, uint32_t cmodelsLen, float *cmodels, uint16_t width, uint16_t height, uint32_t frameLen, uint8_t *frame);
     void emitImage(const QImage &image);
+    void emitFlushImage();
+    void emitBackground();
+    QImage *demosaic(Demosaic *demosaic, ImagePool *images, bool halfRes, uint16_t width, uint16_t height, uint8_t *frame);
+    void compositeCCQ1(QImage *image, uint16_t width, uint16_t height, uint32_t numVals, uint32_t *qVals);
+    void compositeCCB1(QImage *image, uint16_t width, uint16_t height, uint32_t numBlobs, BlobA *blobs);
 
     int renderBA81Filter(uint16_t width, uint16_t height, uint32_t frameLen, uint8_t *frame);
 
     void handleRL(QImage *image, uint color, uint row, uint startCol, uint len);
+    void holdRawFrame(uint16_t width, uint16_t height, uint8_t *frame);
 
     VideoWidget *m_video;
+    PooledBuffer *m_buffer; // args being rendered are in here
+    PooledBuffer *m_rawFrameBuffer; // m_rawFrame is in here, or in m_rawFrameCopy
+    uint8_t *m_rawFrameCopy;
+    uint32_t m_rawFrameCopySize;
+    // The interpreter thread and m_pipeline's render thread both emit images.  Each holds
+    // m_emitMutex from its first emitImage() through its emitFlushImage(), so their layers don't
+    // interleave, and while it uses m_backgroundFrame or m_background.
+    QMutex m_emitMutex;
     bool m_backgroundFrame; // our own copy because we're in a different thread (not gui thread)
     QImage m_background;
 
+    // set and read on the interpreter thread, CMV1 frames take a copy to m_pipeline
     uint32_t m_mode;
+    bool m_halfRes;
+    Demosaic m_demosaic;
+    ImagePool m_images;
+    // CMV1 frames are demosaiced on m_pipeline's render thread, with their own
+    Demosaic m_cmv1Demosaic;
+    ImagePool m_cmv1Images;
+    RenderPipeline *m_pipeline;
 };
 
 #endif // RENDERER_H
@@ -0,0 +1,201 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include "renderpipeline.h"
+
+PipelineFrame::PipelineFrame(const Frame8 &frame, PooledBuffer *buffer, uint32_t mode, bool halfRes)
+{
+    uint32_t len = frame.m_width*frame.m_height;
+
+    m_mode = mode;
+    m_halfRes = halfRes;
+    m_buffer = buffer;
+    if (m_buffer) // keep the buffer the frame is in instead of copying it
+    {
+        m_buffer->ref();
+        m_copy = NULL;
+        m_frame = frame;
+    }
+    else
+    {
+        m_copy = new uint8_t[len];
+        memcpy(m_copy, frame.m_pixels, len);
+        m_frame = Frame8(m_copy, frame.m_width, frame.m_height);
+    }
+}
+
+PipelineFrame::~PipelineFrame()
+{
+    if (m_buffer)
+        m_buffer->release();
+    delete [] m_copy;
+}
+
+
+PipelineStage::PipelineStage(RenderPipeline *pipeline, bool render)
+{
+    m_pipeline = pipeline;
+    m_render = render;
+}
+
+void PipelineStage::run()
+{
+    if (m_render)
+        m_pipeline->render();
+    else
+        m_pipeline->process();
+}
+
+
+RenderPipeline::RenderPipeline(PipelineRenderer *renderer) :
+    m_processStage(this, false), m_renderStage(this, true)
+{
+    m_renderer = renderer;
+    m_newModels = false;
+    m_drops = 0;
+    m_done = false;
+
+    m_processStage.start();
+    m_renderStage.start();
+}
+
+RenderPipeline::~RenderPipeline()
+{
+    m_mutex.lock();
+    m_done = true;
+    m_processReady.wakeAll();
+    m_renderReady.wakeAll();
+    m_mutex.unlock();
+
+    m_processStage.wait();
+    m_renderStage.wait();
+
+    while (!m_processQueue.empty())
+    {
+        delete m_processQueue.front();
+        m_processQueue.pop_front();
+    }
+    while (!m_renderQueue.empty())
+    {
+        delete m_renderQueue.front();
+        m_renderQueue.pop_front();
+    }
+}
+
+void RenderPipeline::put(const float *cmodels, const Frame8 &frame, PooledBuffer *buffer, uint32_t mode, bool halfRes)
+{
+    PipelineFrame *pframe = new PipelineFrame(frame, buffer, mode, halfRes);
+
+    m_mutex.lock();
+    // models stay here until a frame is processed, a dropped frame doesn't lose them
+    if (cmodels)
+    {
+        memcpy(m_cmodels, cmodels, sizeof(m_cmodels));
+        m_newModels = true;
+    }
+    enqueue(&m_processQueue, pframe);
+    m_processReady.wakeOne();
+    m_mutex.unlock();
+}
+
+uint32_t RenderPipeline::drops()
+{
+    uint32_t drops;
+
+    m_mutex.lock();
+    drops = m_drops;
+    m_mutex.unlock();
+
+    return drops;
+}
+
+PipelineFrame *RenderPipeline::get(std::deque<PipelineFrame *> *queue, HostWaitCondition *ready)
+{
+    PipelineFrame *frame = NULL;
+
+    m_mutex.lock();
+    while (queue->empty() && !m_done)
+        ready->wait(&m_mutex);
+    if (!m_done)
+    {
+        frame = queue->front();
+        queue->pop_front();
+    }
+    m_mutex.unlock();
+
+    return frame;
+}
+
+// called with m_mutex locked
+void RenderPipeline::enqueue(std::deque<PipelineFrame *> *queue, PipelineFrame *frame)
+{
+    if (queue->size()>=RP_QUEUE_DEPTH)
+    {
+        delete queue->front();
+        queue->pop_front();
+        m_drops++;
+    }
+    queue->push_back(frame);
+}
+
+void RenderPipeline::process()
+{
+    int i;
+    bool newModels;
+    float cmodels[sizeof(m_cmodels)/sizeof(float)];
+    uint32_t numBlobs, numQvals;
+    BlobA *blobs;
+    Qval *qvals;
+    PipelineFrame *frame;
+
+    while((frame=get(&m_processQueue, &m_processReady)))
+    {
+        // build the lut from a copy, put() shouldn't have to wait for it
+        m_mutex.lock();
+        newModels = m_newModels;
+        if (newModels)
+            memcpy(cmodels, m_cmodels, sizeof(cmodels));
+        m_newModels = false;
+        m_mutex.unlock();
+        if (newModels)
+        {
+            m_blobs.m_blobs->m_clut->clear();
+            for (i=0; i<NUM_MODELS; i++)
+                m_blobs.m_blobs->m_clut->add((ColorModel *)cmodels+i, i+1);
+        }
+
+        m_blobs.process(frame->m_frame, &numBlobs, &blobs, &numQvals, &qvals);
+        // blobs and q vals belong to m_blobs, and we process the next frame while this one's rendered
+        frame->m_blobs.assign(blobs, blobs+numBlobs);
+        frame->m_qvals.assign(qvals, qvals+numQvals);
+
+        m_mutex.lock();
+        enqueue(&m_renderQueue, frame);
+        m_renderReady.wakeOne();
+        m_mutex.unlock();
+    }
+}
+
+void RenderPipeline::render()
+{
+    PipelineFrame *frame;
+
+    while((frame=get(&m_renderQueue, &m_renderReady)))
+    {
+        m_renderer->composeCMV1(frame);
+        delete frame;
+    }
+}
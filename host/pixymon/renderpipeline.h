@@ -0,0 +1,112 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef RENDERPIPELINE_H
+#define RENDERPIPELINE_H
+
+#include <deque>
+#include <vector>
+#include "hostsync.h"
+#include "processblobs.h"
+#include "bufferpool.h"
+
+// frames waiting for each stage, when a stage falls behind its oldest waiting frame is dropped
+#define RP_QUEUE_DEPTH     2
+
+class RenderPipeline;
+
+struct PipelineFrame
+{
+    PipelineFrame(const Frame8 &frame, PooledBuffer *buffer, uint32_t mode, bool halfRes);
+    ~PipelineFrame();
+
+    Frame8 m_frame;
+    PooledBuffer *m_buffer; // m_frame's pixels are in here, or in m_copy
+    uint8_t *m_copy;
+    // the renderer's settings when the frame came in, they're changed on another thread
+    uint32_t m_mode;
+    bool m_halfRes;
+    std::vector<BlobA> m_blobs;
+    std::vector<Qval> m_qvals;
+};
+
+// what the render stage hands frames to, Renderer in PixyMon
+class PipelineRenderer
+{
+public:
+    virtual ~PipelineRenderer() {}
+    // called on the render stage's thread, frame is deleted when this returns
+    virtual void composeCMV1(PipelineFrame *frame) = 0;
+};
+
+class PipelineStage : public HostThread
+{
+public:
+    PipelineStage(RenderPipeline *pipeline, bool render);
+
+protected:
+    virtual void run();
+
+private:
+    RenderPipeline *m_pipeline;
+    bool m_render;
+};
+
+// Takes CMV1 frames (Bayer frames with the color models Pixy is using) off the thread that
+// receives them, so it never waits on processing or the GUI.  The process stage rebuilds the
+// lut when the models change and finds the frame's segments and blobs, the render stage
+// demosaics, composites and emits the image (PipelineRenderer::composeCMV1()), each on its own
+// thread.
+// Each stage has a queue of RP_QUEUE_DEPTH frames.  When the camera is faster than a stage,
+// the stage's oldest waiting frame is dropped, so what's shown is as recent as it can be.
+class RenderPipeline
+{
+public:
+    RenderPipeline(PipelineRenderer *renderer);
+    ~RenderPipeline();
+
+    // Queue frame for processing, never waits.  frame's pixels are in buffer, which is
+    // referenced until the frame is rendered, or they're copied if buffer is NULL.  cmodels are
+    // NUM_MODELS ColorModels, NULL if they haven't changed.  mode and halfRes are what the frame
+    // is rendered with.
+    void put(const float *cmodels, const Frame8 &frame, PooledBuffer *buffer, uint32_t mode, bool halfRes);
+
+    uint32_t drops(); // frames dropped by either stage so far
+
+    friend class PipelineStage;
+
+private:
+    PipelineFrame *get(std::deque<PipelineFrame *> *queue, HostWaitCondition *ready);
+    void enqueue(std::deque<PipelineFrame *> *queue, PipelineFrame *frame);
+    void process();
+    void render();
+
+    PipelineRenderer *m_renderer;
+    ProcessBlobs m_blobs;
+    PipelineStage m_processStage;
+    PipelineStage m_renderStage;
+
+    HostMutex m_mutex;
+    HostWaitCondition m_processReady; // a frame is waiting to be processed, or we're done
+    HostWaitCondition m_renderReady;  // a frame is waiting to be rendered, or we're done
+    std::deque<PipelineFrame *> m_processQueue;
+    std::deque<PipelineFrame *> m_renderQueue;
+    float m_cmodels[sizeof(ColorModel)*NUM_MODELS/sizeof(float)];
+    bool m_newModels; // m_cmodels haven't made it into the lut yet
+    uint32_t m_drops;
+    bool m_done;
+};
+
+#endif // RENDERPIPELINE_H
@@ -25,6 +25,10 @@ public:
     {
         QThread::msleep(msecs);
     }
+    static void usleep(unsigned long usecs)
+    {
+        QThread::usleep(usecs);
+    }
 };
 
 #endif // SLEEPER_H
@@ -0,0 +1,310 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <QThread>
+#include "stripeassembler.h"
+
+StripeJob::StripeJob(StripeAssembler *assembler, uint32_t stripe)
+{
+    m_assembler = assembler;
+    m_stripe = stripe;
+    setAutoDelete(false);
+}
+
+void StripeJob::run()
+{
+    m_assembler->assembleStripe(m_stripe);
+}
+
+
+StripeAssembler::StripeAssembler(uint32_t numStripes)
+{
+    uint32_t i;
+
+    if (numStripes==0)
+        numStripes = QThread::idealThreadCount()>0 ? QThread::idealThreadCount() : 1;
+    m_numStripes = numStripes;
+    m_stripes = 1;
+    m_pool.setMaxThreadCount(numStripes);
+
+    m_assemblers = new CBlobAssembler[numStripes][NUM_MODELS];
+    m_labels = new SBlobLabels[numStripes][NUM_MODELS];
+    m_firstLabel = new int[numStripes][NUM_MODELS];
+    m_begin = new uint32_t[numStripes];
+    m_end = new uint32_t[numStripes];
+    m_rows = new short[numStripes];
+    m_used = new bool[numStripes];
+    m_stripeSegments = NULL;
+
+    for (i=0; i<numStripes; i++)
+        m_jobs.push_back(new StripeJob(this, i));
+}
+
+StripeAssembler::~StripeAssembler()
+{
+    uint32_t i;
+
+    for (i=0; i<m_jobs.size(); i++)
+        delete m_jobs[i];
+    delete [] m_assemblers;
+    delete [] m_labels;
+    delete [] m_firstLabel;
+    delete [] m_begin;
+    delete [] m_end;
+    delete [] m_rows;
+    delete [] m_used;
+}
+
+void StripeAssembler::blobify(Blobs *blobs, const Qval *qvals, uint32_t numQvals)
+{
+    uint32_t i;
+    int32_t row;
+    bool wide;
+    SSegment s;
+
+    m_segments.clear();
+    for (i=0, row=-1, wide=false; i<numQvals; i++)
+    {
+        // same as Blobs::unpack()
+        if (QVAL_IS_FRAME_START(qvals[i]))
+        {
+            if (i>0)
+                break;
+            wide = qvals[i]==QVAL_FRAME_START_WIDE;
+            continue;
+        }
+        if (Blobs::decode(qvals[i], wide, &row, &s))
+            m_segments.push_back(s);
+    }
+    if (m_segments.size())
+        assemble(&m_segments[0], m_segments.size(), blobs->getAssemblers());
+    blobs->blobifyAssembled();
+}
+
+void StripeAssembler::assemble(const SSegment *segments, uint32_t numSegments, CBlobAssembler *assemblers)
+{
+    uint32_t i, j, k, m, rows;
+    int label;
+
+    if (numSegments==0)
+        return;
+
+    // split the rows evenly
+    rows = segments[numSegments-1].row + 1;
+    m_stripes = rows<m_numStripes ? rows : m_numStripes;
+    m_stripeSegments = segments;
+    for (k=0, i=0; k<m_stripes; k++)
+    {
+        m_rows[k] = k*rows/m_stripes;
+        for (; i<numSegments && segments[i].row<m_rows[k]; i++);
+        m_begin[k] = i;
+        if (k>0)
+            m_end[k-1] = i;
+    }
+    m_end[m_stripes-1] = numSegments;
+
+    // labels for the first row of each stripe (the first stripe doesn't need any)
+    for (k=0, label=0; k<m_stripes; k++)
+    {
+        for (m=0; m<NUM_MODELS; m++)
+        {
+            m_assemblers[k][m].labels = &m_labels[k][m];
+            m_labels[k][m].labelRow = k==0 ? -1 : m_rows[k];
+            m_labels[k][m].nextLabel = label;
+            m_labels[k][m].links.clear();
+            m_firstLabel[k][m] = label;
+            if (k==0)
+                continue;
+            for (j=m_begin[k]; j<m_end[k] && segments[j].row==m_rows[k]; j++)
+            {
+                if (segments[j].model==m+1)
+                    label++;
+            }
+        }
+    }
+    m_parent.resize(label);
+    for (i=0; i<(uint32_t)label; i++)
+        m_parent[i] = i;
+
+    // assemble stripes in parallel
+    if (m_stripes==1)
+        assembleStripe(0);
+    else
+    {
+        for (k=0; k<m_stripes; k++)
+            m_pool.start(m_jobs[k]);
+        m_pool.waitForDone();
+    }
+
+    // join stripes, one model at a time
+    for (m=0; m<NUM_MODELS; m++)
+        join(m, &assemblers[m]);
+}
+
+void StripeAssembler::assembleStripe(uint32_t stripe)
+{
+    uint32_t i;
+
+    for (i=m_begin[stripe]; i<m_end[stripe]; i++)
+    {
+        const SSegment &s = m_stripeSegments[i];
+        if (m_assemblers[stripe][s.model-1].Add(s)<0)
+            break; // out of memory, same as Blobs
+    }
+}
+
+void StripeAssembler::join(uint32_t model, CBlobAssembler *result)
+{
+    uint32_t i, k;
+    CBlobAssembler *upper;
+    CBlob *blob, *next, *acc;
+    int root;
+
+    upper = &m_assemblers[0][model];
+    m_used[0] = true;
+    for (k=1; k<m_stripes; k++)
+    {
+        if (joinable(upper, k, model))
+        {
+            m_used[k] = true;
+            upper = &m_assemblers[k][model];
+        }
+        else
+        {
+            // start over with this stripe, continuing from the stripe above
+            m_used[k] = false;
+            m_assemblers[k][model].EndFrame();
+            m_assemblers[k][model].Reset();
+            for (i=m_begin[k]; i<m_end[k]; i++)
+            {
+                if (m_stripeSegments[i].model==model+1 && upper->Add(m_stripeSegments[i])<0)
+                    break;
+            }
+        }
+    }
+
+    // labels that were merged within the stripes
+    for (k=0; k<m_stripes; k++)
+    {
+        if (m_used[k])
+        {
+            for (i=0; i<m_labels[k][model].links.size(); i++)
+                merge(m_labels[k][model].links[i].first, m_labels[k][model].links[i].second);
+        }
+    }
+
+    // combine blobs with the same label, move everything to result
+    m_labelBlobs.assign(m_parent.size(), NULL);
+    for (k=0; k<m_stripes; k++)
+    {
+        if (!m_used[k])
+            continue;
+        m_assemblers[k][model].EndFrame();
+        for (blob=m_assemblers[k][model].finishedBlobs; blob; blob=next)
+        {
+            next = blob->next;
+            if (blob->label>=0)
+            {
+                root = find(blob->label);
+                acc = m_labelBlobs[root];
+                if (acc)
+                {
+                    acc->moments.Add(blob->moments);
+                    acc->UpdateBoundingBox(blob->left, blob->top, blob->right);
+                    if (blob->lastBottom.row>acc->lastBottom.row)
+                        acc->lastBottom.row = blob->lastBottom.row;
+                    delete blob;
+                    continue;
+                }
+                m_labelBlobs[root] = blob;
+            }
+            blob->next = result->finishedBlobs;
+            result->finishedBlobs = blob;
+        }
+        m_assemblers[k][model].finishedBlobs = NULL;
+        m_assemblers[k][model].Reset();
+    }
+}
+
+bool StripeAssembler::joinable(CBlobAssembler *upper, uint32_t stripe, uint32_t model)
+{
+    uint32_t i, j, jj, n, match;
+    int label;
+    short row = m_rows[stripe];
+    CBlob *blob;
+
+    // spans on the row above the seam (the lastBottom of the next row), left to right
+    m_spans.clear();
+    for (blob=upper->GetActiveBlobs(); blob; blob=blob->next)
+    {
+        if (blob->nextBottom.row!=row-1)
+            continue;
+        if (m_spans.size() && m_spans.back()->nextBottom.endCol>=blob->nextBottom.startCol)
+            return false; // spans overlap
+        m_spans.push_back(blob);
+    }
+
+    // segments on the first row of the stripe (all of them started a blob), left to right
+    m_matches.clear();
+    m_spanUsed.assign(m_spans.size(), false);
+    label = m_firstLabel[stripe][model];
+    for (i=m_begin[stripe], j=0; i<m_end[stripe] && m_stripeSegments[i].row==row; i++)
+    {
+        const SSegment &s = m_stripeSegments[i];
+        if (s.model!=model+1)
+            continue;
+        for (; j<m_spans.size() && m_spans[j]->nextBottom.endCol<s.startCol; j++);
+        for (jj=j, n=0, match=0; jj<m_spans.size() && m_spans[jj]->nextBottom.startCol<=s.endCol; jj++, n++)
+            match = jj;
+        if (n>1 || (n==1 && m_spanUsed[match]))
+            return false; // not one-to-one
+        if (n==1)
+        {
+            m_spanUsed[match] = true;
+            m_matches.push_back(std::make_pair(match, label));
+        }
+        label++;
+    }
+
+    for (i=0; i<m_matches.size(); i++)
+    {
+        blob = m_spans[m_matches[i].first];
+        if (blob->label<0)
+        {
+            blob->label = m_parent.size();
+            m_parent.push_back(blob->label);
+        }
+        merge(blob->label, m_matches[i].second);
+    }
+    return true;
+}
+
+int StripeAssembler::find(int label)
+{
+    while (m_parent[label]!=label)
+    {
+        m_parent[label] = m_parent[m_parent[label]];
+        label = m_parent[label];
+    }
+    return label;
+}
+
+void StripeAssembler::merge(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a!=b)
+        m_parent[b] = a;
+}
@@ -0,0 +1,94 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef STRIPEASSEMBLER_H
+#define STRIPEASSEMBLER_H
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <vector>
+#include "blobs.h"
+
+class StripeAssembler;
+
+class StripeJob : public QRunnable
+{
+public:
+    StripeJob(StripeAssembler *assembler, uint32_t stripe);
+    virtual void run();
+
+private:
+    StripeAssembler *m_assembler;
+    uint32_t m_stripe;
+};
+
+// Assembles blobs in horizontal stripes, one thread per stripe, for large frames.
+// Each stripe is assembled with its own CBlobAssembler per model.  Blobs started on the first
+// row of a stripe are labeled, and the labels are joined across the seams with a union-find.
+//
+// The serial assembler attaches segments to the span of a blob's bottom row (lastBottom), not
+// to its segments, so the stripes are only joined when the result is certain to be the same:
+// the spans on the last row above the seam and the segments on the first row below it must
+// overlap one-to-one.  Otherwise the stripe below is assembled again, continuing from the
+// stripe above, which is exactly what the serial assembler does.  Either way the blobs are
+// the same as Blobs::blobify() produces.
+class StripeAssembler
+{
+public:
+    StripeAssembler(uint32_t numStripes=0); // 0 = one stripe per core
+    ~StripeAssembler();
+
+    // same as blobs->blobify(qvals, numQvals)
+    void blobify(Blobs *blobs, const Qval *qvals, uint32_t numQvals);
+
+    // Assemble the segments (in row order) into assemblers (one per model).  The assemblers
+    // end up with finishedBlobs only, as if Add() were called for each segment, then EndFrame().
+    void assemble(const SSegment *segments, uint32_t numSegments, CBlobAssembler *assemblers);
+
+    friend class StripeJob;
+
+private:
+    void assembleStripe(uint32_t stripe);
+    void join(uint32_t model, CBlobAssembler *result);
+    bool joinable(CBlobAssembler *upper, uint32_t stripe, uint32_t model);
+    int find(int label);
+    void merge(int a, int b);
+
+    uint32_t m_numStripes;
+    uint32_t m_stripes; // stripes in this frame
+    QThreadPool m_pool;
+    std::vector<StripeJob *> m_jobs;
+
+    // per stripe: assemblers, labels, segment range and first row
+    CBlobAssembler (*m_assemblers)[NUM_MODELS];
+    SBlobLabels (*m_labels)[NUM_MODELS];
+    int (*m_firstLabel)[NUM_MODELS];
+    uint32_t *m_begin;
+    uint32_t *m_end;
+    short *m_rows;
+    bool *m_used;
+
+    std::vector<SSegment> m_segments;
+    const SSegment *m_stripeSegments;
+    std::vector<int> m_parent; // union-find over labels
+    std::vector<CBlob *> m_labelBlobs;
+
+    // for joinable()
+    std::vector<CBlob *> m_spans;
+    std::vector<bool> m_spanUsed;
+    std::vector<std::pair<uint32_t, int> > m_matches;
+};
+
+#endif // STRIPEASSEMBLER_H
@@ -0,0 +1,320 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include "usbbackend.h"
+
+// runs the backend's events until the transfers have all come back after stop()
+class USBEventThread : public HostThread
+{
+public:
+    USBEventThread(AsyncUSBLink *link)
+    {
+        m_link = link;
+    }
+
+protected:
+    virtual void run()
+    {
+        bool done;
+
+        while(1)
+        {
+            m_link->m_mutex.lock();
+            done = m_link->m_stopping && m_link->m_outstanding==0;
+            m_link->m_mutex.unlock();
+            if (done)
+                break;
+            m_link->m_backend->handleEvents(USB_EVENT_TIMEOUT);
+        }
+    }
+
+private:
+    AsyncUSBLink *m_link;
+};
+
+
+AsyncUSBLink::AsyncUSBLink()
+{
+    m_backend = NULL;
+    m_thread = NULL;
+    m_outstanding = 0;
+    m_stopping = false;
+    m_error = 0;
+    m_ring = new uint8_t[USB_RING_SIZE];
+    m_head = 0;
+    m_tail = 0;
+    memset(m_transfers, 0, sizeof(m_transfers));
+    m_blockSize = 64;
+    m_flags = LINK_FLAG_ERROR_CORRECTED | LINK_FLAG_BUFFERED_RECEIVE;
+}
+
+AsyncUSBLink::~AsyncUSBLink()
+{
+    stop();
+    delete [] m_ring;
+}
+
+int AsyncUSBLink::start(USBBackend *backend, uint32_t packetSize)
+{
+    int i;
+
+    stop();
+    m_backend = backend;
+    m_stopping = false;
+    m_error = 0;
+    m_head = m_tail = 0;
+    m_thread = new USBEventThread(this);
+    m_thread->start();
+
+    m_mutex.lock();
+    for (i=0; i<USB_IN_TRANSFERS; i++)
+    {
+        m_transfers[i].link = this;
+        m_transfers[i].buf = new uint8_t[USB_IN_TRANSFER_SIZE];
+        m_transfers[i].len = packetSize<USB_IN_TRANSFER_SIZE ? packetSize : USB_IN_TRANSFER_SIZE;
+        m_transfers[i].handle = NULL;
+        resubmit(&m_transfers[i]);
+    }
+    m_mutex.unlock();
+
+    if (m_error)
+    {
+        i = m_error;
+        stop();
+        return i;
+    }
+    return 0;
+}
+
+void AsyncUSBLink::stop()
+{
+    int i;
+
+    if (m_backend==NULL)
+        return;
+
+    m_mutex.lock();
+    m_stopping = true;
+    m_held.clear();
+    m_mutex.unlock();
+    for (i=0; i<USB_IN_TRANSFERS; i++)
+        m_backend->cancel(&m_transfers[i]);
+    m_arrived.wakeAll();
+
+    m_thread->wait();
+    delete m_thread;
+    m_thread = NULL;
+    delete m_backend;
+    m_backend = NULL;
+    for (i=0; i<USB_IN_TRANSFERS; i++)
+    {
+        delete [] m_transfers[i].buf;
+        m_transfers[i].buf = NULL;
+    }
+}
+
+int AsyncUSBLink::send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    if (m_backend==NULL)
+        return LINK_RESULT_ERROR;
+
+    if (timeoutMs==0) // 0 equals infinity
+        timeoutMs = 10;
+
+    return m_backend->write(data, len, timeoutMs);
+}
+
+int AsyncUSBLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    uint32_t n, i, recvd;
+
+    if (timeoutMs==0) // 0 equals infinity
+        timeoutMs = 50;
+
+    m_mutex.lock();
+    for (recvd=0; true; )
+    {
+        // take what's arrived, the ring can wrap once
+        n = m_head-m_tail;
+        if (n>len-recvd)
+            n = len-recvd;
+        i = m_tail&(USB_RING_SIZE-1);
+        if (i+n>USB_RING_SIZE)
+        {
+            memcpy(data+recvd, m_ring+i, USB_RING_SIZE-i);
+            memcpy(data+recvd+USB_RING_SIZE-i, m_ring, n-(USB_RING_SIZE-i));
+        }
+        else
+            memcpy(data+recvd, m_ring+i, n);
+        m_tail += n;
+        recvd += n;
+
+        // there's room now for reads that were held up
+        while (m_held.size() && put(m_held.front()))
+        {
+            resubmit(m_held.front());
+            m_held.pop_front();
+        }
+
+        if (recvd==len || m_error)
+            break;
+        // the timeout is for the link being idle, so it starts over when something comes in
+        if (m_head==m_tail && !m_arrived.wait(&m_mutex, timeoutMs))
+            break;
+    }
+    n = m_error;
+    m_mutex.unlock();
+
+    if (recvd)
+        return recvd;
+    if (n)
+        return n;
+    return LINK_RESULT_ERROR_RECV_TIMEOUT;
+}
+
+void AsyncUSBLink::setTimer()
+{
+    m_time.start();
+}
+
+uint32_t AsyncUSBLink::getTimer()
+{
+    return m_time.elapsed();
+}
+
+void AsyncUSBLink::complete(USBTransfer *transfer)
+{
+    m_mutex.lock();
+    m_outstanding--;
+    if (!m_stopping)
+    {
+        // a failed read isn't resubmitted, it's probably the device going away
+        if (transfer->actual<0)
+            m_error = transfer->actual;
+        // The reads queued behind a failed one are dropped too-- what the failed read had is
+        // missing from the stream, so nothing after it can be received.
+        else if (m_error)
+            ;
+        // reads complete in order, so once one is held the rest are too
+        else if (m_held.empty() && put(transfer))
+            resubmit(transfer);
+        else
+            m_held.push_back(transfer);
+        m_arrived.wakeAll();
+    }
+    m_mutex.unlock();
+}
+
+// copy transfer's data to the ring if there's room (m_mutex is locked)
+bool AsyncUSBLink::put(USBTransfer *transfer)
+{
+    uint32_t i, n = transfer->actual;
+
+    if (n>USB_RING_SIZE-(m_head-m_tail))
+        return false;
+    i = m_head&(USB_RING_SIZE-1);
+    if (i+n>USB_RING_SIZE)
+    {
+        memcpy(m_ring+i, transfer->buf, USB_RING_SIZE-i);
+        memcpy(m_ring, transfer->buf+USB_RING_SIZE-i, n-(USB_RING_SIZE-i));
+    }
+    else
+        memcpy(m_ring+i, transfer->buf, n);
+    m_head += n;
+
+    return true;
+}
+
+// m_mutex is locked
+void AsyncUSBLink::resubmit(USBTransfer *transfer)
+{
+    int res;
+
+    m_outstanding++;
+    if ((res=m_backend->submit(transfer))<0)
+    {
+        m_outstanding--;
+        m_error = res;
+    }
+}
+
+
+LinkUSBBackend::LinkUSBBackend(Link *link)
+{
+    m_link = link;
+}
+
+int LinkUSBBackend::write(const uint8_t *data, uint32_t len, uint32_t timeoutMs)
+{
+    return m_link->send(data, len, timeoutMs);
+}
+
+int LinkUSBBackend::submit(USBTransfer *transfer)
+{
+    m_mutex.lock();
+    transfer->handle = NULL; // not cancelled
+    m_submitted.push_back(transfer);
+    m_mutex.unlock();
+    m_submittedCond.wakeAll();
+
+    return 0;
+}
+
+void LinkUSBBackend::cancel(USBTransfer *transfer)
+{
+    m_mutex.lock();
+    transfer->handle = transfer;
+    m_mutex.unlock();
+    m_submittedCond.wakeAll();
+}
+
+void LinkUSBBackend::handleEvents(uint32_t timeoutMs)
+{
+    int res, n;
+    bool cancelled;
+    USBTransfer *transfer;
+
+    m_mutex.lock();
+    if (m_submitted.empty())
+        m_submittedCond.wait(&m_mutex, timeoutMs);
+    if (m_submitted.empty())
+    {
+        m_mutex.unlock();
+        return;
+    }
+    // reads complete in order, so only the oldest one can be filled
+    transfer = m_submitted.front();
+    cancelled = transfer->handle!=NULL;
+    m_mutex.unlock();
+
+    if (cancelled)
+        res = LINK_RESULT_ERROR;
+    else
+    {
+        // like a short packet, the read ends with what's there once something has come in
+        res = m_link->receive(transfer->buf, 1, timeoutMs);
+        if (res==0 || res==LINK_RESULT_ERROR_RECV_TIMEOUT)
+            return;
+        if (res==1 && (n=m_link->receive(transfer->buf+1, transfer->len-1, 0))>0)
+            res += n;
+    }
+
+    m_mutex.lock();
+    m_submitted.pop_front();
+    m_mutex.unlock();
+    transfer->actual = res;
+    transfer->link->complete(transfer);
+}
@@ -0,0 +1,121 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef USBBACKEND_H
+#define USBBACKEND_H
+
+#include <deque>
+#include "hostsync.h"
+#include <link.h>
+
+#define USB_IN_TRANSFERS        32       // reads queued at once
+#define USB_IN_TRANSFER_SIZE    512      // largest read, one high speed bulk packet
+#define USB_RING_SIZE           0x100000 // received data not yet taken by receive(), must be a power of 2
+#define USB_EVENT_TIMEOUT       100      // ms, how often the event thread checks whether it should stop
+
+class AsyncUSBLink;
+class USBEventThread;
+
+// a read from the IN endpoint
+struct USBTransfer
+{
+    AsyncUSBLink *link;
+    uint8_t *buf;
+    uint32_t len;
+    int actual; // bytes read, or a negative error code, when complete
+    void *handle; // the backend's
+};
+
+// How AsyncUSBLink gets its bulk transfers done, libusb or something that stands in for it.
+class USBBackend
+{
+public:
+    virtual ~USBBackend() {}
+
+    // write to the OUT endpoint, returns the number of bytes written or a negative error code
+    virtual int write(const uint8_t *data, uint32_t len, uint32_t timeoutMs) = 0;
+    // Start a read from the IN endpoint, transfer->link->complete(transfer) is called from
+    // handleEvents() when it's done.  Can be called from any thread.
+    virtual int submit(USBTransfer *transfer) = 0;
+    // complete() is still called, with an error
+    virtual void cancel(USBTransfer *transfer) = 0;
+    // complete the transfers that are done, waiting up to timeoutMs for one
+    virtual void handleEvents(uint32_t timeoutMs) = 0;
+};
+
+// A Link that keeps several reads queued, so the device never waits for us to ask for data.  An
+// event thread copies what comes in to a ring, and receive() takes it from there.  If the ring
+// fills up, reads are held until receive() makes room.
+class AsyncUSBLink : public Link
+{
+public:
+    AsyncUSBLink();
+    virtual ~AsyncUSBLink();
+
+    // Takes backend and starts reading.  Each read is one packet (packetSize bytes, up to
+    // USB_IN_TRANSFER_SIZE), so it never waits for the next send to fill it.
+    int start(USBBackend *backend, uint32_t packetSize=USB_IN_TRANSFER_SIZE);
+    void stop();
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual void setTimer();
+    virtual uint32_t getTimer();
+
+    // called by the backend
+    void complete(USBTransfer *transfer);
+
+private:
+    friend class USBEventThread;
+    bool put(USBTransfer *transfer);
+    void resubmit(USBTransfer *transfer);
+
+    USBBackend *m_backend;
+    USBEventThread *m_thread;
+    USBTransfer m_transfers[USB_IN_TRANSFERS];
+    std::deque<USBTransfer *> m_held; // complete, waiting for room in the ring
+    uint32_t m_outstanding;
+    bool m_stopping;
+    int m_error; // from the last read that failed, returned once the ring is empty
+
+    uint8_t *m_ring;
+    uint32_t m_head; // free running
+    uint32_t m_tail;
+    HostMutex m_mutex;
+    HostWaitCondition m_arrived;
+    HostElapsedTimer m_time;
+};
+
+// Stands in for libusb, the device end is another Link (LoopbackLink, for example).  Each read
+// gets what the other end has sent, up to the transfer's length.  link should return what it
+// has without waiting when the timeout is 0, like SimLink does.
+class LinkUSBBackend : public USBBackend
+{
+public:
+    LinkUSBBackend(Link *link);
+
+    virtual int write(const uint8_t *data, uint32_t len, uint32_t timeoutMs);
+    virtual int submit(USBTransfer *transfer);
+    virtual void cancel(USBTransfer *transfer);
+    virtual void handleEvents(uint32_t timeoutMs);
+
+private:
+    Link *m_link;
+    std::deque<USBTransfer *> m_submitted;
+    HostMutex m_mutex;
+    HostWaitCondition m_submittedCond;
+};
+
+#endif // USBBACKEND_H
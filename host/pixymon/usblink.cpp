@@ -13,23 +13,114 @@
 // end license header
 //
 
-#include <QDebug>
 #include "usblink.h"
-#include "sleeper.h"
 #include "pixy.h"
 
 
 
+LibusbBackend::LibusbBackend(libusb_context *context, libusb_device_handle *handle)
+{
+    m_context = context;
+    m_handle = handle;
+}
+
+LibusbBackend::~LibusbBackend()
+{
+    uint32_t i;
+
+    for (i=0; i<m_xfers.size(); i++)
+        libusb_free_transfer(m_xfers[i]);
+}
+
+int LibusbBackend::write(const uint8_t *data, uint32_t len, uint32_t timeoutMs)
+{
+    int res, transferred;
+
+    if ((res=libusb_bulk_transfer(m_handle, 0x02, (unsigned char *)data, len, &transferred, timeoutMs))<0)
+    {
+#ifdef __MACOS__
+        libusb_clear_halt(m_handle, 0x02);
+#endif
+        hostDebug("libusb_bulk_write %d", res);
+        return res;
+    }
+    return transferred;
+}
+
+int LibusbBackend::submit(USBTransfer *transfer)
+{
+    int res;
+    libusb_transfer *xfer = (libusb_transfer *)transfer->handle;
+
+    if (xfer==NULL)
+    {
+        if ((xfer=libusb_alloc_transfer(0))==NULL)
+            return LIBUSB_ERROR_NO_MEM;
+        m_xfers.push_back(xfer);
+        transfer->handle = xfer;
+    }
+    // no timeout, the read is there for whenever the device has something
+    libusb_fill_bulk_transfer(xfer, m_handle, 0x82, transfer->buf, transfer->len, callback, transfer, 0);
+    if ((res=libusb_submit_transfer(xfer))<0)
+        hostDebug("libusb_submit_transfer %d", res);
+    return res;
+}
+
+void LibusbBackend::cancel(USBTransfer *transfer)
+{
+    if (transfer->handle)
+        libusb_cancel_transfer((libusb_transfer *)transfer->handle);
+}
+
+void LibusbBackend::handleEvents(uint32_t timeoutMs)
+{
+    struct timeval tv;
+
+    tv.tv_sec = timeoutMs/1000;
+    tv.tv_usec = (timeoutMs%1000)*1000;
+    libusb_handle_events_timeout(m_context, &tv);
+}
+
+void LIBUSB_CALL LibusbBackend::callback(libusb_transfer *xfer)
+{
+    USBTransfer *transfer = (USBTransfer *)xfer->user_data;
+
+    switch (xfer->status)
+    {
+    case LIBUSB_TRANSFER_COMPLETED:
+        transfer->actual = xfer->actual_length;
+        break;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        transfer->actual = LIBUSB_ERROR_NO_DEVICE;
+        break;
+    case LIBUSB_TRANSFER_CANCELLED:
+        transfer->actual = LIBUSB_ERROR_INTERRUPTED;
+        break;
+    case LIBUSB_TRANSFER_STALL:
+        transfer->actual = LIBUSB_ERROR_PIPE;
+        break;
+    case LIBUSB_TRANSFER_OVERFLOW:
+        transfer->actual = LIBUSB_ERROR_OVERFLOW;
+        break;
+    default:
+        transfer->actual = LIBUSB_ERROR_IO;
+        break;
+    }
+    if (transfer->actual<0 && xfer->status!=LIBUSB_TRANSFER_CANCELLED)
+        hostDebug("libusb bulk read %d", transfer->actual);
+    transfer->link->complete(transfer);
+}
+
+
 USBLink::USBLink()
 {
     m_handle = 0;
     m_context = 0;
-    m_blockSize = 64;
-    m_flags = LINK_FLAG_ERROR_CORRECTED;
 }
 
 USBLink::~USBLink()
 {
+    stop(); // before the handle goes
     if (m_handle)
         libusb_close(m_handle);
     if (m_context)
@@ -38,6 +129,8 @@ USBLink::~USBLink()
 
 int USBLink::open()
 {
+    int packetSize;
+
     libusb_init(&m_context);
 
     m_handle = libusb_open_device_with_vid_pid(m_context, PIXY_VID, PIXY_DID);
@@ -45,7 +138,7 @@ int USBLink::open()
         return -1;
 #ifdef __MACOS__
     libusb_reset_device(m_handle);
-    Sleeper::msleep(100);
+    HostThread::msleep(100);
 #endif
     if (libusb_set_configuration(m_handle, 1)<0)
     {
@@ -62,56 +155,9 @@ int USBLink::open()
 #ifdef __LINUX__
     libusb_reset_device(m_handle);
 #endif
-    return 0;
-}
-
-
-
-int USBLink::send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
-{
-    int res, transferred;
-
-    if (timeoutMs==0) // 0 equals infinity
-        timeoutMs = 10;
-
-    if ((res=libusb_bulk_transfer(m_handle, 0x02, (unsigned char *)data, len, &transferred, timeoutMs))<0)
-    {
-#ifdef __MACOS__
-        libusb_clear_halt(m_handle, 0x02);
-#endif
-        qDebug("libusb_bulk_write %d", res);
-        return res;
-    }
-    return transferred;
-}
-
-int USBLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
-{
-    int res, transferred;
-
-    if (timeoutMs==0) // 0 equals infinity
-        timeoutMs = 50;
-
-    if ((res=libusb_bulk_transfer(m_handle, 0x82, (unsigned char *)data, len, &transferred, timeoutMs))<0)
-    {
-#ifdef __MACOS__
-        libusb_clear_halt(m_handle, 0x82);
-#endif
-        qDebug("libusb_bulk_read %d", res);
-        return res;
-    }
-    return transferred;
+    // 512 at high speed, 64 at full speed
+    if ((packetSize=libusb_get_max_packet_size(libusb_get_device(m_handle), 0x82))<=0)
+        packetSize = USB_IN_TRANSFER_SIZE;
+    return start(new LibusbBackend(m_context, m_handle), packetSize);
 }
 
-void USBLink::setTimer()
-{
-    m_time.start();
-}
-
-uint32_t USBLink::getTimer()
-{
-    return m_time.elapsed();
-}
-
-
-
@@ -16,26 +16,40 @@
 #ifndef _USBLINK_H
 #define _USBLINK_H
 
-#include <link.h>
-#include <QTime>
 #include "libusb.h"
+#include "usbbackend.h"
 
-class USBLink : public Link
+// bulk transfers with libusb, reads are asynchronous
+class LibusbBackend : public USBBackend
+{
+public:
+    LibusbBackend(libusb_context *context, libusb_device_handle *handle);
+    virtual ~LibusbBackend();
+
+    virtual int write(const uint8_t *data, uint32_t len, uint32_t timeoutMs);
+    virtual int submit(USBTransfer *transfer);
+    virtual void cancel(USBTransfer *transfer);
+    virtual void handleEvents(uint32_t timeoutMs);
+
+private:
+    static void LIBUSB_CALL callback(libusb_transfer *xfer);
+
+    libusb_context *m_context;
+    libusb_device_handle *m_handle;
+    std::deque<libusb_transfer *> m_xfers;
+};
+
+class USBLink : public AsyncUSBLink
 {
 public:
     USBLink();
     ~USBLink();
 
     int open();
-    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
-    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
-    virtual void setTimer();
-    virtual uint32_t getTimer();
 
 private:
     libusb_context *m_context;
     libusb_device_handle *m_handle;
-    QTime m_time;
 };
 #endif
 
@@ -67,8 +67,8 @@ void VideoWidget::handleFlush()
     if (m_images.size()==0)
         return; // nothing to render...
 
-    m_renderedImages.clear();
-    m_renderedImages = m_images;
+    // swap so neither vector reallocates, and the previous images are released for reuse
+    m_renderedImages.swap(m_images);
     m_images.clear();
     repaint();
 }
@@ -106,17 +106,17 @@ void VideoWidget::paintEvent(QPaintEvent *event)
     float war;
     float pmar;
     QPainter p(this);
-    QPixmap bgPixmap;
 
     if (m_renderedImages.size()==0)
         return;
 
-    // background pixmap
-    bgPixmap = QPixmap::fromImage(m_renderedImages[0]);
+    // The images are drawn as they are.  Converting them to pixmaps first copies every layer on
+    // every repaint, and with the raster paint engine a pixmap is just another image anyway.
+    const QImage &bg = m_renderedImages[0];
 
     // calc aspect ratios
     war = (float)m_width/(float)m_height; // widget aspect ratio
-    pmar = (float)bgPixmap.width()/(float)bgPixmap.height();
+    pmar = (float)bg.width()/(float)bg.height();
 
     // set blending mode
     p.setCompositionMode(QPainter::CompositionMode_SourceOver);
@@ -136,14 +136,14 @@ void VideoWidget::paintEvent(QPaintEvent *event)
     }
 
     // figure out scale between background resolution and active width of widget
-    m_scale = (float)m_width/bgPixmap.width();
+    m_scale = (float)m_width/bg.width();
 
     // draw background
-    p.drawPixmap(QRect(m_xOffset, m_yOffset, m_width, m_height), bgPixmap);
+    p.drawImage(QRect(m_xOffset, m_yOffset, m_width, m_height), bg);
 
     // draw/blend foreground images
     for (i=1; i<m_renderedImages.size(); i++)
-        p.drawPixmap(QRect(m_xOffset, m_yOffset, m_width, m_height), QPixmap::fromImage(m_renderedImages[i]));
+        p.drawImage(QRect(m_xOffset, m_yOffset, m_width, m_height), m_renderedImages[i]);
 
     // draw selection rectangle
     if (m_selection)
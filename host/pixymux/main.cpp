@@ -0,0 +1,55 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <signal.h>
+#include "muxserver.h"
+
+static MuxServer *g_server = NULL;
+
+static void handleSignal(int sig)
+{
+    if (g_server)
+        g_server->stop();
+}
+
+int main(int argc, char *argv[])
+{
+    int res;
+    const char *path = argc>1 ? argv[1] : MUX_DEFAULT_PATH;
+    MuxServer server;
+
+    if (argc>2)
+    {
+        fprintf(stderr, "usage: pixymux [socket path]\n");
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    if (server.open(path)<0)
+        return 1;
+    g_server = &server;
+    printf("pixymux: serving Pixy on %s\n", path);
+
+    res = server.run();
+    g_server = NULL;
+    if (res<0)
+        fprintf(stderr, "pixymux: lost Pixy (%d)\n", res);
+
+    return res<0 ? 1 : 0;
+}
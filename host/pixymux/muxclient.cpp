@@ -0,0 +1,92 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include "muxclient.h"
+
+MuxClient::MuxClient() : Chirp(true, true)
+{
+    m_record = NULL;
+    m_recordLen = 0;
+    m_drops = 0;
+    m_overruns = 0;
+}
+
+MuxClient::~MuxClient()
+{
+    // Chirp's destructor would let the other end know we're going, but m_link is gone by then
+    if (connected())
+        remoteInit(false);
+    m_client = false;
+}
+
+int MuxClient::open(const char *path)
+{
+    int res;
+
+    if ((res=m_link.open(path))<0)
+        return res;
+    return setLink(&m_link);
+}
+
+uint8_t *MuxClient::dataArgs(uint8_t type, uint32_t *len)
+{
+    if (m_record)
+    {
+        *len = m_recordLen;
+        return (uint8_t *)m_record;
+    }
+    return Chirp::dataArgs(type, len);
+}
+
+void MuxClient::handleData(void *args[])
+{
+}
+
+void MuxClient::handleXdata(void *data[])
+{
+    uint32_t pos, len, next;
+    const uint8_t *record;
+    void *args[CRP_MAX_ARGS+1];
+
+    if (data[0]==NULL || getType(data[0])!=CRP_TYPE_HINT || *(uint32_t *)data[0]!=MUX_NOTIFY)
+    {
+        handleData(data);
+        return;
+    }
+    // ring name, record position, drops
+    if (data[1]==NULL || data[2]==NULL || data[3]==NULL)
+        return;
+    if (!m_ring.isOpen() || strcmp(m_ring.name(), (char *)data[1]))
+    {
+        if (m_ring.open((char *)data[1])<0)
+            return;
+    }
+    pos = *(uint32_t *)data[2];
+    m_drops = *(uint32_t *)data[3];
+
+    if (!m_ring.valid(pos) || (record=m_ring.read(pos, &len, &next))==NULL ||
+            deserializeParse((uint8_t *)record, len, args)<0)
+    {
+        m_overruns++;
+        return;
+    }
+    m_record = record;
+    m_recordLen = len;
+    handleData(args);
+    m_record = NULL;
+    if (!m_ring.valid(pos))
+        m_overruns++;
+}
@@ -0,0 +1,65 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef MUXCLIENT_H
+#define MUXCLIENT_H
+
+#include "chirp.hpp"
+#include "socketlink.h"
+#include "muxring.h"
+
+#define MUX_DEFAULT_PATH        "/tmp/pixymux"
+#define MUX_STREAM_OTHER        0x80000000 // subscribe bit for frames the running program pushes on its own
+#define MUX_NOTIFY              FOURCC('M','U','X','1') // frame is in the ring: ring name, position, drops
+
+// Talks to Pixy through pixymux.  Calls work the same as over USB.  After stream_subscribe(),
+// frames are read in place from pixymux's shared memory and handed to handleData() along with
+// everything else Pixy pushes.  Without open(), i.e. with setLink() to Pixy itself, it's a
+// Chirp whose XDATA goes to handleData().
+class MuxClient : public Chirp
+{
+public:
+    MuxClient();
+    virtual ~MuxClient();
+
+    int open(const char *path);
+
+    uint32_t drops() // frames pixymux couldn't tell us about because we were behind
+    {
+        return m_drops;
+    }
+    uint32_t overruns() // frames overwritten before (or while) we read them
+    {
+        return m_overruns;
+    }
+    // Chirp::dataArgs(), or the frame in the ring while handleData() has one, so it can be stored
+    // as it came in either way
+    uint8_t *dataArgs(uint8_t type, uint32_t *len);
+
+protected:
+    // args are as received from Pixy and only valid until this returns
+    virtual void handleData(void *args[]);
+    virtual void handleXdata(void *data[]);
+
+private:
+    SocketLink m_link;
+    MuxRing m_ring;
+    const uint8_t *m_record; // being handled
+    uint32_t m_recordLen;
+    uint32_t m_drops;
+    uint32_t m_overruns;
+};
+
+#endif // MUXCLIENT_H
@@ -0,0 +1,160 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <new>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "muxring.h"
+
+#define ALIGN8(n)   (((n)+7)&~7)
+
+MuxRing::MuxRing()
+{
+    m_name[0] = '\0';
+    m_owner = false;
+    m_header = NULL;
+    m_records = NULL;
+    m_size = 0;
+    m_pos = 0;
+}
+
+MuxRing::~MuxRing()
+{
+    close();
+}
+
+int MuxRing::create(const char *name, uint32_t size)
+{
+    int fd;
+    void *mem;
+
+    close();
+    if (strlen(name)>=sizeof(m_name) || (size&(size-1)))
+        return -1;
+    shm_unlink(name); // left over from a previous run
+    if ((fd=shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644))<0)
+        return -1;
+    if (ftruncate(fd, MUXRING_HEADER_SIZE+size)<0 ||
+            (mem=mmap(NULL, MUXRING_HEADER_SIZE+size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))==MAP_FAILED)
+    {
+        ::close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    ::close(fd);
+
+    strcpy(m_name, name);
+    m_owner = true;
+    m_header = new (mem) Header;
+    m_header->size = size;
+    m_header->reserved.storeRelease(0);
+    m_header->committed.storeRelease(0);
+    m_header->magic = MUXRING_MAGIC;
+    m_records = (uint8_t *)mem+MUXRING_HEADER_SIZE;
+    m_size = size;
+    m_pos = 0;
+
+    return 0;
+}
+
+int MuxRing::open(const char *name)
+{
+    int fd;
+    void *mem;
+    struct stat st;
+
+    close();
+    if (strlen(name)>=sizeof(m_name) || (fd=shm_open(name, O_RDONLY, 0))<0)
+        return -1;
+    if (fstat(fd, &st)<0 || st.st_size<MUXRING_HEADER_SIZE ||
+            (mem=mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0))==MAP_FAILED)
+    {
+        ::close(fd);
+        return -1;
+    }
+    ::close(fd);
+
+    m_header = (Header *)mem;
+    if (m_header->magic!=MUXRING_MAGIC || MUXRING_HEADER_SIZE+m_header->size!=(uint32_t)st.st_size)
+    {
+        munmap(mem, st.st_size);
+        m_header = NULL;
+        return -1;
+    }
+    strcpy(m_name, name);
+    m_owner = false;
+    m_records = (uint8_t *)mem+MUXRING_HEADER_SIZE;
+    m_size = m_header->size;
+
+    return 0;
+}
+
+void MuxRing::close()
+{
+    if (m_header==NULL)
+        return;
+    munmap(m_header, MUXRING_HEADER_SIZE+m_size);
+    if (m_owner)
+        shm_unlink(m_name);
+    m_header = NULL;
+    m_records = NULL;
+    m_size = 0;
+}
+
+int64_t MuxRing::write(const uint8_t *data, uint32_t len)
+{
+    uint32_t offset, span = ALIGN8(sizeof(uint32_t)+len);
+
+    if (span>m_size/4)
+        return -1;
+
+    offset = m_pos&(m_size-1);
+    if (offset+span>m_size)
+    {
+        // doesn't fit before the end, pad it out and start at the beginning
+        m_header->reserved.storeRelease(m_pos+m_size-offset+span);
+        *(uint32_t *)(m_records+offset) = MUXRING_PAD;
+        m_pos += m_size-offset;
+        offset = 0;
+    }
+    else
+        m_header->reserved.storeRelease(m_pos+span);
+
+    *(uint32_t *)(m_records+offset) = len;
+    memcpy(m_records+offset+sizeof(uint32_t), data, len);
+    m_pos += span;
+    m_header->committed.storeRelease(m_pos);
+
+    return m_pos-span;
+}
+
+const uint8_t *MuxRing::read(uint32_t pos, uint32_t *len, uint32_t *next)
+{
+    uint32_t offset = pos&(m_size-1);
+
+    if (*(uint32_t *)(m_records+offset)==MUXRING_PAD)
+    {
+        pos += m_size-offset;
+        offset = 0;
+    }
+    *len = *(uint32_t *)(m_records+offset);
+    if (*len>m_size-offset-sizeof(uint32_t)) // overwritten while we were looking
+        return NULL;
+    *next = pos+ALIGN8(sizeof(uint32_t)+*len);
+    return m_records+offset+sizeof(uint32_t);
+}
@@ -0,0 +1,83 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef MUXRING_H
+#define MUXRING_H
+
+#include <stdint.h>
+#include "hostsync.h"
+
+#define MUXRING_MAGIC           0x584d5850 // "PXMX"
+#define MUXRING_SIZE            0x1000000  // record space, must be a power of 2
+#define MUXRING_HEADER_SIZE     64
+#define MUXRING_PAD             0xffffffff // record length that means skip to the start of the ring
+
+// Shared memory ring of records, written by pixymux and read in place by any number of
+// subscribers in other processes.  The writer never waits for readers.  It overwrites the
+// oldest records, so a reader checks valid() before and after using a record, and a reader
+// that has fallen a whole ring behind skips ahead.  Positions are free running byte counts.
+//
+// Each record is a uint32_t length followed by the data, padded to 8 bytes.  Records don't wrap,
+// a MUXRING_PAD length fills the rest of the ring instead.
+class MuxRing
+{
+public:
+    MuxRing();
+    ~MuxRing();
+
+    int create(const char *name, uint32_t size=MUXRING_SIZE); // writer
+    int open(const char *name); // reader, mapped read-only
+    void close();
+    bool isOpen()
+    {
+        return m_header!=NULL;
+    }
+    const char *name()
+    {
+        return m_name;
+    }
+
+    // copy a record in, returns its position, or -1 if it's too big
+    int64_t write(const uint8_t *data, uint32_t len);
+
+    uint32_t head() // end of the last complete record, where the next read catches up to
+    {
+        return (uint32_t)m_header->committed.loadAcquire();
+    }
+    bool valid(uint32_t pos) // record at pos hasn't been overwritten (yet)
+    {
+        return (uint32_t)m_header->reserved.loadAcquire()-pos<=m_size;
+    }
+    // the record at pos and the position of the next one, NULL if it's been overwritten
+    const uint8_t *read(uint32_t pos, uint32_t *len, uint32_t *next);
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t size;
+        HostAtomicInt reserved; // end of the record being written, what's a ring behind it can't be read
+        HostAtomicInt committed; // end of the last complete record
+    };
+
+    char m_name[64];
+    bool m_owner;
+    Header *m_header;
+    uint8_t *m_records;
+    uint32_t m_size;
+    uint32_t m_pos; // writer's position
+};
+
+#endif // MUXRING_H
@@ -0,0 +1,380 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "pixytypes.h"
+#include "muxserver.h"
+
+MuxDevice::MuxDevice(MuxServer *server) : Chirp(true, true) // we pass hints on, so we want them
+{
+    m_server = server;
+    m_link = &m_usb;
+}
+
+MuxDevice::~MuxDevice()
+{
+    // Chirp's destructor would let Pixy know we're going, but m_usb is gone by then
+    if (connected())
+        remoteInit(false);
+    m_client = false;
+}
+
+int MuxDevice::open(Link *link)
+{
+    int res;
+
+    if (link)
+        m_link = link;
+    else if (m_usb.open()<0)
+        return CRP_RES_ERROR_NOT_CONNECTED;
+    if ((res=setLink(m_link))<0)
+        return res;
+    return present() ? CRP_RES_OK : CRP_RES_ERROR_NOT_CONNECTED;
+}
+
+int MuxDevice::relay(uint8_t *type, ChirpProc *proc, const uint8_t *args, uint32_t len)
+{
+    int res;
+    void *recvArgs[CRP_MAX_ARGS+1];
+
+    // one call at a time, so the first response is ours (no request id needed)
+    if ((res=sendRaw(*type, *proc, 0, args, len))<0)
+        return res;
+
+    m_link->setTimer();
+    while(1)
+    {
+        if ((res=recvChirp(type, proc, recvArgs, true))<0)
+            return res;
+        if (*type&CRP_RESPONSE)
+            return CRP_RES_OK;
+        handleChirp(*type, *proc, recvArgs);
+        if (m_link->getTimer()>m_headerTimeout)
+            return CRP_RES_ERROR_RECV_TIMEOUT;
+    }
+}
+
+uint8_t *MuxDevice::response(uint8_t type, uint32_t *len)
+{
+    uint8_t id;
+
+    return rawArgs(type, len, &id);
+}
+
+int MuxDevice::handleChirp(uint8_t type, ChirpProc proc, void *args[])
+{
+    // before Chirp::handleChirp() gets ready to respond, so rawArgs() is still what we received
+    if (type==CRP_XDATA)
+    {
+        m_server->handleData(args);
+        return CRP_RES_OK;
+    }
+    if (type&CRP_RESPONSE) // too late, whoever was waiting for it has given up
+        return CRP_RES_OK;
+    return Chirp::handleChirp(type, proc, args);
+}
+
+
+MuxConnection::MuxConnection(MuxServer *server, int fd) : m_link(fd)
+{
+    m_server = server;
+    m_streams = 0;
+    m_decimation = 1;
+    m_drops = 0;
+    setLink(&m_link);
+}
+
+void MuxConnection::push(const uint8_t *data, uint32_t len)
+{
+    if (m_link.writable())
+        sendRaw(CRP_XDATA, 0, 0, data, len);
+    else
+        m_drops++;
+}
+
+void MuxConnection::notify(const char *ring, uint32_t pos)
+{
+    if (!m_link.writable())
+    {
+        m_drops++;
+        return;
+    }
+    ChirpWriter writer(this, CRP_XDATA);
+    writer << CrpHType(MUX_NOTIFY) << ring << pos << m_drops;
+    assemble(&writer);
+}
+
+int MuxConnection::handleChirp(uint8_t type, ChirpProc proc, void *args[])
+{
+    // the link between us and the client is negotiated between us
+    if (type==CRP_CALL_INIT)
+        return Chirp::handleChirp(type, proc, args);
+    if (type&CRP_CALL)
+        return m_server->call(this, type, proc, args);
+    return CRP_RES_OK; // clients don't push anything we're interested in
+}
+
+
+MuxServer::MuxServer()
+{
+    m_device = NULL;
+    m_listenFd = -1;
+    m_path[0] = '\0';
+    m_run = true;
+    m_subscribeProc = -1;
+    m_ackProc = -1;
+    m_streams = 0;
+    m_consumed = 0;
+    m_acked = 0;
+}
+
+MuxServer::~MuxServer()
+{
+    while(m_clients.size())
+        closeClient(m_clients.size()-1);
+    if (m_listenFd>=0)
+    {
+        close(m_listenFd);
+        unlink(m_path);
+    }
+    delete m_device;
+}
+
+int MuxServer::open(const char *path, Link *pixy)
+{
+    int res;
+    char name[32];
+    struct sockaddr_un addr;
+
+    if (strlen(path)>=sizeof(addr.sun_path))
+        return -1;
+
+    m_device = new MuxDevice(this);
+    if ((res=m_device->open(pixy))<0)
+    {
+        fprintf(stderr, "pixymux: unable to connect to Pixy (%d)\n", res);
+        return res;
+    }
+    // these are handled here, not passed on (older firmware doesn't have them)
+    m_subscribeProc = m_device->getProc("stream_subscribe");
+    m_ackProc = m_device->getProc("stream_ack");
+
+    sprintf(name, "/pixymux-%d", (int)getpid());
+    if (m_ring.create(name)<0)
+    {
+        fprintf(stderr, "pixymux: unable to create shared memory %s\n", name);
+        return -1;
+    }
+
+    if ((m_listenFd=socket(AF_UNIX, SOCK_STREAM, 0))<0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path); // left over from a previous run
+    if (bind(m_listenFd, (struct sockaddr *)&addr, sizeof(addr))<0 || listen(m_listenFd, MUX_MAX_CLIENTS)<0)
+    {
+        fprintf(stderr, "pixymux: unable to listen on %s\n", path);
+        close(m_listenFd);
+        m_listenFd = -1;
+        return -1;
+    }
+    strcpy(m_path, path);
+    fcntl(m_listenFd, F_SETFL, fcntl(m_listenFd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+int MuxServer::run()
+{
+    int res;
+
+    while(m_run && m_device->present())
+    {
+        // Clients come first.  What Pixy pushes in the meantime is handled while we wait for
+        // its responses.  Otherwise wait on Pixy, up to MUX_USB_POLL_TIMEOUT if it's quiet.
+        if (!serviceClients())
+            m_device->service(false);
+        if ((res=updateDevice())<0)
+            return res;
+    }
+    return m_run ? CRP_RES_ERROR_NOT_CONNECTED : 0;
+}
+
+// returns true if any client had something for us
+bool MuxServer::serviceClients()
+{
+    int fd;
+    uint32_t i, n;
+    struct pollfd pfds[MUX_MAX_CLIENTS+1];
+
+    n = m_clients.size();
+    for (i=0; i<n; i++)
+    {
+        pfds[i].fd = m_clients[i]->m_link.fd();
+        pfds[i].events = POLLIN;
+    }
+    pfds[n].fd = m_listenFd;
+    pfds[n].events = POLLIN;
+    if (poll(pfds, n+1, 0)<=0)
+        return false;
+
+    // calls are handled in the order clients come up, one chirp per client per pass so everyone
+    // gets a turn
+    for (i=n; i>0; i--)
+    {
+        if (pfds[i-1].revents&(POLLIN | POLLHUP | POLLERR))
+        {
+            m_clients[i-1]->service(false);
+            if (m_clients[i-1]->m_link.closed())
+                closeClient(i-1);
+        }
+    }
+
+    if ((pfds[n].revents&POLLIN) && (fd=accept(m_listenFd, NULL, NULL))>=0)
+    {
+        if (m_clients.size()<MUX_MAX_CLIENTS)
+            m_clients.push_back(new MuxConnection(this, fd));
+        else
+            close(fd);
+    }
+    return true;
+}
+
+void MuxServer::closeClient(uint32_t index)
+{
+    delete m_clients[index];
+    m_clients.erase(m_clients.begin()+index);
+}
+
+int MuxServer::call(MuxConnection *conn, uint8_t type, ChirpProc proc, void *args[])
+{
+    int res;
+    uint8_t id;
+    uint32_t len;
+    int32_t responseInt;
+    uint8_t *data = conn->rawArgs(type, &len, &id);
+
+    if (type==CRP_CALL && proc>=0 && (proc==m_subscribeProc || proc==m_ackProc))
+    {
+        // we return Pixy's credits ourselves
+        responseInt = proc==m_subscribeProc ? subscribe(conn, args) : 0;
+        return conn->sendRaw(CRP_RESPONSE, proc, id, (uint8_t *)&responseInt, sizeof(responseInt));
+    }
+
+    if ((res=m_device->relay(&type, &proc, data, len))<0)
+    {
+        // let the client know rather than leave it waiting
+        responseInt = res;
+        conn->sendRaw(CRP_RESPONSE, proc, id, (uint8_t *)&responseInt, sizeof(responseInt));
+        return res;
+    }
+    data = m_device->response(type, &len);
+    return conn->sendRaw(type, proc, id, data, len);
+}
+
+int32_t MuxServer::subscribe(MuxConnection *conn, void *args[])
+{
+    if (args[0]==NULL)
+        return CRP_RES_ERROR_PARSE;
+    conn->m_streams = *(uint32_t *)args[0];
+    conn->m_decimation = args[1] && *(uint8_t *)args[1] ? *(uint8_t *)args[1] : 1;
+    // Pixy is resubscribed in updateDevice(), we're in the middle of a client's chirp
+    return 0;
+}
+
+int MuxServer::updateDevice()
+{
+    int res, response;
+    uint32_t i, streams;
+
+    if (m_subscribeProc<0)
+        return 0;
+
+    for (i=0, streams=0; i<m_clients.size(); i++)
+        streams |= m_clients[i]->m_streams;
+    streams &= STREAM_CCB1 | STREAM_CCQ1 | STREAM_BA81;
+    if (streams!=m_streams)
+    {
+        if ((res=m_device->callSync(m_subscribeProc, UINT32(streams), UINT8(1), UINT8(MUX_CREDITS), END_OUT_ARGS, &response, END_IN_ARGS))<0)
+            return res;
+        m_streams = streams;
+        m_consumed = 0;
+        m_acked = 0;
+    }
+    if (m_streams && m_consumed-m_acked>=MUX_CREDITS/2)
+    {
+        if ((res=m_device->callSync(m_ackProc, UINT32(m_consumed), END_OUT_ARGS, &response, END_IN_ARGS))<0)
+            return res;
+        m_acked = m_consumed;
+    }
+    return 0;
+}
+
+void MuxServer::handleData(void *args[])
+{
+    uint8_t id;
+    uint32_t i, n, len, type, stream, seq;
+    int64_t pos;
+    uint8_t *data = m_device->rawArgs(CRP_XDATA, &len, &id);
+
+    if (args[0]==NULL)
+        return;
+
+    // prints and such go to everyone
+    if (Chirp::getType(args[0])!=CRP_TYPE_HINT)
+    {
+        for (i=0; i<m_clients.size(); i++)
+            m_clients[i]->push(data, len);
+        return;
+    }
+
+    type = *(uint32_t *)args[0];
+    if (type==FOURCC('C','C','B','1'))
+        stream = STREAM_CCB1;
+    else if (type==FOURCC('C','C','Q','1'))
+        stream = STREAM_CCQ1;
+    else if (type==FOURCC('B','A','8','1'))
+        stream = STREAM_BA81;
+    else
+        stream = 0;
+    // the streams' array is followed by the frame sequence number and drops, then the latency
+    // trailer (see stream.h on the device side)
+    seq = 0;
+    if (stream&m_streams)
+    {
+        m_consumed++;
+        for (n=0; args[n]; n++);
+        if (n>=8)
+            seq = *(uint32_t *)args[6];
+    }
+    else
+        stream = MUX_STREAM_OTHER;
+
+    // the only copy of the frame
+    if ((pos=m_ring.write(data, len))<0)
+        return;
+    for (i=0; i<m_clients.size(); i++)
+    {
+        if ((m_clients[i]->m_streams&stream) && seq%m_clients[i]->m_decimation==0)
+            m_clients[i]->notify(m_ring.name(), pos);
+    }
+}
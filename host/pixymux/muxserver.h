@@ -0,0 +1,160 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef MUXSERVER_H
+#define MUXSERVER_H
+
+#include <vector>
+#include "chirp.hpp"
+#include "usblink.h"
+#include "socketlink.h"
+#include "muxring.h"
+#include "muxclient.h"
+
+#define MUX_MAX_CLIENTS         16
+#define MUX_CREDITS             8  // streamed frames Pixy can send before we acknowledge them
+#define MUX_USB_POLL_TIMEOUT    5  // ms to wait for Pixy before checking on clients
+
+class MuxServer;
+
+// doesn't wait as long as USBLink when nothing is coming, so clients aren't kept waiting
+class MuxUSBLink : public USBLink
+{
+public:
+    MuxUSBLink()
+    {
+        m_gone = false;
+    }
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        return check(USBLink::send(data, len, timeoutMs));
+    }
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        return check(USBLink::receive(data, len, timeoutMs ? timeoutMs : MUX_USB_POLL_TIMEOUT));
+    }
+    bool gone() // Pixy has been unplugged
+    {
+        return m_gone;
+    }
+
+private:
+    int check(int res)
+    {
+        if (res==LIBUSB_ERROR_NO_DEVICE)
+            m_gone = true;
+        return res;
+    }
+
+    bool m_gone;
+};
+
+// our session with Pixy
+class MuxDevice : public Chirp
+{
+public:
+    MuxDevice(MuxServer *server);
+    ~MuxDevice();
+
+    int open(Link *link); // link to Pixy, NULL for USB
+    // Send a call as it is and wait for the response, handling what Pixy pushes in the meantime.
+    // type and proc are replaced with the response's, the response is left in rawArgs().
+    int relay(uint8_t *type, ChirpProc *proc, const uint8_t *args, uint32_t len);
+    uint8_t *response(uint8_t type, uint32_t *len);
+    bool present()
+    {
+        return connected() && !m_usb.gone();
+    }
+
+protected:
+    virtual int handleChirp(uint8_t type, ChirpProc proc, void *args[]);
+
+private:
+    MuxServer *m_server;
+    MuxUSBLink m_usb;
+    Link *m_link; // m_usb, or what open() was given
+};
+
+// a client's session with us
+class MuxConnection : public Chirp
+{
+public:
+    MuxConnection(MuxServer *server, int fd);
+
+    // Pass on something Pixy pushed, or tell the client there's a frame for it in the ring.
+    // A client that's behind misses these rather than holding everyone up.
+    void push(const uint8_t *data, uint32_t len);
+    void notify(const char *ring, uint32_t pos);
+
+    SocketLink m_link;
+    uint32_t m_streams; // STREAM_CCB1, etc. and MUX_STREAM_OTHER
+    uint8_t m_decimation;
+    uint32_t m_drops; // pushes the client wasn't ready for
+
+protected:
+    virtual int handleChirp(uint8_t type, ChirpProc proc, void *args[]);
+
+private:
+    MuxServer *m_server;
+};
+
+// Shares one Pixy among local processes.  Clients connect to a Unix socket and talk Chirp to
+// us the same as they would to Pixy.  Their calls are passed on to Pixy one at a time, as they
+// are (one copy into our USB buffer and one back out).  Frames Pixy pushes are copied once from
+// the USB buffer into a shared memory ring, and each subscribed client gets a small notification
+// with where to find it, so subscribers read frames in place.  Clients subscribe with
+// stream_subscribe(), which we handle ourselves.  Pixy is subscribed to what all the clients
+// want, and we return its credits.  A subscriber that falls a ring behind loses frames, it
+// doesn't hold anyone up.  Prints are passed on to everyone.
+class MuxServer
+{
+public:
+    MuxServer();
+    ~MuxServer();
+
+    // serve Pixy on the socket at path, pixy is the link to it, NULL for USB
+    int open(const char *path=MUX_DEFAULT_PATH, Link *pixy=NULL);
+    int run(); // until Pixy goes away or stop()
+    void stop()
+    {
+        m_run = false;
+    }
+
+private:
+    friend class MuxDevice;
+    friend class MuxConnection;
+
+    int call(MuxConnection *conn, uint8_t type, ChirpProc proc, void *args[]);
+    int32_t subscribe(MuxConnection *conn, void *args[]);
+    void handleData(void *args[]);
+    bool serviceClients();
+    void closeClient(uint32_t index);
+    int updateDevice();
+
+    MuxDevice *m_device;
+    MuxRing m_ring;
+    std::vector<MuxConnection *> m_clients;
+    int m_listenFd;
+    char m_path[108];
+    volatile bool m_run;
+
+    ChirpProc m_subscribeProc;
+    ChirpProc m_ackProc;
+    uint32_t m_streams; // what Pixy is subscribed to
+    uint32_t m_consumed;
+    uint32_t m_acked;
+};
+
+#endif // MUXSERVER_H
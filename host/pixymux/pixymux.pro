@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# pixymux, shares one Pixy among local processes
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = pixymux
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    muxserver.cpp \
+    muxclient.cpp \
+    muxring.cpp \
+    socketlink.cpp \
+    ../pixymon/usblink.cpp \
+    ../pixymon/usbbackend.cpp \
+    ../../common/chirp.cpp
+
+HEADERS += muxserver.h \
+    muxclient.h \
+    muxring.h \
+    socketlink.h \
+    ../pixymon/usblink.h \
+    ../pixymon/usbbackend.h \
+    ../pixymon/hostsync.h \
+    ../../common/chirp.hpp \
+    ../../common/link.h \
+    ../../common/pixytypes.h
+
+INCLUDEPATH += ../../common ../pixymon
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+    LIBS += -L/opt/local/lib -lusb-1.0
+    INCLUDEPATH += /opt/local/include/libusb-1.0
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    LIBS += -lusb-1.0 -lrt
+    INCLUDEPATH += /usr/include/libusb-1.0
+}
@@ -0,0 +1,162 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "socketlink.h"
+
+SocketLink::SocketLink(int fd)
+{
+    m_fd = fd;
+    m_closed = false;
+    m_blockSize = 64;
+    m_flags = LINK_FLAG_ERROR_CORRECTED | LINK_FLAG_BUFFERED_RECEIVE;
+    if (m_fd>=0)
+        setup();
+}
+
+SocketLink::~SocketLink()
+{
+    close();
+}
+
+int SocketLink::open(const char *path)
+{
+    struct sockaddr_un addr;
+
+    close();
+    if (strlen(path)>=sizeof(addr.sun_path))
+        return LINK_RESULT_ERROR;
+    if ((m_fd=socket(AF_UNIX, SOCK_STREAM, 0))<0)
+        return LINK_RESULT_ERROR;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (::connect(m_fd, (struct sockaddr *)&addr, sizeof(addr))<0)
+    {
+        close();
+        return LINK_RESULT_ERROR;
+    }
+    setup();
+
+    return LINK_RESULT_OK;
+}
+
+void SocketLink::close()
+{
+    if (m_fd>=0)
+        ::close(m_fd);
+    m_fd = -1;
+    m_closed = false;
+}
+
+void SocketLink::setup()
+{
+#ifdef __MACOS__
+    int on = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+}
+
+int SocketLink::send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    int res;
+    uint32_t sent;
+    struct pollfd pfd;
+
+    if (closed())
+        return LINK_RESULT_ERROR;
+
+    pfd.fd = m_fd;
+    pfd.events = POLLOUT;
+    for (sent=0; sent<len; sent+=res)
+    {
+        // once we've started, we have to finish or the stream is out of sync
+        if ((res=poll(&pfd, 1, sent ? SOCKETLINK_TIMEOUT : timeoutMs))<=0)
+            return sent ? LINK_RESULT_ERROR : LINK_RESULT_ERROR_SEND_TIMEOUT;
+        if ((res=::send(m_fd, data+sent, len-sent, MSG_NOSIGNAL))<0)
+        {
+            if (errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
+            {
+                m_closed = true;
+                return LINK_RESULT_ERROR;
+            }
+            res = 0;
+        }
+    }
+    return len;
+}
+
+int SocketLink::receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+{
+    int res;
+    uint32_t recvd;
+    struct pollfd pfd;
+
+    if (closed())
+        return LINK_RESULT_ERROR;
+
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    for (recvd=0; recvd<len; recvd+=res)
+    {
+        if ((res=poll(&pfd, 1, recvd ? SOCKETLINK_TIMEOUT : timeoutMs))<=0)
+            break;
+        if ((res=::recv(m_fd, data+recvd, len-recvd, 0))<0)
+        {
+            if (errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
+            {
+                m_closed = true;
+                return LINK_RESULT_ERROR;
+            }
+            res = 0;
+        }
+        else if (res==0) // the other end is gone
+        {
+            m_closed = true;
+            return LINK_RESULT_ERROR;
+        }
+    }
+    // nothing at all is a timeout, same as USBLink, which is how Chirp tells there's nothing yet
+    return recvd ? (int)recvd : LINK_RESULT_ERROR_RECV_TIMEOUT;
+}
+
+void SocketLink::setTimer()
+{
+    m_timer.start();
+}
+
+uint32_t SocketLink::getTimer()
+{
+    return m_timer.elapsed();
+}
+
+bool SocketLink::writable()
+{
+    struct pollfd pfd;
+
+    if (closed())
+        return false;
+    pfd.fd = m_fd;
+    pfd.events = POLLOUT;
+    return poll(&pfd, 1, 0)>0;
+}
@@ -0,0 +1,60 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+#ifndef SOCKETLINK_H
+#define SOCKETLINK_H
+
+#include <link.h>
+#include "hostsync.h"
+
+#define SOCKETLINK_TIMEOUT      1000 // ms, for the rest of a receive that has started
+
+// A Link over a connected Unix stream socket, between pixymux and its clients.  The socket is
+// reliable and the kernel buffers it, so the link is error corrected and buffers what's sent to
+// it (LINK_FLAG_BUFFERED_RECEIVE).  Timeouts of 0 mean don't wait.
+class SocketLink : public Link
+{
+public:
+    SocketLink(int fd=-1); // takes fd, an accepted connection
+    ~SocketLink();
+
+    int open(const char *path); // connect to the socket at path
+    void close();
+    int fd()
+    {
+        return m_fd;
+    }
+    bool closed() // the other end has gone away
+    {
+        return m_fd<0 || m_closed;
+    }
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs);
+    virtual void setTimer();
+    virtual uint32_t getTimer();
+
+    // true if there's room in the socket, so a small send won't wait
+    bool writable();
+
+private:
+    void setup();
+
+    int m_fd;
+    bool m_closed;
+    HostElapsedTimer m_timer;
+};
+
+#endif // SOCKETLINK_H
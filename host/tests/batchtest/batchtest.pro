@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+# batchtest, checks BatchProcessor against one ProcessBlobs going through
+# a recording in order, batchtest -b times 1, 2, 4 and 8 workers
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = batchtest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp \
+    ../../pixymon/batchprocessor.cpp \
+    ../../pixymon/processblobs.cpp \
+    ../../pixymon/recording.cpp \
+    ../../../common/chirp.cpp \
+    ../../../common/blobs.cpp \
+    ../../../common/blob.cpp \
+    ../../../common/colorlut.cpp \
+    ../../../common/qqueue.cpp \
+    ../../../common/rls.cpp
+
+HEADERS += ../../pixymon/batchprocessor.h \
+    ../../pixymon/processblobs.h \
+    ../../pixymon/recording.h \
+    ../../pixymon/hostsync.h \
+    ../../../common/chirp.hpp
+
+INCLUDEPATH += ../../pixymon ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    LIBS += -lpthread
+}
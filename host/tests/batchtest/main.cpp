@@ -0,0 +1,319 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test and benchmark for BatchProcessor.  A recording of CMV1 frames (with new color models
+// partway through, and records that aren't CMV1 in between) is played back by one ProcessBlobs
+// in order, the way PixyHost::play() does, and by BatchProcessor with 1, 2, 3, 4 and 8 workers
+// through RecordingBatchReader.  The blocks must be the same, frame for frame, and written in
+// frame order.
+//
+// batchtest -b also times one ProcessBlobs against 1, 2, 4 and 8 workers.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "batchprocessor.h"
+#include "chirp.hpp"
+
+#define RECORDING_FILE  "batchtest.pxrc"
+#define MODEL_CHANGE    20 // frame that comes with new color models
+
+static uint32_t g_seed;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+struct Result
+{
+    uint32_t index;
+    uint64_t timestamp;
+    std::vector<BlobA> blobs;
+};
+
+class Collector : public BatchWriter
+{
+public:
+    Collector(int failAt=-1)
+    {
+        m_failAt = failAt;
+    }
+    virtual int write(const BatchFrame *frame)
+    {
+        Result result;
+
+        if ((int)m_results.size()==m_failAt)
+            return -1;
+        result.index = frame->m_index;
+        result.timestamp = frame->m_timestamp;
+        result.blobs.assign(frame->m_blobs, frame->m_blobs+frame->m_numBlobs);
+        m_results.push_back(result);
+        return 0;
+    }
+
+    std::vector<Result> m_results;
+
+private:
+    int m_failAt;
+};
+
+// Bayer frame, gray with noise and dark rectangles, which are what the lut picks out
+static void bayerFrame(std::vector<uint8_t> *frame, uint16_t width, uint16_t height)
+{
+    uint32_t i, n, x, y, x0, y0, x1, y1;
+
+    frame->resize(width*height);
+    for (i=0; i<frame->size(); i++)
+        (*frame)[i] = 100 + rnd()%16;
+    for (n=rnd()%12; n; n--)
+    {
+        x0 = rnd()%width;
+        y0 = rnd()%height;
+        x1 = x0 + rnd()%(width/4);
+        y1 = y0 + rnd()%(height/4);
+        for (y=y0; y<y1 && y<height; y++)
+        {
+            for (x=x0; x<x1 && x<width; x++)
+                (*frame)[y*width + x] = rnd()%12;
+        }
+    }
+}
+
+// CMV1 frames serialized the way the firmware's sendCMV1() does it, stamped 20 ms apart
+static int writeRecording(uint32_t numFrames, uint16_t width, uint16_t height)
+{
+    RecordingWriter writer;
+    std::vector<uint8_t> frame, buf(width*height+0x400);
+    float cmodels[sizeof(ColorModel)*NUM_MODELS/sizeof(float)];
+    uint16_t blobs[] = {1, 10, 20, 30, 40};
+    uint32_t i, j, nmodels;
+    int len;
+
+    if (writer.open(RECORDING_FILE)<0)
+        return -1;
+    for (i=0; i<numFrames; i++)
+    {
+        bayerFrame(&frame, width, height);
+        // models with the first frame and MODEL_CHANGE
+        nmodels = i==0 || i==MODEL_CHANGE ? sizeof(cmodels)/sizeof(float) : 0;
+        for (j=0; j<sizeof(cmodels)/sizeof(float); j++)
+            cmodels[j] = (float)(rnd()%1000)/100.0f;
+        len = Chirp::serialize(NULL, &buf[0], buf.size(), HTYPE(FOURCC('C','M','V','1')), HINT8(RENDER_FLAG_FLUSH),
+                               FLTS32(nmodels, cmodels), UINT16(width), UINT16(height), UINTS8(width*height, &frame[0]), END);
+        if (len<0 || writer.write(i*20000, CRP_XDATA, FOURCC('C','M','V','1'), &buf[0], len)<0)
+            return -1;
+        // something that isn't a frame to skip
+        if (i%7==3)
+        {
+            len = Chirp::serialize(NULL, &buf[0], buf.size(), HTYPE(FOURCC('C','C','B','1')), HINT8(RENDER_FLAG_FLUSH),
+                                   UINT16(width/2), UINT16(height/2), UINTS16(sizeof(blobs)/sizeof(uint16_t), blobs), END);
+            if (len<0 || writer.write(i*20000+1, CRP_XDATA, FOURCC('C','C','B','1'), &buf[0], len)<0)
+                return -1;
+        }
+    }
+    return writer.close();
+}
+
+// one ProcessBlobs through the recording in order, what PixyHost::play() does
+static int sequential(std::vector<Result> *results)
+{
+    RecordingReader recording;
+    ProcessBlobs blobs;
+    const RecordHeader *header;
+    void *args[CRP_MAX_ARGS+1];
+    const ColorModel *cmodels;
+    uint32_t i, j, numBlobs, numQvals;
+    BlobA *blobA;
+    Qval *qvals;
+    Result result;
+
+    results->clear();
+    if (recording.open(RECORDING_FILE)<0)
+        return -1;
+    for (i=0; i<recording.records(); i++)
+    {
+        if ((header=recording.args(i, args))==NULL || header->fourcc!=FOURCC('C','M','V','1'))
+            continue;
+        if (*(uint32_t *)args[2]>=sizeof(ColorModel)*NUM_MODELS/sizeof(float))
+        {
+            cmodels = (const ColorModel *)args[3];
+            blobs.m_blobs->m_clut->clear();
+            for (j=0; j<NUM_MODELS; j++)
+                blobs.m_blobs->m_clut->add(cmodels+j, j+1);
+        }
+        blobs.process(Frame8((uint8_t *)args[7], *(uint16_t *)args[4], *(uint16_t *)args[5]), &numBlobs, &blobA, &numQvals, &qvals);
+        result.index = results->size();
+        result.timestamp = header->timestamp;
+        result.blobs.assign(blobA, blobA+numBlobs);
+        results->push_back(result);
+    }
+    return 0;
+}
+
+static int batch(uint32_t workers, Collector *collector)
+{
+    RecordingReader recording;
+    BatchProcessor processor(workers);
+    int res;
+
+    if ((res=recording.open(RECORDING_FILE))<0)
+        return res;
+    RecordingBatchReader reader(&recording);
+    return processor.process(&reader, collector);
+}
+
+static int compare(uint32_t workers, const std::vector<Result> &ref, const std::vector<Result> &results)
+{
+    uint32_t i;
+
+    if (results.size()!=ref.size())
+    {
+        printf("FAIL %u workers: %u frames, should be %u\n", workers, (uint32_t)results.size(), (uint32_t)ref.size());
+        return 1;
+    }
+    for (i=0; i<ref.size(); i++)
+    {
+        if (results[i].index!=i || results[i].timestamp!=ref[i].timestamp)
+        {
+            printf("FAIL %u workers: frame %u written as frame %u, stamped %llu, should be %llu\n", workers, i,
+                   results[i].index, (unsigned long long)results[i].timestamp, (unsigned long long)ref[i].timestamp);
+            return 1;
+        }
+        if (results[i].blobs.size()!=ref[i].blobs.size() ||
+                (ref[i].blobs.size() && memcmp(&results[i].blobs[0], &ref[i].blobs[0], ref[i].blobs.size()*sizeof(BlobA))))
+        {
+            printf("FAIL %u workers: frame %u has %u blocks, should be %u, or they're different\n", workers, i,
+                   (uint32_t)results[i].blobs.size(), (uint32_t)ref[i].blobs.size());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ms to go through the recording passes times, best of 3 so other processes don't count
+static int64_t timePasses(uint32_t workers, uint32_t passes)
+{
+    HostElapsedTimer timer;
+    std::vector<Result> ref;
+    uint32_t i, j;
+    int64_t ms, best=0;
+
+    for (i=0; i<3; i++)
+    {
+        timer.start();
+        for (j=0; j<passes; j++)
+        {
+            Collector collector;
+            if (workers==0)
+                sequential(&ref);
+            else
+                batch(workers, &collector);
+        }
+        ms = timer.elapsed();
+        if (i==0 || ms<best)
+            best = ms;
+    }
+    return best>0 ? best : 1;
+}
+
+static void benchmark()
+{
+    static const uint16_t sizes[][2] = {{320, 200}, {640, 400}};
+    static const uint32_t workers[] = {1, 2, 4, 8};
+    uint32_t i, j, frames, passes=40;
+    int64_t serialMs, ms;
+
+    printf("%d cores\n", HostThread::idealThreadCount());
+    for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+    {
+        // the recording is played passes times, so it can be small enough to stay cached
+        frames = 12800000/(sizes[i][0]*sizes[i][1]);
+        g_seed = 12345;
+        if (writeRecording(frames, sizes[i][0], sizes[i][1])<0)
+        {
+            printf("can't write %s\n", RECORDING_FILE);
+            return;
+        }
+        serialMs = timePasses(0, passes);
+        printf("%ux%u, %u frames\n", sizes[i][0], sizes[i][1], frames*passes);
+        printf("sequential: %7.1f frames/s\n", frames*passes*1000.0/serialMs);
+        for (j=0; j<sizeof(workers)/sizeof(workers[0]); j++)
+        {
+            ms = timePasses(workers[j], passes);
+            printf("%u workers:  %7.1f frames/s, %.2fx\n", workers[j], frames*passes*1000.0/ms, (double)serialMs/ms);
+        }
+    }
+    remove(RECORDING_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t workers[] = {1, 2, 3, 4, 8};
+    std::vector<Result> ref;
+    uint32_t i, seed, numBlobs;
+    int res, fails=0;
+
+    for (seed=1; seed<=3; seed++)
+    {
+        g_seed = seed*7919;
+        if (writeRecording(MODEL_CHANGE*2, seed==3 ? 640 : 320, seed==3 ? 400 : 200)<0 || sequential(&ref)<0)
+        {
+            printf("FAIL can't write and read %s\n", RECORDING_FILE);
+            return 1;
+        }
+        for (i=0, numBlobs=0; i<ref.size(); i++)
+            numBlobs += ref[i].blobs.size();
+        if (numBlobs<ref.size())
+        {
+            printf("FAIL only %u blocks in %u frames, not much of a test\n", numBlobs, (uint32_t)ref.size());
+            fails++;
+        }
+        for (i=0; i<sizeof(workers)/sizeof(workers[0]); i++)
+        {
+            Collector collector;
+            if ((res=batch(workers[i], &collector))!=(int)ref.size())
+            {
+                printf("FAIL %u workers: process() returned %d, should be %u\n", workers[i], res, (uint32_t)ref.size());
+                fails++;
+            }
+            fails += compare(workers[i], ref, collector.m_results);
+        }
+
+        // a writer that fails stops processing, and nothing is left behind
+        Collector failing(5);
+        if ((res=batch(4, &failing))!=-1 || failing.m_results.size()!=5)
+        {
+            printf("FAIL failed writer: process() returned %d after %u frames\n", res, (uint32_t)failing.m_results.size());
+            fails++;
+        }
+    }
+    remove(RECORDING_FILE);
+
+    if (fails)
+    {
+        printf("%d FAILED\n", fails);
+        return 1;
+    }
+    printf("all passed\n");
+
+    if (argc>1 && strcmp(argv[1], "-b")==0)
+        benchmark();
+    return 0;
+}
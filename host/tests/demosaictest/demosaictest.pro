@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# demosaictest, checks Demosaic against the old per-pixel interpolation,
+# demosaictest -b times both at 320x200, 640x400 and 1280x800
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = demosaictest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    ../../pixymon/demosaic.cpp
+
+HEADERS += ../../pixymon/demosaic.h
+
+INCLUDEPATH += ../../pixymon
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+}
+
+win32 {
+    DEFINES += __WINDOWS__
+}
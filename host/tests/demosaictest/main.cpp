@@ -0,0 +1,283 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test and benchmark for Demosaic.  Random BA81 frames are demosaiced by Demosaic::bilinear() and
+// by the per-pixel interpolateBayer() loop Renderer::renderBA81() used before, and the pixels must
+// be the same, bit for bit.  halfRes() is checked against a per-pixel version the same way.  The
+// images have a wider stride than needed, and what's outside the image must be left alone.
+//
+// demosaictest -b also times the old loop against bilinear() with one band and one band per core,
+// and halfRes().
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <QElapsedTimer>
+#include <QThread>
+#include "demosaic.h"
+
+#define GUARD   0xdeadbeef
+#define PAD     5 // extra pixels per image line
+
+static uint32_t g_seed;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+// what Renderer::renderBA81() did before Demosaic
+static inline void interpolateBayer(unsigned int width, unsigned int x, unsigned int y, const unsigned char *pixel, unsigned int &r, unsigned int &g, unsigned int &b)
+{
+    if (y&1)
+    {
+        if (x&1)
+        {
+            r = *pixel;
+            g = (*(pixel-1)+*(pixel+1)+*(pixel+width)+*(pixel-width))>>2;
+            b = (*(pixel-width-1)+*(pixel-width+1)+*(pixel+width-1)+*(pixel+width+1))>>2;
+        }
+        else
+        {
+            r = (*(pixel-1)+*(pixel+1))>>1;
+            g = *pixel;
+            b = (*(pixel-width)+*(pixel+width))>>1;
+        }
+    }
+    else
+    {
+        if (x&1)
+        {
+            r = (*(pixel-width)+*(pixel+width))>>1;
+            g = *pixel;
+            b = (*(pixel-1)+*(pixel+1))>>1;
+        }
+        else
+        {
+            r = (*(pixel-width-1)+*(pixel-width+1)+*(pixel+width-1)+*(pixel+width+1))>>2;
+            g = (*(pixel-1)+*(pixel+1)+*(pixel+width)+*(pixel-width))>>2;
+            b = *pixel;
+        }
+    }
+}
+
+static void refBilinear(const uint8_t *frame, uint16_t width, uint16_t height, uint32_t *image, uint32_t stride)
+{
+    uint16_t x, y;
+    uint32_t *line;
+    uint32_t r, g, b;
+
+    // skip first line
+    frame += width;
+
+    for (y=1; y<height-1; y++)
+    {
+        line = image + (y-1)*stride;
+        frame++;
+        for (x=1; x<width-1; x++, frame++)
+        {
+            interpolateBayer(width, x, y, frame, r, g, b);
+            *line++ = (0x40<<24) | (r<<16) | (g<<8) | (b<<0);
+        }
+        frame++;
+    }
+}
+
+static void refHalfRes(const uint8_t *frame, uint16_t width, uint16_t height, uint32_t *image, uint32_t stride)
+{
+    uint16_t x, y;
+    const uint8_t *p, *q;
+
+    for (y=0; y<height/2; y++)
+    {
+        for (x=0; x<width/2; x++)
+        {
+            p = frame + 2*y*width + 2*x; // blue, green
+            q = p + width; // green, red
+            image[y*stride + x] = (0x40<<24) | (q[1]<<16) | (((p[1]+q[0])>>1)<<8) | p[0];
+        }
+    }
+}
+
+static void randomFrame(std::vector<uint8_t> *frame, uint16_t width, uint16_t height)
+{
+    uint32_t i;
+
+    frame->resize(width*height);
+    for (i=0; i<frame->size(); i++)
+        (*frame)[i] = rnd();
+}
+
+// extremes, so any overflow or saturation in the 16 bit sums shows
+static void extremeFrame(std::vector<uint8_t> *frame, uint16_t width, uint16_t height)
+{
+    uint32_t i;
+
+    frame->resize(width*height);
+    for (i=0; i<frame->size(); i++)
+        (*frame)[i] = rnd()&1 ? 0xff : 0x00;
+}
+
+static int compare(const char *what, const std::vector<uint32_t> &ref, const std::vector<uint32_t> &image,
+                   uint16_t width, uint16_t height, uint32_t cols, uint32_t stride, uint32_t bands)
+{
+    uint32_t i;
+
+    for (i=0; i<image.size(); i++)
+    {
+        if (image[i]!=ref[i])
+        {
+            if (i<ref.size()-stride && i%stride<cols)
+                printf("FAIL %s %ux%u, %u bands: pixel (%u, %u) is 0x%08x, should be 0x%08x\n", what, width, height, bands,
+                       i%stride, i/stride, image[i], ref[i]);
+            else
+                printf("FAIL %s %ux%u, %u bands: wrote 0x%08x outside the image at (%u, %u)\n", what, width, height, bands,
+                       image[i], i%stride, i/stride);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int test(Demosaic *demosaic, uint32_t bands, const std::vector<uint8_t> &frame, uint16_t width, uint16_t height)
+{
+    uint32_t cols, rows, stride;
+    std::vector<uint32_t> ref, image;
+    int fails = 0;
+
+    // one more line for anything written past the end
+    cols = width-2;
+    rows = height-2;
+    stride = cols + PAD;
+    ref.assign((rows+1)*stride, GUARD);
+    image.assign((rows+1)*stride, GUARD);
+    refBilinear(&frame[0], width, height, &ref[0], stride);
+    demosaic->bilinear(&frame[0], width, height, &image[0], stride);
+    fails += compare("bilinear", ref, image, width, height, cols, stride, bands);
+
+    cols = width/2;
+    rows = height/2;
+    stride = cols + PAD;
+    ref.assign((rows+1)*stride, GUARD);
+    image.assign((rows+1)*stride, GUARD);
+    refHalfRes(&frame[0], width, height, &ref[0], stride);
+    demosaic->halfRes(&frame[0], width, height, &image[0], stride);
+    fails += compare("halfRes", ref, image, width, height, cols, stride, bands);
+
+    return fails;
+}
+
+static void benchmark()
+{
+    static const uint16_t sizes[][2] = {{320, 200}, {640, 400}, {1280, 800}};
+    uint32_t cores = QThread::idealThreadCount()>0 ? QThread::idealThreadCount() : 1;
+    Demosaic serial(1), banded(cores);
+    std::vector<uint8_t> frame;
+    std::vector<uint32_t> image;
+    QElapsedTimer timer;
+    uint32_t i, j, iters;
+    uint16_t width, height;
+    qint64 refNs, serialNs, bandedNs, halfNs;
+
+    printf("%u cores\n", cores);
+    for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+    {
+        width = sizes[i][0];
+        height = sizes[i][1];
+        iters = 64000000/(width*height);
+        g_seed = 12345;
+        randomFrame(&frame, width, height);
+        image.resize(width*height);
+
+        timer.start();
+        for (j=0; j<iters; j++)
+            refBilinear(&frame[0], width, height, &image[0], width-2);
+        refNs = timer.nsecsElapsed();
+
+        timer.start();
+        for (j=0; j<iters; j++)
+            serial.bilinear(&frame[0], width, height, &image[0], width-2);
+        serialNs = timer.nsecsElapsed();
+
+        timer.start();
+        for (j=0; j<iters; j++)
+            banded.bilinear(&frame[0], width, height, &image[0], width-2);
+        bandedNs = timer.nsecsElapsed();
+
+        timer.start();
+        for (j=0; j<iters; j++)
+            banded.halfRes(&frame[0], width, height, &image[0], width/2);
+        halfNs = timer.nsecsElapsed();
+
+        printf("%4ux%-4u  interpolateBayer %7.3f ms  bilinear %7.3f ms %5.2fx  %u bands %7.3f ms %5.2fx  halfRes %7.3f ms\n",
+               width, height, refNs/1e6/iters, serialNs/1e6/iters, (double)refNs/serialNs,
+               cores, bandedNs/1e6/iters, (double)refNs/bandedNs, halfNs/1e6/iters);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // the frame sizes Pixy sends, and odd ones so the SSE2 loops have leftovers
+    static const uint16_t sizes[][2] = {{320, 200}, {640, 400}, {1280, 800}, {321, 201}, {35, 7}, {18, 4}, {3, 3}, {2, 2}};
+    static const uint32_t bands[] = {1, 2, 4, 8};
+    std::vector<uint8_t> frame;
+    uint32_t i, j, seed;
+    int fails=0;
+
+    for (j=0; j<sizeof(bands)/sizeof(bands[0]); j++)
+    {
+        Demosaic demosaic(bands[j]);
+
+        for (seed=1; seed<=4; seed++)
+        {
+            for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+            {
+                g_seed = seed*7919 + i;
+                if (sizes[i][0]>=3 && sizes[i][1]>=3)
+                {
+                    randomFrame(&frame, sizes[i][0], sizes[i][1]);
+                    fails += test(&demosaic, bands[j], frame, sizes[i][0], sizes[i][1]);
+                    extremeFrame(&frame, sizes[i][0], sizes[i][1]);
+                    fails += test(&demosaic, bands[j], frame, sizes[i][0], sizes[i][1]);
+                }
+                else
+                {
+                    // too small for bilinear, which must leave the image alone
+                    std::vector<uint32_t> ref, image;
+                    randomFrame(&frame, sizes[i][0], sizes[i][1]);
+                    ref.assign(4*PAD, GUARD);
+                    image.assign(4*PAD, GUARD);
+                    demosaic.bilinear(&frame[0], sizes[i][0], sizes[i][1], &image[0], PAD);
+                    fails += compare("bilinear", ref, image, sizes[i][0], sizes[i][1], 0, PAD, bands[j]);
+                }
+            }
+        }
+    }
+
+    if (fails)
+    {
+        printf("%d FAILED\n", fails);
+        return 1;
+    }
+    printf("all passed\n");
+
+    if (argc>1 && strcmp(argv[1], "-b")==0)
+        benchmark();
+    return 0;
+}
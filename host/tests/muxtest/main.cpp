@@ -0,0 +1,594 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test and benchmark for pixymux.  Pixy is a Chirp on a thread at the other end of a socketpair,
+// with an echo call and the stream calls.  It pushes CCB1 frames the way stream.cpp does (latency
+// trailer and all) as its credits allow, and a print every so often.  MuxServer serves it on a
+// socket, the way pixymux serves it over USB.  Calls made from clients on other threads at the same
+// time must each get their own responses.  libpixyhost, through pixy_host_open_mux(), must get
+// frames intact and in order, and record them the same as over USB, while a MuxClient subscribed
+// with decimation 3 gets only every third frame, and the prints.  Clients that go away, even
+// halfway through a call, mustn't upset the others.  A program that doesn't fit in Pixy (hostprog_add
+// turns it away) is run by libpixyhost itself, one that does is left to Pixy.
+//
+// muxtest -b also times calls through pixymux with 1 and 4 clients, and frames pushed 10000 times
+// a second.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <vector>
+#include "muxserver.h"
+#include "muxclient.h"
+#include "pixyhost.h"
+#include "pixytypes.h"
+
+#define MUX_PATH        "/tmp/muxtest"
+#define RECORDING_FILE  "muxtest.pxrc"
+#define PIXY_BLOCKS     4
+#define PIXY_PERIOD     1000 // us between frames
+#define PIXY_PRINT      50   // a print every this many frames
+#define WAIT_MS         5000 // for what should come long before
+#define PIXY_PROG_CALLS 4    // calls that fit in Pixy's uploaded program
+
+static int g_fails = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            g_fails++; \
+        } \
+    } while (0)
+
+// Waits a little when asked not to wait (timeout 0), the same as MuxUSBLink does, so what's
+// polling it doesn't spin.
+class PolledLink : public SocketLink
+{
+public:
+    PolledLink(int fd) : SocketLink(fd)
+    {
+        m_pollMs = 1;
+    }
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        return SocketLink::receive(data, len, timeoutMs ? timeoutMs : m_pollMs);
+    }
+
+    uint16_t m_pollMs;
+};
+
+// what the firmware does, as far as pixymux can tell
+class Pixy : public HostThread
+{
+public:
+    Pixy(int fd);
+
+    void stop()
+    {
+        m_run = false;
+        wait();
+    }
+
+    volatile bool m_run;
+    volatile uint32_t m_period; // us between frames
+    uint32_t m_seq;
+    uint32_t m_drops;
+    uint32_t m_acks;
+    uint32_t m_echoes;
+    uint32_t m_adds;
+    uint32_t m_progCalls; // in the uploaded program
+    bool m_progRunning;
+
+protected:
+    virtual void run();
+
+private:
+    static uint32_t echo(const uint32_t *x, Chirp *chirp);
+    static uint32_t subscribe(const uint32_t *streams, const uint8_t *decimation, const uint8_t *credits, Chirp *chirp);
+    static uint32_t ack(const uint32_t *consumed, Chirp *chirp);
+    static uint32_t progClear(Chirp *chirp);
+    static uint32_t progAdd(const uint16_t *proc, const uint32_t *len, const uint8_t *args, Chirp *chirp);
+    static uint32_t progRun(Chirp *chirp);
+    void push();
+
+    PolledLink m_link;
+    Chirp m_chirp;
+    uint32_t m_streams;
+    uint8_t m_credits;
+    uint32_t m_sent;
+    uint32_t m_consumed;
+};
+
+static Pixy *g_pixy = NULL;
+
+// so that libpixyhost can parse "echo 5"
+static ProcTableExtension g_echoInfo = {{CRP_UINT32, END}, (char *)"returns x+1"};
+
+Pixy::Pixy(int fd) : m_link(fd), m_chirp(false, false)
+{
+    m_run = true;
+    m_period = PIXY_PERIOD;
+    m_seq = 0;
+    m_drops = 0;
+    m_acks = 0;
+    m_echoes = 0;
+    m_adds = 0;
+    m_progCalls = 0;
+    m_progRunning = false;
+    m_streams = 0;
+    m_credits = 0;
+    m_sent = 0;
+    m_consumed = 0;
+    g_pixy = this;
+    m_chirp.setLink(&m_link);
+    m_chirp.setProc("echo", (ProcPtr)(ChirpAnyFn)echo, &g_echoInfo);
+    m_chirp.setProc("stream_subscribe", (ProcPtr)(ChirpAnyFn)subscribe);
+    m_chirp.setProc("stream_ack", (ProcPtr)(ChirpAnyFn)ack);
+    m_chirp.setProc("hostprog_clear", (ProcPtr)(ChirpAnyFn)progClear);
+    m_chirp.setProc("hostprog_add", (ProcPtr)(ChirpAnyFn)progAdd);
+    m_chirp.setProc("hostprog_run", (ProcPtr)(ChirpAnyFn)progRun);
+}
+
+uint32_t Pixy::echo(const uint32_t *x, Chirp *chirp)
+{
+    g_pixy->m_echoes++;
+    return *x+1;
+}
+
+// hostprog.cpp's, the calls are only counted, running the program isn't what's tested
+uint32_t Pixy::progClear(Chirp *chirp)
+{
+    g_pixy->m_progCalls = 0;
+    g_pixy->m_progRunning = false;
+    return 0;
+}
+
+uint32_t Pixy::progAdd(const uint16_t *proc, const uint32_t *len, const uint8_t *args, Chirp *chirp)
+{
+    g_pixy->m_adds++;
+    if (g_pixy->m_progCalls==PIXY_PROG_CALLS)
+        return (uint32_t)-2; // the program is full
+    g_pixy->m_progCalls++;
+    return 0;
+}
+
+uint32_t Pixy::progRun(Chirp *chirp)
+{
+    if (g_pixy->m_progCalls==0)
+        return (uint32_t)-1;
+    g_pixy->m_progRunning = true;
+    return 0;
+}
+
+uint32_t Pixy::subscribe(const uint32_t *streams, const uint8_t *decimation, const uint8_t *credits, Chirp *chirp)
+{
+    g_pixy->m_streams = *streams;
+    g_pixy->m_credits = *credits;
+    g_pixy->m_sent = 0;
+    g_pixy->m_consumed = 0;
+    return 0;
+}
+
+uint32_t Pixy::ack(const uint32_t *consumed, Chirp *chirp)
+{
+    g_pixy->m_consumed = *consumed;
+    g_pixy->m_acks++;
+    return 0;
+}
+
+void Pixy::run()
+{
+    uint64_t last = hostTime();
+
+    while (m_run)
+    {
+        // don't wait for calls when frames are due more often than that
+        m_link.m_pollMs = m_period>=1000 ? 1 : 0;
+        m_chirp.service(false);
+        if ((m_streams&STREAM_CCB1) && hostTime()-last>=m_period)
+        {
+            last = hostTime();
+            push();
+        }
+    }
+}
+
+// stream_sendBlobs(), with blocks that say which frame they're from
+void Pixy::push()
+{
+    uint16_t blocks[PIXY_BLOCKS*5];
+    uint32_t stamps[LAT_DEVICE_STAGES];
+    uint32_t i;
+
+    m_seq++;
+    if (m_seq%PIXY_PRINT==0)
+        m_chirp.assemble(CRP_XDATA, HSTRING("frame\n"), END);
+    if (m_credits && m_sent-m_consumed>=m_credits)
+    {
+        m_drops++;
+        return;
+    }
+    for (i=0; i<PIXY_BLOCKS; i++)
+    {
+        blocks[i*5] = i+1;
+        blocks[i*5+1] = m_seq&0xffff;
+        blocks[i*5+2] = m_seq>>16;
+        blocks[i*5+3] = i;
+        blocks[i*5+4] = i+10;
+    }
+    memset(stamps, 0, sizeof(stamps));
+    ChirpWriter writer(&m_chirp, CRP_XDATA);
+    writer << CrpHType(FOURCC('C','C','B','1')) << CrpHint<uint8_t>(RENDER_FLAG_FLUSH) << CrpHint<uint16_t>(320) <<
+              CrpHint<uint16_t>(200) << CrpArray<uint16_t>(PIXY_BLOCKS*5, blocks) << m_seq << m_drops <<
+              CrpArray<uint32_t>(LAT_DEVICE_STAGES, stamps);
+    if (m_chirp.assemble(&writer)>=0)
+        m_sent++;
+}
+
+// true if the blocks are the ones Pixy pushed with frame seq
+static bool frameOk(const uint16_t *blocks, uint32_t numBlocks, uint32_t seq)
+{
+    uint32_t i;
+
+    if (numBlocks!=PIXY_BLOCKS)
+        return false;
+    for (i=0; i<PIXY_BLOCKS; i++)
+    {
+        if (blocks[i*5]!=i+1 || blocks[i*5+1]!=(seq&0xffff) || blocks[i*5+2]!=seq>>16 || blocks[i*5+3]!=i ||
+                blocks[i*5+4]!=i+10)
+            return false;
+    }
+    return true;
+}
+
+class Server : public HostThread
+{
+public:
+    Server()
+    {
+        m_res = 0;
+    }
+
+    MuxServer m_server;
+    int m_res;
+
+protected:
+    virtual void run()
+    {
+        m_res = m_server.run();
+    }
+};
+
+// makes calls of its own through pixymux
+class Caller : public HostThread
+{
+public:
+    Caller(uint32_t base, uint32_t calls)
+    {
+        m_base = base;
+        m_calls = calls;
+        m_bad = 0;
+    }
+
+    uint32_t m_bad; // calls that failed, or got someone else's response
+
+protected:
+    virtual void run()
+    {
+        MuxClient client;
+        ChirpProc proc;
+        uint32_t i;
+        int res, response;
+
+        if (client.open(MUX_PATH)<0 || (proc=client.getProc("echo"))<0)
+        {
+            m_bad = m_calls;
+            return;
+        }
+        for (i=0; i<m_calls; i++)
+        {
+            response = -1;
+            res = client.callSync(proc, UINT32(m_base+i), END_OUT_ARGS, &response, END_IN_ARGS);
+            if (res<0 || response!=(int)(m_base+i+1))
+                m_bad++;
+        }
+    }
+
+private:
+    uint32_t m_base;
+    uint32_t m_calls;
+};
+
+class Subscriber : public MuxClient
+{
+public:
+    Subscriber()
+    {
+        m_bad = 0;
+        m_prints = 0;
+    }
+
+    int subscribe(uint32_t streams, uint8_t decimation)
+    {
+        int res, response;
+
+        res = callSync(getProc("stream_subscribe"), UINT32(streams), UINT8(decimation), UINT8(4), END_OUT_ARGS,
+                       &response, END_IN_ARGS);
+        return res<0 ? res : response;
+    }
+
+    std::vector<uint32_t> m_seqs;
+    uint32_t m_bad;
+    uint32_t m_prints;
+
+protected:
+    virtual void handleData(void *args[])
+    {
+        uint32_t n;
+
+        if (args[0]==NULL)
+            return;
+        if (getType(args[0])==CRP_HSTRING)
+        {
+            m_prints++;
+            return;
+        }
+        for (n=0; args[n]; n++);
+        if (getType(args[0])!=CRP_TYPE_HINT || *(uint32_t *)args[0]!=FOURCC('C','C','B','1') || n<8)
+        {
+            m_bad++;
+            return;
+        }
+        m_seqs.push_back(*(uint32_t *)args[6]);
+        if (!frameOk((uint16_t *)args[5], *(uint32_t *)args[4]*sizeof(uint16_t)/sizeof(pixy_block), m_seqs.back()))
+            m_bad++;
+    }
+};
+
+struct Frames
+{
+    Frames()
+    {
+        bad = 0;
+    }
+
+    std::vector<uint32_t> seqs;
+    uint32_t bad;
+};
+
+static void handleFrame(void *context, const pixy_frame *frame)
+{
+    Frames *frames = (Frames *)context;
+
+    frames->seqs.push_back(frame->sequence);
+    if (frame->width!=320 || frame->height!=200 || !frameOk((const uint16_t *)frame->blocks, frame->numBlocks, frame->sequence))
+        frames->bad++;
+}
+
+// strictly increasing, each a multiple of decimation
+static bool inOrder(const std::vector<uint32_t> &seqs, uint32_t decimation)
+{
+    uint32_t i;
+
+    for (i=0; i<seqs.size(); i++)
+    {
+        if (seqs[i]%decimation || (i && seqs[i]<=seqs[i-1]))
+            return false;
+    }
+    return true;
+}
+
+static void testCalls()
+{
+    Caller one(1000, 300), two(2000000, 300);
+
+    one.start();
+    two.start();
+    one.wait();
+    two.wait();
+    CHECK(one.m_bad==0 && two.m_bad==0, "calls from two clients at once: %u and %u bad responses", one.m_bad, two.m_bad);
+}
+
+static void testStreams()
+{
+    pixy_host *host;
+    Frames frames, played;
+    Subscriber sub;
+    HostElapsedTimer timer;
+    int res;
+
+    CHECK((res=pixy_host_open_mux(&host, "/tmp/muxtest-nothing"))==PIXY_HOST_ERROR_MUX_OPEN,
+          "opening a socket nobody's serving returned %d", res);
+    if ((res=pixy_host_open_mux(&host, MUX_PATH))<0)
+    {
+        CHECK(false, "pixy_host_open_mux() returned %d", res);
+        return;
+    }
+    pixy_host_set_handler(host, handleFrame, &frames);
+    CHECK((res=pixy_host_record(host, RECORDING_FILE))==0, "pixy_host_record() returned %d", res);
+    CHECK((res=pixy_host_subscribe(host, PIXY_STREAM_CCB1, 1))==0, "pixy_host_subscribe() returned %d", res);
+    CHECK(sub.open(MUX_PATH)>=0 && sub.subscribe(STREAM_CCB1, 3)==0, "subscriber");
+
+    timer.start();
+    while ((frames.seqs.size()<200 || sub.m_prints==0) && timer.elapsed()<WAIT_MS)
+    {
+        if ((res=pixy_host_service(host))<0 || (res=sub.service(false))<0)
+            break;
+    }
+    CHECK(res>=0, "service() returned %d", res);
+    CHECK(frames.seqs.size()>=200 && frames.bad==0 && inOrder(frames.seqs, 1),
+          "libpixyhost: %u frames, %u bad or out of order", (uint32_t)frames.seqs.size(), frames.bad);
+    CHECK(sub.m_seqs.size()>=200/3/2 && sub.m_bad==0 && inOrder(sub.m_seqs, 3),
+          "decimation 3: %u frames, %u bad, or not every third", (uint32_t)sub.m_seqs.size(), sub.m_bad);
+    CHECK(sub.m_prints>0, "no prints");
+
+    // the recording has what the handler got
+    pixy_host_subscribe(host, 0, 0);
+    pixy_host_record(host, NULL);
+    pixy_host_close(host);
+    CHECK((res=pixy_host_play(RECORDING_FILE, handleFrame, &played))==(int)frames.seqs.size() &&
+          played.seqs==frames.seqs && played.bad==0, "recording through pixymux: %d frames, %u handled", res,
+          (uint32_t)frames.seqs.size());
+    remove(RECORDING_FILE);
+}
+
+static void testProgram()
+{
+    pixy_host *host;
+    uint32_t i, echoes, adds;
+    int res;
+
+    if ((res=pixy_host_open_mux(&host, MUX_PATH))<0)
+    {
+        CHECK(false, "pixy_host_open_mux() returned %d", res);
+        return;
+    }
+
+    // one call too many, libpixyhost makes them, and doesn't try to upload them again
+    for (i=0; i<PIXY_PROG_CALLS+1; i++)
+        CHECK((res=pixy_host_program_add(host, "echo 5"))==0, "pixy_host_program_add() returned %d", res);
+    echoes = g_pixy->m_echoes;
+    CHECK((res=pixy_host_service(host))>=0, "service() returned %d", res);
+    CHECK(g_pixy->m_echoes==echoes+PIXY_PROG_CALLS+1, "%u of %u calls made after Pixy turned the program away",
+          g_pixy->m_echoes-echoes, PIXY_PROG_CALLS+1);
+    CHECK(g_pixy->m_progCalls==0 && !g_pixy->m_progRunning, "part of the program left on Pixy");
+    adds = g_pixy->m_adds;
+    CHECK((res=pixy_host_service(host))>=0 && g_pixy->m_echoes==echoes+2*(PIXY_PROG_CALLS+1) && g_pixy->m_adds==adds,
+          "second service(): returned %d, uploaded %u calls again", res, g_pixy->m_adds-adds);
+
+    // one that fits is left to Pixy
+    pixy_host_program_clear(host);
+    for (i=0; i<PIXY_PROG_CALLS; i++)
+        pixy_host_program_add(host, "echo 5");
+    echoes = g_pixy->m_echoes;
+    CHECK((res=pixy_host_service(host))>=0, "service() returned %d", res);
+    CHECK(g_pixy->m_progRunning && g_pixy->m_progCalls==PIXY_PROG_CALLS && g_pixy->m_echoes==echoes,
+          "program that fits: running %d, %u calls uploaded, %u made by libpixyhost", g_pixy->m_progRunning,
+          g_pixy->m_progCalls, g_pixy->m_echoes-echoes);
+    pixy_host_close(host);
+}
+
+static void testGone()
+{
+    static const uint8_t half[20] = {0};
+
+    // one that goes away halfway through a chirp, one that never says anything, one that goes
+    // away while it's subscribed
+    {
+        SocketLink link;
+        CHECK(link.open(MUX_PATH)==0 && link.send(half, sizeof(half), 100)==sizeof(half), "can't connect");
+    }
+    {
+        SocketLink link;
+        link.open(MUX_PATH);
+    }
+    {
+        Subscriber sub;
+        CHECK(sub.open(MUX_PATH)>=0 && sub.subscribe(STREAM_CCB1, 1)==0, "subscriber");
+    }
+    testCalls();
+}
+
+static void benchmark()
+{
+    static const uint32_t clients[] = {1, 4};
+    std::vector<Caller *> callers;
+    HostElapsedTimer timer;
+    pixy_host *host;
+    Frames frames;
+    uint32_t i, j, calls=2000;
+    int64_t ms;
+
+    for (i=0; i<sizeof(clients)/sizeof(clients[0]); i++)
+    {
+        for (j=0; j<clients[i]; j++)
+            callers.push_back(new Caller(j*calls, calls/clients[i]));
+        timer.start();
+        for (j=0; j<clients[i]; j++)
+            callers[j]->start();
+        for (j=0; j<clients[i]; j++)
+        {
+            callers[j]->wait();
+            delete callers[j];
+        }
+        callers.clear();
+        ms = timer.elapsed();
+        printf("%u clients: %7.0f calls/s\n", clients[i], calls*1000.0/(ms>0 ? ms : 1));
+    }
+
+    // 10000 frames/s offered, what isn't taken is dropped for lack of credits
+    g_pixy->m_period = 100;
+    g_pixy->m_drops = 0;
+    if (pixy_host_open_mux(&host, MUX_PATH)<0)
+        return;
+    pixy_host_set_handler(host, handleFrame, &frames);
+    pixy_host_subscribe(host, PIXY_STREAM_CCB1, 1);
+    timer.start();
+    while (timer.elapsed()<2000 && pixy_host_service(host)>=0);
+    ms = timer.elapsed();
+    pixy_host_subscribe(host, 0, 0);
+    pixy_host_close(host);
+    printf("streamed: %7.0f of 10000 frames/s through the ring to libpixyhost, Pixy dropped %u\n",
+           frames.seqs.size()*1000.0/ms, g_pixy->m_drops);
+}
+
+int main(int argc, char *argv[])
+{
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)<0)
+    {
+        printf("FAIL can't make a socketpair\n");
+        return 1;
+    }
+    Pixy pixy(fds[1]);
+    PolledLink link(fds[0]);
+    Server server;
+
+    pixy.start();
+    if (server.m_server.open(MUX_PATH, &link)<0)
+    {
+        printf("FAIL can't serve Pixy on %s\n", MUX_PATH);
+        pixy.stop();
+        return 1;
+    }
+    server.start();
+
+    testCalls();
+    testStreams();
+    testProgram();
+    testGone();
+    CHECK(pixy.m_acks>0, "pixymux never returned Pixy's credits");
+    if (g_fails==0 && argc>1 && strcmp(argv[1], "-b")==0)
+        benchmark();
+
+    // run() only returns early if it lost Pixy
+    server.m_server.stop();
+    server.wait();
+    CHECK(server.m_res==0, "run() returned %d", server.m_res);
+    pixy.stop();
+
+    if (g_fails)
+    {
+        printf("%d FAILED\n", g_fails);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
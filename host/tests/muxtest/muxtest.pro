@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+# muxtest, pixymux with a Pixy on the other end of a socketpair,
+# MuxClients and libpixyhost sharing it, muxtest -b times calls
+# and frames through it
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = muxtest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp \
+    ../../pixymux/muxserver.cpp
+
+HEADERS += ../../pixymux/muxserver.h \
+    ../../pixymux/muxclient.h \
+    ../../pixymux/socketlink.h \
+    ../../libpixyhost/pixyhost.h \
+    ../../pixymon/hostsync.h \
+    ../../../common/chirp.hpp
+
+INCLUDEPATH += ../../pixymux ../../libpixyhost ../../pixymon ../../../common
+
+LIBS += -L../../libpixyhost -lpixyhost
+PRE_TARGETDEPS += ../../libpixyhost/libpixyhost.a
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+    LIBS += -L/opt/local/lib -lusb-1.0
+    INCLUDEPATH += /opt/local/include/libusb-1.0
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    LIBS += -lusb-1.0 -lrt -lpthread
+    INCLUDEPATH += /usr/include/libusb-1.0
+}
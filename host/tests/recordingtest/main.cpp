@@ -0,0 +1,355 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test for RecordingWriter and RecordingReader.  Records of frame data are written and read back
+// from the closed recording, and from copies cut off at every byte, the way a recording is left
+// when the host crashes or the cable's pulled (no index, header never rewritten).  Every record
+// that made it in whole has to come back as it went in, and the partly written one is left off.
+// Records whose len runs past the file and args that run past their record's len (array lengths,
+// strings without their null) have to be turned away, not read from whatever follows.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "recording.h"
+#include "chirp.hpp"
+#include "pixytypes.h"
+
+#define RECORDING_FILE  "recordingtest.pxrc"
+#define CRASHED_FILE    "recordingtest-crashed.pxrc"
+#define NUM_RECORDS     24
+
+static int g_fails = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            g_fails++; \
+        } \
+    } while (0)
+
+struct Record
+{
+    uint64_t timestamp;
+    uint32_t fourcc;
+    std::vector<uint8_t> data;
+    uint64_t end; // file offset of the end of its data
+};
+
+static std::vector<Record> g_records;
+
+// CCB1 frames with 0 to 7 blocks, and a print every so often
+static int writeRecording(const char *filename)
+{
+    RecordingWriter writer;
+    Record record;
+    uint16_t blocks[7*5];
+    uint32_t aligned[0x100/4];
+    uint8_t *buf=(uint8_t *)aligned;
+    uint64_t offset = sizeof(RecordingHeader);
+    uint32_t i, j, n;
+    int len;
+
+    g_records.clear();
+    if (writer.open(filename)<0)
+        return -1;
+    for (i=0; i<NUM_RECORDS; i++)
+    {
+        n = i%8;
+        for (j=0; j<n*5; j++)
+            blocks[j] = i*100 + j;
+        if (i%5==4)
+            len = Chirp::serialize(NULL, buf, sizeof(aligned), HSTRING("frame\n"), END);
+        else
+            len = Chirp::serialize(NULL, buf, sizeof(aligned), HTYPE(FOURCC('C','C','B','1')), HINT8(RENDER_FLAG_FLUSH),
+                                   UINT16(320), UINT16(200), UINTS16(n*5, blocks), END);
+        if (len<0)
+            return -1;
+        record.timestamp = i*20000;
+        record.fourcc = i%5==4 ? 0 : FOURCC('C','C','B','1');
+        record.data.assign(buf, buf+len);
+        record.end = offset + sizeof(RecordHeader) + len;
+        offset = (record.end+RECORDING_ALIGN-1)&~(uint64_t)(RECORDING_ALIGN-1);
+        if (writer.write(record.timestamp, CRP_XDATA, record.fourcc, buf, len)<0)
+            return -1;
+        g_records.push_back(record);
+    }
+    return writer.close();
+}
+
+static bool readFile(const char *filename, std::vector<uint8_t> *bytes)
+{
+    FILE *file;
+    long size;
+
+    if ((file=fopen(filename, "rb"))==NULL)
+        return false;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bytes->resize(size);
+    if (size>0 && fread(&(*bytes)[0], 1, size, file)!=(size_t)size)
+        size = -1;
+    fclose(file);
+    return size>=0;
+}
+
+static bool writeFile(const char *filename, const uint8_t *data, uint32_t len)
+{
+    FILE *file;
+    bool res;
+
+    if ((file=fopen(filename, "wb"))==NULL)
+        return false;
+    res = len==0 || fwrite(data, 1, len, file)==len;
+    return fclose(file)==0 && res;
+}
+
+// the first count records have to be what was written, args and all
+static int checkRecords(RecordingReader *reader, uint32_t count, const char *what, uint32_t cut)
+{
+    const RecordHeader *header;
+    void *args[CRP_MAX_ARGS+1];
+    uint8_t *data;
+    uint32_t i, j;
+
+    if (reader->records()!=count)
+    {
+        printf("FAIL %s at %u: %u records, should be %u\n", what, cut, reader->records(), count);
+        return 1;
+    }
+    for (i=0; i<count; i++)
+    {
+        const Record &record = g_records[i];
+
+        if ((header=reader->record(i, &data))==NULL || header->timestamp!=record.timestamp || header->fourcc!=record.fourcc ||
+                header->len!=record.data.size() || memcmp(data, &record.data[0], header->len)!=0)
+        {
+            printf("FAIL %s at %u: record %u isn't what was written\n", what, cut, i);
+            return 1;
+        }
+        if (reader->args(i, args)==NULL)
+        {
+            printf("FAIL %s at %u: record %u's args don't parse\n", what, cut, i);
+            return 1;
+        }
+        if (record.fourcc==0)
+        {
+            if (Chirp::getType(args[0])!=CRP_HSTRING || strcmp((char *)args[0], "frame\n")!=0 || args[1]!=NULL)
+            {
+                printf("FAIL %s at %u: record %u's print is wrong\n", what, cut, i);
+                return 1;
+            }
+            continue;
+        }
+        for (j=0; args[j]; j++);
+        if (j!=6 || *(uint32_t *)args[0]!=record.fourcc || *(uint16_t *)args[2]!=320 || *(uint32_t *)args[4]!=i%8*5)
+        {
+            printf("FAIL %s at %u: record %u's args are wrong\n", what, cut, i);
+            return 1;
+        }
+        for (j=0; j<i%8*5; j++)
+        {
+            if (((uint16_t *)args[5])[j]!=i*100+j)
+            {
+                printf("FAIL %s at %u: record %u's blocks are wrong\n", what, cut, i);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void testClosed()
+{
+    RecordingReader reader;
+    const RecordHeader *header;
+    uint8_t *data;
+    int res;
+
+    CHECK((res=reader.open(RECORDING_FILE))==0, "open() returned %d", res);
+    g_fails += checkRecords(&reader, NUM_RECORDS, "closed", 0);
+    CHECK(reader.record(NUM_RECORDS, &data)==NULL, "record past the end");
+    CHECK((header=reader.record(NUM_RECORDS-1, &data))!=NULL && header->len==g_records.back().data.size(), "last record");
+    reader.close();
+    CHECK(reader.records()==0, "%u records after close()", reader.records());
+}
+
+// cut off at every byte, with the header the writer started with
+static void testCrashed()
+{
+    std::vector<uint8_t> bytes;
+    RecordingHeader *header;
+    uint32_t cut, count, fails=0;
+    int res;
+
+    if (!readFile(RECORDING_FILE, &bytes))
+    {
+        CHECK(false, "can't read %s", RECORDING_FILE);
+        return;
+    }
+    header = (RecordingHeader *)&bytes[0];
+    header->indexOffset = 0;
+    header->numRecords = 0;
+    for (cut=0; cut<=bytes.size() && fails==0; cut++)
+    {
+        RecordingReader reader;
+
+        if (!writeFile(CRASHED_FILE, &bytes[0], cut))
+        {
+            CHECK(false, "can't write %s", CRASHED_FILE);
+            return;
+        }
+        res = reader.open(CRASHED_FILE);
+        if (cut<sizeof(RecordingHeader))
+        {
+            if (res!=RECORDING_ERROR_FORMAT)
+            {
+                printf("FAIL cut at %u: open() returned %d, should be %d\n", cut, res, RECORDING_ERROR_FORMAT);
+                fails++;
+            }
+            continue;
+        }
+        if (res!=0)
+        {
+            printf("FAIL cut at %u: open() returned %d\n", cut, res);
+            fails++;
+            continue;
+        }
+        // the index is past the last record's padding, the scan doesn't take it for a record
+        for (count=0; count<NUM_RECORDS && g_records[count].end<=cut; count++);
+        fails += checkRecords(&reader, count, "cut", cut);
+    }
+    g_fails += fails;
+}
+
+// closed, but the index is cut off or points somewhere it can't be
+static void testBadIndex()
+{
+    std::vector<uint8_t> bytes;
+    RecordingHeader *header;
+    RecordingReader reader;
+    uint64_t indexOffset;
+
+    if (!readFile(RECORDING_FILE, &bytes))
+    {
+        CHECK(false, "can't read %s", RECORDING_FILE);
+        return;
+    }
+    header = (RecordingHeader *)&bytes[0];
+    indexOffset = header->indexOffset;
+
+    // the records are scanned, and end where the index starts
+    CHECK(writeFile(CRASHED_FILE, &bytes[0], bytes.size()-4) && reader.open(CRASHED_FILE)==0, "index cut off");
+    g_fails += checkRecords(&reader, NUM_RECORDS, "index cut off", bytes.size()-4);
+
+    header->indexOffset = ~(uint64_t)0 - 4;
+    CHECK(writeFile(CRASHED_FILE, &bytes[0], bytes.size()) && reader.open(CRASHED_FILE)==0, "index offset past the end");
+    g_fails += checkRecords(&reader, NUM_RECORDS, "index offset past the end", 0);
+
+    header->indexOffset = indexOffset;
+    header->numRecords = 0x40000000;
+    CHECK(writeFile(CRASHED_FILE, &bytes[0], bytes.size()) && reader.open(CRASHED_FILE)==0, "too many records");
+    g_fails += checkRecords(&reader, NUM_RECORDS, "too many records", 0);
+    reader.close();
+}
+
+// records and args that run past where they should end
+static void testBounds()
+{
+    RecordingWriter writer;
+    RecordingReader reader;
+    std::vector<uint8_t> bytes;
+    void *args[CRP_MAX_ARGS+1];
+    uint16_t blocks[5*5] = {0};
+    uint32_t i, *len, aligned[0x100/4];
+    uint8_t *buf=(uint8_t *)aligned, *data;
+    int n;
+
+    // a print without its null, the file's padding after it is zeros; a CCB1 frame with 5
+    // blocks, saying it has 6 (the next record follows); and one that's fine
+    CHECK(writer.open(RECORDING_FILE)==0, "open() for writing");
+    n = Chirp::serialize(NULL, buf, sizeof(aligned), HSTRING("no null"), END);
+    CHECK(n>0 && writer.write(0, CRP_XDATA, 0, buf, n-1)==0, "print");
+    n = Chirp::serialize(NULL, buf, sizeof(aligned), HTYPE(FOURCC('C','C','B','1')), HINT8(RENDER_FLAG_FLUSH),
+                         UINT16(320), UINT16(200), UINTS16(5*5, blocks), END);
+    CHECK(n>0 && Chirp::deserializeParse(buf, n, args)==CRP_RES_OK, "CCB1");
+    len = (uint32_t *)args[4];
+    *len += 5;
+    CHECK(writer.write(1, CRP_XDATA, FOURCC('C','C','B','1'), buf, n)==0, "CCB1 that says it's longer");
+    *len -= 5;
+    CHECK(writer.write(2, CRP_XDATA, FOURCC('C','C','B','1'), buf, n)==0, "CCB1");
+    // one with 1 byte of its 4 byte scalar
+    n = Chirp::serialize(NULL, buf, sizeof(aligned), HTYPE(FOURCC('C','C','B','1')), END);
+    CHECK(n>0 && writer.write(3, CRP_XDATA, FOURCC('C','C','B','1'), buf, n-3)==0, "cut scalar");
+    CHECK(writer.close()==0, "close()");
+
+    CHECK(reader.open(RECORDING_FILE)==0 && reader.records()==4, "%u records", reader.records());
+    CHECK(reader.record(0, &data)!=NULL && reader.args(0, args)==NULL, "print without its null parsed");
+    CHECK(reader.record(1, &data)!=NULL && reader.args(1, args)==NULL, "array past the record parsed");
+    CHECK(reader.args(2, args)!=NULL && *(uint32_t *)args[4]==5*5, "CCB1 that's fine didn't parse");
+    CHECK(reader.record(3, &data)!=NULL && reader.args(3, args)==NULL, "cut scalar parsed");
+    reader.close();
+
+    // a record whose len runs past the end of the file isn't handed out
+    CHECK(readFile(RECORDING_FILE, &bytes), "can't read %s", RECORDING_FILE);
+    ((RecordHeader *)&bytes[sizeof(RecordingHeader)])->len = bytes.size();
+    CHECK(writeFile(CRASHED_FILE, &bytes[0], bytes.size()) && reader.open(CRASHED_FILE)==0, "len past the end");
+    CHECK(reader.records()==4 && reader.record(0, &data)==NULL && reader.args(0, args)==NULL &&
+          reader.record(2, &data)!=NULL, "record with a len past the end of the file was handed out");
+    reader.close();
+
+    // and without the index, the scan stops there
+    ((RecordingHeader *)&bytes[0])->indexOffset = 0;
+    CHECK(writeFile(CRASHED_FILE, &bytes[0], bytes.size()) && reader.open(CRASHED_FILE)==0, "len past the end, no index");
+    CHECK(reader.records()==0, "%u records scanned past a len that runs off the end", reader.records());
+    reader.close();
+
+    // and garbage in the args is turned away, whatever it is, without reading past them (ASan)
+    for (n=1; n<0x100; n++)
+    {
+        for (i=0; i<sizeof(aligned); i++)
+            buf[i] = i*n + (n>>4);
+        std::vector<uint8_t> garbage(buf, buf+n);
+        Chirp::deserializeParse(&garbage[0], n, args);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (writeRecording(RECORDING_FILE)<0)
+    {
+        printf("FAIL can't write %s\n", RECORDING_FILE);
+        return 1;
+    }
+    testClosed();
+    testCrashed();
+    testBadIndex();
+    testBounds();
+    remove(RECORDING_FILE);
+    remove(CRASHED_FILE);
+
+    if (g_fails)
+    {
+        printf("%d FAILED\n", g_fails);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
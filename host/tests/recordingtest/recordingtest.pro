@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# recordingtest, RecordingWriter to RecordingReader, closed,
+# cut off as if the host crashed, and with records and args
+# that don't fit
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = recordingtest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp \
+    ../../pixymon/recording.cpp \
+    ../../../common/chirp.cpp
+
+HEADERS += ../../pixymon/recording.h \
+    ../../../common/chirp.hpp
+
+INCLUDEPATH += ../../pixymon ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+}
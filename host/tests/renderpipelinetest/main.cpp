@@ -0,0 +1,249 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test for RenderPipeline.  Frames are put in every PUT_US, and the renderer takes 4 times as
+// long with each one, the way the camera outruns a busy GUI.  Every frame has to be rendered or
+// counted in drops(), the ones that are rendered in the order they were put in, the newest one
+// last, each with the mode and halfRes it was put in with and its pixels untouched.  The frames
+// are in pooled buffers or copied, and when the pipeline is gone every buffer has to be back in
+// the pool, without the pool having allocated more than the pipeline can hold at once.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "renderpipeline.h"
+#include "bufferpool.h"
+#include "chirp.hpp"
+
+#define WIDTH           64
+#define HEIGHT          40
+#define OFFSET          16 // where the frame is in the buffer, after the rest of the chirp
+#define FRAMES          200
+#define PUT_US          500 // 4 frames put in for every one the renderer gets through
+#define RENDER_US       2000
+#define WAIT_MS         5000
+// frames in the queues, one in each stage and the one being put
+#define MAX_BUFFERS     (2*RP_QUEUE_DEPTH + 3)
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL line %d: ", __LINE__); printf(__VA_ARGS__); printf("\n"); g_fails++; } } while (0)
+
+static int g_fails;
+static uint32_t g_seed;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+// what each frame is put in with, changed from frame to frame like the GUI thread might
+static uint32_t frameMode(uint32_t seq)
+{
+    return seq%4;
+}
+
+static bool frameHalfRes(uint32_t seq)
+{
+    return (seq/3)&1;
+}
+
+// the frame's number, then a pattern that depends on it
+static void fillFrame(uint8_t *pixels, uint32_t seq)
+{
+    uint32_t i;
+
+    memcpy(pixels, &seq, sizeof(seq));
+    for (i=sizeof(seq); i<WIDTH*HEIGHT; i++)
+        pixels[i] = seq*7 + i*13;
+}
+
+// chirp needs a link for its buffer, this one goes nowhere
+class NullLink : public Link
+{
+public:
+    NullLink()
+    {
+        m_flags = LINK_FLAG_ERROR_CORRECTED;
+        m_blockSize = 64;
+    }
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        return LINK_RESULT_ERROR_SEND_TIMEOUT;
+    }
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        return LINK_RESULT_ERROR_RECV_TIMEOUT;
+    }
+    virtual void setTimer()
+    {
+    }
+    virtual uint32_t getTimer()
+    {
+        return 0;
+    }
+};
+
+class SlowRenderer : public PipelineRenderer
+{
+public:
+    SlowRenderer(uint32_t renderUs)
+    {
+        m_renderUs = renderUs;
+        m_fails = 0;
+    }
+
+    virtual void composeCMV1(PipelineFrame *frame)
+    {
+        uint32_t i, seq;
+        bool ok;
+
+        memcpy(&seq, frame->m_frame.m_pixels, sizeof(seq));
+        ok = frame->m_frame.m_width==WIDTH && frame->m_frame.m_height==HEIGHT;
+        for (i=sizeof(seq); ok && i<WIDTH*HEIGHT; i++)
+            ok = frame->m_frame.m_pixels[i]==(uint8_t)(seq*7 + i*13);
+        ok = ok && frame->m_mode==frameMode(seq) && frame->m_halfRes==frameHalfRes(seq);
+
+        m_mutex.lock();
+        if (!ok)
+        {
+            // on this thread, so just count it
+            if (m_fails++==0)
+                printf("FAIL frame %u rendered with mode %u, halfRes %d, or its pixels changed\n", seq, frame->m_mode, frame->m_halfRes);
+        }
+        m_rendered.push_back(seq);
+        m_mutex.unlock();
+
+        HostThread::usleep(m_renderUs);
+    }
+
+    uint32_t rendered()
+    {
+        uint32_t n;
+
+        m_mutex.lock();
+        n = m_rendered.size();
+        m_mutex.unlock();
+        return n;
+    }
+
+    std::vector<uint32_t> m_rendered;
+    uint32_t m_fails;
+
+private:
+    HostMutex m_mutex;
+    uint32_t m_renderUs;
+};
+
+// Puts frames in pooled buffers, or copied out of one that's scribbled on right after, and waits
+// for the pipeline to catch up if wait is set.  Otherwise the pipeline is deleted with frames in it.
+static void test(const char *what, bool pooled, bool wait)
+{
+    float cmodels[sizeof(ColorModel)*NUM_MODELS/sizeof(float)];
+    std::vector<uint8_t> copy(WIDTH*HEIGHT);
+    SlowRenderer renderer(RENDER_US);
+    BufferPool pool;
+    NullLink link;
+    Chirp chirp(false, false, &link);
+    PooledBuffer *buffer;
+    HostElapsedTimer timer;
+    uint32_t i, drops=0;
+
+    for (i=0; i<sizeof(cmodels)/sizeof(float); i++)
+        cmodels[i] = (float)(rnd()%1000)/100.0f;
+    {
+        RenderPipeline pipeline(&renderer);
+
+        for (i=0; i<FRAMES; i++)
+        {
+            if (pooled)
+            {
+                if ((buffer=pool.take(&chirp))==NULL)
+                {
+                    CHECK(false, "%s: take() returned NULL", what);
+                    return;
+                }
+                // what chirp does when a chirp doesn't fit
+                if (buffer->m_size<OFFSET+WIDTH*HEIGHT)
+                {
+                    delete [] buffer->m_buf;
+                    buffer->m_size = OFFSET+WIDTH*HEIGHT;
+                    buffer->m_buf = new uint8_t[buffer->m_size];
+                }
+                fillFrame(buffer->m_buf+OFFSET, i);
+                pipeline.put(i==0 ? cmodels : NULL, Frame8(buffer->m_buf+OFFSET, WIDTH, HEIGHT), buffer,
+                             frameMode(i), frameHalfRes(i));
+                buffer->release();
+            }
+            else
+            {
+                fillFrame(&copy[0], i);
+                pipeline.put(i==0 ? cmodels : NULL, Frame8(&copy[0], WIDTH, HEIGHT), NULL, frameMode(i), frameHalfRes(i));
+                memset(&copy[0], 0, copy.size());
+            }
+            HostThread::usleep(PUT_US);
+        }
+
+        if (wait)
+        {
+            timer.start();
+            while (renderer.rendered()+pipeline.drops()<FRAMES && timer.elapsed()<WAIT_MS)
+                HostThread::msleep(1);
+            drops = pipeline.drops();
+        }
+    }
+    // the render stage is done with renderer, and the frames still queued are gone
+
+    CHECK(renderer.m_fails==0, "%s: %u frames rendered wrong", what, renderer.m_fails);
+    for (i=1; i<renderer.m_rendered.size(); i++)
+        CHECK(renderer.m_rendered[i]>renderer.m_rendered[i-1], "%s: frame %u rendered after frame %u", what,
+              renderer.m_rendered[i], renderer.m_rendered[i-1]);
+    if (wait)
+    {
+        CHECK(renderer.m_rendered.size()+drops==FRAMES, "%s: %u frames rendered and %u dropped out of %u", what,
+              (uint32_t)renderer.m_rendered.size(), drops, FRAMES);
+        CHECK(drops>0, "%s: nothing dropped, the renderer isn't slow enough for a test", what);
+        CHECK(renderer.m_rendered.size() && renderer.m_rendered.back()==FRAMES-1, "%s: the last frame wasn't rendered", what);
+    }
+    else
+        CHECK(renderer.m_rendered.size()<FRAMES, "%s: everything was rendered before the pipeline was deleted", what);
+    if (pooled)
+    {
+        CHECK(pool.available()==pool.allocations(), "%s: %u of %u buffers back in the pool", what,
+              pool.available(), pool.allocations());
+        CHECK(pool.allocations()<=MAX_BUFFERS, "%s: %u buffers allocated, no more than %u are in use at once", what,
+              pool.allocations(), MAX_BUFFERS);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    g_seed = 7919;
+    test("pooled", true, true);
+    test("copied", false, true);
+    test("pooled, deleted while busy", true, false);
+    test("copied, deleted while busy", false, false);
+
+    if (g_fails)
+    {
+        printf("%d FAILED\n", g_fails);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+# renderpipelinetest, puts frames into RenderPipeline faster than a slow
+# renderer takes them, and checks what's dropped, rendered and released
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = renderpipelinetest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp \
+    ../../pixymon/renderpipeline.cpp \
+    ../../pixymon/bufferpool.cpp \
+    ../../pixymon/processblobs.cpp \
+    ../../../common/chirp.cpp \
+    ../../../common/blobs.cpp \
+    ../../../common/blob.cpp \
+    ../../../common/colorlut.cpp \
+    ../../../common/qqueue.cpp \
+    ../../../common/rls.cpp
+
+HEADERS += ../../pixymon/renderpipeline.h \
+    ../../pixymon/bufferpool.h \
+    ../../pixymon/processblobs.h \
+    ../../pixymon/hostsync.h \
+    ../../../common/chirp.hpp
+
+INCLUDEPATH += ../../pixymon ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    LIBS += -lpthread
+}
@@ -0,0 +1,280 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Regression test for RLS (common/rls.cpp).  RLS::processFrame() is compared, q val for q val,
+// against a plain transcription of lineProcessedRL1A/lineProcessedRL1AW in rls_m0.c that reads
+// one column at a time-- no line store tricks, no skipping stretches of columns.  The frames and
+// luts are generated from fixed seeds, so a failure is always reproducible.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "rls.h"
+
+#define LUT_SIZE        0x10000
+
+static uint32_t g_seed;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+// Straight transcription of lineProcessedRL1A.  The labels, registers and order of operations are
+// the assembly's, see rls_m0.c.
+class RefLine
+{
+public:
+    RefLine(const uint8_t *lut, const uint8_t *bgLine, const uint8_t *grLine, uint32_t width, bool wide) :
+        m_lut(lut), m_bgLine(bgLine), m_grLine(grLine), m_width(width), m_wide(wide)
+    {
+    }
+
+    void run(std::vector<Qval> *qvals)
+    {
+        uint32_t r6, r7=0, r8, r10=0, r11=0;
+
+        m_col = 0;
+    zero0:
+        r8 = 0;
+        if (m_col>=m_width)
+            goto eol;
+    zero1:
+        r7 = lext();
+        if (r7==0)
+            goto zero0;
+        r10 = m_col;
+        r8 += m_r1;
+        if (m_col>=m_width)
+            goto eol;
+        r6 = lext();
+        if (r6!=r7)
+            goto zero0;
+    one:
+        r11 = m_r1;
+        r8 += m_r1;
+        if (m_col>=m_width)
+            goto eol;
+        r6 = lext();
+        if (r6==r7)
+            goto one;
+        r8 += r11;
+        if (m_col>=m_width)
+            goto eol;
+        r6 = lext();
+        if (r6==r7)
+            goto one;
+        qvals->push_back(qval(r10, r7, r8));
+        r8 = 0;
+        m_col++;
+        goto zero1;
+    eol:
+        if (r8!=0)
+            qvals->push_back(qval(r10, r7, r8));
+    }
+
+private:
+    // LEXT: create index, look up, inc col, extract model.  Past the end of the line (horizontal
+    // blanking) the pixels are 0 and so is the line store.
+    uint32_t lext()
+    {
+        int g=0, r=0;
+        uint32_t index=0;
+
+        if (m_col<m_width)
+        {
+            index = ((m_bgLine[m_col*2] + m_bgLine[m_col*2+1] - 127)>>1)&0xff;
+            g = m_grLine[m_col*2];
+            r = m_grLine[m_col*2+1];
+        }
+        index |= (((r+g-127)>>1)&0xff)<<8;
+        m_r1 = m_lut[index];
+        m_col++;
+        return m_r1&0x07;
+    }
+
+    // QVAL, the shift lut is intLog()+3
+    Qval qval(uint32_t begin, uint32_t model, uint32_t sum)
+    {
+        uint32_t len, shift;
+
+        len = m_col - begin;
+        shift = 3;
+        if (m_wide)
+            return (begin<<3) | model | (len<<13) | ((sum>>shift)<<23) | (shift<<29);
+        return (begin<<3) | model | (len<<12) | ((sum>>shift)<<21) | (shift<<28);
+    }
+
+    const uint8_t *m_lut;
+    const uint8_t *m_bgLine;
+    const uint8_t *m_grLine;
+    uint32_t m_width;
+    bool m_wide;
+    uint32_t m_col;
+    uint32_t m_r1;
+};
+
+static void refFrame(const uint8_t *lut, const Frame8 &frame, std::vector<Qval> *qvals)
+{
+    uint32_t row, width;
+    bool wide;
+    const uint8_t *line;
+
+    width = frame.m_width/2;
+    wide = width>RLS_MAX_NARROW_WIDTH;
+    qvals->clear();
+    qvals->push_back(wide ? QVAL_FRAME_START_WIDE : QVAL_FRAME_START);
+    for (row=0, line=frame.m_pixels; row<(uint32_t)frame.m_height/2; row++, line+=frame.m_width*2)
+    {
+        qvals->push_back(0);
+        RefLine(lut, line, line+frame.m_width, width, wide).run(qvals);
+    }
+}
+
+// luts
+
+static void randomLut(uint8_t *lut, uint32_t onPercent)
+{
+    uint32_t i;
+
+    for (i=0; i<LUT_SIZE; i++)
+        lut[i] = rnd()%100<onPercent ? ((rnd()&0xf8) | (rnd()%7 + 1)) : 0;
+}
+
+// Large regions of the color space map to the same model, like a real color signature, so that
+// frames with smooth color have long run-lengths.
+static void blockLut(uint8_t *lut)
+{
+    uint32_t i, model;
+
+    for (i=0; i<LUT_SIZE; i++)
+    {
+        model = ((i>>13)*3 + ((i>>5)&7))%8;
+        lut[i] = model ? (((i*37)&0xf8) | model) : 0;
+    }
+}
+
+// frames
+
+static void noiseFrame(uint8_t *pixels, uint32_t size)
+{
+    uint32_t i;
+
+    for (i=0; i<size; i++)
+        pixels[i] = rnd();
+}
+
+// Rectangles of flat color, with some noise and an occasional outlier pixel-- long runs with
+// spurious pixels inside them, and runs that end at the end of the line.
+static void blockFrame(uint8_t *pixels, uint16_t width, uint16_t height)
+{
+    uint32_t x, y, n, color;
+    int32_t v;
+
+    memset(pixels, 0, width*height);
+    for (n=0; n<40; n++)
+    {
+        uint32_t x0 = rnd()%width, y0 = rnd()%height;
+        uint32_t w = rnd()%(width/2) + 1, h = rnd()%(height/2) + 1;
+        color = rnd();
+        for (y=y0; y<y0+h && y<height; y++)
+            for (x=x0; x<x0+w && x<width; x++)
+            {
+                v = ((color>>((x&1)*8 + (y&1)*16))&0xff) + (int32_t)(rnd()%5) - 2;
+                if (rnd()%64==0)
+                    v = rnd();
+                pixels[y*width+x] = v<0 ? 0 : v>255 ? 255 : v;
+            }
+    }
+}
+
+static int compare(const char *desc, const uint8_t *lut, const Frame8 &frame)
+{
+    std::vector<Qval> ref;
+    std::vector<Qval> qvals(RLS_MAX_QVALS_PER_LINE(frame.m_width/2)*frame.m_height + 2);
+    RLS rls(lut);
+    int32_t n;
+    uint32_t i;
+
+    refFrame(lut, frame, &ref);
+    n = rls.processFrame(frame, &qvals[0], qvals.size());
+    if (n!=(int32_t)ref.size())
+    {
+        printf("FAIL %s %dx%d: %d q vals, expected %d\n", desc, frame.m_width, frame.m_height, n, (int)ref.size());
+        return 1;
+    }
+    for (i=0; i<ref.size(); i++)
+    {
+        if (qvals[i]!=ref[i])
+        {
+            printf("FAIL %s %dx%d: q val %u is 0x%08x, expected 0x%08x\n", desc, frame.m_width, frame.m_height, i, qvals[i], ref[i]);
+            return 1;
+        }
+    }
+    printf("ok   %s %dx%d: %u q vals\n", desc, frame.m_width, frame.m_height, (uint32_t)ref.size());
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // widths in pixels: narrow (up to 320 columns) and wide (up to 640 columns), including widths
+    // that aren't a multiple of the 16 columns the SSE2 paths handle at a time
+    static const uint16_t widths[] = {16, 34, 200, 318, 640, 642, 1000, 1280};
+    std::vector<uint8_t> lut(LUT_SIZE);
+    std::vector<uint8_t> pixels;
+    uint32_t i, seed, fails=0, height=40;
+    Frame8 frame;
+
+    for (seed=1; seed<=4; seed++)
+    {
+        for (i=0; i<sizeof(widths)/sizeof(widths[0]); i++)
+        {
+            g_seed = seed*7919 + widths[i];
+            pixels.resize(widths[i]*height);
+            frame = Frame8(&pixels[0], widths[i], height);
+
+            randomLut(&lut[0], 50);
+            noiseFrame(&pixels[0], pixels.size());
+            fails += compare("noise/random lut", &lut[0], frame);
+
+            randomLut(&lut[0], 95);
+            noiseFrame(&pixels[0], pixels.size());
+            fails += compare("noise/dense lut", &lut[0], frame);
+
+            blockLut(&lut[0]);
+            blockFrame(&pixels[0], widths[i], height);
+            fails += compare("blocks/block lut", &lut[0], frame);
+
+            // every entry on, the same model-- runs span the whole line
+            memset(&lut[0], 0x0d, LUT_SIZE);
+            fails += compare("blocks/full lut", &lut[0], frame);
+
+            memset(&lut[0], 0, LUT_SIZE);
+            fails += compare("blocks/empty lut", &lut[0], frame);
+        }
+    }
+
+    if (fails)
+    {
+        printf("%u FAILED\n", fails);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
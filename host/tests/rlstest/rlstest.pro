@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# rlstest, checks RLS against a scalar transcription of lineProcessedRL1A
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = rlstest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+SOURCES += main.cpp \
+    ../../../common/rls.cpp
+
+HEADERS += ../../../common/rls.h \
+    ../../../common/qqueue.h \
+    ../../../common/pixytypes.h
+
+INCLUDEPATH += ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
@@ -0,0 +1,326 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test for StreamCredits, the device's credit and drop accounting for pushed streams
+// (device/video/stream.cpp).  Frames go through it the way blobsLoop and videoLoop push them,
+// to a host that acks late, stops acking, disconnects and stops reading.  Every frame that's
+// due has to come out as either sent or dropped, counted against its own stream, and the host
+// never has more than its credits' worth of frames it hasn't acked.  Pushes are sent by a Chirp
+// with a push timeout, over a link that can stop taking data, and mustn't disconnect it.
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "chirp.hpp"
+#include "pixytypes.h"
+#include "streamcredits.h"
+
+#define STREAM_INDEX_CCB1    0
+#define STREAM_INDEX_CCQ1    1
+#define STREAM_INDEX_BA81    2
+#define STREAM_SEND_TIMEOUT  5 // same as stream.cpp
+
+static int g_fails = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            g_fails++; \
+        } \
+    } while (0)
+
+// The USB link as the device sees it.  Sends fail with a timeout while the host isn't reading,
+// and each send's timeout is kept so we can see what the pushes used.  What the host sends is
+// fed to it beforehand, each receive takes exactly what it asks for.
+class HostLink : public Link
+{
+public:
+    HostLink()
+    {
+        m_reading = true;
+        m_flags = LINK_FLAG_ERROR_CORRECTED;
+        m_blockSize = 64; // USB's, 0 would be a disconnect in the init call
+    }
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        m_timeouts.push_back(timeoutMs);
+        if (!m_reading)
+            return LINK_RESULT_ERROR_SEND_TIMEOUT;
+        m_sent.insert(m_sent.end(), data, data+len);
+        return len;
+    }
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        if (m_received.size()<len)
+            return LINK_RESULT_ERROR_RECV_TIMEOUT;
+        std::copy(m_received.begin(), m_received.begin()+len, data);
+        m_received.erase(m_received.begin(), m_received.begin()+len);
+        return len;
+    }
+    virtual void setTimer()
+    {
+    }
+    virtual uint32_t getTimer()
+    {
+        return 0;
+    }
+
+    bool m_reading;
+    std::vector<uint8_t> m_sent;
+    std::deque<uint8_t> m_received;
+    std::vector<uint16_t> m_timeouts;
+};
+
+// Connect chirp the way the host does, with an init call.  The host's Chirp sends it to link's
+// receive queue, it doesn't get the response (it's left in link's sends), which doesn't matter.
+static bool connect(Chirp *chirp, HostLink *link)
+{
+    HostLink host;
+    int i;
+
+    {
+        Chirp client(false, true);
+        client.setLink(&host); // sends the init call, and retries it
+        link->m_received.insert(link->m_received.end(), host.m_sent.begin(), host.m_sent.end());
+    }
+    // the init call, and its retries if the client didn't hear back
+    for (i=0; i<8 && link->m_received.size(); i++)
+        chirp->service(false);
+    link->m_sent.clear();
+    link->m_timeouts.clear();
+    return chirp->connected();
+}
+
+// a connected Chirp on link
+class DeviceChirp : public Chirp
+{
+public:
+    DeviceChirp(HostLink *link) : Chirp(false, false, link)
+    {
+        CHECK(connect(this, link), "can't connect");
+    }
+};
+
+// what stream.cpp's push() does
+static int push(Chirp *chirp, StreamCredits *account, uint8_t index)
+{
+    uint16_t timeout;
+    int res;
+
+    ChirpWriter writer(chirp, CRP_XDATA);
+    writer << CrpHType(FOURCC('C','C','B','1')) << CrpHint<uint8_t>(RENDER_FLAG_FLUSH) << account->seq() <<
+              account->drops(index);
+    timeout = chirp->setPushTimeout(STREAM_SEND_TIMEOUT);
+    res = chirp->assemble(&writer);
+    chirp->setPushTimeout(timeout);
+    return account->sent(res, index);
+}
+
+// CCB1 pushed for frames frames.  The host acks everything it has received ackLag frames later
+// (never if ackLag<0), and checks it never has more than credits frames it hasn't acked.
+static void run(StreamCredits *account, Chirp *chirp, uint32_t frames, int ackLag, uint8_t credits,
+                bool connected=true)
+{
+    std::vector<uint32_t> received; // by the host, as of each frame
+    uint32_t i, acked=0;
+
+    for (i=0; i<frames; i++)
+    {
+        account->frame();
+        if (account->due(STREAM_CCB1, STREAM_INDEX_CCB1, connected))
+            push(chirp, account, STREAM_INDEX_CCB1);
+        received.push_back(account->sentFrames());
+        if (ackLag>=0 && (int)i>=ackLag)
+        {
+            acked = received[i-ackLag];
+            account->ack(acked);
+        }
+        if (ackLag>=0 && credits)
+            CHECK(account->sentFrames()-acked<=credits, "frame %u: %u frames not acked, %u credits", i,
+                  account->sentFrames()-acked, credits);
+    }
+}
+
+static void testNoLimit()
+{
+    StreamCredits account;
+    HostLink link;
+    DeviceChirp chirp(&link);
+
+    account.reset(STREAM_CCB1, 0, 0);
+    run(&account, &chirp, 100, -1, 0);
+    CHECK(account.sentFrames()==100 && account.drops(STREAM_INDEX_CCB1)==0,
+          "no limit: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+    CHECK(account.seq()==100, "seq %u", account.seq());
+}
+
+static void testDecimation()
+{
+    StreamCredits account;
+    HostLink link;
+    DeviceChirp chirp(&link);
+    uint32_t i, due=0;
+
+    account.reset(STREAM_CCB1, 3, 0);
+    for (i=1; i<=99; i++)
+    {
+        account.frame();
+        if (account.due(STREAM_CCB1, STREAM_INDEX_CCB1, true))
+        {
+            CHECK(i%3==0, "frame %u due with decimation 3", i);
+            due++;
+            push(&chirp, &account, STREAM_INDEX_CCB1);
+        }
+    }
+    CHECK(due==33 && account.sentFrames()==33 && account.drops(STREAM_INDEX_CCB1)==0,
+          "decimation 3: %u due, %u sent, %u dropped", due, account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+    // a stream we aren't subscribed to isn't due, and isn't a drop
+    CHECK(!account.due(STREAM_BA81, STREAM_INDEX_BA81, true) && account.drops(STREAM_INDEX_BA81)==0, "unsubscribed stream");
+}
+
+static void testCredits()
+{
+    StreamCredits account;
+    HostLink link;
+    DeviceChirp chirp(&link);
+
+    // host never acks, it gets its credits' worth and the rest are dropped
+    account.reset(STREAM_CCB1, 1, 4);
+    run(&account, &chirp, 100, -1, 4);
+    CHECK(account.sentFrames()==4 && account.drops(STREAM_INDEX_CCB1)==96,
+          "no acks: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+
+    // an ack returns the credits
+    account.ack(4);
+    run(&account, &chirp, 10, -1, 4);
+    CHECK(account.sentFrames()==8 && account.drops(STREAM_INDEX_CCB1)==102,
+          "after ack: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+
+    // host keeping up, nothing dropped
+    account.reset(STREAM_CCB1, 1, 4);
+    run(&account, &chirp, 100, 0, 4);
+    CHECK(account.sentFrames()==100 && account.drops(STREAM_INDEX_CCB1)==0,
+          "ack lag 0: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+
+    // host acks 6 frames late with 4 credits: it can't have more than 4 out, every frame is one or the other
+    account.reset(STREAM_CCB1, 1, 4);
+    run(&account, &chirp, 120, 6, 4);
+    CHECK(account.sentFrames()+account.drops(STREAM_INDEX_CCB1)==120 && account.sentFrames()>=4*120/7 &&
+          account.drops(STREAM_INDEX_CCB1)>0,
+          "ack lag 6: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+
+    // a host that acks more than it got doesn't look like it's run out
+    account.reset(STREAM_CCB1, 1, 4);
+    account.ack(10);
+    run(&account, &chirp, 10, -1, 0);
+    CHECK(account.sentFrames()==10 && account.drops(STREAM_INDEX_CCB1)==0,
+          "over-acked: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+}
+
+static void testNotReady()
+{
+    StreamCredits account;
+    HostLink link;
+    DeviceChirp chirp(&link);
+
+    // disconnected: dropped without sending, and no credits used
+    account.reset(STREAM_CCB1, 1, 4);
+    run(&account, &chirp, 10, -1, 4, false);
+    CHECK(account.sentFrames()==0 && account.drops(STREAM_INDEX_CCB1)==10 && link.m_timeouts.empty(),
+          "disconnected: %u sent, %u dropped, %u sends", account.sentFrames(), account.drops(STREAM_INDEX_CCB1),
+          (uint32_t)link.m_timeouts.size());
+    run(&account, &chirp, 4, -1, 4);
+    CHECK(account.sentFrames()==4, "reconnected: %u sent", account.sentFrames());
+}
+
+static void testHostNotReading()
+{
+    StreamCredits account;
+    HostLink link;
+    DeviceChirp chirp(&link);
+    uint32_t i;
+
+    // the sends fail (the host isn't taking data), each one is a drop and uses no credits
+    account.reset(STREAM_CCB1, 1, 4);
+    link.m_reading = false;
+    run(&account, &chirp, 10, -1, 4);
+    CHECK(account.sentFrames()==0 && account.drops(STREAM_INDEX_CCB1)==10,
+          "not reading: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+    // each was tried once with the push timeout, and we're still connected
+    CHECK(link.m_timeouts.size()==10, "%u sends for 10 pushes", (uint32_t)link.m_timeouts.size());
+    for (i=0; i<link.m_timeouts.size(); i++)
+        CHECK(link.m_timeouts[i]==STREAM_SEND_TIMEOUT, "push sent with timeout %u", link.m_timeouts[i]);
+    CHECK(chirp.connected(), "a push that failed disconnected us");
+    CHECK(chirp.setPushTimeout(0)==0, "push timeout not put back");
+
+    // host is back
+    link.m_reading = true;
+    run(&account, &chirp, 4, -1, 4);
+    CHECK(account.sentFrames()==4 && account.drops(STREAM_INDEX_CCB1)==10,
+          "reading again: %u sent, %u dropped", account.sentFrames(), account.drops(STREAM_INDEX_CCB1));
+}
+
+static void testStreams()
+{
+    StreamCredits account;
+    HostLink link;
+    DeviceChirp chirp(&link);
+    uint32_t i;
+
+    // CCQ1 and CCB1 share the credits, drops are counted per stream
+    account.reset(STREAM_CCB1 | STREAM_CCQ1, 1, 3);
+    for (i=0; i<5; i++)
+    {
+        account.frame();
+        if (account.due(STREAM_CCQ1, STREAM_INDEX_CCQ1, true))
+            push(&chirp, &account, STREAM_INDEX_CCQ1);
+        if (account.due(STREAM_CCB1, STREAM_INDEX_CCB1, true))
+            push(&chirp, &account, STREAM_INDEX_CCB1);
+    }
+    // q vals go first: CCQ1, CCB1, CCQ1, then out of credits
+    CHECK(account.sentFrames()==3 && account.drops(STREAM_INDEX_CCQ1)==3 && account.drops(STREAM_INDEX_CCB1)==4 &&
+          account.drops(STREAM_INDEX_BA81)==0, "two streams: %u sent, %u, %u, %u dropped", account.sentFrames(),
+          account.drops(STREAM_INDEX_CCB1), account.drops(STREAM_INDEX_CCQ1), account.drops(STREAM_INDEX_BA81));
+
+    // subscribing again starts over
+    account.reset(STREAM_BA81, 1, 0);
+    CHECK(account.seq()==0 && account.sentFrames()==0 && account.drops(STREAM_INDEX_CCB1)==0 &&
+          account.drops(STREAM_INDEX_CCQ1)==0 && !account.subscribed(STREAM_CCB1 | STREAM_CCQ1) &&
+          account.subscribed(STREAM_BA81), "reset");
+}
+
+int main(int argc, char *argv[])
+{
+    testNoLimit();
+    testDecimation();
+    testCredits();
+    testNotReady();
+    testHostNotReading();
+    testStreams();
+
+    if (g_fails)
+    {
+        printf("%d FAILED\n", g_fails);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
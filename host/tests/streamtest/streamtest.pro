@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# streamtest, the device's stream credit and drop accounting
+# (StreamCredits) with a host that acks late, stops acking
+# and stops reading
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = streamtest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp \
+    ../../../common/chirp.cpp
+
+HEADERS += ../../../common/streamcredits.h \
+    ../../../common/chirp.hpp \
+    ../../../common/link.h
+
+INCLUDEPATH += ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+}
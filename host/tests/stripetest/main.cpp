@@ -0,0 +1,356 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test and benchmark for StripeAssembler.  The same segments are assembled by a CBlobAssembler per
+// model (what Blobs::blobify() does) and by StripeAssembler with 2, 4 and 8 stripes, and the blob
+// lists must be the same.  The shapes include concave blobs and U shapes whose arms only meet
+// several seams below where they start, so the stripes have to be joined, or assembled again.
+//
+// stripetest -b also times serial assembly against 2, 4 and 8 stripes.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <QElapsedTimer>
+#include "stripeassembler.h"
+
+#define MAX_WIDTH    640
+#define MAX_HEIGHT   400
+
+static uint32_t g_seed;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+// model per pixel, 0 = none
+class Image
+{
+public:
+    Image(uint16_t width, uint16_t height) : m_width(width), m_height(height), m_pixels(width*height)
+    {
+    }
+
+    void set(int x, int y, uint8_t model)
+    {
+        if (x>=0 && x<m_width && y>=0 && y<m_height)
+            m_pixels[y*m_width + x] = model;
+    }
+
+    void rect(int x0, int y0, int x1, int y1, uint8_t model)
+    {
+        int x, y;
+        for (y=y0; y<=y1; y++)
+            for (x=x0; x<=x1; x++)
+                set(x, y, model);
+    }
+
+    // run-length segments in row order, like Blobs::unpack()
+    void segments(std::vector<SSegment> *segments) const
+    {
+        int x, y, start;
+        uint8_t model;
+        SSegment s;
+
+        segments->clear();
+        for (y=0; y<m_height; y++)
+        {
+            for (x=0; x<m_width; )
+            {
+                model = m_pixels[y*m_width + x];
+                for (start=x; x<m_width && m_pixels[y*m_width + x]==model; x++);
+                if (model==0)
+                    continue;
+                s.model = model;
+                s.row = y;
+                s.startCol = start;
+                s.endCol = x - 1;
+                segments->push_back(s);
+            }
+        }
+    }
+
+    uint16_t m_width;
+    uint16_t m_height;
+    std::vector<uint8_t> m_pixels;
+};
+
+// U shape: two arms joined at the bottom, open at the top
+static void uShape(Image *image, int x, int y, int w, int h, int t, uint8_t model)
+{
+    image->rect(x, y, x+t-1, y+h-1, model);
+    image->rect(x+w-t, y, x+w-1, y+h-1, model);
+    image->rect(x, y+h-t, x+w-1, y+h-1, model);
+}
+
+// upside-down U: the arms are joined at the top, so they are one blob from the start
+static void nShape(Image *image, int x, int y, int w, int h, int t, uint8_t model)
+{
+    image->rect(x, y, x+w-1, y+t-1, model);
+    image->rect(x, y, x+t-1, y+h-1, model);
+    image->rect(x+w-t, y, x+w-1, y+h-1, model);
+}
+
+// comb: several teeth that only meet at the bottom row
+static void comb(Image *image, int x, int y, int w, int h, int teeth, uint8_t model)
+{
+    int i;
+    for (i=0; i<teeth; i++)
+        image->rect(x + i*w/teeth, y, x + i*w/teeth + w/(2*teeth), y+h-1, model);
+    image->rect(x, y+h-2, x+w-1, y+h-1, model);
+}
+
+// spiral: concave, and the same blob crosses each seam several times
+static void spiral(Image *image, int x, int y, int size, int t, uint8_t model)
+{
+    int x0=x, y0=y, x1=x+size-1, y1=y+size-1;
+
+    while (x1-x0>2*t && y1-y0>2*t)
+    {
+        image->rect(x0, y0, x1, y0+t-1, model);      // top
+        image->rect(x1-t+1, y0, x1, y1, model);      // right
+        image->rect(x0, y1-t+1, x1, y1, model);      // bottom
+        image->rect(x0, y0+2*t, x0+t-1, y1, model);  // left, leaving a gap to the next turn
+        image->rect(x0, y0+2*t, x0+2*t, y0+3*t-1, model);
+        x0 += 2*t;
+        y0 += 2*t+t;
+        x1 -= 2*t;
+        y1 -= 2*t;
+    }
+}
+
+static void shapes(Image *image)
+{
+    int i, w=image->m_width, h=image->m_height;
+
+    for (i=0; i<6; i++)
+    {
+        uint8_t model = rnd()%NUM_MODELS + 1;
+        int x = rnd()%w, y = rnd()%(h/2);
+        switch (rnd()%4)
+        {
+        case 0:
+            uShape(image, x, y, rnd()%(w/2) + 8, rnd()%(h-y) + 4, rnd()%4 + 1, model);
+            break;
+        case 1:
+            nShape(image, x, y, rnd()%(w/2) + 8, rnd()%(h-y) + 4, rnd()%4 + 1, model);
+            break;
+        case 2:
+            comb(image, x, y, rnd()%(w/2) + 16, rnd()%(h-y) + 4, rnd()%6 + 2, model);
+            break;
+        default:
+            spiral(image, x, y, rnd()%(h/2) + 16, rnd()%3 + 1, model);
+            break;
+        }
+    }
+}
+
+static void noise(Image *image, uint32_t percent)
+{
+    uint32_t i;
+    for (i=0; i<image->m_pixels.size(); i++)
+        image->m_pixels[i] = rnd()%100<percent ? rnd()%NUM_MODELS + 1 : 0;
+}
+
+// Blobs with diagonal stripes-- lots of segments that touch more than one segment above
+static void diagonals(Image *image)
+{
+    int x, y;
+    for (y=0; y<image->m_height; y++)
+        for (x=0; x<image->m_width; x++)
+            image->set(x, y, ((x+y)/5)%3==0 || rnd()%20==0 ? (x/50)%NUM_MODELS + 1 : 0);
+}
+
+struct BlobDesc
+{
+    bool operator<(const BlobDesc &b) const
+    {
+        return memcmp(this, &b, sizeof(BlobDesc))<0;
+    }
+    bool operator==(const BlobDesc &b) const
+    {
+        return memcmp(this, &b, sizeof(BlobDesc))==0;
+    }
+
+    int model;
+    int area;
+    short left, top, right, bottom;
+};
+
+// take the blobs from the assemblers, sorted
+static void collect(CBlobAssembler *assemblers, std::vector<BlobDesc> *blobs)
+{
+    uint32_t m;
+    CBlob *blob;
+    BlobDesc desc;
+
+    blobs->clear();
+    memset(&desc, 0, sizeof(desc));
+    for (m=0; m<NUM_MODELS; m++)
+    {
+        for (blob=assemblers[m].finishedBlobs; blob; blob=blob->next)
+        {
+            desc.model = m;
+            desc.area = blob->moments.area;
+            blob->getBBox(desc.left, desc.top, desc.right, desc.bottom);
+            blobs->push_back(desc);
+        }
+        assemblers[m].Reset();
+    }
+    std::sort(blobs->begin(), blobs->end());
+}
+
+static void reset(CBlobAssembler *assemblers)
+{
+    uint32_t m;
+    for (m=0; m<NUM_MODELS; m++)
+        assemblers[m].Reset();
+}
+
+static void serial(const std::vector<SSegment> &segments, CBlobAssembler *assemblers)
+{
+    uint32_t i;
+
+    for (i=0; i<segments.size(); i++)
+        assemblers[segments[i].model-1].Add(segments[i]);
+    for (i=0; i<NUM_MODELS; i++)
+        assemblers[i].EndFrame();
+}
+
+static int compare(const char *desc, const Image &image, StripeAssembler **stripes)
+{
+    static const uint32_t numStripes[] = {2, 4, 8};
+    std::vector<SSegment> segments;
+    std::vector<BlobDesc> ref, blobs;
+    CBlobAssembler assemblers[NUM_MODELS];
+    uint32_t i;
+    int fails=0;
+
+    image.segments(&segments);
+    if (segments.size()==0)
+        return 0;
+    serial(segments, assemblers);
+    collect(assemblers, &ref);
+
+    for (i=0; i<sizeof(numStripes)/sizeof(numStripes[0]); i++)
+    {
+        stripes[i]->assemble(&segments[0], segments.size(), assemblers);
+        collect(assemblers, &blobs);
+        if (!(blobs==ref))
+        {
+            printf("FAIL %s %dx%d, %u stripes: %u blobs, expected %u\n", desc, image.m_width, image.m_height,
+                   numStripes[i], (uint32_t)blobs.size(), (uint32_t)ref.size());
+            fails++;
+        }
+    }
+    return fails;
+}
+
+static void benchmark()
+{
+    static const uint32_t numStripes[] = {1, 2, 4, 8};
+    Image image(MAX_WIDTH, MAX_HEIGHT);
+    std::vector<SSegment> segments;
+    std::vector<BlobDesc> blobs;
+    CBlobAssembler assemblers[NUM_MODELS];
+    QElapsedTimer timer;
+    uint32_t i, j, iters=200;
+    qint64 serialNs, ns;
+
+    g_seed = 12345;
+    noise(&image, 2);
+    shapes(&image);
+    image.segments(&segments);
+    serial(segments, assemblers);
+    collect(assemblers, &blobs);
+
+    timer.start();
+    for (j=0; j<iters; j++)
+    {
+        serial(segments, assemblers);
+        reset(assemblers);
+    }
+    serialNs = timer.nsecsElapsed();
+    printf("%ux%u, %u segments, %u blobs\n", MAX_WIDTH, MAX_HEIGHT, (uint32_t)segments.size(), (uint32_t)blobs.size());
+    printf("serial:     %8.1f us/frame\n", serialNs/1000.0/iters);
+
+    for (i=0; i<sizeof(numStripes)/sizeof(numStripes[0]); i++)
+    {
+        StripeAssembler stripes(numStripes[i]);
+        timer.start();
+        for (j=0; j<iters; j++)
+        {
+            stripes.assemble(&segments[0], segments.size(), assemblers);
+            reset(assemblers);
+        }
+        ns = timer.nsecsElapsed();
+        printf("%u stripes:  %8.1f us/frame, %.2fx\n", numStripes[i], ns/1000.0/iters, (double)serialNs/ns);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint16_t sizes[][2] = {{64, 40}, {320, 200}, {333, 97}, {640, 400}};
+    StripeAssembler *stripes[3];
+    uint32_t i, seed;
+    int fails=0;
+
+    stripes[0] = new StripeAssembler(2);
+    stripes[1] = new StripeAssembler(4);
+    stripes[2] = new StripeAssembler(8);
+
+    for (seed=1; seed<=10; seed++)
+    {
+        for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+        {
+            Image image(sizes[i][0], sizes[i][1]);
+
+            g_seed = seed*7919 + i;
+            shapes(&image);
+            fails += compare("shapes", image, stripes);
+
+            noise(&image, 40);
+            fails += compare("noise", image, stripes);
+
+            noise(&image, 10);
+            shapes(&image);
+            fails += compare("shapes+noise", image, stripes);
+
+            image.m_pixels.assign(image.m_pixels.size(), 0);
+            diagonals(&image);
+            fails += compare("diagonals", image, stripes);
+        }
+    }
+
+    for (i=0; i<3; i++)
+        delete stripes[i];
+
+    if (fails)
+    {
+        printf("%d FAILED\n", fails);
+        return 1;
+    }
+    printf("all passed\n");
+
+    if (argc>1 && strcmp(argv[1], "-b")==0)
+        benchmark();
+    return 0;
+}
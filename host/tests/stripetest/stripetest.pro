@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# stripetest, checks StripeAssembler against serial blob assembly,
+# stripetest -b times 1, 2, 4 and 8 stripes
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = stripetest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    ../../pixymon/stripeassembler.cpp \
+    ../../../common/blob.cpp \
+    ../../../common/blobs.cpp \
+    ../../../common/colorlut.cpp \
+    ../../../common/qqueue.cpp
+
+HEADERS += ../../pixymon/stripeassembler.h \
+    ../../../common/blob.h \
+    ../../../common/blobs.h
+
+INCLUDEPATH += ../../pixymon ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+}
+
+win32 {
+    DEFINES += __WINDOWS__
+}
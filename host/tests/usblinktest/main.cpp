@@ -0,0 +1,350 @@
+//
+// begin license header
+//
+// This file is part of Pixy CMUcam5 or "Pixy" for short
+//
+// All Pixy source code is provided under the terms of the
+// GNU General Public License v2 (http://www.gnu.org/licenses/gpl-2.0.html).
+// Those wishing to use Pixy source code, software and/or
+// technologies under different licensing terms should contact us at
+// cmucam@cs.cmu.edu. Such licensing terms are available for
+// all portions of the Pixy codebase presented here.
+//
+// end license header
+//
+
+// Test for AsyncUSBLink, the USB link's queued reads, over LinkUSBBackend.  The device end is a
+// ScriptedLink that hands out exactly what the test gives it: short reads (each chunk completes a
+// read, like a short packet), nothing at all (timeouts) and failed transfers (error codes).
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "usbbackend.h"
+
+#define TIMEOUT_SLACK    100 // ms, how late a timeout can be
+
+static uint32_t g_seed = 1;
+
+static uint32_t rnd()
+{
+    // xorshift32
+    g_seed ^= g_seed<<13;
+    g_seed ^= g_seed>>17;
+    g_seed ^= g_seed<<5;
+    return g_seed;
+}
+
+static int g_fails = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("FAIL line %d: ", __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            g_fails++; \
+        } \
+    } while (0)
+
+// The device end.  What's pushed is received in chunks, a receive never goes past the end of a
+// chunk.  An error chunk is returned as the result of a receive.
+class ScriptedLink : public Link
+{
+public:
+    ScriptedLink()
+    {
+        m_sendResult = 0;
+        m_flags = LINK_FLAG_ERROR_CORRECTED;
+    }
+
+    void push(const uint8_t *data, uint32_t len)
+    {
+        m_mutex.lock();
+        m_chunks.push_back(Chunk(std::vector<uint8_t>(data, data+len), 0));
+        m_mutex.unlock();
+        m_pushed.wakeAll();
+    }
+    void pushError(int error)
+    {
+        m_mutex.lock();
+        m_chunks.push_back(Chunk(std::vector<uint8_t>(), error));
+        m_mutex.unlock();
+        m_pushed.wakeAll();
+    }
+    // 0 = sends succeed
+    void setSendResult(int res)
+    {
+        m_sendResult = res;
+    }
+    std::vector<uint8_t> sent()
+    {
+        return m_sent;
+    }
+
+    virtual int send(const uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        if (m_sendResult)
+            return m_sendResult;
+        m_sent.insert(m_sent.end(), data, data+len);
+        return len;
+    }
+
+    virtual int receive(uint8_t *data, uint32_t len, uint16_t timeoutMs)
+    {
+        uint32_t n;
+        int res;
+
+        m_mutex.lock();
+        if (m_chunks.empty() && timeoutMs)
+            m_pushed.wait(&m_mutex, timeoutMs);
+        if (m_chunks.empty())
+        {
+            m_mutex.unlock();
+            return timeoutMs ? LINK_RESULT_ERROR_RECV_TIMEOUT : 0;
+        }
+        Chunk &chunk = m_chunks.front();
+        if (chunk.second)
+        {
+            res = chunk.second;
+            m_chunks.pop_front();
+            m_mutex.unlock();
+            return res;
+        }
+        n = chunk.first.size()<len ? chunk.first.size() : len;
+        memcpy(data, &chunk.first[0], n);
+        chunk.first.erase(chunk.first.begin(), chunk.first.begin()+n);
+        if (chunk.first.empty())
+            m_chunks.pop_front();
+        m_mutex.unlock();
+        return n;
+    }
+
+    virtual void setTimer()
+    {
+    }
+    virtual uint32_t getTimer()
+    {
+        return 0;
+    }
+
+private:
+    typedef std::pair<std::vector<uint8_t>, int> Chunk;
+
+    std::deque<Chunk> m_chunks;
+    std::vector<uint8_t> m_sent;
+    int m_sendResult;
+    HostMutex m_mutex;
+    HostWaitCondition m_pushed;
+};
+
+static void randomData(std::vector<uint8_t> *data, uint32_t len)
+{
+    uint32_t i;
+
+    data->resize(len);
+    for (i=0; i<len; i++)
+        (*data)[i] = rnd();
+}
+
+// push data in chunks of 1 to maxChunk bytes
+static void pushChunks(ScriptedLink *device, const std::vector<uint8_t> &data, uint32_t maxChunk)
+{
+    uint32_t i, n;
+
+    for (i=0; i<data.size(); i+=n)
+    {
+        n = rnd()%maxChunk + 1;
+        if (n>data.size()-i)
+            n = data.size()-i;
+        device->push(&data[i], n);
+    }
+}
+
+// receive len bytes, in receives of 1 to maxRecv bytes
+static bool receiveAll(AsyncUSBLink *link, std::vector<uint8_t> *data, uint32_t len, uint32_t maxRecv)
+{
+    uint32_t i, n;
+    int res;
+
+    data->resize(len);
+    for (i=0; i<len; i+=res)
+    {
+        n = rnd()%maxRecv + 1;
+        if (n>len-i)
+            n = len-i;
+        res = link->receive(&(*data)[i], n, 200);
+        if (res<=0)
+        {
+            printf("receive returned %d after %u of %u bytes\n", res, i, len);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testShortReads()
+{
+    static const uint32_t packetSizes[] = {64, 512};
+    std::vector<uint8_t> data, received;
+    uint32_t i;
+
+    // chunks smaller and larger than a packet, so reads complete short, full and split
+    for (i=0; i<sizeof(packetSizes)/sizeof(packetSizes[0]); i++)
+    {
+        ScriptedLink device;
+        AsyncUSBLink link;
+
+        CHECK(link.start(new LinkUSBBackend(&device), packetSizes[i])==0, "start");
+        randomData(&data, 200000);
+        pushChunks(&device, data, 1200);
+        CHECK(receiveAll(&link, &received, data.size(), 3000), "short reads, packet size %u", packetSizes[i]);
+        CHECK(received==data, "short reads, packet size %u: data differs", packetSizes[i]);
+        link.stop();
+    }
+}
+
+// more than the ring holds arrives before anything is received, so reads are held
+static void testRingFull()
+{
+    ScriptedLink device;
+    AsyncUSBLink link;
+    std::vector<uint8_t> data, received;
+    uint32_t i;
+
+    CHECK(link.start(new LinkUSBBackend(&device))==0, "start");
+    randomData(&data, USB_RING_SIZE + USB_RING_SIZE/2);
+    pushChunks(&device, data, 512);
+    // let the event thread fill the ring
+    for (i=0; i<50; i++)
+        HostThread::msleep(10);
+    CHECK(receiveAll(&link, &received, data.size(), 0x10000), "ring full");
+    CHECK(received==data, "ring full: data differs");
+}
+
+static void testTimeouts()
+{
+    ScriptedLink device;
+    AsyncUSBLink link;
+    HostElapsedTimer timer;
+    uint8_t buf[64], data[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    int64_t ms;
+    int res, i;
+
+    CHECK(link.start(new LinkUSBBackend(&device))==0, "start");
+
+    // nothing arrives
+    timer.start();
+    res = link.receive(buf, sizeof(buf), 50);
+    ms = timer.elapsed();
+    CHECK(res==LINK_RESULT_ERROR_RECV_TIMEOUT, "nothing: receive returned %d", res);
+    CHECK(ms>=45 && ms<50+TIMEOUT_SLACK, "nothing: timed out after %d ms", (int)ms);
+
+    // less than asked for arrives, we get it when the link has been idle for the timeout
+    device.push(data, sizeof(data));
+    timer.start();
+    res = link.receive(buf, sizeof(buf), 50);
+    ms = timer.elapsed();
+    CHECK(res==(int)sizeof(data) && memcmp(buf, data, sizeof(data))==0, "partial: receive returned %d", res);
+    CHECK(ms>=45 && ms<50+TIMEOUT_SLACK, "partial: timed out after %d ms", (int)ms);
+
+    // the timeout is for idle time, it starts over each time something arrives
+    class Trickle : public HostThread
+    {
+    public:
+        Trickle(ScriptedLink *device, const uint8_t *data) : m_device(device), m_data(data) {}
+    protected:
+        virtual void run()
+        {
+            int i;
+            for (i=0; i<5; i++)
+            {
+                HostThread::msleep(30);
+                m_device->push(m_data+i*2, 2);
+            }
+        }
+    private:
+        ScriptedLink *m_device;
+        const uint8_t *m_data;
+    } trickle(&device, data);
+    trickle.start();
+    res = link.receive(buf, sizeof(data), 80);
+    trickle.wait();
+    CHECK(res==(int)sizeof(data) && memcmp(buf, data, sizeof(data))==0, "trickle: receive returned %d", res);
+
+    // a timeout of 0 is the default, not forever
+    timer.start();
+    res = link.receive(buf, sizeof(buf), 0);
+    ms = timer.elapsed();
+    CHECK(res==LINK_RESULT_ERROR_RECV_TIMEOUT && ms<50+TIMEOUT_SLACK, "0 timeout: returned %d after %d ms", res, (int)ms);
+
+    // and the link still works
+    for (i=0; i<3; i++)
+    {
+        device.push(data, sizeof(data));
+        res = link.receive(buf, sizeof(data), 200);
+        CHECK(res==(int)sizeof(data) && memcmp(buf, data, sizeof(data))==0, "after timeouts: receive returned %d", res);
+    }
+}
+
+static void testErrors()
+{
+    ScriptedLink device;
+    AsyncUSBLink link;
+    std::vector<uint8_t> data, received;
+    uint8_t buf[64];
+    int res;
+
+    CHECK(link.start(new LinkUSBBackend(&device))==0, "start");
+
+    // data that came in before a read failed is received first, then the error, which sticks.
+    // What comes in after the failed read is dropped.
+    randomData(&data, 3000);
+    pushChunks(&device, data, 700);
+    device.pushError(LINK_RESULT_ERROR);
+    device.push(&data[0], 100);
+    CHECK(receiveAll(&link, &received, data.size(), 1000), "error: data before the error");
+    CHECK(received==data, "error: data differs");
+    res = link.receive(buf, sizeof(buf), 200);
+    CHECK(res==LINK_RESULT_ERROR, "error: receive returned %d", res);
+    res = link.receive(buf, sizeof(buf), 200);
+    CHECK(res==LINK_RESULT_ERROR, "error again: receive returned %d", res);
+
+    // a receive that gets some data and then the error returns the data
+    CHECK(link.start(new LinkUSBBackend(&device))==0, "restart");
+    device.push(&data[0], 100);
+    CHECK(link.receive(buf, 50, 200)==50, "restart: receive");
+    HostThread::msleep(50); // the other 50 bytes are in
+    device.pushError(LINK_RESULT_ERROR);
+    res = link.receive(buf, sizeof(buf), 200);
+    CHECK(res==50, "data then error: receive returned %d", res);
+    res = link.receive(buf, sizeof(buf), 200);
+    CHECK(res==LINK_RESULT_ERROR, "data then error: then receive returned %d", res);
+
+    // sends go straight to the backend, errors included
+    CHECK(link.start(new LinkUSBBackend(&device))==0, "restart");
+    CHECK(link.send(buf, 10, 100)==10 && device.sent().size()==10, "send");
+    device.setSendResult(LINK_RESULT_ERROR_SEND_TIMEOUT);
+    res = link.send(buf, 10, 100);
+    CHECK(res==LINK_RESULT_ERROR_SEND_TIMEOUT, "send error: send returned %d", res);
+    link.stop();
+    CHECK(link.send(buf, 10, 100)==LINK_RESULT_ERROR, "send after stop");
+}
+
+int main(int argc, char *argv[])
+{
+    testShortReads();
+    testRingFull();
+    testTimeouts();
+    testErrors();
+
+    if (g_fails)
+    {
+        printf("%d FAILED\n", g_fails);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# usblinktest, AsyncUSBLink over LinkUSBBackend with short reads,
+# timeouts and failed transfers
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = usblinktest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle qt
+
+DEFINES += PIXY_HOST_NO_QT
+
+SOURCES += main.cpp \
+    ../../pixymon/usbbackend.cpp
+
+HEADERS += ../../pixymon/usbbackend.h \
+    ../../pixymon/hostsync.h \
+    ../../../common/link.h
+
+INCLUDEPATH += ../../pixymon ../../../common
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter
+
+macx {
+    DEFINES += __MACOS__
+}
+
+unix:!macx {
+    DEFINES += __LINUX__
+    LIBS += -lpthread
+}